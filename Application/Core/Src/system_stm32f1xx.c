@@ -164,6 +164,9 @@ const uint8_t APBPrescTable[8U] =  {0, 0, 0, 0, 1, 2, 3, 4};
   * @{
   */
 
+/* Vector table of startup_stm32f103c8tx.s, its address follows BL_APP_BASE in memory_layout.ld */
+extern uint32_t g_pfnVectors[];
+
 /**
   * @brief  Setup the microcontroller system
   *         Initialize the Embedded Flash Interface, the PLL and update the 
@@ -184,7 +187,7 @@ void SystemInit (void)
 //#if defined(USER_VECT_TAB_ADDRESS)
 //  SCB->VTOR = VECT_TAB_BASE_ADDRESS | VECT_TAB_OFFSET; /* Vector Table Relocation in Internal SRAM. */
 //#else
-  SCB->VTOR = FLASH_BASE | 0x8000; /* Vector Table Relocation in Internal FLASH. */
+  SCB->VTOR = (uint32_t)g_pfnVectors; /* Vector Table Relocation in Internal FLASH, placed at BL_APP_BASE by the linker script. */
 //#endif /* USER_VECT_TAB_ADDRESS */
 }
 
@@ -0,0 +1,50 @@
+/**
+ ******************************************************************************
+ * @file           : bl_ecdsa.h
+ * @author         : Ahmed Naeim
+ * @brief          : Contains declaration for the ECDSA P-256 signature check
+ *                   of the secure boot (FIPS 186-4, SHA-256 digests)
+ ******************************************************************************
+**/
+#ifndef INC_BOOTLOADER_BL_ECDSA_H_
+#define INC_BOOTLOADER_BL_ECDSA_H_
+
+/**********************************************Includes Start**********************************************/
+#include <stdint.h>
+/**********************************************Includes End**********************************************/
+
+/**********************************************Macro Declaration Start**********************************************/
+
+#define BL_ECDSA_PUBLIC_KEY_SIZE				64					/* X then Y, 32 bytes each, big endian */
+#define BL_ECDSA_SIGNATURE_SIZE					64					/* r then s, 32 bytes each, big endian */
+#define BL_ECDSA_DIGEST_SIZE					32
+
+/* Stack of one BL_ECDSA_P256_Verify call at most. make stack-budget adds up every frame of bl_ecdsa.c against it (more
+ * than the deepest call chain), bl_sim --bench-ecdsa measures the stack of the host build */
+#ifndef BL_ECDSA_STACK_BUDGET
+#define BL_ECDSA_STACK_BUDGET					1536
+#endif
+
+/**********************************************Macro Declaration End**********************************************/
+
+
+
+/**********************************************Data Types Declaration Start**********************************************/
+
+typedef enum{
+	BL_ECDSA_OK = 0,
+	BL_ECDSA_INVALID_KEY,						/* Not a point of the curve */
+	BL_ECDSA_INVALID_SIGNATURE					/* r or s out of [1, n - 1], or the check failed */
+}BL_ECDSA_Status;
+
+/**********************************************Data Types Declaration End**********************************************/
+
+
+/**********************************************Software Interfaces Declaration Start**********************************************/
+
+/* Public data only, the check does not run in constant time */
+BL_ECDSA_Status BL_ECDSA_P256_Verify(const uint8_t *Public_Key, const uint8_t *Digest, const uint8_t *Signature);
+
+/**********************************************Software Interfaces Declaration End**********************************************/
+
+#endif /* INC_BOOTLOADER_BL_ECDSA_H_ */
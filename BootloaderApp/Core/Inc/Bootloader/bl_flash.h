@@ -0,0 +1,88 @@
+/**
+ ******************************************************************************
+ * @file           : bl_flash.h
+ * @author         : Ahmed Naeim
+ * @brief          : Contains declaration for the flash geometry of the STM32F1
+ *                   part the bootloader runs on, read at boot from
+ *                   DBGMCU_IDCODE and the flash size register
+ ******************************************************************************
+**/
+#ifndef INC_BOOTLOADER_BL_FLASH_H_
+#define INC_BOOTLOADER_BL_FLASH_H_
+
+/**********************************************Includes Start**********************************************/
+#include <stdint.h>
+/**********************************************Includes End**********************************************/
+
+/**********************************************Macro Declaration Start**********************************************/
+
+/* DEV_ID field of DBGMCU_IDCODE (RM0008, 31.6.1) */
+#define BL_FLASH_DEV_ID_MASK					0x00000FFFUL
+#define BL_FLASH_DEV_ID_LOW_DENSITY				0x412
+#define BL_FLASH_DEV_ID_MEDIUM_DENSITY			0x410
+#define BL_FLASH_DEV_ID_HIGH_DENSITY			0x414
+#define BL_FLASH_DEV_ID_XL_DENSITY				0x430
+#define BL_FLASH_DEV_ID_CONNECTIVITY			0x418
+#define BL_FLASH_DEV_ID_VALUE_LINE				0x420				/* Low and medium density value line */
+#define BL_FLASH_DEV_ID_VALUE_LINE_HIGH			0x428
+
+/* Flash size register (F_SIZE), the flash size in KB. Erased (0xFFFF) on some early parts */
+#define BL_FLASH_SIZE_REGISTER					0x1FFFF7E0UL
+
+#define BL_FLASH_BASE_ADDRESS					0x08000000UL
+#define BL_FLASH_SMALL_PAGE_SIZE				1024				/* Low and medium density */
+#define BL_FLASH_LARGE_PAGE_SIZE				2048				/* High density, XL density and connectivity lines */
+#define BL_FLASH_SMALL_PAGE_MAX_SIZE			(128UL * 1024)		/* Largest part of the 1 KB page lines */
+#define BL_FLASH_BANK_1_MAX_SIZE				(512UL * 1024)		/* XL density: bank 1 is the first 512 KB, bank 2 the rest */
+#define BL_FLASH_MAX_SIZE						(1024UL * 1024)
+#define BL_FLASH_MAX_PAGE_COUNT					(BL_FLASH_MAX_SIZE / BL_FLASH_LARGE_PAGE_SIZE)
+
+/* Linked flash layout, set in memory_layout.ld and exported by the linker */
+extern const uint8_t BL_FLASH_END[];
+extern const uint8_t BL_FLASH_PAGE_SIZE[];
+extern const uint8_t BL_META_SIZE[];
+
+/**********************************************Macro Declaration End**********************************************/
+
+
+
+/**********************************************Macro Functions Start**********************************************/
+
+/* Absolute address of a page and page of an absolute address, for the page size of the part */
+#define BL_FLASH_PAGE_ADDRESS(Page_Number)		(BL_FLASH_BASE_ADDRESS + ((uint32_t)(Page_Number) * BL_Flash.Page_Size))
+#define BL_FLASH_PAGE_NUMBER(Address)			(((uint32_t)(Address) - BL_FLASH_BASE_ADDRESS) / BL_Flash.Page_Size)
+
+/**********************************************Macro Functions End**********************************************/
+
+
+
+/**********************************************Data Types Declaration Start**********************************************/
+
+typedef struct{
+	uint16_t Device_ID;								/* DEV_ID of DBGMCU_IDCODE */
+	uint16_t Page_Size;
+	uint32_t Flash_Size;							/* Bytes */
+	uint32_t Flash_End;								/* First address after the flash */
+	uint32_t Bank_1_End;							/* First address of bank 2 on XL density parts, Flash_End on the others */
+	uint16_t Page_Count;
+	uint8_t Layout_Valid;							/* memory_layout.ld fits the part, erase and write are refused otherwise */
+	uint8_t Reserved;
+}BL_Flash_Geometry;
+
+/**********************************************Data Types Declaration End**********************************************/
+
+
+/**********************************************Software Interfaces Declaration Start**********************************************/
+
+/* Filled by BL_Flash_Geometry_Init, read only afterwards */
+extern BL_Flash_Geometry BL_Flash;
+
+/* Reads the geometry of the part and checks the linked layout against it, call it before anything touches the flash */
+void BL_Flash_Geometry_Init(void);
+
+/* 1 when every byte of the range reads 0xFF, the range is a whole number of words */
+uint8_t BL_Flash_Is_Blank(uint32_t Address, uint32_t Length);
+
+/**********************************************Software Interfaces Declaration End**********************************************/
+
+#endif /* INC_BOOTLOADER_BL_FLASH_H_ */
@@ -0,0 +1,184 @@
+/**
+ ******************************************************************************
+ * @file           : bl_log.h
+ * @author         : Ahmed Naeim
+ * @brief          : Contains declaration for the tokenized bootloader logger
+ ******************************************************************************
+**/
+#ifndef INC_BOOTLOADER_BL_LOG_H_
+#define INC_BOOTLOADER_BL_LOG_H_
+
+/**********************************************Includes Start**********************************************/
+#include <stdint.h>
+#include "usart.h"
+/**********************************************Includes End**********************************************/
+
+/**********************************************Macro Declaration Start**********************************************/
+
+/*
+ * Log Record Format (little endian):
+ * Sync (1 byte = 0xA5) + Sequence (1 byte) + Log ID (1 byte) + Payload Length (1 byte = N) + Payload (N bytes)
+ * Token records carry N/4 uint32_t arguments, BL_LOG_ID_TEXT records carry N characters.
+ * The format strings live in BL_LOG_DICTIONARY of Host.py, keep both lists in sync.
+ * */
+
+#define BL_LOG_UART								&huart3
+#define BL_LOG_RING_SIZE						256					/* Power of two */
+#define BL_LOG_SYNC_BYTE						0xA5
+#define BL_LOG_HEADER_SIZE						4
+#define BL_LOG_MAX_ARGS							2
+#define BL_LOG_MAX_TEXT_LENGTH					64
+
+/* Log Levels, a record is kept when its level is lower than or equal to the level of its module */
+#define BL_LOG_LEVEL_NONE						0
+#define BL_LOG_LEVEL_ERROR						1
+#define BL_LOG_LEVEL_WARN						2
+#define BL_LOG_LEVEL_INFO						3
+#define BL_LOG_LEVEL_DEBUG						4
+
+/* Debug builds (-DDEBUG) log at INFO, release builds compile every record out */
+#ifndef BL_LOG_LEVEL_DEFAULT
+#ifdef DEBUG
+#define BL_LOG_LEVEL_DEFAULT					BL_LOG_LEVEL_INFO
+#else
+#define BL_LOG_LEVEL_DEFAULT					BL_LOG_LEVEL_NONE
+#endif
+#endif
+
+/* Module Levels, each one can be overridden from the build (-DBL_LOG_LEVEL_FLASH=BL_LOG_LEVEL_DEBUG) */
+#ifndef BL_LOG_LEVEL_SYS
+#define BL_LOG_LEVEL_SYS						BL_LOG_LEVEL_DEFAULT		/* Startup and jumps */
+#endif
+#ifndef BL_LOG_LEVEL_CMD
+#define BL_LOG_LEVEL_CMD						BL_LOG_LEVEL_DEFAULT		/* Command dispatch */
+#endif
+#ifndef BL_LOG_LEVEL_CRC
+#define BL_LOG_LEVEL_CRC						BL_LOG_LEVEL_DEFAULT		/* Frame CRC checks */
+#endif
+#ifndef BL_LOG_LEVEL_FLASH
+#define BL_LOG_LEVEL_FLASH						BL_LOG_LEVEL_DEFAULT		/* Erase and write */
+#endif
+#ifndef BL_LOG_LEVEL_OB
+#define BL_LOG_LEVEL_OB							BL_LOG_LEVEL_DEFAULT		/* Option bytes */
+#endif
+
+/* The ring and the DMA callback are only linked when some module logs */
+#if ((BL_LOG_LEVEL_SYS != BL_LOG_LEVEL_NONE) || (BL_LOG_LEVEL_CMD != BL_LOG_LEVEL_NONE) || \
+	 (BL_LOG_LEVEL_CRC != BL_LOG_LEVEL_NONE) || (BL_LOG_LEVEL_FLASH != BL_LOG_LEVEL_NONE) || \
+	 (BL_LOG_LEVEL_OB != BL_LOG_LEVEL_NONE))
+#define BL_LOG_ENABLE							1
+#else
+#define BL_LOG_ENABLE							0
+#endif
+
+#if (BL_LOG_ENABLE && defined(BL_PORT_LL))
+#error "The size profile has no debug UART (USART3), build it with every log level at BL_LOG_LEVEL_NONE"
+#endif
+
+/**********************************************Macro Declaration End**********************************************/
+
+
+
+/**********************************************Macro Functions Start**********************************************/
+
+/*
+ * Usage: BL_LOG_INFO(FLASH, BL_LOG_ID_PAGE_ERASE, Page_Number, Number_of_Pages)
+ * The level test is a constant expression, a disabled record and its arguments are removed by the compiler.
+ * */
+#define BL_LOG_ERROR(Module, ...)				BL_LOG_AT(BL_LOG_LEVEL_ERROR, BL_LOG_LEVEL_##Module, __VA_ARGS__)
+#define BL_LOG_WARN(Module, ...)				BL_LOG_AT(BL_LOG_LEVEL_WARN, BL_LOG_LEVEL_##Module, __VA_ARGS__)
+#define BL_LOG_INFO(Module, ...)				BL_LOG_AT(BL_LOG_LEVEL_INFO, BL_LOG_LEVEL_##Module, __VA_ARGS__)
+#define BL_LOG_DEBUG(Module, ...)				BL_LOG_AT(BL_LOG_LEVEL_DEBUG, BL_LOG_LEVEL_##Module, __VA_ARGS__)
+
+/* The module name is pasted before it is expanded, CRC and FLASH are also CMSIS peripheral macros */
+#define BL_LOG_AT(Level, Module_Level, ...)	do{ if((Level) <= (Module_Level)){ BL_LOG_WRITE(__VA_ARGS__); } }while(0)
+
+/* Counts the arguments after the log ID (0 to BL_LOG_MAX_ARGS) and pads the missing ones with 0 */
+#define BL_LOG_WRITE(...)						BL_LOG_WRITE_(BL_LOG_ARG_COUNT(__VA_ARGS__), __VA_ARGS__, 0, 0)
+#define BL_LOG_WRITE_(Count, Log_Id, Arg0, Arg1, ...)	BL_Log_Write((Log_Id), (Count), (uint32_t)(Arg0), (uint32_t)(Arg1))
+#define BL_LOG_ARG_COUNT(...)					BL_LOG_ARG_COUNT_(__VA_ARGS__, 2, 1, 0)
+#define BL_LOG_ARG_COUNT_(Log_Id, A0, A1, Count, ...)	Count
+
+/**********************************************Macro Functions End**********************************************/
+
+
+
+/**********************************************Data Types Declaration Start**********************************************/
+
+typedef enum{
+	BL_LOG_ID_TEXT = 0x00,						/* Free text from BL_Log_Text */
+	BL_LOG_ID_BOOTLOADER_STARTED = 0x01,
+	BL_LOG_ID_INVALID_COMMAND = 0x02,			/* Arg0: command code */
+	BL_LOG_ID_CRC_PASSED = 0x03,
+	BL_LOG_ID_CRC_FAILED = 0x04,
+	BL_LOG_ID_REPLY_REPEATED = 0x05,			/* Arg0: sequence of the request sent again */
+	BL_LOG_ID_FRAME_DROPPED = 0x06,				/* Arg0: decoded length of a COBS frame hit on the line, or a length byte under 5 */
+	BL_LOG_ID_FRAME_TIMEOUT = 0x07,				/* Arg0: length byte of the frame given up, bytes in of a COBS frame */
+	BL_LOG_ID_CMD_GET_VER = 0x10,
+	BL_LOG_ID_CMD_GET_HELP = 0x11,
+	BL_LOG_ID_CMD_GET_CID = 0x12,
+	BL_LOG_ID_CMD_GET_RDP_STATUS = 0x13,
+	BL_LOG_ID_CMD_GO_TO_ADDR = 0x14,
+	BL_LOG_ID_CMD_FLASH_ERASE = 0x15,
+	BL_LOG_ID_CMD_MEM_WRITE = 0x16,
+	BL_LOG_ID_CMD_MEM_READ = 0x18,
+	BL_LOG_ID_CMD_CHANGE_ROP_LEVEL = 0x21,
+	BL_LOG_ID_CMD_BATCH = 0x22,
+	BL_LOG_ID_CMD_GET_STATS = 0x23,
+	BL_LOG_ID_CMD_ALLOCATE_PAGES = 0x24,
+	BL_LOG_ID_CMD_LOAD_AND_EXEC = 0x25,
+	BL_LOG_ID_CMD_FLASH_IMAGE = 0x26,
+	BL_LOG_ID_CMD_RELIABLE = 0x27,
+	BL_LOG_ID_CMD_GET_CAPABILITIES = 0x28,
+	BL_LOG_ID_JUMP_ADDRESS_VALID = 0x30,
+	BL_LOG_ID_JUMP_TO_ADDRESS = 0x31,			/* Arg0: address */
+	BL_LOG_ID_STUB_CALL = 0x32,					/* Arg0: entry address, Arg1: first argument */
+	BL_LOG_ID_STUB_RETURNED = 0x33,				/* Arg0: stub result */
+	BL_LOG_ID_STUB_REFUSED = 0x34,
+	BL_LOG_ID_BOOT_WINDOW_CLOSED = 0x35,		/* Arg0: application base, started without a frame from the host */
+	BL_LOG_ID_SIGNATURE_CHECKED = 0x36,			/* Arg0: cycles of the image SHA-256, Arg1: cycles of the ECDSA check */
+	BL_LOG_ID_SIGNATURE_INVALID = 0x37,			/* Arg0: signed size, 0 without a trailer */
+	BL_LOG_ID_SIGNATURE_SLOW = 0x38,			/* Arg0: cycles of the check, Arg1: BL_SECURE_BOOT_CYCLE_BUDGET */
+	BL_LOG_ID_SECURE_BOOT_REFUSED = 0x39,		/* Arg0: command code, GO_TO_ADDR or LOAD_AND_EXEC under secure boot */
+	BL_LOG_ID_MASS_ERASE = 0x40,
+	BL_LOG_ID_PAGE_ERASE = 0x41,				/* Arg0: first page, Arg1: number of pages */
+	BL_LOG_ID_ERASE_PASSED = 0x42,
+	BL_LOG_ID_ERASE_FAILED = 0x43,				/* Arg0: failing page address */
+	BL_LOG_ID_PAGES_ALLOCATED = 0x44,			/* Arg0: first page, Arg1: highest erase count of the pages */
+	BL_LOG_ID_FLASH_GEOMETRY = 0x45,			/* Arg0: DEV_ID, Arg1: F_SIZE in KB */
+	BL_LOG_ID_FLASH_LAYOUT_MISMATCH = 0x46,		/* Arg0: linked flash end, Arg1: linked page size */
+	BL_LOG_ID_WRITE_POSTED = 0x47,				/* Arg0: address, Arg1: length */
+	BL_LOG_ID_POSTED_WRITE_FAILED = 0x48,		/* Arg0: command code that waited for it */
+	BL_LOG_ID_PAGE_BLANK = 0x49,				/* Arg0: page a write found blank, not erased */
+	BL_LOG_ID_WRITE_SKIPPED = 0x4A,				/* Arg0: address, Arg1: length of a skip record */
+	BL_LOG_ID_IMAGE_BEGIN = 0x4B,				/* Arg0: load address, Arg1: image size */
+	BL_LOG_ID_IMAGE_COMMITTED = 0x4C,			/* Arg0: version, Arg1: image CRC32 */
+	BL_LOG_ID_IMAGE_REFUSED = 0x4D,				/* Arg0: image status, Arg1: next image offset */
+	BL_LOG_ID_IMAGE_CHECKPOINT = 0x4E,			/* Arg0: next image offset, Arg1: written pages stored */
+	BL_LOG_ID_IMAGE_RESUMED = 0x4F,				/* Arg0: next image offset, Arg1: written pages */
+	BL_LOG_ID_WRITE_ADDRESS = 0x50,				/* Arg0: address, Arg1: payload length */
+	BL_LOG_ID_WRITE_PASSED = 0x51,
+	BL_LOG_ID_WRITE_FAILED = 0x52,
+	BL_LOG_ID_WRITE_CYCLES = 0x53,				/* Arg0: cycles per received byte, Arg1: cycles per programmed half-word */
+	BL_LOG_ID_READ_ADDRESS = 0x54,				/* Arg0: address, Arg1: length */
+	BL_LOG_ID_READ_REFUSED = 0x55,
+	BL_LOG_ID_IMAGE_DIGEST = 0x56,				/* Arg0: image bytes hashed, Arg1: cycles spent in the SHA-256 */
+	BL_LOG_ID_ERASE_PLAN_RESTARTED = 0x57,		/* Arg0: address, Arg1: length of a write over bytes the plan programmed */
+	BL_LOG_ID_OB_UNLOCK_FAILED = 0x60,
+	BL_LOG_ID_OB_UNLOCK_PASSED = 0x61,
+	BL_LOG_ID_OB_PROGRAM_FAILED = 0x62,
+	BL_LOG_ID_OB_PROGRAM_PASSED = 0x63,			/* Arg0: RDP level */
+	BL_LOG_ID_RING_OVERFLOW = 0x70				/* Arg0: number of dropped records */
+}BL_Log_Id;
+
+/**********************************************Data Types Declaration End**********************************************/
+
+
+/**********************************************Software Interfaces Declaration Start**********************************************/
+
+void BL_Log_Write(BL_Log_Id Log_Id, uint8_t Arg_Count, uint32_t Arg0, uint32_t Arg1);
+void BL_Log_Text(const char *Text, uint8_t Text_Len);
+
+/**********************************************Software Interfaces Declaration End**********************************************/
+
+#endif /* INC_BOOTLOADER_BL_LOG_H_ */
@@ -0,0 +1,72 @@
+/**
+ ******************************************************************************
+ * @file           : bl_meta.h
+ * @author         : Ahmed Naeim
+ * @brief          : Contains declaration for the bootloader metadata area,
+ *                   typed records kept in the last flash pages across resets
+ ******************************************************************************
+**/
+#ifndef INC_BOOTLOADER_BL_META_H_
+#define INC_BOOTLOADER_BL_META_H_
+
+/**********************************************Includes Start**********************************************/
+#include <stdint.h>
+#include "Bootloader/bl_port.h"
+#include "Bootloader/bl_flash.h"
+/**********************************************Includes End**********************************************/
+
+/**********************************************Macro Declaration Start**********************************************/
+
+/*
+ * Metadata Page Format:
+ * Page header (Magic (4 bytes) + Generation (4 bytes) + Complete (2 bytes) + Reserved (2 bytes))
+ * + Records, each one Type (2 bytes) + Length (2 bytes = N) + Payload (N bytes, padded to 4) + CRC32 of type, length and payload (4 bytes)
+ *
+ * A record is appended after the last one, the newest record of a type wins. When a page is full the newest record of
+ * every other type is copied to the other page, which becomes active once its Complete half-word is programmed to 0:
+ * a reset in the middle of the copy leaves the old page active.
+ * */
+
+/* One flash page of the part, BL_META_SIZE in memory_layout.ld is BL_META_PAGE_COUNT pages (checked by bl_flash.c) */
+#define BL_META_PAGE_SIZE						((uint32_t)BL_Flash.Page_Size)
+#define BL_META_PAGE_COUNT						2
+
+#define BL_META_MAGIC							0x4154454DUL		/* "META" */
+#define BL_META_PAGE_COMPLETE					0x0000
+#define BL_META_TYPE_ERASED						0xFFFF
+
+/* Record types */
+#define BL_META_TYPE_STATS						0x0001				/* BL_Stats_Record of bootloader.c */
+#define BL_META_TYPE_IMAGE						0x0002				/* BL_Image_Record of bootloader.c */
+
+/* Metadata base address, set in memory_layout.ld (BL_META_BASE) and exported by the linker */
+extern const uint8_t BL_META_BASE[];
+#define BL_META_BASE_ADDRESS					((uint32_t)BL_META_BASE)
+
+/**********************************************Macro Declaration End**********************************************/
+
+
+
+/**********************************************Data Types Declaration Start**********************************************/
+
+typedef enum{
+	BL_META_OK = 0,
+	BL_META_NOT_FOUND,
+	BL_META_ERROR								/* Flash erase or program failed, the record can't fit in a page or the layout does not fit the part */
+}BL_Meta_Status;
+
+/**********************************************Data Types Declaration End**********************************************/
+
+
+/**********************************************Software Interfaces Declaration Start**********************************************/
+
+/* Copies the newest record of Record_Type, a shorter record is padded with 0 (older layout of the same type) */
+BL_Meta_Status BL_Meta_Load(uint16_t Record_Type, void *Data, uint16_t Data_Len);
+BL_Meta_Status BL_Meta_Store(uint16_t Record_Type, const void *Data, uint16_t Data_Len);
+
+/* Generation of the active page, the number of metadata page erases so far */
+uint32_t BL_Meta_Generation(void);
+
+/**********************************************Software Interfaces Declaration End**********************************************/
+
+#endif /* INC_BOOTLOADER_BL_META_H_ */
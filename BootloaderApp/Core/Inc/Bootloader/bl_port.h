@@ -0,0 +1,124 @@
+/**
+ ******************************************************************************
+ * @file           : bl_port.h
+ * @author         : Ahmed Naeim
+ * @brief          : Contains declaration for the bootloader hardware port,
+ *                   implemented with LL / registers (bl_port_ll.c) and HAL
+ *                   (bl_port_hal.c)
+ ******************************************************************************
+**/
+#ifndef INC_BOOTLOADER_BL_PORT_H_
+#define INC_BOOTLOADER_BL_PORT_H_
+
+/**********************************************Includes Start**********************************************/
+#include <stdint.h>
+/**********************************************Includes End**********************************************/
+
+/**********************************************Macro Declaration Start**********************************************/
+
+/*
+ * Host UART, CRC, half-word programming and erase always run on bl_port_ll.c, option bytes and clocks use the
+ * HAL (bl_port_hal.c). The size profile (make PROFILE=size) defines BL_PORT_LL, links no HAL driver and replaces
+ * the CubeMX initialization (main.c, usart.c, crc.c, gpio.c, dma.c) with BL_Port_Init.
+ * BL_PORT_HAL_HOT_PATH puts the hot path back on HAL_UART_Receive / HAL_FLASH_Program, BL_PORT_CYCLE_PROFILE
+ * reports the DWT cycles per received byte and per programmed half-word, build both ways to compare.
+ * */
+
+#if (defined(BL_PORT_LL) && defined(BL_PORT_HAL_HOT_PATH))
+#error "BL_PORT_HAL_HOT_PATH needs the HAL, the size profile (BL_PORT_LL) has none"
+#endif
+
+/* The HAL hot path drives the bank 1 controller only, BL_Flash leaves bank 2 of an XL density part out in that build */
+#if defined(BL_PORT_HAL_HOT_PATH)
+#define BL_PORT_FLASH_DUAL_BANK					0
+#else
+#define BL_PORT_FLASH_DUAL_BANK					1
+#endif
+
+#define BL_PORT_RDP_LEVEL_0						0xA5				/* Same values as OB_RDP_LEVEL_x */
+#define BL_PORT_RDP_LEVEL_1						0x00
+
+/* Largest payload BL_Port_Flash_Post_Program takes, the port keeps its own copy while it programs */
+#define BL_PORT_POSTED_MAX_LENGTH				255
+
+#define BL_PORT_HOST_BAUD_RATE					115200
+#define BL_PORT_SYSCLK_FREQ						72000000U			/* HSE 8 MHz x 9, same clock tree as SystemClock_Config */
+
+/* Host link timeouts, override them from the build (-DBL_PORT_INTER_BYTE_TIMEOUT_MS=100). A frame is given up when
+ * the next byte does not come within the inter-byte timeout or the frame is not in within the frame timeout of its
+ * first byte. The LL port times them with the DWT cycle counter, which wraps after 59 s at 72 MHz */
+#ifndef BL_PORT_INTER_BYTE_TIMEOUT_MS
+#define BL_PORT_INTER_BYTE_TIMEOUT_MS			50
+#endif
+#ifndef BL_PORT_FRAME_TIMEOUT_MS
+#define BL_PORT_FRAME_TIMEOUT_MS				1000				/* A 258 byte frame takes 23 ms at 115200 baud */
+#endif
+#define BL_PORT_WAIT_FOREVER					0xFFFFFFFFUL		/* Same value as HAL_MAX_DELAY */
+
+#if ((BL_PORT_INTER_BYTE_TIMEOUT_MS > BL_PORT_FRAME_TIMEOUT_MS) || (BL_PORT_FRAME_TIMEOUT_MS >= 59000))
+#error "The inter-byte timeout can't be longer than the frame timeout, which has to stay below 59 s"
+#endif
+
+/* BL_Port_DeInit waits this long for the debug UART to send the log ring before it stops it, 256 bytes take 22 ms */
+#define BL_PORT_LOG_DRAIN_TIMEOUT_MS			50
+
+/**********************************************Macro Declaration End**********************************************/
+
+
+
+/**********************************************Data Types Declaration Start**********************************************/
+
+typedef enum{
+	BL_PORT_OK = 0,
+	BL_PORT_ERROR,
+	BL_PORT_LOCKED,								/* The flash or option byte controller refused the unlock keys */
+	BL_PORT_POSTED,								/* Programming started, BL_Port_Flash_Sync returns how it ended */
+	BL_PORT_TIMEOUT								/* The host did not send the first byte in time or stopped part way */
+}BL_Port_Status;
+
+/**********************************************Data Types Declaration End**********************************************/
+
+
+/**********************************************Software Interfaces Declaration Start**********************************************/
+
+/* Host link. The first byte is waited for up to Timeout_Ms (BL_PORT_WAIT_FOREVER: no limit), the next ones up to the
+ * inter-byte timeout and the frame timeout, else BL_PORT_TIMEOUT and what came in is left */
+BL_Port_Status BL_Port_Host_Receive(uint8_t *Data, uint16_t Data_Len, uint32_t Timeout_Ms);
+/* Up to the next Delimiter, which is not stored. BL_PORT_ERROR when more than Data_Max_Len bytes come before it,
+ * they are dropped up to the delimiter */
+BL_Port_Status BL_Port_Host_Receive_Until(uint8_t *Data, uint16_t Data_Max_Len, uint8_t Delimiter, uint16_t *Data_Len, uint32_t Timeout_Ms);
+void BL_Port_Host_Transmit(const uint8_t *Data, uint16_t Data_Len);
+
+/* CRC unit, each byte is fed as one 32 bit word the way Host.py computes the frame CRC */
+uint32_t BL_Port_CRC_Calculate(const uint8_t *Data, uint32_t Data_Len);
+
+/* Flash, the addresses are absolute and Data is programmed as little endian half-words */
+BL_Port_Status BL_Port_Flash_Erase_Pages(uint32_t Page_Address, uint16_t Number_of_Pages, uint32_t *Page_Error);
+BL_Port_Status BL_Port_Flash_Mass_Erase(void);
+BL_Port_Status BL_Port_Flash_Program(uint32_t Address, const uint8_t *Data, uint16_t Data_Len);
+
+/*
+ * Read while write: on a dual bank part (XL density) a payload for bank 2 is copied and programmed by the bank 2
+ * controller while the bootloader goes on from bank 1, the host receive loop feeds it the next half-word.
+ * Post_Program waits for the previous posted payload and returns its error without starting the new one, anything
+ * else (bank 1, SRAM, a single bank part) is programmed before it returns like BL_Port_Flash_Program.
+ * Sync waits for the posted payload and returns its status once, call it before any other flash access or read.
+ * */
+BL_Port_Status BL_Port_Flash_Post_Program(uint32_t Address, const uint8_t *Data, uint16_t Data_Len);
+BL_Port_Status BL_Port_Flash_Sync(void);
+
+/* Option bytes, a successful level change reloads the option bytes and resets the MCU */
+uint8_t BL_Port_Get_RDP_Level(void);
+BL_Port_Status BL_Port_Set_RDP_Level(uint8_t RDP_Level);
+
+/* Before any jump: stops the debug UART, its DMA and their interrupts once the log ring is out, and puts the clocks
+ * back in their reset state */
+void BL_Port_DeInit(void);
+
+#if defined(BL_PORT_LL)
+void BL_Port_Init(void);
+#endif
+
+/**********************************************Software Interfaces Declaration End**********************************************/
+
+#endif /* INC_BOOTLOADER_BL_PORT_H_ */
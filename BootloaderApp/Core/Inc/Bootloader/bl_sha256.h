@@ -0,0 +1,58 @@
+/**
+ ******************************************************************************
+ * @file           : bl_sha256.h
+ * @author         : Ahmed Naeim
+ * @brief          : Contains declaration for the streaming SHA-256 (FIPS 180-4)
+ *                   of the image transfer, fed frame by frame from the write
+ *                   path so the digest is ready with the last byte
+ ******************************************************************************
+**/
+#ifndef INC_BOOTLOADER_BL_SHA256_H_
+#define INC_BOOTLOADER_BL_SHA256_H_
+
+/**********************************************Includes Start**********************************************/
+#include <stdint.h>
+/**********************************************Includes End**********************************************/
+
+/**********************************************Macro Declaration Start**********************************************/
+
+#define BL_SHA256_BLOCK_SIZE					64
+#define BL_SHA256_DIGEST_SIZE					32
+
+/* 1: the block function runs 16 rounds per pass with the message schedule expanded in line, a few KB of code.
+ * 0: one round per loop pass, under 1 KB and about a third slower. The size profile takes the small one */
+#ifndef BL_SHA256_UNROLLED
+#if defined(BL_PORT_LL)
+#define BL_SHA256_UNROLLED						0
+#else
+#define BL_SHA256_UNROLLED						1
+#endif
+#endif
+
+/**********************************************Macro Declaration End**********************************************/
+
+
+
+/**********************************************Data Types Declaration Start**********************************************/
+
+typedef struct{
+	uint32_t State[8];
+	uint64_t Length;								/* Bytes hashed so far */
+	uint8_t Block[BL_SHA256_BLOCK_SIZE];			/* Bytes of a block not complete yet */
+	uint32_t Block_Len;
+}BL_SHA256_Context;
+
+/**********************************************Data Types Declaration End**********************************************/
+
+
+/**********************************************Software Interfaces Declaration Start**********************************************/
+
+void BL_SHA256_Init(BL_SHA256_Context *Context);
+/* Any length and alignment, whole blocks are hashed straight from Data */
+void BL_SHA256_Update(BL_SHA256_Context *Context, const uint8_t *Data, uint32_t Data_Len);
+/* Pads the message and writes the digest, the context has to be initialized again before the next message */
+void BL_SHA256_Final(BL_SHA256_Context *Context, uint8_t *Digest);
+
+/**********************************************Software Interfaces Declaration End**********************************************/
+
+#endif /* INC_BOOTLOADER_BL_SHA256_H_ */
@@ -9,29 +9,83 @@
 #define INC_BOOTLOADER_BOOTLOADER_H_
 
 /**********************************************Includes Start**********************************************/
-#include <stdio.h>
 #include <string.h>
-#include <stdarg.h>
 #include "usart.h"
 #include "crc.h"
+#include "Bootloader/bl_log.h"
+#include "Bootloader/bl_port.h"
+#include "Bootloader/bl_meta.h"
+#include "Bootloader/bl_flash.h"
+#include "Bootloader/bl_sha256.h"
+#include "Bootloader/bl_ecdsa.h"
 /**********************************************Includes End**********************************************/
 
 /**********************************************Macro Declaration Start**********************************************/
 
-#define BL_DEBUG_UART             		  	 	&huart2
 #define BL_HOST_COMMUNICATION_UART				&huart2
 #define CRC_ENGINE_OBJ							&hcrc
 
-#define BL_DEBUG_DISABLE						0
-#define BL_DEBUG_ENABLE							1
-#define BL_DEBUG_ENABLE							DEBUG_INFO_ENABLE
-
-#define BL_ENABLE_UART_DEBUG_MESSAGE			0x00
-#define BL_ENABLE_SPI_DEBUG_MESSAGE				0x01
-#define BL_ENABLE_CAN_DEBUG_MESSAGE				0x02
-#define BL_DEBUG_METHOD							(BL_ENABLE_UART_DEBUG_MESSAGE)
-
-#define BL_HOST_BUFFER_RX_LENGTH 				200
+#define BL_HOST_BUFFER_RX_LENGTH 				258					/* Length byte (max 255) + the bytes it announces + 2 COBS code bytes */
+
+/* Host framing: a frame starts with its length byte. A 0x00 first byte switches the link to COBS framing until the next
+ * reset, every frame is then COBS encoded and ends with BL_COBS_DELIMITER: a byte lost or added on the line only breaks
+ * the frame it hits, the next delimiter starts the next frame */
+#define BL_HOST_FRAMING_LENGTH					0x00
+#define BL_HOST_FRAMING_COBS					0x01
+#define BL_COBS_DELIMITER						0x00
+#define BL_COBS_MAX_BLOCK_CODE					0xFF				/* 254 data bytes and no zero after them */
+
+/* Boot window: after a reset with a valid application the host has this long to send the first byte, then the
+ * application starts. 0 (default) waits for the host as long as it takes, -DBL_BOOT_WINDOW_MS=500 opens a window */
+#ifndef BL_BOOT_WINDOW_MS
+#define BL_BOOT_WINDOW_MS						0
+#endif
+
+#if (BL_BOOT_WINDOW_MS >= 59000)
+#error "The boot window is timed with the DWT cycle counter, which wraps after 59 s at 72 MHz"
+#endif
+
+/* Secure boot: the boot window only starts an image committed at the application base whose trailer (BL_Image_Trailer,
+ * Tools/sign_image.py) holds an ECDSA P-256 signature of BL_Signing_Public_Key over the SHA-256 of the image, checked
+ * at the COMMIT and at every reset. 0 (default) compiles the check out, -DBL_SECURE_BOOT=1 turns it on. The key
+ * bl_public_key.c ships with is the development key, it also takes -DBL_SECURE_BOOT_DEV_KEY */
+#ifndef BL_SECURE_BOOT
+#define BL_SECURE_BOOT							0
+#endif
+
+/* Hash and signature check of one boot, 250 ms at 72 MHz. Advisory only: a boot over it still starts and is logged
+ * (BL_LOG_ID_SIGNATURE_SLOW), no build step measures the check on a target */
+#ifndef BL_SECURE_BOOT_CYCLE_BUDGET
+#define BL_SECURE_BOOT_CYCLE_BUDGET				18000000UL
+#endif
+
+#if (BL_SECURE_BOOT && (BL_BOOT_WINDOW_MS == 0))
+#error "Secure boot checks the image the boot window starts, open one with BL_BOOT_WINDOW_MS"
+#endif
+
+/* Protocol features a small build can leave out, all on by default (make PROFILE=size turns them off):
+ * BL_FEATURE_IMAGE     CBL_FLASH_IMAGE_CMD transactions, their checkpoints and the SHA-256 of the COMMIT
+ * BL_FEATURE_RELIABLE  CBL_RELIABLE_CMD envelope and its reply frames
+ * BL_FEATURE_COBS      COBS framing of the host link, the length framing stays
+ * GET_HELP and GET_CAPABILITIES only report what is built in, the other commands answer a NACK */
+#ifndef BL_FEATURE_IMAGE
+#define BL_FEATURE_IMAGE						1
+#endif
+#ifndef BL_FEATURE_RELIABLE
+#define BL_FEATURE_RELIABLE						1
+#endif
+#ifndef BL_FEATURE_COBS
+#define BL_FEATURE_COBS							1
+#endif
+
+#if (BL_SECURE_BOOT && !BL_FEATURE_IMAGE)
+#error "Secure boot only starts an image committed with CBL_FLASH_IMAGE_CMD, it needs BL_FEATURE_IMAGE"
+#endif
+
+#define BL_IMAGE_TRAILER_MAGIC					0x4E474953			/* "SIGN" */
+
+/* Public key of the secure boot (bl_public_key.c, Tools/sign_image.py --public-key-c), in the bootloader flash */
+extern const uint8_t BL_Signing_Public_Key[BL_ECDSA_PUBLIC_KEY_SIZE];
 
 /* Command Code Defines */
 #define CBL_GET_VER_CMD							0x10
@@ -46,11 +100,19 @@
 #define	CBL_READ_PAGE_STATUS_CMD				0x19
 #define	CBL_OTP_READ_CMD						0x20
 #define	CBL_DIS_R_W_PROTECT_CMD					0x21
+#define	CBL_BATCH_CMD							0x22
+#define	CBL_GET_STATS_CMD						0x23
+#define	CBL_ALLOCATE_PAGES_CMD					0x24
+#define	CBL_LOAD_AND_EXEC_CMD					0x25
+#define	CBL_FLASH_IMAGE_CMD						0x26
+#define	CBL_RELIABLE_CMD						0x27
+#define	CBL_GET_CAPABILITIES_CMD				0x28
 
 #define CBL_VENDOR_ID							100
 #define CBL_SW_MAJOR_VERSION					1
 #define CBL_SW_MINOR_VERSION					0
 #define CBL_SW_PATCH_VERSION					0
+#define CBL_PROTOCOL_VERSION					1					/* Raised when a frame or a reply changes incompatibly */
 
 #define CRC_TYPE_SIZE_BYTE						4
 
@@ -60,20 +122,54 @@
 #define CBL_SEND_NACK							0xAB
 #define CBL_SEND_ACK							0xCD
 
-/*Start Address of page 2*/
-#define FLASH_PAGE2_BASE_ADDRESS				0x08008000U
+/* CBL_BATCH_CMD */
+#define BL_BATCH_STOP_ON_FAILURE				0x00
+#define BL_BATCH_CONTINUE_ON_FAILURE			0x01
+#define BL_BATCH_REPLY_MAX_LENGTH				255					/* Aggregated reply length has to fit in the ACK length byte */
+#define BL_BATCH_MIN_SUB_FRAME_LENGTH			5					/* Command code + CRC32 */
+#define BL_BATCH_MAX_SUB_REPLY_LENGTH			32					/* Command code + ACK + length + largest command reply */
+
+/* CBL_RELIABLE_CMD */
+#define BL_RELIABLE_REPLY_SYNC					0x5A
+#define BL_RELIABLE_HEADER_SIZE					4					/* Sync + Sequence + Reply length (2 bytes) */
+#define BL_RELIABLE_REQUEST_OFFSET				3					/* Length, code and sequence of the envelope */
+#define BL_RELIABLE_REPLY_MAX_LENGTH			(2 + CBL_MEM_READ_MAX_LENGTH)	/* ACK + length + the longest command reply */
+#define BL_RELIABLE_FRAME_MAX_LENGTH			(BL_RELIABLE_HEADER_SIZE + BL_RELIABLE_REPLY_MAX_LENGTH + CRC_TYPE_SIZE_BYTE)
+
+/* DWT cycle counter, started by BL_Stats_Init. Read around receive, program and erase for the statistics,
+ * and around the port hot path when it is profiled (BL_PORT_CYCLE_PROFILE) */
+#define BL_CYCLE_COUNTER_ENABLE()				do{ CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk; DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk; }while(0)
+#define BL_CYCLE_COUNTER()						(DWT->CYCCNT)
+
+/* Application base address, set once in memory_layout.ld (BL_APP_BASE) and exported by the linker */
+extern const uint8_t BL_APP_BASE[];
+#define BL_APP_BASE_ADDRESS						((uint32_t)BL_APP_BASE)
 
 #define ADDRESS_IS_VALID						0x01
 #define ADDRESS_IS_INVALID						0x00
 
 
-#define STM32F103_FLASH_SIZE					(1024 * 64)
 #define STM32F103_SRAM_SIZE						(1024 * 20)
-#define STM32F103_FLASH_END						(FLASH_BASE + STM32F103_FLASH_SIZE)
 #define STM32F103_SRAM_END						(SRAM_BASE + STM32F103_SRAM_SIZE)
+#define STM32F103_SYSTEM_MEMORY_BASE			0x1FFFF000UL		/* ROM bootloader, flash size and unique device ID */
+#define STM32F103_OPTION_BYTES_BASE				0x1FFFF800UL
+#define STM32F103_OPTION_BYTES_END				0x1FFFF810UL
+
+/* Page numbers are in pages of the part (BL_Flash.Page_Size). The original frame carries them in one byte, the
+ * extended frame in two for the parts with more than 255 pages */
+#define CBL_FLASH_MASS_ERASE					0xFF				/* Erases the application region, the bootloader and its metadata stay */
+#define CBL_FLASH_MASS_ERASE_EXTENDED			0xFFFF
+#define CBL_FLASH_ERASE_EXTENDED_LENGTH			9					/* Length byte of the extended frame: code, page, count and CRC32 */
+
+/* Pages of the application region, the only flash the host may erase or write */
+#define CBL_APP_FIRST_PAGE						BL_FLASH_PAGE_NUMBER(BL_APP_BASE_ADDRESS)
+#define CBL_APP_END_PAGE						BL_FLASH_PAGE_NUMBER(BL_META_BASE_ADDRESS)
 
-#define CBL_FLASH_MAX_PAGE_NUMBER 				128					/*CBL --> Custom Bootloader*/
-#define CBL_FLASH_MASS_ERASE					0xFF
+/* Bootloader_Memory_Regions permissions */
+#define BL_REGION_READ							0x01
+#define BL_REGION_WRITE							0x02
+#define BL_REGION_ERASE							0x04
+#define BL_REGION_EXECUTE						0x08
 
 
 #define INVALID_PAGE_NUMBER 					0x00
@@ -87,10 +183,90 @@
 /* CBL_MEM_WRITE_CMD */
 #define FLASH_PAYLOAD_WRITE_FAILED   0x00
 #define FLASH_PAYLOAD_WRITE_PASSED   0x01
+#define FLASH_PAYLOAD_WRITE_POSTED   0x02									/* Bank 2 of a dual bank part, programmed while the next frame arrives */
+#define BL_ERASE_PLAN_WORDS          ((BL_FLASH_MAX_PAGE_COUNT + 31) / 32)	/* One bit per page of the largest part */
+#define CBL_MEM_WRITE_SKIP_LENGTH    14									/* Length byte of a skip record: code, address, empty payload, skip length and CRC32 */
 
 #define FLASH_LOCK_WRITE_FAILED      0x00
 #define FLASH_LOCK_WRITE_PASSED      0x01
 
+/* CBL_MEM_READ_CMD */
+#define CBL_MEM_READ_MAX_LENGTH      255									/* Reply length has to fit in the ACK length byte */
+#define CBL_MEM_READ_MAX_BATCH_LENGTH (BL_BATCH_MAX_SUB_REPLY_LENGTH - 3)	/* Inside a batch: minus command code, ACK and length */
+
+/* CBL_GET_STATS_CMD, one erase counter per BL_Stats.Pages_Per_Entry pages so the record fits in a reply on every part */
+#define BL_STATS_RECORD_VERSION      0x02
+#define BL_STATS_PAGE_COUNT          64
+#define BL_STATS_UID_WORDS           3
+
+/* CBL_ALLOCATE_PAGES_CMD, windows are searched in the application region (CBL_APP_FIRST_PAGE to CBL_APP_END_PAGE).
+ * The reply is only a hint for the host: nothing is reserved, the bootloader does not place anything there itself
+ * (FLASH_IMAGE writes at the load address of its manifest, the metadata stays in its two pages). The wear it compares
+ * is the count of the statistics entry of a page, shared by BL_STATS_PAGES_PER_ENTRY pages: per page up to 64 pages,
+ * then per 2 pages on 128 page parts, up to per 8 pages on 512 page parts. An erase of one page of an entry counts for
+ * all of them, so a window is told apart from its neighbours at that grain only */
+#define CBL_ALLOCATE_NO_PAGES        0xFF
+#define CBL_ALLOCATE_NO_PAGES_EXTENDED 0xFFFF
+#define CBL_ALLOCATE_EXTENDED_LENGTH 11									/* Length byte of the extended frame: code, three page numbers and CRC32 */
+
+/* CBL_LOAD_AND_EXEC_CMD, stub window at the top of the SRAM, set once in memory_layout.ld (BL_STUB_BASE) and exported by the linker */
+extern const uint8_t BL_STUB_BASE[];
+#define BL_STUB_BASE_ADDRESS         ((uint32_t)BL_STUB_BASE)
+#define BL_STUB_WINDOW_SIZE          (STM32F103_SRAM_END - BL_STUB_BASE_ADDRESS)
+#define CBL_STUB_LOAD                0x00
+#define CBL_STUB_EXEC                0x01
+#define CBL_STUB_LOAD_HEADER_SIZE    6									/* Length, command code, operation, offset and data length */
+#define CBL_STUB_EXEC_LENGTH         26									/* Length byte of an exec frame: code, operation, offset, stub length, stub CRC32, arguments and CRC32 */
+#define CBL_STUB_ARG_COUNT           3
+#define STUB_OPERATION_FAILED        0x00
+#define STUB_OPERATION_PASSED        0x01
+
+/* CBL_FLASH_IMAGE_CMD, one image transfer at a time: BEGIN checks the manifest, DATA frames follow in image order, COMMIT checks the image.
+ * RESUME picks up a transfer that did not commit, from the written pages of the metadata record */
+#define CBL_IMAGE_BEGIN              0x00
+#define CBL_IMAGE_DATA               0x01
+#define CBL_IMAGE_COMMIT             0x02
+#define CBL_IMAGE_RESUME             0x03
+#define CBL_IMAGE_MANIFEST_LENGTH    22									/* Length byte of BEGIN and RESUME: code, operation, manifest and CRC32 */
+#define CBL_IMAGE_DATA_HEADER_SIZE   8									/* Length, command code, operation, image offset and data length */
+#define CBL_IMAGE_SKIP_LENGTH        15									/* Length byte of a DATA skip record: code, operation, offset, empty data, skip length and CRC32 */
+#define CBL_IMAGE_COMMIT_DIGEST_LENGTH 38									/* Length byte of a COMMIT with the SHA-256 of the image: code, operation, digest and CRC32 */
+#define IMAGE_OPERATION_FAILED       0x00
+#define IMAGE_OPERATION_PASSED       0x01
+#define IMAGE_MANIFEST_INVALID       0x02									/* Empty image or a range the host may not write and erase */
+#define IMAGE_OFFSET_MISMATCH        0x03									/* Nothing written, the reply carries the offset the transfer is at */
+#define IMAGE_NO_TRANSFER            0x04
+#define IMAGE_CRC_MISMATCH           0x05
+#define IMAGE_DIGEST_MISMATCH        0x06									/* The SHA-256 of the DATA frames is not the one of the COMMIT */
+#define IMAGE_SIGNATURE_INVALID      0x07									/* Secure boot: no trailer, or its signature does not check */
+#define BL_IMAGE_PAGE_WORDS          ((BL_FLASH_MAX_PAGE_COUNT + 31) / 32)	/* One bit per page of the largest part */
+#define BL_IMAGE_CHECKPOINT_PAGES    4									/* Written pages between two stores of the progress, a lost link costs at most these */
+
+/* CBL_GET_CAPABILITIES_CMD, the reply is a list of Type (1 byte) + Length (1 byte) + Value (Length bytes) records,
+ * little endian. A host skips the types it does not know, new ones go at the end */
+#define BL_CAP_PROTOCOL              0x01									/* Protocol version, vendor ID, major, minor, patch */
+#define BL_CAP_MAX_FRAME             0x02									/* uint16 longest request frame, uint16 longest reply */
+#define BL_CAP_WINDOW                0x03									/* Requests in flight, longest aggregated batch reply */
+#define BL_CAP_BAUD_RATES            0x04									/* uint32 host UART baud rates */
+#define BL_CAP_CODECS                0x05									/* uint16 BL_CAP_CODEC_x bits */
+#define BL_CAP_FRAMINGS              0x06									/* BL_CAP_FRAMING_x bits */
+#define BL_CAP_FLASH_GEOMETRY        0x07									/* uint16 DEV_ID, uint16 page size, uint16 page count, uint32 flash size */
+#define BL_CAP_SLOTS                 0x08									/* uint32 base and size of the application, metadata and stub slots */
+#define BL_CAP_CODEC_ERASED_SKIP     0x0001								/* Skip records of MEM_WRITE and image DATA for 0xFF runs */
+#define BL_CAP_CODEC_IMAGE_SHA256    0x0002								/* Image COMMIT with the SHA-256 of the image */
+#define BL_CAP_FRAMING_LENGTH        0x01
+#define BL_CAP_FRAMING_COBS          0x02
+#define BL_CAP_FRAMING_RELIABLE      0x04									/* CBL_RELIABLE_CMD envelope and reply frames */
+#define BL_CAP_FRAMING_BATCH         0x08
+#define BL_CAP_FRAMING_IMAGE         0x10									/* CBL_FLASH_IMAGE_CMD with RESUME */
+#define BL_CAP_WINDOW_REQUESTS       1									/* Stop and wait, the reply ends a request */
+#define BL_CAP_RECORD_MAX_LENGTH     80
+
+
+/* Bootloader_Command_Table flags */
+#define BL_COMMAND_ENDS_ERASE_PLAN   0x01									/* Erases, jumps or runs code: the next write starts a new plan */
+#define BL_COMMAND_POSTS_WRITES      0x02									/* Writes payloads: a bank 2 payload still programming is left to the handler */
+#define BL_COMMAND_RUNS_HOST_CODE    0x04									/* Jumps to or runs code the host picks: refused under BL_SECURE_BOOT */
 
 /* CBL_GET_RDP_STATUS_CMD */
 #define ROP_LEVEL_READ_INVALID       0x00
@@ -110,6 +286,13 @@
 
 /**********************************************Macro Functions Start**********************************************/
 
+/* Statistics entry of a flash page: 1 page per entry up to 64 pages, more on the larger parts */
+#define BL_STATS_PAGES_PER_ENTRY				((BL_Flash.Page_Count + BL_STATS_PAGE_COUNT - 1) / BL_STATS_PAGE_COUNT)
+#define BL_STATS_ENTRY(Page_Number)				((uint32_t)(Page_Number) / BL_STATS_PAGES_PER_ENTRY)
+
+/* Half-word of a payload at an even offset reads 0xFFFF, the missing high byte of an odd length is erased */
+#define BL_HALF_WORD_IS_ERASED(Data, Offset, Data_Len)	((0xFF == (Data)[Offset]) && ((((Offset) + 1) >= (Data_Len)) || (0xFF == (Data)[(Offset) + 1])))
+
 /**********************************************Macro Functions End**********************************************/
 
 
@@ -121,16 +304,103 @@ typedef enum{
 	BL_OK=1
 }BL_Status;
 
+typedef BL_Status (*BL_Command_Handler) (uint8_t *Host_Buffer);
+
+typedef struct{
+	uint8_t Command_Code;
+	BL_Command_Handler Handler;
+	uint8_t Flags;									/* BL_COMMAND_ENDS_ERASE_PLAN, BL_COMMAND_POSTS_WRITES */
+}BL_Command_Entry;
+
+typedef struct{
+	uint8_t Active;									/* Replies are appended to Buffer instead of being sent to the host */
+	uint8_t Overflow;
+	uint16_t Length;
+	uint16_t Limit;									/* Bytes this capture may append to Buffer */
+	uint8_t Buffer[BL_RELIABLE_FRAME_MAX_LENGTH];	/* Batch reply, or reliable reply frame with its header and CRC32 */
+}BL_Reply_Capture;
+
+/*
+ * Bootloader statistics, counted since the metadata area was first written. The record is the CBL_GET_STATS_CMD
+ * reply as it is (little endian, every field at its natural alignment) and the BL_META_TYPE_STATS metadata record.
+ * Host.py decodes it with BL_STATS_RECORD_FORMAT, append new fields at the end and bump BL_STATS_RECORD_VERSION.
+ * */
+typedef struct{
+	uint8_t Version;
+	uint8_t Page_Count;								/* Entries of Page_Erase_Count */
+	uint16_t Record_Length;
+	uint32_t Unique_ID[BL_STATS_UID_WORDS];			/* 96 bit device ID, tells the boards of a fleet apart */
+	uint32_t Core_Clock_Hz;							/* Rate of the cycle counts below */
+	uint32_t Boot_Count;
+	uint32_t Frames_Received;
+	uint32_t CRC_Failures;
+	uint32_t NACKs_Sent;
+	uint32_t Flash_Errors;							/* Failed erases and failed payload writes */
+	uint32_t Bytes_Programmed;
+	uint32_t Meta_Generation;						/* Erases of the metadata pages */
+	uint64_t Receive_Cycles;						/* Frame bodies, from the length byte to the CRC */
+	uint64_t Program_Cycles;
+	uint64_t Erase_Cycles;
+	uint16_t Page_Erase_Count[BL_STATS_PAGE_COUNT];	/* Erase commands that hit the pages of an entry, saturates at 0xFFFF */
+	uint32_t Flash_Size;							/* Version 2: geometry of the part, BL_Flash */
+	uint16_t Flash_Page_Size;
+	uint16_t Pages_Per_Entry;						/* Pages counted by one Page_Erase_Count entry */
+}BL_Stats_Record;
+
+/* Entry of Bootloader_Memory_Regions, every range a host command touches has to lie in a single region */
+typedef struct{
+	const uint8_t *Base;
+	const uint8_t *End;								/* Excluded */
+	uint8_t Permissions;							/* BL_REGION_READ, BL_REGION_WRITE, BL_REGION_ERASE, BL_REGION_EXECUTE */
+	uint8_t Alignment;								/* Of the first address of a write or a jump */
+}BL_Memory_Region;
+
+/* Manifest of a CBL_FLASH_IMAGE_CMD transfer, the BEGIN frame carries it as it is */
+typedef struct{
+	uint32_t Load_Address;
+	uint32_t Image_Size;
+	uint32_t Image_CRC32;							/* Same CRC as the frames, over the Image_Size bytes at Load_Address */
+	uint32_t Version;
+}BL_Image_Manifest;
+
+/* Last bytes of a signed image, inside Image_Size. The signature covers the Signed_Size bytes at Load_Address */
+typedef struct{
+	uint32_t Magic;									/* BL_IMAGE_TRAILER_MAGIC */
+	uint32_t Signed_Size;							/* Image_Size - sizeof(BL_Image_Trailer) */
+	uint8_t Signature[BL_ECDSA_SIGNATURE_SIZE];
+}BL_Image_Trailer;
+
+/* BL_META_TYPE_IMAGE metadata record: the manifest of the last transfer, bootable once its COMMIT checked the image.
+ * The manifest is the ID of the transfer, RESUME only continues one the host describes with the same manifest */
+typedef struct{
+	BL_Image_Manifest Manifest;
+	uint8_t Bootable;
+	uint8_t Reserved[3];
+	uint32_t Written_Pages[BL_IMAGE_PAGE_WORDS];	/* Bit n: page n of the image (from the page of Load_Address) is programmed */
+}BL_Image_Record;
+
+typedef struct{
+	BL_Image_Manifest Manifest;
+	uint32_t Next_Offset;							/* Image bytes written so far, the offset of the next DATA frame */
+	uint32_t Written_Pages[BL_IMAGE_PAGE_WORDS];	/* As stored by the last checkpoint */
+	uint32_t Checkpoint_Pages;						/* Image pages set in Written_Pages */
+	BL_SHA256_Context Digest;						/* Of the Next_Offset bytes written so far, fed by every DATA frame */
+	uint32_t Hash_Cycles;							/* Spent in the digest by this transfer */
+	uint8_t Active;
+}BL_Image_Transfer;
+
 typedef void (*pMainApp) (void);
 typedef void (*JumpPtr) (void);
+/* Entry of a CBL_LOAD_AND_EXEC_CMD stub, position independent Thumb code called with the AAPCS */
+typedef uint32_t (*BL_Stub_Entry) (uint32_t Arg0, uint32_t Arg1, uint32_t Arg2);
 
 /**********************************************Data Types Declaration End**********************************************/
 
 
 /**********************************************Software Interfaces Declaration Start**********************************************/
 
-void BL_Print_Message(char *format, ...);
 BL_Status BL_UART_Featch_Host_Command(void);
+void BL_Stats_Init(void);
 
 /**********************************************Software Interfaces Declaration End**********************************************/
 
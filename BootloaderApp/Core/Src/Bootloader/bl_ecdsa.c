@@ -0,0 +1,521 @@
+/**
+ ******************************************************************************
+ * @file           : bl_ecdsa.c
+ * @author         : Ahmed Naeim
+ * @brief          : ECDSA P-256 signature check of the secure boot. Field
+ *                   elements are 8 limbs of 32 bits, every product is a
+ *                   32 x 32 -> 64 bit UMULL/UMLAL of the Cortex-M3 (no UMAAL
+ *                   needed), the products mod p are folded back with the
+ *                   Solinas reduction of the P-256 prime. u1 G + u2 Q is
+ *                   taken in one pass of 256 doublings (Shamir's trick) in
+ *                   Jacobian coordinates with mixed additions of an affine
+ *                   table, and the result is compared as X = r Z^2 so only
+ *                   the table needs an inversion
+ ******************************************************************************
+**/
+
+#include <string.h>
+#include "Bootloader/bl_ecdsa.h"
+
+
+
+/*****************************************Macro Declaration Start*****************************************/
+
+#define BL_P256_WORDS							8
+#define BL_P256_BITS							256
+#define BL_P256_N_INV							0xEE00BC4FUL		/* -n^-1 mod 2^32, Montgomery products mod n */
+
+#define BL_P256_BIT(Scalar, Bit_Index)			(((Scalar)[(Bit_Index) >> 5] >> ((Bit_Index) & 31)) & 1)
+
+/*****************************************Macro Declaration End*****************************************/
+
+
+
+/*****************************************Data Types Declaration Start*****************************************/
+
+/* x = X / Z^2, y = Y / Z^3, Z = 0 is the point at infinity */
+typedef struct{
+	uint32_t X[BL_P256_WORDS];
+	uint32_t Y[BL_P256_WORDS];
+	uint32_t Z[BL_P256_WORDS];
+}BL_P256_Point;
+
+typedef struct{
+	uint32_t X[BL_P256_WORDS];
+	uint32_t Y[BL_P256_WORDS];
+}BL_P256_Affine;
+
+typedef void (*BL_P256_Mul_Function)(uint32_t *R, const uint32_t *A, const uint32_t *B);
+
+/*****************************************Data Types Declaration End*****************************************/
+
+
+
+/*****************************************Global Variables Start*****************************************/
+
+/* Least significant limb first */
+static const uint32_t BL_P256_P[BL_P256_WORDS] = {
+	0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0x00000000, 0x00000000, 0x00000000, 0x00000001, 0xFFFFFFFF
+};
+static const uint32_t BL_P256_N[BL_P256_WORDS] = {
+	0xFC632551, 0xF3B9CAC2, 0xA7179E84, 0xBCE6FAAD, 0xFFFFFFFF, 0xFFFFFFFF, 0x00000000, 0xFFFFFFFF
+};
+static const uint32_t BL_P256_B[BL_P256_WORDS] = {
+	0x27D2604B, 0x3BCE3C3E, 0xCC53B0F6, 0x651D06B0, 0x769886BC, 0xB3EBBD55, 0xAA3A93E7, 0x5AC635D8
+};
+/* 2^512 mod n, into the Montgomery form mod n */
+static const uint32_t BL_P256_N_RR[BL_P256_WORDS] = {
+	0xBE79EEA2, 0x83244C95, 0x49BD6FA6, 0x4699799C, 0x2B6BEC59, 0x2845B239, 0xF3D95620, 0x66E12D94
+};
+static const BL_P256_Affine BL_P256_G = {
+	{0xD898C296, 0xF4A13945, 0x2DEB33A0, 0x77037D81, 0x63A440F2, 0xF8BCE6E5, 0xE12C4247, 0x6B17D1F2},
+	{0x37BF51F5, 0xCBB64068, 0x6B315ECE, 0x2BCE3357, 0x7C0F9E16, 0x8EE7EB4A, 0xFE1A7F9B, 0x4FE342E2}
+};
+
+/*****************************************Global Variables End*****************************************/
+
+
+
+/*****************************************Static Functions Declarations Start*****************************************/
+
+static void BL_P256_Load(uint32_t *R, const uint8_t *Bytes);
+static uint32_t BL_P256_Add(uint32_t *R, const uint32_t *A, const uint32_t *B);
+static uint32_t BL_P256_Sub(uint32_t *R, const uint32_t *A, const uint32_t *B);
+static uint8_t BL_P256_Is_Less(const uint32_t *A, const uint32_t *B);
+static uint8_t BL_P256_Is_Zero(const uint32_t *A);
+static void BL_P256_Field_Add(uint32_t *R, const uint32_t *A, const uint32_t *B);
+static void BL_P256_Field_Sub(uint32_t *R, const uint32_t *A, const uint32_t *B);
+static void BL_P256_Field_Reduce(uint32_t *R, const uint32_t *C);
+static void BL_P256_Field_Mul(uint32_t *R, const uint32_t *A, const uint32_t *B);
+static void BL_P256_Field_Sqr(uint32_t *R, const uint32_t *A);
+static void BL_P256_Mont_Mul_N(uint32_t *R, const uint32_t *A, const uint32_t *B);
+static void BL_P256_Inverse(uint32_t *R, const uint32_t *A, const uint32_t *Modulus, BL_P256_Mul_Function Mul);
+static uint8_t BL_P256_Is_On_Curve(const BL_P256_Affine *Q);
+static void BL_P256_Point_Double(BL_P256_Point *P);
+static void BL_P256_Point_Add_Affine(BL_P256_Point *P, const BL_P256_Affine *Q);
+static void BL_P256_To_Affine(BL_P256_Affine *Q, const BL_P256_Point *P);
+
+/*****************************************Static Functions Declarations End*****************************************/
+
+
+/*****************************************Software Interface Implementation Start*****************************************/
+
+BL_ECDSA_Status BL_ECDSA_P256_Verify(const uint8_t *Public_Key, const uint8_t *Digest, const uint8_t *Signature){
+	BL_ECDSA_Status Status = BL_ECDSA_INVALID_SIGNATURE;
+	BL_P256_Affine Table[3];								/* G, Q and G + Q, entry (bit of u2 << 1 | bit of u1) - 1 */
+	BL_P256_Point Sum;
+	uint32_t R[BL_P256_WORDS];
+	uint32_t S[BL_P256_WORDS];
+	uint32_t U1[BL_P256_WORDS];
+	uint32_t U2[BL_P256_WORDS];
+	uint32_t Bit_Index = 0;
+	uint32_t Entry = 0;
+
+	BL_P256_Load(Table[1].X, &Public_Key[0]);
+	BL_P256_Load(Table[1].Y, &Public_Key[BL_ECDSA_PUBLIC_KEY_SIZE / 2]);
+	BL_P256_Load(R, &Signature[0]);
+	BL_P256_Load(S, &Signature[BL_ECDSA_SIGNATURE_SIZE / 2]);
+	BL_P256_Load(U1, Digest);
+	/* Q = G or -G has no G + Q entry, no private key of a real signer gives it */
+	if((!BL_P256_Is_On_Curve(&Table[1])) || (0 == memcmp(Table[1].X, BL_P256_G.X, sizeof(Table[1].X)))){
+		Status = BL_ECDSA_INVALID_KEY;
+	}
+	else if(BL_P256_Is_Zero(R) || (!BL_P256_Is_Less(R, BL_P256_N)) || BL_P256_Is_Zero(S) || (!BL_P256_Is_Less(S, BL_P256_N))){
+		Status = BL_ECDSA_INVALID_SIGNATURE;
+	}
+	else{
+		/* w = s^-1 mod n stays in the Montgomery form, the products with it drop the factor: u1 = e w, u2 = r w */
+		if(!BL_P256_Is_Less(U1, BL_P256_N)){
+			BL_P256_Sub(U1, U1, BL_P256_N);
+		}
+		BL_P256_Mont_Mul_N(S, S, BL_P256_N_RR);
+		BL_P256_Inverse(S, S, BL_P256_N, BL_P256_Mont_Mul_N);
+		BL_P256_Mont_Mul_N(U1, U1, S);
+		BL_P256_Mont_Mul_N(U2, R, S);
+
+		Table[0] = BL_P256_G;
+		memset(&Sum, 0, sizeof(Sum));
+		BL_P256_Point_Add_Affine(&Sum, &Table[0]);
+		BL_P256_Point_Add_Affine(&Sum, &Table[1]);
+		BL_P256_To_Affine(&Table[2], &Sum);
+
+		/* One doubling per bit for both scalars, the leading zero bits cost nothing while Sum is at infinity */
+		memset(&Sum, 0, sizeof(Sum));
+		for(Bit_Index = BL_P256_BITS; Bit_Index-- > 0;){
+			BL_P256_Point_Double(&Sum);
+			Entry = BL_P256_BIT(U1, Bit_Index) | (BL_P256_BIT(U2, Bit_Index) << 1);
+			if(0 != Entry){
+				BL_P256_Point_Add_Affine(&Sum, &Table[Entry - 1]);
+			}
+		}
+
+		/* x mod n = r, with x = X / Z^2 in [0, p): X = r Z^2, or X = (r + n) Z^2 when r + n is below p */
+		if(!BL_P256_Is_Zero(Sum.Z)){
+			BL_P256_Field_Sqr(S, Sum.Z);
+			BL_P256_Field_Mul(U1, R, S);
+			if(0 == memcmp(U1, Sum.X, sizeof(U1))){
+				Status = BL_ECDSA_OK;
+			}
+			else if((0 == BL_P256_Add(U2, R, BL_P256_N)) && BL_P256_Is_Less(U2, BL_P256_P)){
+				BL_P256_Field_Mul(U1, U2, S);
+				if(0 == memcmp(U1, Sum.X, sizeof(U1))){
+					Status = BL_ECDSA_OK;
+				}
+			}
+		}
+	}
+	return Status;
+}
+
+/*****************************************Software Interface Implementation End*****************************************/
+
+
+/*****************************************Static Functions Implementation Start*****************************************/
+
+static void BL_P256_Load(uint32_t *R, const uint8_t *Bytes){
+	uint32_t Limb_Index = 0;
+
+	/* 32 big endian bytes, the last four are limb 0 */
+	for(Limb_Index = 0; Limb_Index < BL_P256_WORDS; Limb_Index++){
+		R[Limb_Index] = ((uint32_t)Bytes[28 - (4 * Limb_Index)] << 24) | ((uint32_t)Bytes[29 - (4 * Limb_Index)] << 16)
+					  | ((uint32_t)Bytes[30 - (4 * Limb_Index)] << 8) | (uint32_t)Bytes[31 - (4 * Limb_Index)];
+	}
+}
+
+static uint32_t BL_P256_Add(uint32_t *R, const uint32_t *A, const uint32_t *B){
+	uint64_t Acc = 0;
+	uint32_t Limb_Index = 0;
+
+	for(Limb_Index = 0; Limb_Index < BL_P256_WORDS; Limb_Index++){
+		Acc += (uint64_t)A[Limb_Index] + B[Limb_Index];
+		R[Limb_Index] = (uint32_t)Acc;
+		Acc >>= 32;
+	}
+	return (uint32_t)Acc;
+}
+
+static uint32_t BL_P256_Sub(uint32_t *R, const uint32_t *A, const uint32_t *B){
+	int64_t Acc = 0;
+	uint32_t Limb_Index = 0;
+
+	for(Limb_Index = 0; Limb_Index < BL_P256_WORDS; Limb_Index++){
+		Acc += (int64_t)A[Limb_Index] - B[Limb_Index];
+		R[Limb_Index] = (uint32_t)Acc;
+		Acc >>= 32;
+	}
+	/* 1 on a borrow */
+	return (uint32_t)(-Acc);
+}
+
+static uint8_t BL_P256_Is_Less(const uint32_t *A, const uint32_t *B){
+	uint32_t Limb_Index = BL_P256_WORDS;
+
+	while((Limb_Index-- > 0) && (A[Limb_Index] == B[Limb_Index])){}
+	return (Limb_Index < BL_P256_WORDS) && (A[Limb_Index] < B[Limb_Index]);
+}
+
+static uint8_t BL_P256_Is_Zero(const uint32_t *A){
+	uint32_t Bits = 0;
+	uint32_t Limb_Index = 0;
+
+	for(Limb_Index = 0; Limb_Index < BL_P256_WORDS; Limb_Index++){
+		Bits |= A[Limb_Index];
+	}
+	return (0 == Bits);
+}
+
+static void BL_P256_Field_Add(uint32_t *R, const uint32_t *A, const uint32_t *B){
+	if(BL_P256_Add(R, A, B) || (!BL_P256_Is_Less(R, BL_P256_P))){
+		BL_P256_Sub(R, R, BL_P256_P);
+	}
+}
+
+static void BL_P256_Field_Sub(uint32_t *R, const uint32_t *A, const uint32_t *B){
+	if(BL_P256_Sub(R, A, B)){
+		BL_P256_Add(R, R, BL_P256_P);
+	}
+}
+
+static void BL_P256_Field_Reduce(uint32_t *R, const uint32_t *C){
+	/*
+	 * Solinas reduction of the 512 bit product C (FIPS 186-4 D.2.3): p = 2^256 - 2^224 + 2^192 + 2^96 - 1 turns
+	 * every limb above 255 bits into a few additions and subtractions of limbs, summed per result limb with the
+	 * carry in a signed accumulator. The sum is in (-5 p, 7 p), a few additions or subtractions of p bring it in
+	 * */
+	int64_t Acc = 0;
+	int32_t Top = 0;
+
+	Acc = (int64_t)C[0] + C[8] + C[9] - C[11] - C[12] - C[13] - C[14];
+	R[0] = (uint32_t)Acc;
+	Acc >>= 32;
+	Acc += (int64_t)C[1] + C[9] + C[10] - C[12] - C[13] - C[14] - C[15];
+	R[1] = (uint32_t)Acc;
+	Acc >>= 32;
+	Acc += (int64_t)C[2] + C[10] + C[11] - C[13] - C[14] - C[15];
+	R[2] = (uint32_t)Acc;
+	Acc >>= 32;
+	Acc += (int64_t)C[3] + (2 * ((int64_t)C[11] + C[12])) + C[13] - C[8] - C[9] - C[15];
+	R[3] = (uint32_t)Acc;
+	Acc >>= 32;
+	Acc += (int64_t)C[4] + (2 * ((int64_t)C[12] + C[13])) + C[14] - C[9] - C[10];
+	R[4] = (uint32_t)Acc;
+	Acc >>= 32;
+	Acc += (int64_t)C[5] + (2 * ((int64_t)C[13] + C[14])) + C[15] - C[10] - C[11];
+	R[5] = (uint32_t)Acc;
+	Acc >>= 32;
+	Acc += (int64_t)C[6] + (3 * (int64_t)C[14]) + (2 * (int64_t)C[15]) + C[13] - C[8] - C[9];
+	R[6] = (uint32_t)Acc;
+	Acc >>= 32;
+	Acc += (int64_t)C[7] + (3 * (int64_t)C[15]) + C[8] - C[10] - C[11] - C[12] - C[13];
+	R[7] = (uint32_t)Acc;
+	Top = (int32_t)(Acc >> 32);
+
+	/* The value is Top 2^256 + R */
+	while(Top < 0){
+		Top += (int32_t)BL_P256_Add(R, R, BL_P256_P);
+	}
+	while((Top > 0) || (!BL_P256_Is_Less(R, BL_P256_P))){
+		Top -= (int32_t)BL_P256_Sub(R, R, BL_P256_P);
+	}
+}
+
+static void BL_P256_Field_Mul(uint32_t *R, const uint32_t *A, const uint32_t *B){
+	uint32_t Product[2 * BL_P256_WORDS];
+	uint64_t Acc = 0;
+	uint32_t Carry = 0;
+	uint32_t A_Limb = 0;
+	uint32_t Row = 0;
+	uint32_t Column = 0;
+
+	/* Row by row, a * b + product limb + carry always fits in 64 bits: one UMULL and two adds with carry per limb pair */
+	memset(Product, 0, BL_P256_WORDS * sizeof(uint32_t));
+	for(Row = 0; Row < BL_P256_WORDS; Row++){
+		A_Limb = A[Row];
+		Carry = 0;
+		for(Column = 0; Column < BL_P256_WORDS; Column++){
+			Acc = ((uint64_t)A_Limb * B[Column]) + Product[Row + Column] + Carry;
+			Product[Row + Column] = (uint32_t)Acc;
+			Carry = (uint32_t)(Acc >> 32);
+		}
+		Product[Row + BL_P256_WORDS] = Carry;
+	}
+	BL_P256_Field_Reduce(R, Product);
+}
+
+static void BL_P256_Field_Sqr(uint32_t *R, const uint32_t *A){
+	uint32_t Product[2 * BL_P256_WORDS];
+	uint64_t Acc = 0;
+	uint32_t Carry = 0;
+	uint32_t Row = 0;
+	uint32_t Column = 0;
+
+	/* The 28 products a[i] a[j] (i < j) once, doubled, then the 8 squares on the diagonal: 36 of the 64 products */
+	memset(Product, 0, sizeof(Product));
+	for(Row = 0; Row < (BL_P256_WORDS - 1); Row++){
+		Carry = 0;
+		for(Column = Row + 1; Column < BL_P256_WORDS; Column++){
+			Acc = ((uint64_t)A[Row] * A[Column]) + Product[Row + Column] + Carry;
+			Product[Row + Column] = (uint32_t)Acc;
+			Carry = (uint32_t)(Acc >> 32);
+		}
+		Product[Row + BL_P256_WORDS] = Carry;
+	}
+	for(Column = (2 * BL_P256_WORDS) - 1; Column > 0; Column--){
+		Product[Column] = (Product[Column] << 1) | (Product[Column - 1] >> 31);
+	}
+	Carry = 0;
+	for(Row = 0; Row < BL_P256_WORDS; Row++){
+		Acc = ((uint64_t)A[Row] * A[Row]) + Product[2 * Row] + Carry;
+		Product[2 * Row] = (uint32_t)Acc;
+		Acc = (Acc >> 32) + Product[(2 * Row) + 1];
+		Product[(2 * Row) + 1] = (uint32_t)Acc;
+		Carry = (uint32_t)(Acc >> 32);
+	}
+	BL_P256_Field_Reduce(R, Product);
+}
+
+static void BL_P256_Mont_Mul_N(uint32_t *R, const uint32_t *A, const uint32_t *B){
+	/* a b 2^-256 mod n, one limb of b and one reduction step per pass (CIOS). Only a few calls per signature */
+	uint32_t T[BL_P256_WORDS + 2] = {0};
+	uint64_t Acc = 0;
+	uint32_t Carry = 0;
+	uint32_t M = 0;
+	uint32_t Row = 0;
+	uint32_t Column = 0;
+
+	for(Row = 0; Row < BL_P256_WORDS; Row++){
+		Carry = 0;
+		for(Column = 0; Column < BL_P256_WORDS; Column++){
+			Acc = ((uint64_t)A[Column] * B[Row]) + T[Column] + Carry;
+			T[Column] = (uint32_t)Acc;
+			Carry = (uint32_t)(Acc >> 32);
+		}
+		Acc = (uint64_t)T[BL_P256_WORDS] + Carry;
+		T[BL_P256_WORDS] = (uint32_t)Acc;
+		T[BL_P256_WORDS + 1] = (uint32_t)(Acc >> 32);
+		/* Adds the multiple of n that clears limb 0, then shifts one limb down */
+		M = T[0] * (uint32_t)BL_P256_N_INV;
+		Acc = ((uint64_t)M * BL_P256_N[0]) + T[0];
+		Carry = (uint32_t)(Acc >> 32);
+		for(Column = 1; Column < BL_P256_WORDS; Column++){
+			Acc = ((uint64_t)M * BL_P256_N[Column]) + T[Column] + Carry;
+			T[Column - 1] = (uint32_t)Acc;
+			Carry = (uint32_t)(Acc >> 32);
+		}
+		Acc = (uint64_t)T[BL_P256_WORDS] + Carry;
+		T[BL_P256_WORDS - 1] = (uint32_t)Acc;
+		T[BL_P256_WORDS] = T[BL_P256_WORDS + 1] + (uint32_t)(Acc >> 32);
+	}
+	if((0 != T[BL_P256_WORDS]) || (!BL_P256_Is_Less(T, BL_P256_N))){
+		BL_P256_Sub(T, T, BL_P256_N);
+	}
+	memcpy(R, T, BL_P256_WORDS * sizeof(uint32_t));
+}
+
+static void BL_P256_Inverse(uint32_t *R, const uint32_t *A, const uint32_t *Modulus, BL_P256_Mul_Function Mul){
+	/* a^(m - 2) for the prime m, left to right from the top bit (set for both p - 2 and n - 2) */
+	uint32_t Exponent[BL_P256_WORDS];
+	uint32_t Base[BL_P256_WORDS];
+	uint32_t Bit_Index = BL_P256_BITS - 1;
+
+	memcpy(Exponent, Modulus, sizeof(Exponent));
+	Exponent[0] -= 2;
+	memcpy(Base, A, sizeof(Base));
+	memcpy(R, A, sizeof(Base));
+	while(Bit_Index-- > 0){
+		Mul(R, R, R);
+		if(BL_P256_BIT(Exponent, Bit_Index)){
+			Mul(R, R, Base);
+		}
+	}
+}
+
+static uint8_t BL_P256_Is_On_Curve(const BL_P256_Affine *Q){
+	uint8_t On_Curve = 0;
+	uint32_t Right[BL_P256_WORDS];
+	uint32_t Left[BL_P256_WORDS];
+
+	/* y^2 = x^3 - 3 x + b = (x^2 - 3) x + b */
+	if(BL_P256_Is_Less(Q->X, BL_P256_P) && BL_P256_Is_Less(Q->Y, BL_P256_P)){
+		BL_P256_Field_Sqr(Right, Q->X);
+		BL_P256_Field_Mul(Right, Right, Q->X);
+		BL_P256_Field_Sub(Right, Right, Q->X);
+		BL_P256_Field_Sub(Right, Right, Q->X);
+		BL_P256_Field_Sub(Right, Right, Q->X);
+		BL_P256_Field_Add(Right, Right, BL_P256_B);
+		BL_P256_Field_Sqr(Left, Q->Y);
+		On_Curve = (0 == memcmp(Left, Right, sizeof(Left)));
+	}
+	return On_Curve;
+}
+
+static void BL_P256_Point_Double(BL_P256_Point *P){
+	/* dbl-2001-b for a = -3: 3M + 5S. The curve has no point of order 2, only infinity stays where it is */
+	uint32_t Delta[BL_P256_WORDS];
+	uint32_t Gamma[BL_P256_WORDS];
+	uint32_t Beta[BL_P256_WORDS];
+	uint32_t Alpha[BL_P256_WORDS];
+	uint32_t T[BL_P256_WORDS];
+
+	if(!BL_P256_Is_Zero(P->Z)){
+		BL_P256_Field_Sqr(Delta, P->Z);
+		BL_P256_Field_Sqr(Gamma, P->Y);
+		BL_P256_Field_Mul(Beta, P->X, Gamma);
+		/* Alpha = 3 (X - Delta) (X + Delta) */
+		BL_P256_Field_Sub(T, P->X, Delta);
+		BL_P256_Field_Add(Alpha, P->X, Delta);
+		BL_P256_Field_Mul(Alpha, Alpha, T);
+		BL_P256_Field_Add(T, Alpha, Alpha);
+		BL_P256_Field_Add(Alpha, T, Alpha);
+		/* Z3 = (Y + Z)^2 - Gamma - Delta */
+		BL_P256_Field_Add(T, P->Y, P->Z);
+		BL_P256_Field_Sqr(T, T);
+		BL_P256_Field_Sub(T, T, Gamma);
+		BL_P256_Field_Sub(P->Z, T, Delta);
+		/* X3 = Alpha^2 - 8 Beta */
+		BL_P256_Field_Add(Beta, Beta, Beta);
+		BL_P256_Field_Add(Beta, Beta, Beta);
+		BL_P256_Field_Sqr(T, Alpha);
+		BL_P256_Field_Sub(T, T, Beta);
+		BL_P256_Field_Sub(P->X, T, Beta);
+		/* Y3 = Alpha (4 Beta - X3) - 8 Gamma^2 */
+		BL_P256_Field_Sub(Beta, Beta, P->X);
+		BL_P256_Field_Mul(Beta, Alpha, Beta);
+		BL_P256_Field_Sqr(Gamma, Gamma);
+		BL_P256_Field_Add(Gamma, Gamma, Gamma);
+		BL_P256_Field_Add(Gamma, Gamma, Gamma);
+		BL_P256_Field_Add(Gamma, Gamma, Gamma);
+		BL_P256_Field_Sub(P->Y, Beta, Gamma);
+	}
+}
+
+static void BL_P256_Point_Add_Affine(BL_P256_Point *P, const BL_P256_Affine *Q){
+	/* madd-2007-bl, Jacobian plus affine: 7M + 4S */
+	uint32_t Z1Z1[BL_P256_WORDS];
+	uint32_t U2[BL_P256_WORDS];
+	uint32_t S2[BL_P256_WORDS];
+	uint32_t H[BL_P256_WORDS];
+	uint32_t R[BL_P256_WORDS];
+	uint32_t T[BL_P256_WORDS];
+
+	if(BL_P256_Is_Zero(P->Z)){
+		memcpy(P->X, Q->X, sizeof(P->X));
+		memcpy(P->Y, Q->Y, sizeof(P->Y));
+		memset(P->Z, 0, sizeof(P->Z));
+		P->Z[0] = 1;
+	}
+	else{
+		BL_P256_Field_Sqr(Z1Z1, P->Z);
+		BL_P256_Field_Mul(U2, Q->X, Z1Z1);
+		BL_P256_Field_Mul(S2, Q->Y, P->Z);
+		BL_P256_Field_Mul(S2, S2, Z1Z1);
+		BL_P256_Field_Sub(H, U2, P->X);
+		BL_P256_Field_Sub(R, S2, P->Y);
+		BL_P256_Field_Add(R, R, R);
+		if(BL_P256_Is_Zero(H)){
+			/* Same x: the same point or its negation */
+			if(BL_P256_Is_Zero(R)){
+				BL_P256_Point_Double(P);
+			}
+			else{
+				memset(P->Z, 0, sizeof(P->Z));
+			}
+		}
+		else{
+			/* I = 4 H^2 in T, J = H I in U2, V = X1 I in S2 */
+			BL_P256_Field_Sqr(Z1Z1, H);
+			BL_P256_Field_Add(T, Z1Z1, Z1Z1);
+			BL_P256_Field_Add(T, T, T);
+			BL_P256_Field_Mul(U2, H, T);
+			BL_P256_Field_Mul(S2, P->X, T);
+			/* Z3 = (Z1 + H)^2 - Z1Z1 - HH = 2 Z1 H */
+			BL_P256_Field_Mul(P->Z, P->Z, H);
+			BL_P256_Field_Add(P->Z, P->Z, P->Z);
+			/* X3 = R^2 - J - 2 V */
+			BL_P256_Field_Sqr(T, R);
+			BL_P256_Field_Sub(T, T, U2);
+			BL_P256_Field_Sub(T, T, S2);
+			BL_P256_Field_Sub(T, T, S2);
+			/* Y3 = R (V - X3) - 2 Y1 J */
+			BL_P256_Field_Sub(S2, S2, T);
+			BL_P256_Field_Mul(S2, R, S2);
+			BL_P256_Field_Mul(U2, P->Y, U2);
+			BL_P256_Field_Add(U2, U2, U2);
+			BL_P256_Field_Sub(P->Y, S2, U2);
+			memcpy(P->X, T, sizeof(P->X));
+		}
+	}
+}
+
+static void BL_P256_To_Affine(BL_P256_Affine *Q, const BL_P256_Point *P){
+	uint32_t Z_Inverse[BL_P256_WORDS];
+	uint32_t Z_Power[BL_P256_WORDS];
+
+	BL_P256_Inverse(Z_Inverse, P->Z, BL_P256_P, BL_P256_Field_Mul);
+	BL_P256_Field_Sqr(Z_Power, Z_Inverse);
+	BL_P256_Field_Mul(Q->X, P->X, Z_Power);
+	BL_P256_Field_Mul(Z_Power, Z_Power, Z_Inverse);
+	BL_P256_Field_Mul(Q->Y, P->Y, Z_Power);
+}
+
+/*****************************************Static Functions Implementation End*****************************************/
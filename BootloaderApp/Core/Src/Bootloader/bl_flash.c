@@ -0,0 +1,111 @@
+/**
+ ******************************************************************************
+ * @file           : bl_flash.c
+ * @author         : Ahmed Naeim
+ * @brief          : Flash geometry of the STM32F1 part the bootloader runs
+ *                   on: page size from the device line, flash size from the
+ *                   F_SIZE register, bank split of the XL density line, and
+ *                   the check of the linked layout against them
+ ******************************************************************************
+**/
+
+#include "Bootloader/bootloader.h"
+
+
+
+/*****************************************Data Types Declaration Start*****************************************/
+
+typedef struct{
+	uint16_t Device_ID;
+	uint16_t Page_Size;
+}BL_Flash_Line;
+
+/*****************************************Data Types Declaration End*****************************************/
+
+
+
+/*****************************************Global Variables Start*****************************************/
+
+BL_Flash_Geometry BL_Flash;
+
+/* Page size of every F1 line (RM0008, 3.3.3), the connectivity line has 2 KB pages whatever its size */
+static const BL_Flash_Line BL_Flash_Lines[] = {
+	{BL_FLASH_DEV_ID_LOW_DENSITY,		BL_FLASH_SMALL_PAGE_SIZE},
+	{BL_FLASH_DEV_ID_MEDIUM_DENSITY,	BL_FLASH_SMALL_PAGE_SIZE},
+	{BL_FLASH_DEV_ID_VALUE_LINE,		BL_FLASH_SMALL_PAGE_SIZE},
+	{BL_FLASH_DEV_ID_HIGH_DENSITY,		BL_FLASH_LARGE_PAGE_SIZE},
+	{BL_FLASH_DEV_ID_VALUE_LINE_HIGH,	BL_FLASH_LARGE_PAGE_SIZE},
+	{BL_FLASH_DEV_ID_XL_DENSITY,		BL_FLASH_LARGE_PAGE_SIZE},
+	{BL_FLASH_DEV_ID_CONNECTIVITY,		BL_FLASH_LARGE_PAGE_SIZE}
+};
+
+#define BL_FLASH_LINE_COUNT				(sizeof(BL_Flash_Lines) / sizeof(BL_Flash_Lines[0]))
+
+/*****************************************Global Variables End*****************************************/
+
+
+
+/*****************************************Software Interface Implementation Start*****************************************/
+
+void BL_Flash_Geometry_Init(void){
+	uint16_t Flash_Size_KB = *((const volatile uint16_t *)BL_FLASH_SIZE_REGISTER);
+	uint8_t Line_Index = 0;
+
+	BL_Flash.Device_ID = (uint16_t)(DBGMCU->IDCODE & BL_FLASH_DEV_ID_MASK);
+	BL_Flash.Flash_Size = (uint32_t)Flash_Size_KB * 1024;
+	if((0 == BL_Flash.Flash_Size) || (BL_Flash.Flash_Size > BL_FLASH_MAX_SIZE)){
+		/* F_SIZE not programmed: trust the size the images were linked for */
+		BL_Flash.Flash_Size = (uint32_t)BL_FLASH_END - BL_FLASH_BASE_ADDRESS;
+	}
+
+	/* A line missing from the table gets the page size the F1 parts of its size have */
+	BL_Flash.Page_Size = (BL_Flash.Flash_Size > BL_FLASH_SMALL_PAGE_MAX_SIZE) ? BL_FLASH_LARGE_PAGE_SIZE : BL_FLASH_SMALL_PAGE_SIZE;
+	for(Line_Index = 0; Line_Index < BL_FLASH_LINE_COUNT; Line_Index++){
+		if(BL_Flash_Lines[Line_Index].Device_ID == BL_Flash.Device_ID){
+			BL_Flash.Page_Size = BL_Flash_Lines[Line_Index].Page_Size;
+		}
+	}
+
+	BL_Flash.Flash_End = BL_FLASH_BASE_ADDRESS + BL_Flash.Flash_Size;
+	BL_Flash.Page_Count = (uint16_t)(BL_Flash.Flash_Size / BL_Flash.Page_Size);
+	BL_Flash.Bank_1_End = BL_Flash.Flash_End;
+	if((BL_FLASH_DEV_ID_XL_DENSITY == BL_Flash.Device_ID) && (BL_Flash.Flash_Size > BL_FLASH_BANK_1_MAX_SIZE)){
+		BL_Flash.Bank_1_End = BL_FLASH_BASE_ADDRESS + BL_FLASH_BANK_1_MAX_SIZE;
+	}
+	if(!BL_PORT_FLASH_DUAL_BANK){
+		/* The port can't erase or program bank 2: a layout that reaches into it fails the check below */
+		BL_Flash.Flash_End = BL_Flash.Bank_1_End;
+	}
+
+	/* An erase of a page that is not where the layout expects it would take a part of the bootloader or of its
+	 * metadata with it: the host commands that erase or write are refused until the layout is rebuilt for this part */
+	BL_Flash.Layout_Valid = ((BL_Flash.Page_Size == (uint32_t)BL_FLASH_PAGE_SIZE)
+							 && ((uint32_t)BL_FLASH_END <= BL_Flash.Flash_End)
+							 && (0 == ((BL_APP_BASE_ADDRESS - BL_FLASH_BASE_ADDRESS) % BL_Flash.Page_Size))
+							 && (0 == ((BL_META_BASE_ADDRESS - BL_FLASH_BASE_ADDRESS) % BL_Flash.Page_Size))
+							 && ((uint32_t)BL_META_SIZE == (BL_META_PAGE_COUNT * (uint32_t)BL_Flash.Page_Size))) ? 1 : 0;
+
+	BL_LOG_INFO(FLASH, BL_LOG_ID_FLASH_GEOMETRY, BL_Flash.Device_ID, Flash_Size_KB);
+	if(!BL_Flash.Layout_Valid){
+		BL_LOG_ERROR(FLASH, BL_LOG_ID_FLASH_LAYOUT_MISMATCH, (uint32_t)BL_FLASH_END, (uint32_t)BL_FLASH_PAGE_SIZE);
+	}
+}
+
+uint8_t BL_Flash_Is_Blank(uint32_t Address, uint32_t Length){
+	const volatile uint32_t *Flash_Word = (const volatile uint32_t *)(uintptr_t)Address;
+	uint32_t Word_Count = Length / 4;
+	uint32_t Erased_Bits = 0xFFFFFFFFUL;
+
+	/* Four words ANDed a step, the scan stops at the first step with a programmed bit */
+	for(; (Word_Count >= 4) && (0xFFFFFFFFUL == Erased_Bits); Word_Count -= 4){
+		Erased_Bits = Flash_Word[0] & Flash_Word[1] & Flash_Word[2] & Flash_Word[3];
+		Flash_Word += 4;
+	}
+	for(; (Word_Count > 0) && (0xFFFFFFFFUL == Erased_Bits); Word_Count--){
+		Erased_Bits = *Flash_Word;
+		Flash_Word++;
+	}
+	return (0xFFFFFFFFUL == Erased_Bits) ? 1 : 0;
+}
+
+/*****************************************Software Interface Implementation End*****************************************/
@@ -0,0 +1,145 @@
+/**
+ ******************************************************************************
+ * @file           : bl_log.c
+ * @author         : Ahmed Naeim
+ * @brief          : Tokenized bootloader logger, records are queued in a RAM
+ *                   ring and drained by DMA on the debug UART
+ ******************************************************************************
+**/
+
+#include "Bootloader/bl_log.h"
+
+#if BL_LOG_ENABLE
+
+
+
+/*****************************************Global Variables Start*****************************************/
+
+static uint8_t BL_Log_Ring[BL_LOG_RING_SIZE];
+static volatile uint16_t BL_Log_Head = 0;				/* Free running index of the next byte to write */
+static volatile uint16_t BL_Log_Tail = 0;				/* Free running index of the next byte to send */
+static volatile uint16_t BL_Log_Tx_Length = 0;			/* Bytes handed to the DMA, 0 when the channel is idle */
+static uint8_t BL_Log_Sequence = 0;
+static uint32_t BL_Log_Dropped = 0;
+
+/*****************************************Global Variables End*****************************************/
+
+
+
+/*****************************************Static Functions Declarations Start*****************************************/
+
+static void BL_Log_Push(BL_Log_Id Log_Id, const uint8_t *Payload, uint8_t Payload_Len);
+static void BL_Log_Copy_To_Ring(const uint8_t *Data, uint8_t Data_Len);
+static void BL_Log_Start_Transfer(void);
+
+/*****************************************Static Functions Declarations End*****************************************/
+
+
+/*****************************************Software Interface Implementation Start*****************************************/
+
+void BL_Log_Write(BL_Log_Id Log_Id, uint8_t Arg_Count, uint32_t Arg0, uint32_t Arg1){
+	uint32_t Args[BL_LOG_MAX_ARGS] = {Arg0, Arg1};
+
+	if(Arg_Count > BL_LOG_MAX_ARGS){
+		Arg_Count = BL_LOG_MAX_ARGS;
+	}
+	/* Cortex-M3 is little endian, the arguments go out as they are stored */
+	BL_Log_Push(Log_Id, (const uint8_t *)Args, Arg_Count * sizeof(uint32_t));
+}
+
+void BL_Log_Text(const char *Text, uint8_t Text_Len){
+	if(Text_Len > BL_LOG_MAX_TEXT_LENGTH){
+		Text_Len = BL_LOG_MAX_TEXT_LENGTH;
+	}
+	BL_Log_Push(BL_LOG_ID_TEXT, (const uint8_t *)Text, Text_Len);
+}
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart){
+	if(BL_LOG_UART == huart){
+		/* The DMA chunk is out, release it and send whatever was queued meanwhile */
+		BL_Log_Tail += BL_Log_Tx_Length;
+		BL_Log_Tx_Length = 0;
+		BL_Log_Start_Transfer();
+	}
+}
+
+/*****************************************Software Interface Implementation End*****************************************/
+
+
+/*****************************************Static Functions Implementation Start*****************************************/
+
+static void BL_Log_Push(BL_Log_Id Log_Id, const uint8_t *Payload, uint8_t Payload_Len){
+	uint8_t Header[BL_LOG_HEADER_SIZE] = {BL_LOG_SYNC_BYTE, 0, 0, 0};
+	uint32_t Dropped_Count = 0;
+	uint16_t Free_Space = 0;
+	uint32_t Primask = __get_PRIMASK();
+
+	/* The DMA completion interrupt also touches the ring indexes */
+	__disable_irq();
+
+	Free_Space = BL_LOG_RING_SIZE - (uint16_t)(BL_Log_Head - BL_Log_Tail);
+
+	if(BL_Log_Dropped){
+		/* Report the lost records first so the host knows the gap in the sequence numbers is real */
+		if(Free_Space >= (2 * BL_LOG_HEADER_SIZE + sizeof(uint32_t) + Payload_Len)){
+			Dropped_Count = BL_Log_Dropped;
+			BL_Log_Dropped = 0;
+			Header[1] = BL_Log_Sequence++;
+			Header[2] = BL_LOG_ID_RING_OVERFLOW;
+			Header[3] = sizeof(uint32_t);
+			BL_Log_Copy_To_Ring(Header, BL_LOG_HEADER_SIZE);
+			BL_Log_Copy_To_Ring((const uint8_t *)&Dropped_Count, sizeof(uint32_t));
+			Free_Space -= BL_LOG_HEADER_SIZE + sizeof(uint32_t);
+		}
+	}
+
+	if(Free_Space < (BL_LOG_HEADER_SIZE + Payload_Len)){
+		/* Never block the caller, drop the record instead */
+		BL_Log_Dropped++;
+	}
+	else{
+		Header[1] = BL_Log_Sequence++;
+		Header[2] = (uint8_t)Log_Id;
+		Header[3] = Payload_Len;
+		BL_Log_Copy_To_Ring(Header, BL_LOG_HEADER_SIZE);
+		BL_Log_Copy_To_Ring(Payload, Payload_Len);
+	}
+
+	if(0 == BL_Log_Tx_Length){
+		BL_Log_Start_Transfer();
+	}
+
+	__set_PRIMASK(Primask);
+}
+
+static void BL_Log_Copy_To_Ring(const uint8_t *Data, uint8_t Data_Len){
+	uint8_t Data_Counter = 0;
+
+	for(Data_Counter = 0; Data_Counter < Data_Len; Data_Counter++){
+		BL_Log_Ring[BL_Log_Head & (BL_LOG_RING_SIZE - 1)] = Data[Data_Counter];
+		BL_Log_Head++;
+	}
+}
+
+static void BL_Log_Start_Transfer(void){
+	uint16_t Pending_Bytes = (uint16_t)(BL_Log_Head - BL_Log_Tail);
+	uint16_t Tail_Index = BL_Log_Tail & (BL_LOG_RING_SIZE - 1);
+	uint16_t Chunk_Length = 0;
+
+	if(Pending_Bytes){
+		/* The DMA needs a contiguous block, a wrapped ring goes out in two transfers */
+		Chunk_Length = BL_LOG_RING_SIZE - Tail_Index;
+		if(Chunk_Length > Pending_Bytes){
+			Chunk_Length = Pending_Bytes;
+		}
+		BL_Log_Tx_Length = Chunk_Length;
+		if(HAL_OK != HAL_UART_Transmit_DMA(BL_LOG_UART, &BL_Log_Ring[Tail_Index], Chunk_Length)){
+			/* Channel still busy, the next record or completion retries */
+			BL_Log_Tx_Length = 0;
+		}
+	}
+}
+
+/*****************************************Static Functions Implementation End*****************************************/
+
+#endif /* BL_LOG_ENABLE */
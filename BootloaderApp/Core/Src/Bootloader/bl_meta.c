@@ -0,0 +1,248 @@
+/**
+ ******************************************************************************
+ * @file           : bl_meta.c
+ * @author         : Ahmed Naeim
+ * @brief          : Bootloader metadata area, append only records in two
+ *                   flash pages that take turns as the active page
+ ******************************************************************************
+**/
+
+#include <stddef.h>
+#include <string.h>
+#include "Bootloader/bl_meta.h"
+
+
+
+/*****************************************Macro Declaration Start*****************************************/
+
+#define BL_META_PAGE_ADDRESS(Page_Index)		(BL_META_BASE_ADDRESS + ((uint32_t)(Page_Index) * BL_META_PAGE_SIZE))
+#define BL_META_RECORD_SIZE(Payload_Len)		(sizeof(BL_Meta_Record_Header) + (((uint32_t)(Payload_Len) + 3) & ~3UL) + sizeof(uint32_t))
+
+/*****************************************Macro Declaration End*****************************************/
+
+
+
+/*****************************************Data Types Declaration Start*****************************************/
+
+typedef struct{
+	uint32_t Magic;
+	uint32_t Generation;									/* Metadata page erases so far, the complete page with the highest one is active */
+	uint16_t Complete;
+	uint16_t Reserved;
+}BL_Meta_Page_Header;
+
+typedef struct{
+	uint16_t Type;
+	uint16_t Length;
+}BL_Meta_Record_Header;
+
+/*****************************************Data Types Declaration End*****************************************/
+
+
+
+/*****************************************Static Functions Declarations Start*****************************************/
+
+static uint32_t BL_Meta_Active_Page(void);
+static uint32_t BL_Meta_Find(uint32_t Page_Address, uint16_t Record_Type, uint32_t *Free_Offset);
+static BL_Meta_Status BL_Meta_Format(uint32_t Page_Address, uint32_t Generation);
+static BL_Meta_Status BL_Meta_Activate(uint32_t Page_Address);
+static BL_Meta_Status BL_Meta_Append(uint32_t Record_Address, uint16_t Record_Type, const void *Data, uint16_t Data_Len);
+static BL_Meta_Status BL_Meta_Compact(uint32_t *Page_Address, uint16_t Skipped_Type, uint32_t *Free_Offset);
+
+/*****************************************Static Functions Declarations End*****************************************/
+
+
+/*****************************************Software Interface Implementation Start*****************************************/
+
+BL_Meta_Status BL_Meta_Load(uint16_t Record_Type, void *Data, uint16_t Data_Len){
+	BL_Meta_Status Meta_Status = BL_META_NOT_FOUND;
+	uint32_t Page_Address = BL_Meta_Active_Page();
+	uint32_t Record_Address = 0;
+	uint32_t Free_Offset = 0;
+	uint16_t Copy_Len = 0;
+
+	if(0 != Page_Address){
+		Record_Address = BL_Meta_Find(Page_Address, Record_Type, &Free_Offset);
+	}
+	if(0 != Record_Address){
+		Copy_Len = ((const BL_Meta_Record_Header *)Record_Address)->Length;
+		if(Copy_Len > Data_Len){
+			Copy_Len = Data_Len;
+		}
+		memset(Data, 0, Data_Len);
+		memcpy(Data, (const uint8_t *)(Record_Address + sizeof(BL_Meta_Record_Header)), Copy_Len);
+		Meta_Status = BL_META_OK;
+	}
+	return Meta_Status;
+}
+
+BL_Meta_Status BL_Meta_Store(uint16_t Record_Type, const void *Data, uint16_t Data_Len){
+	BL_Meta_Status Meta_Status = BL_META_OK;
+	uint32_t Page_Address = BL_Meta_Active_Page();
+	uint32_t Free_Offset = sizeof(BL_Meta_Page_Header);
+
+	/* With a layout that does not fit the part the metadata pages may share a page with the application */
+	if((BL_META_TYPE_ERASED == Record_Type) || !BL_Flash.Layout_Valid
+			|| (BL_META_RECORD_SIZE(Data_Len) > (BL_META_PAGE_SIZE - sizeof(BL_Meta_Page_Header)))){
+		Meta_Status = BL_META_ERROR;
+	}
+	else if(0 == Page_Address){
+		/* First use of the area, or both pages damaged: start over on the first page */
+		Page_Address = BL_META_PAGE_ADDRESS(0);
+		Meta_Status = BL_Meta_Format(Page_Address, 1);
+		if(BL_META_OK == Meta_Status){
+			Meta_Status = BL_Meta_Activate(Page_Address);
+		}
+	}
+	else{
+		BL_Meta_Find(Page_Address, BL_META_TYPE_ERASED, &Free_Offset);
+		if(BL_META_RECORD_SIZE(Data_Len) > (BL_META_PAGE_SIZE - Free_Offset)){
+			Meta_Status = BL_Meta_Compact(&Page_Address, Record_Type, &Free_Offset);
+		}
+	}
+	if(BL_META_OK == Meta_Status){
+		Meta_Status = BL_Meta_Append(Page_Address + Free_Offset, Record_Type, Data, Data_Len);
+	}
+	return Meta_Status;
+}
+
+uint32_t BL_Meta_Generation(void){
+	uint32_t Page_Address = BL_Meta_Active_Page();
+	uint32_t Generation = 0;
+
+	if(0 != Page_Address){
+		Generation = ((const BL_Meta_Page_Header *)Page_Address)->Generation;
+	}
+	return Generation;
+}
+
+/*****************************************Software Interface Implementation End*****************************************/
+
+
+/*****************************************Static Functions Implementation Start*****************************************/
+
+static uint32_t BL_Meta_Active_Page(void){
+	const BL_Meta_Page_Header *Page_Header = NULL;
+	uint32_t Active_Page = 0;
+	uint32_t Active_Generation = 0;
+	uint8_t Page_Index = 0;
+
+	for(Page_Index = 0; Page_Index < BL_META_PAGE_COUNT; Page_Index++){
+		Page_Header = (const BL_Meta_Page_Header *)BL_META_PAGE_ADDRESS(Page_Index);
+		if((BL_META_MAGIC == Page_Header->Magic) && (BL_META_PAGE_COMPLETE == Page_Header->Complete)
+				&& (Page_Header->Generation >= Active_Generation)){
+			Active_Generation = Page_Header->Generation;
+			Active_Page = BL_META_PAGE_ADDRESS(Page_Index);
+		}
+	}
+	return Active_Page;
+}
+
+static uint32_t BL_Meta_Find(uint32_t Page_Address, uint16_t Record_Type, uint32_t *Free_Offset){
+	const BL_Meta_Record_Header *Record = NULL;
+	uint32_t Record_Address = 0;
+	uint32_t Record_Size = 0;
+	uint32_t Offset = sizeof(BL_Meta_Page_Header);
+	uint32_t Record_CRC = 0;
+
+	while((Offset + sizeof(BL_Meta_Record_Header)) <= BL_META_PAGE_SIZE){
+		Record = (const BL_Meta_Record_Header *)(Page_Address + Offset);
+		if(BL_META_TYPE_ERASED == Record->Type){
+			break;
+		}
+		Record_Size = BL_META_RECORD_SIZE(Record->Length);
+		if(Record_Size > (BL_META_PAGE_SIZE - Offset)){
+			/* Header cut by a reset, nothing can be appended after it */
+			Offset = BL_META_PAGE_SIZE;
+			break;
+		}
+		/* A record cut by a reset fails its CRC and is skipped */
+		Record_CRC = *((const uint32_t *)(Page_Address + Offset + Record_Size - sizeof(uint32_t)));
+		if((Record_Type == Record->Type) &&
+		   (Record_CRC == BL_Port_CRC_Calculate((const uint8_t *)Record, sizeof(BL_Meta_Record_Header) + Record->Length))){
+			Record_Address = Page_Address + Offset;
+		}
+		Offset += Record_Size;
+	}
+	*Free_Offset = Offset;
+	return Record_Address;
+}
+
+static BL_Meta_Status BL_Meta_Format(uint32_t Page_Address, uint32_t Generation){
+	BL_Meta_Status Meta_Status = BL_META_ERROR;
+	BL_Meta_Page_Header Page_Header = {BL_META_MAGIC, Generation, 0xFFFF, 0xFFFF};
+	uint32_t Page_Error = 0;
+
+	/* Complete stays erased, the page is not active until BL_Meta_Activate */
+	if((BL_PORT_OK == BL_Port_Flash_Erase_Pages(Page_Address, 1, &Page_Error))
+			&& (BL_PORT_OK == BL_Port_Flash_Program(Page_Address, (const uint8_t *)&Page_Header, offsetof(BL_Meta_Page_Header, Complete)))){
+		Meta_Status = BL_META_OK;
+	}
+	return Meta_Status;
+}
+
+static BL_Meta_Status BL_Meta_Activate(uint32_t Page_Address){
+	uint16_t Complete = BL_META_PAGE_COMPLETE;
+
+	/* 0xFFFF to 0x0000 needs no erase */
+	return (BL_PORT_OK == BL_Port_Flash_Program(Page_Address + offsetof(BL_Meta_Page_Header, Complete), (const uint8_t *)&Complete, sizeof(Complete)))
+			? BL_META_OK : BL_META_ERROR;
+}
+
+static BL_Meta_Status BL_Meta_Append(uint32_t Record_Address, uint16_t Record_Type, const void *Data, uint16_t Data_Len){
+	BL_Meta_Status Meta_Status = BL_META_ERROR;
+	BL_Meta_Record_Header Record = {Record_Type, Data_Len};
+	uint32_t Record_CRC = 0;
+
+	/* Header first: a record cut after it still tells where the next one starts */
+	if((BL_PORT_OK == BL_Port_Flash_Program(Record_Address, (const uint8_t *)&Record, sizeof(Record)))
+			&& (BL_PORT_OK == BL_Port_Flash_Program(Record_Address + sizeof(Record), (const uint8_t *)Data, Data_Len))){
+		/* CRC of what reached the flash, a bad program shows up as a record that fails its CRC */
+		Record_CRC = BL_Port_CRC_Calculate((const uint8_t *)Record_Address, sizeof(Record) + Data_Len);
+		if(BL_PORT_OK == BL_Port_Flash_Program(Record_Address + BL_META_RECORD_SIZE(Data_Len) - sizeof(uint32_t),
+											   (const uint8_t *)&Record_CRC, sizeof(Record_CRC))){
+			Meta_Status = BL_META_OK;
+		}
+	}
+	return Meta_Status;
+}
+
+static BL_Meta_Status BL_Meta_Compact(uint32_t *Page_Address, uint16_t Skipped_Type, uint32_t *Free_Offset){
+	const BL_Meta_Page_Header *Page_Header = (const BL_Meta_Page_Header *)*Page_Address;
+	const BL_Meta_Record_Header *Record = NULL;
+	BL_Meta_Status Meta_Status = BL_META_ERROR;
+	uint32_t Target_Page = BL_META_PAGE_ADDRESS(0);
+	uint32_t Target_Offset = sizeof(BL_Meta_Page_Header);
+	uint32_t Offset = sizeof(BL_Meta_Page_Header);
+	uint32_t Scan_Offset = 0;
+
+	if(Target_Page == *Page_Address){
+		Target_Page = BL_META_PAGE_ADDRESS(1);
+	}
+	Meta_Status = BL_Meta_Format(Target_Page, Page_Header->Generation + 1);
+
+	/* Copy the newest valid record of every type, the caller appends the new record of Skipped_Type */
+	while((BL_META_OK == Meta_Status) && ((Offset + sizeof(BL_Meta_Record_Header)) <= BL_META_PAGE_SIZE)){
+		Record = (const BL_Meta_Record_Header *)(*Page_Address + Offset);
+		if((BL_META_TYPE_ERASED == Record->Type) || (BL_META_RECORD_SIZE(Record->Length) > (BL_META_PAGE_SIZE - Offset))){
+			break;
+		}
+		if((Skipped_Type != Record->Type) && ((*Page_Address + Offset) == BL_Meta_Find(*Page_Address, Record->Type, &Scan_Offset))){
+			Meta_Status = BL_Meta_Append(Target_Page + Target_Offset, Record->Type,
+										 (const uint8_t *)Record + sizeof(BL_Meta_Record_Header), Record->Length);
+			Target_Offset += BL_META_RECORD_SIZE(Record->Length);
+		}
+		Offset += BL_META_RECORD_SIZE(Record->Length);
+	}
+
+	if(BL_META_OK == Meta_Status){
+		Meta_Status = BL_Meta_Activate(Target_Page);
+	}
+	if(BL_META_OK == Meta_Status){
+		*Page_Address = Target_Page;
+		*Free_Offset = Target_Offset;
+	}
+	return Meta_Status;
+}
+
+/*****************************************Static Functions Implementation End*****************************************/
@@ -0,0 +1,237 @@
+/**
+ ******************************************************************************
+ * @file           : bl_port_hal.c
+ * @author         : Ahmed Naeim
+ * @brief          : Bootloader hardware port on top of the STM32F1 HAL for the
+ *                   cold paths (option bytes, clocks) of the CubeIDE build
+ *                   and the debug / release profiles. The hot path and the
+ *                   erase are in bl_port_ll.c, the HAL ones are kept behind
+ *                   BL_PORT_HAL_HOT_PATH to measure both
+ ******************************************************************************
+**/
+
+#include "Bootloader/bootloader.h"
+
+#if !defined(BL_PORT_LL)
+
+/*****************************************Software Interface Implementation Start*****************************************/
+
+#if defined(BL_PORT_HAL_HOT_PATH)
+
+BL_Port_Status BL_Port_Host_Receive(uint8_t *Data, uint16_t Data_Len, uint32_t Timeout_Ms){
+	BL_Port_Status Port_Status = BL_PORT_OK;
+	HAL_StatusTypeDef HAL_Status = HAL_OK;
+
+	/* HAL_UART_Receive times the whole transfer: the frame timeout after the first byte also bounds every gap */
+	if(Data_Len > 0){
+		HAL_Status = HAL_UART_Receive(BL_HOST_COMMUNICATION_UART, Data, 1, Timeout_Ms);
+	}
+	if((HAL_OK == HAL_Status) && (Data_Len > 1)){
+		HAL_Status = HAL_UART_Receive(BL_HOST_COMMUNICATION_UART, &Data[1], Data_Len - 1, BL_PORT_FRAME_TIMEOUT_MS);
+	}
+	if(HAL_TIMEOUT == HAL_Status){
+		Port_Status = BL_PORT_TIMEOUT;
+	}
+	else if(HAL_OK != HAL_Status){
+		Port_Status = BL_PORT_ERROR;
+	}
+	return Port_Status;
+}
+
+BL_Port_Status BL_Port_Host_Receive_Until(uint8_t *Data, uint16_t Data_Max_Len, uint8_t Delimiter, uint16_t *Data_Len, uint32_t Timeout_Ms){
+	BL_Port_Status Port_Status = BL_PORT_OK;
+	HAL_StatusTypeDef HAL_Status = HAL_OK;
+	uint16_t Data_Counter = 0;
+	uint32_t Frame_Start = 0;
+	uint32_t Frame_Elapsed = 0;
+	uint32_t Byte_Timeout = 0;
+	uint8_t Data_Byte = 0;
+
+	HAL_Status = HAL_UART_Receive(BL_HOST_COMMUNICATION_UART, &Data_Byte, 1, Timeout_Ms);
+	Frame_Start = HAL_GetTick();
+	for(;;){
+		if(HAL_OK != HAL_Status){
+			Port_Status = (HAL_TIMEOUT == HAL_Status) ? BL_PORT_TIMEOUT : BL_PORT_ERROR;
+			break;
+		}
+		if(Delimiter == Data_Byte){
+			break;
+		}
+		if(Data_Counter < Data_Max_Len){
+			Data[Data_Counter++] = Data_Byte;
+		}
+		else{
+			Port_Status = BL_PORT_ERROR;
+		}
+		/* The next byte within the inter-byte timeout and the frame timeout, whichever ends first */
+		Frame_Elapsed = HAL_GetTick() - Frame_Start;
+		Byte_Timeout = (Frame_Elapsed < BL_PORT_FRAME_TIMEOUT_MS) ? (BL_PORT_FRAME_TIMEOUT_MS - Frame_Elapsed) : 0;
+		if(Byte_Timeout > BL_PORT_INTER_BYTE_TIMEOUT_MS){
+			Byte_Timeout = BL_PORT_INTER_BYTE_TIMEOUT_MS;
+		}
+		HAL_Status = HAL_UART_Receive(BL_HOST_COMMUNICATION_UART, &Data_Byte, 1, Byte_Timeout);
+	}
+	*Data_Len = Data_Counter;
+	return Port_Status;
+}
+
+void BL_Port_Host_Transmit(const uint8_t *Data, uint16_t Data_Len){
+	/* The longest reply is out in 23 ms at 115200 baud, a transmit never blocks longer than the frame timeout */
+	HAL_UART_Transmit(BL_HOST_COMMUNICATION_UART, (uint8_t *)Data, Data_Len, BL_PORT_FRAME_TIMEOUT_MS);
+}
+
+uint32_t BL_Port_CRC_Calculate(const uint8_t *Data, uint32_t Data_Len){
+	uint32_t CRC_Value = 0;
+	uint32_t Data_Counter = 0;
+	uint32_t Data_Buffer = 0;			/* HAL_CRC_Accumulate takes words, every byte goes in its own word */
+
+	for(Data_Counter = 0; Data_Counter < Data_Len; Data_Counter++){
+		Data_Buffer = (uint32_t)Data[Data_Counter];
+		CRC_Value = HAL_CRC_Accumulate(CRC_ENGINE_OBJ, &Data_Buffer, 1);
+	}
+
+	/* Reset CRC Calculation Unit */
+	__HAL_CRC_DR_RESET(CRC_ENGINE_OBJ);
+
+	return CRC_Value;
+}
+
+BL_Port_Status BL_Port_Flash_Program(uint32_t Address, const uint8_t *Data, uint16_t Data_Len){
+	BL_Port_Status Port_Status = BL_PORT_OK;
+	uint16_t Data_Counter = 0;
+	uint16_t Half_Word = 0;
+
+	if(Address & 0x01){
+		/* The flash is programmed in half-words */
+		Port_Status = BL_PORT_ERROR;
+	}
+	else if(HAL_OK != HAL_FLASH_Unlock()){
+		Port_Status = BL_PORT_LOCKED;
+	}
+	else{
+		for(Data_Counter = 0; (Data_Counter < Data_Len) && (BL_PORT_OK == Port_Status); Data_Counter += 2){
+			/* An odd length leaves the last high byte erased */
+			Half_Word = Data[Data_Counter];
+			Half_Word |= ((Data_Counter + 1) < Data_Len) ? ((uint16_t)Data[Data_Counter + 1] << 8) : 0xFF00;
+			if(HAL_OK != HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, Address + Data_Counter, Half_Word)){
+				Port_Status = BL_PORT_ERROR;
+			}
+		}
+		HAL_FLASH_Lock();
+	}
+	return Port_Status;
+}
+
+BL_Port_Status BL_Port_Flash_Post_Program(uint32_t Address, const uint8_t *Data, uint16_t Data_Len){
+	/* HAL_UART_Receive can't feed a bank 2 payload, every payload is programmed before the reply */
+	return BL_Port_Flash_Program(Address, Data, Data_Len);
+}
+
+BL_Port_Status BL_Port_Flash_Sync(void){
+	return BL_PORT_OK;
+}
+
+BL_Port_Status BL_Port_Flash_Erase_Pages(uint32_t Page_Address, uint16_t Number_of_Pages, uint32_t *Page_Error){
+	BL_Port_Status Port_Status = BL_PORT_OK;
+	FLASH_EraseInitTypeDef Erase_Init;
+	uint16_t Page_Counter = 0;
+
+	Erase_Init.TypeErase = FLASH_TYPEERASE_PAGES;
+	Erase_Init.Banks = FLASH_BANK_1;
+	Erase_Init.NbPages = 1;
+
+	if(HAL_OK != HAL_FLASH_Unlock()){
+		Port_Status = BL_PORT_LOCKED;
+	}
+	else{
+		/* One page per call: HAL_FLASHEx_Erase steps by the FLASH_PAGE_SIZE of the device header, the part may have
+		 * 2 KB pages. Bank 1 only, BL_Flash leaves bank 2 out of the flash in this build (BL_PORT_FLASH_DUAL_BANK) */
+		for(Page_Counter = 0; (Page_Counter < Number_of_Pages) && (BL_PORT_OK == Port_Status); Page_Counter++){
+			Erase_Init.PageAddress = Page_Address + ((uint32_t)Page_Counter * BL_Flash.Page_Size);
+			if(HAL_OK != HAL_FLASHEx_Erase(&Erase_Init, Page_Error)){
+				Port_Status = BL_PORT_ERROR;
+			}
+		}
+		HAL_FLASH_Lock();
+	}
+	return Port_Status;
+}
+
+BL_Port_Status BL_Port_Flash_Mass_Erase(void){
+	BL_Port_Status Port_Status = BL_PORT_ERROR;
+	FLASH_EraseInitTypeDef Erase_Init;
+	uint32_t Page_Error = 0;
+
+	Erase_Init.TypeErase = FLASH_TYPEERASE_MASSERASE;
+	Erase_Init.Banks = FLASH_BANK_1;
+
+	if(HAL_OK != HAL_FLASH_Unlock()){
+		Port_Status = BL_PORT_LOCKED;
+	}
+	else{
+		if(HAL_OK == HAL_FLASHEx_Erase(&Erase_Init, &Page_Error)){
+			Port_Status = BL_PORT_OK;
+		}
+		HAL_FLASH_Lock();
+	}
+	return Port_Status;
+}
+
+#endif /* BL_PORT_HAL_HOT_PATH */
+
+uint8_t BL_Port_Get_RDP_Level(void){
+	FLASH_OBProgramInitTypeDef FLASH_OBProgram;
+
+	/* Get the Option byte configuration */
+	HAL_FLASHEx_OBGetConfig(&FLASH_OBProgram);
+
+	return (uint8_t)(FLASH_OBProgram.RDPLevel);
+}
+
+BL_Port_Status BL_Port_Set_RDP_Level(uint8_t RDP_Level){
+	BL_Port_Status Port_Status = BL_PORT_ERROR;
+	FLASH_OBProgramInitTypeDef FLASH_OBProgramInit;
+
+	FLASH_OBProgramInit.OptionType = OPTIONBYTE_RDP;
+	FLASH_OBProgramInit.Banks = FLASH_BANK_1;
+	FLASH_OBProgramInit.RDPLevel = RDP_Level;
+
+	/* The option byte keys are only accepted once the flash control register is unlocked */
+	if((HAL_OK != HAL_FLASH_Unlock()) || (HAL_OK != HAL_FLASH_OB_Unlock())){
+		HAL_FLASH_Lock();
+		Port_Status = BL_PORT_LOCKED;
+	}
+	else if(HAL_OK != HAL_FLASHEx_OBProgram(&FLASH_OBProgramInit)){
+		HAL_FLASH_OB_Lock();
+		HAL_FLASH_Lock();
+		Port_Status = BL_PORT_ERROR;
+	}
+	else{
+		/* Reload the option bytes, this resets the MCU */
+		HAL_FLASH_OB_Launch();
+		Port_Status = BL_PORT_OK;
+	}
+	return Port_Status;
+}
+
+void BL_Port_DeInit(void){
+	uint32_t Drain_Start = HAL_GetTick();
+
+	/* The log records queued before the jump go out first, the completion interrupt chains the chunks of the ring */
+	while((HAL_UART_STATE_BUSY_TX == (BL_LOG_UART)->gState) && ((HAL_GetTick() - Drain_Start) < BL_PORT_LOG_DRAIN_TIMEOUT_MS)){}
+	/* Then the debug UART stops for good: no DMA request and no USART3 or DMA1 channel 2 interrupt may reach the
+	 * vector table of the application */
+	HAL_UART_AbortTransmit(BL_LOG_UART);
+	HAL_DMA_DeInit((BL_LOG_UART)->hdmatx);
+	HAL_UART_DeInit(BL_LOG_UART);
+	HAL_NVIC_DisableIRQ(DMA1_Channel2_IRQn);
+	HAL_NVIC_DisableIRQ(USART3_IRQn);
+	HAL_NVIC_ClearPendingIRQ(DMA1_Channel2_IRQn);
+	HAL_NVIC_ClearPendingIRQ(USART3_IRQn);
+
+	HAL_RCC_DeInit();						/*MANTADORY*/ /*Resets the RCC clock configuration to the default reset state.*/
+}
+
+/*****************************************Software Interface Implementation End*****************************************/
+
+#endif /* !BL_PORT_LL */
@@ -0,0 +1,486 @@
+/**
+ ******************************************************************************
+ * @file           : bl_port_ll.c
+ * @author         : Ahmed Naeim
+ * @brief          : Bootloader hardware port on top of the LL drivers and the
+ *                   flash registers. The hot path (host UART bytes, frame CRC,
+ *                   half-word programming) and the erase are used by every
+ *                   build, the cold path (clocks, option bytes) and main()
+ *                   only by the size profile, which has no HAL. Every
+ *                   flash access goes to the controller of the bank it falls
+ *                   in, bank 2 payloads are programmed while the next frame
+ *                   arrives
+ ******************************************************************************
+**/
+
+#include "Bootloader/bootloader.h"
+
+#if (defined(BL_PORT_LL) || !defined(BL_PORT_HAL_HOT_PATH))
+
+#include "stm32f1xx_ll_bus.h"
+#include "stm32f1xx_ll_rcc.h"
+#include "stm32f1xx_ll_system.h"
+#include "stm32f1xx_ll_gpio.h"
+#include "stm32f1xx_ll_usart.h"
+#include "stm32f1xx_ll_crc.h"
+
+
+
+/*****************************************Macro Declaration Start*****************************************/
+
+#define BL_PORT_HOST_USART						USART2				/* huart2 in the HAL builds */
+#define BL_PORT_PCLK1_FREQ						(BL_PORT_SYSCLK_FREQ / 2)
+#define BL_PORT_FLASH_ERRORS					(FLASH_SR_PGERR | FLASH_SR_WRPRTERR)
+#define BL_PORT_CYCLES_PER_MS					(BL_PORT_SYSCLK_FREQ / 1000U)	/* DWT cycles, the host link timeouts count them */
+
+/* Bank 2 of the XL density parts has its own KEYR, SR, CR and AR 0x40 after the bank 1 ones (FLASH_KEYR2 to FLASH_AR2),
+ * stm32f103xb.h only knows bank 1. Bank_1_End is the flash end on the single bank parts */
+#define BL_PORT_FLASH_BANK_1					((BL_Port_Flash_Bank *)&FLASH->KEYR)
+#define BL_PORT_FLASH_BANK_2					((BL_Port_Flash_Bank *)(FLASH_R_BASE + 0x44UL))
+#define BL_PORT_FLASH_BANK(Address)				(((Address) < BL_Flash.Bank_1_End) ? BL_PORT_FLASH_BANK_1 : BL_PORT_FLASH_BANK_2)
+
+/*****************************************Macro Declaration End*****************************************/
+
+
+
+/*****************************************Data Types Declaration Start*****************************************/
+
+/* Same layout as the KEYR to AR registers of FLASH_TypeDef */
+typedef struct{
+	volatile uint32_t KEYR;
+	volatile uint32_t OPTKEYR;								/* Bank 1 only, reserved in bank 2 */
+	volatile uint32_t SR;
+	volatile uint32_t CR;
+	volatile uint32_t AR;
+}BL_Port_Flash_Bank;
+
+/* Bank 2 payload of BL_Port_Flash_Post_Program, one half-word is started every time the controller is idle */
+typedef struct{
+	uint8_t Data[BL_PORT_POSTED_MAX_LENGTH];
+	uint8_t Active;											/* PG set and bank 2 unlocked */
+	uint16_t Length;
+	uint16_t Offset;										/* Next half-word to program */
+	uint32_t Address;
+	BL_Port_Status Status;									/* BL_PORT_ERROR once a half-word failed */
+}BL_Port_Posted_Write;
+
+/*****************************************Data Types Declaration End*****************************************/
+
+
+
+/*****************************************Global Variables Start*****************************************/
+
+static BL_Port_Posted_Write BL_Port_Posted;
+
+/*****************************************Global Variables End*****************************************/
+
+
+
+/*****************************************Static Functions Declarations Start*****************************************/
+
+static BL_Port_Status BL_Port_Host_Receive_Byte(uint8_t *Data_Byte, uint32_t Timeout_Ms, uint32_t *Frame_Start, uint16_t Byte_Index);
+static BL_Port_Status BL_Port_Flash_Program_Bank(BL_Port_Flash_Bank *Bank, uint32_t Address, const uint8_t *Data, uint16_t Data_Len);
+static BL_Port_Status BL_Port_Flash_Unlock(BL_Port_Flash_Bank *Bank);
+static void BL_Port_Flash_Lock(BL_Port_Flash_Bank *Bank);
+static BL_Port_Status BL_Port_Flash_Wait(BL_Port_Flash_Bank *Bank);
+static void BL_Port_Flash_Service(void);
+
+/*****************************************Static Functions Declarations End*****************************************/
+
+
+/*****************************************Software Interface Implementation Start*****************************************/
+
+/*
+ * Hot path: no handle state machine, no HAL_GetTick timeout and no per half-word unlock/lock,
+ * the loops only poll the status flag they wait for.
+ * */
+
+BL_Port_Status BL_Port_Host_Receive(uint8_t *Data, uint16_t Data_Len, uint32_t Timeout_Ms){
+	BL_Port_Status Port_Status = BL_PORT_OK;
+	uint16_t Data_Counter = 0;
+	uint32_t Frame_Start = 0;
+
+	for(Data_Counter = 0; (Data_Counter < Data_Len) && (BL_PORT_OK == Port_Status); Data_Counter++){
+		Port_Status = BL_Port_Host_Receive_Byte(&Data[Data_Counter], Timeout_Ms, &Frame_Start, Data_Counter);
+	}
+	return Port_Status;
+}
+
+BL_Port_Status BL_Port_Host_Receive_Until(uint8_t *Data, uint16_t Data_Max_Len, uint8_t Delimiter, uint16_t *Data_Len, uint32_t Timeout_Ms){
+	BL_Port_Status Port_Status = BL_PORT_OK;
+	BL_Port_Status Receive_Status = BL_PORT_OK;
+	uint16_t Data_Counter = 0;
+	uint16_t Byte_Counter = 0;
+	uint32_t Frame_Start = 0;
+	uint8_t Data_Byte = 0;
+
+	for(;;){
+		/* The frame timeout ends a frame long before Byte_Counter could wrap */
+		Receive_Status = BL_Port_Host_Receive_Byte(&Data_Byte, Timeout_Ms, &Frame_Start, Byte_Counter++);
+		if((BL_PORT_OK != Receive_Status) || (Delimiter == Data_Byte)){
+			break;
+		}
+		if(Data_Counter < Data_Max_Len){
+			Data[Data_Counter++] = Data_Byte;
+		}
+		else{
+			Port_Status = BL_PORT_ERROR;
+		}
+	}
+	*Data_Len = Data_Counter;
+	return (BL_PORT_OK != Receive_Status) ? Receive_Status : Port_Status;
+}
+
+void BL_Port_Host_Transmit(const uint8_t *Data, uint16_t Data_Len){
+	/* No hardware flow control, TXE and TC come back every byte time: the loops can't hang on the host */
+	uint16_t Data_Counter = 0;
+
+	for(Data_Counter = 0; Data_Counter < Data_Len; Data_Counter++){
+		while(!LL_USART_IsActiveFlag_TXE(BL_PORT_HOST_USART)){}
+		LL_USART_TransmitData8(BL_PORT_HOST_USART, Data[Data_Counter]);
+	}
+	/* Return once the last stop bit is out, a jump may follow */
+	while(!LL_USART_IsActiveFlag_TC(BL_PORT_HOST_USART)){}
+}
+
+uint32_t BL_Port_CRC_Calculate(const uint8_t *Data, uint32_t Data_Len){
+	uint32_t CRC_Value = 0;
+	uint32_t Data_Counter = 0;
+
+	LL_CRC_ResetCRCCalculationUnit(CRC);
+	for(Data_Counter = 0; Data_Counter < Data_Len; Data_Counter++){
+		LL_CRC_FeedData32(CRC, (uint32_t)Data[Data_Counter]);
+	}
+	CRC_Value = LL_CRC_ReadData32(CRC);
+	LL_CRC_ResetCRCCalculationUnit(CRC);
+
+	return CRC_Value;
+}
+
+BL_Port_Status BL_Port_Flash_Program(uint32_t Address, const uint8_t *Data, uint16_t Data_Len){
+	BL_Port_Status Port_Status = BL_PORT_ERROR;
+	uint16_t Bank_1_Len = Data_Len;
+
+	if(0 == (Address & 0x01)){
+		/* A payload running over the end of bank 1 goes on through the bank 2 controller, the bank end is page aligned */
+		if((Address < BL_Flash.Bank_1_End) && ((BL_Flash.Bank_1_End - Address) < Data_Len)){
+			Bank_1_Len = (uint16_t)(BL_Flash.Bank_1_End - Address);
+		}
+		Port_Status = BL_Port_Flash_Program_Bank(BL_PORT_FLASH_BANK(Address), Address, Data, Bank_1_Len);
+		if((BL_PORT_OK == Port_Status) && (Bank_1_Len < Data_Len)){
+			Port_Status = BL_Port_Flash_Program_Bank(BL_PORT_FLASH_BANK_2, Address + Bank_1_Len, &Data[Bank_1_Len], Data_Len - Bank_1_Len);
+		}
+	}
+	return Port_Status;
+}
+
+BL_Port_Status BL_Port_Flash_Post_Program(uint32_t Address, const uint8_t *Data, uint16_t Data_Len){
+	BL_Port_Status Port_Status = BL_Port_Flash_Sync();
+
+	if(BL_PORT_OK == Port_Status){
+		if((Address >= BL_Flash.Bank_1_End) && (Address < BL_Flash.Flash_End) && (0 == (Address & 0x01))
+				&& (Data_Len > 0) && (Data_Len <= BL_PORT_POSTED_MAX_LENGTH)){
+			/* Only bank 2 runs on its own: the bootloader executes from bank 1, a bank 1 program stalls its fetches */
+			Port_Status = BL_Port_Flash_Unlock(BL_PORT_FLASH_BANK_2);
+			if(BL_PORT_OK == Port_Status){
+				memcpy(BL_Port_Posted.Data, Data, Data_Len);
+				BL_Port_Posted.Address = Address;
+				BL_Port_Posted.Length = Data_Len;
+				BL_Port_Posted.Offset = 0;
+				BL_Port_Posted.Status = BL_PORT_OK;
+				BL_Port_Posted.Active = 1;
+				SET_BIT(BL_PORT_FLASH_BANK_2->CR, FLASH_CR_PG);
+				BL_Port_Flash_Service();
+				Port_Status = BL_PORT_POSTED;
+			}
+		}
+		else{
+			Port_Status = BL_Port_Flash_Program(Address, Data, Data_Len);
+		}
+	}
+	return Port_Status;
+}
+
+BL_Port_Status BL_Port_Flash_Sync(void){
+	BL_Port_Status Port_Status = BL_PORT_OK;
+
+	while(BL_Port_Posted.Active){
+		BL_Port_Flash_Service();
+	}
+	/* Reported once, the next payload starts clean */
+	Port_Status = BL_Port_Posted.Status;
+	BL_Port_Posted.Status = BL_PORT_OK;
+
+	return Port_Status;
+}
+
+/* The HAL builds erase here too: the HAL of the stm32f103xb build only knows the bank 1 controller */
+BL_Port_Status BL_Port_Flash_Erase_Pages(uint32_t Page_Address, uint16_t Number_of_Pages, uint32_t *Page_Error){
+	BL_Port_Status Port_Status = BL_PORT_OK;
+	BL_Port_Flash_Bank *Bank = NULL;
+	uint16_t Page_Counter = 0;
+
+	*Page_Error = HAL_SUCCESSFUL_ERASE;
+	for(Page_Counter = 0; (Page_Counter < Number_of_Pages) && (BL_PORT_OK == Port_Status); Page_Counter++){
+		Bank = BL_PORT_FLASH_BANK(Page_Address);
+		Port_Status = BL_Port_Flash_Unlock(Bank);
+		if(BL_PORT_OK == Port_Status){
+			SET_BIT(Bank->CR, FLASH_CR_PER);
+			WRITE_REG(Bank->AR, Page_Address);
+			SET_BIT(Bank->CR, FLASH_CR_STRT);
+			Port_Status = BL_Port_Flash_Wait(Bank);
+			CLEAR_BIT(Bank->CR, FLASH_CR_PER);
+		}
+		BL_Port_Flash_Lock(Bank);
+		if(BL_PORT_OK != Port_Status){
+			/* Same convention as HAL_FLASHEx_Erase, the failing page address */
+			*Page_Error = Page_Address;
+		}
+		Page_Address += BL_Flash.Page_Size;
+	}
+
+	return Port_Status;
+}
+
+BL_Port_Status BL_Port_Flash_Mass_Erase(void){
+	BL_Port_Status Port_Status = BL_PORT_OK;
+	BL_Port_Flash_Bank *Bank = BL_PORT_FLASH_BANK_1;
+
+	/* MER erases the bank of its controller, a dual bank part takes one per bank */
+	while((NULL != Bank) && (BL_PORT_OK == Port_Status)){
+		Port_Status = BL_Port_Flash_Unlock(Bank);
+		if(BL_PORT_OK == Port_Status){
+			SET_BIT(Bank->CR, FLASH_CR_MER);
+			SET_BIT(Bank->CR, FLASH_CR_STRT);
+			Port_Status = BL_Port_Flash_Wait(Bank);
+			CLEAR_BIT(Bank->CR, FLASH_CR_MER);
+		}
+		BL_Port_Flash_Lock(Bank);
+		Bank = ((BL_PORT_FLASH_BANK_1 == Bank) && (BL_Flash.Bank_1_End < BL_Flash.Flash_End)) ? BL_PORT_FLASH_BANK_2 : NULL;
+	}
+
+	return Port_Status;
+}
+
+#if defined(BL_PORT_LL)
+
+void BL_Port_Init(void){
+	/* 72 MHz needs two flash wait states before the switch */
+	LL_FLASH_SetLatency(LL_FLASH_LATENCY_2);
+	LL_RCC_HSE_Enable();
+	while(!LL_RCC_HSE_IsReady()){}
+	LL_RCC_PLL_ConfigDomain_SYS(LL_RCC_PLLSOURCE_HSE_DIV_1, LL_RCC_PLL_MUL_9);
+	LL_RCC_PLL_Enable();
+	while(!LL_RCC_PLL_IsReady()){}
+	LL_RCC_SetAHBPrescaler(LL_RCC_SYSCLK_DIV_1);
+	LL_RCC_SetAPB1Prescaler(LL_RCC_APB1_DIV_2);
+	LL_RCC_SetAPB2Prescaler(LL_RCC_APB2_DIV_1);
+	LL_RCC_SetSysClkSource(LL_RCC_SYS_CLKSOURCE_PLL);
+	while(LL_RCC_SYS_CLKSOURCE_STATUS_PLL != LL_RCC_GetSysClkSource()){}
+	SystemCoreClock = BL_PORT_SYSCLK_FREQ;
+
+	LL_APB2_GRP1_EnableClock(LL_APB2_GRP1_PERIPH_AFIO | LL_APB2_GRP1_PERIPH_GPIOA);
+	LL_APB1_GRP1_EnableClock(LL_APB1_GRP1_PERIPH_USART2);
+	LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_CRC);
+
+	/* USART2 GPIO Configuration: PA2 ------> USART2_TX, PA3 ------> USART2_RX */
+	LL_GPIO_SetPinMode(GPIOA, LL_GPIO_PIN_2, LL_GPIO_MODE_ALTERNATE);
+	LL_GPIO_SetPinSpeed(GPIOA, LL_GPIO_PIN_2, LL_GPIO_SPEED_FREQ_HIGH);
+	LL_GPIO_SetPinOutputType(GPIOA, LL_GPIO_PIN_2, LL_GPIO_OUTPUT_PUSHPULL);
+	LL_GPIO_SetPinMode(GPIOA, LL_GPIO_PIN_3, LL_GPIO_MODE_FLOATING);
+
+	/* 115200 8N1, same settings as MX_USART2_UART_Init */
+	LL_USART_ConfigCharacter(BL_PORT_HOST_USART, LL_USART_DATAWIDTH_8B, LL_USART_PARITY_NONE, LL_USART_STOPBITS_1);
+	LL_USART_SetTransferDirection(BL_PORT_HOST_USART, LL_USART_DIRECTION_TX_RX);
+	LL_USART_SetHWFlowCtrl(BL_PORT_HOST_USART, LL_USART_HWCONTROL_NONE);
+	LL_USART_SetBaudRate(BL_PORT_HOST_USART, BL_PORT_PCLK1_FREQ, BL_PORT_HOST_BAUD_RATE);
+	LL_USART_Enable(BL_PORT_HOST_USART);
+}
+
+uint8_t BL_Port_Get_RDP_Level(void){
+	return (READ_BIT(FLASH->OBR, FLASH_OBR_RDPRT)) ? BL_PORT_RDP_LEVEL_1 : BL_PORT_RDP_LEVEL_0;
+}
+
+BL_Port_Status BL_Port_Set_RDP_Level(uint8_t RDP_Level){
+	BL_Port_Status Port_Status = BL_Port_Flash_Unlock(BL_PORT_FLASH_BANK_1);
+
+	if(BL_PORT_OK == Port_Status){
+		/* The option byte keys are only accepted once the flash control register is unlocked */
+		WRITE_REG(FLASH->OPTKEYR, FLASH_OPTKEY1);
+		WRITE_REG(FLASH->OPTKEYR, FLASH_OPTKEY2);
+		if(!READ_BIT(FLASH->CR, FLASH_CR_OPTWRE)){
+			Port_Status = BL_PORT_LOCKED;
+		}
+	}
+	if(BL_PORT_OK == Port_Status){
+		/* Same sequence as HAL_FLASHEx_OBProgram for OPTIONBYTE_RDP: erase the option bytes, then program RDP */
+		SET_BIT(FLASH->CR, FLASH_CR_OPTER);
+		SET_BIT(FLASH->CR, FLASH_CR_STRT);
+		Port_Status = BL_Port_Flash_Wait(BL_PORT_FLASH_BANK_1);
+		CLEAR_BIT(FLASH->CR, FLASH_CR_OPTER);
+		if(BL_PORT_OK == Port_Status){
+			SET_BIT(FLASH->CR, FLASH_CR_OPTPG);
+			WRITE_REG(OB->RDP, RDP_Level);
+			Port_Status = BL_Port_Flash_Wait(BL_PORT_FLASH_BANK_1);
+			CLEAR_BIT(FLASH->CR, FLASH_CR_OPTPG);
+		}
+	}
+	if(BL_PORT_OK == Port_Status){
+		/* Reload the option bytes, this resets the MCU */
+		NVIC_SystemReset();
+	}
+	CLEAR_BIT(FLASH->CR, FLASH_CR_OPTWRE);
+	BL_Port_Flash_Lock(BL_PORT_FLASH_BANK_1);
+
+	return Port_Status;
+}
+
+void BL_Port_DeInit(void){
+	LL_USART_Disable(BL_PORT_HOST_USART);
+	LL_APB1_GRP1_ForceReset(LL_APB1_GRP1_PERIPH_USART2);
+	LL_APB1_GRP1_ReleaseReset(LL_APB1_GRP1_PERIPH_USART2);
+
+	/* Back to the reset clock tree (HSI 8 MHz, no PLL) like HAL_RCC_DeInit */
+	LL_RCC_HSI_Enable();
+	while(!LL_RCC_HSI_IsReady()){}
+	LL_RCC_SetSysClkSource(LL_RCC_SYS_CLKSOURCE_HSI);
+	while(LL_RCC_SYS_CLKSOURCE_STATUS_HSI != LL_RCC_GetSysClkSource()){}
+	LL_RCC_SetAHBPrescaler(LL_RCC_SYSCLK_DIV_1);
+	LL_RCC_SetAPB1Prescaler(LL_RCC_APB1_DIV_1);
+	LL_RCC_SetAPB2Prescaler(LL_RCC_APB2_DIV_1);
+	LL_RCC_PLL_Disable();
+	while(LL_RCC_PLL_IsReady()){}
+	LL_RCC_HSE_Disable();
+	LL_FLASH_SetLatency(LL_FLASH_LATENCY_0);
+	SystemCoreClock = HSI_VALUE;
+
+	LL_APB1_GRP1_DisableClock(LL_APB1_GRP1_PERIPH_USART2);
+	LL_APB2_GRP1_DisableClock(LL_APB2_GRP1_PERIPH_AFIO | LL_APB2_GRP1_PERIPH_GPIOA);
+	LL_AHB1_GRP1_DisableClock(LL_AHB1_GRP1_PERIPH_CRC);
+}
+
+#endif /* BL_PORT_LL */
+
+/*****************************************Software Interface Implementation End*****************************************/
+
+
+/*****************************************Static Functions Implementation Start*****************************************/
+
+static BL_Port_Status BL_Port_Host_Receive_Byte(uint8_t *Data_Byte, uint32_t Timeout_Ms, uint32_t *Frame_Start, uint16_t Byte_Index){
+	/* Byte 0 waits up to Timeout_Ms and starts the frame, the next ones the inter-byte timeout within the frame timeout */
+	BL_Port_Status Port_Status = BL_PORT_OK;
+	uint32_t Wait_Start = BL_CYCLE_COUNTER();
+	uint32_t Wait_Cycles = (0 == Byte_Index) ? (Timeout_Ms * BL_PORT_CYCLES_PER_MS) : (BL_PORT_INTER_BYTE_TIMEOUT_MS * BL_PORT_CYCLES_PER_MS);
+	uint8_t Wait_Forever = ((0 == Byte_Index) && (BL_PORT_WAIT_FOREVER == Timeout_Ms)) ? 1 : 0;
+
+	while(!LL_USART_IsActiveFlag_RXNE(BL_PORT_HOST_USART) && (BL_PORT_OK == Port_Status)){
+		/* A byte takes 87 us at 115200 baud, more than a half-word program: the bank 2 payload never waits for us */
+		BL_Port_Flash_Service();
+		if(!Wait_Forever && (((BL_CYCLE_COUNTER() - Wait_Start) > Wait_Cycles) ||
+				((0 != Byte_Index) && ((BL_CYCLE_COUNTER() - *Frame_Start) > (BL_PORT_FRAME_TIMEOUT_MS * BL_PORT_CYCLES_PER_MS))))){
+			Port_Status = BL_PORT_TIMEOUT;
+		}
+	}
+	if(BL_PORT_OK == Port_Status){
+		*Data_Byte = LL_USART_ReceiveData8(BL_PORT_HOST_USART);
+		if(0 == Byte_Index){
+			*Frame_Start = BL_CYCLE_COUNTER();
+		}
+	}
+	return Port_Status;
+}
+
+static BL_Port_Status BL_Port_Flash_Program_Bank(BL_Port_Flash_Bank *Bank, uint32_t Address, const uint8_t *Data, uint16_t Data_Len){
+	BL_Port_Status Port_Status = BL_Port_Flash_Unlock(Bank);
+	uint16_t Data_Counter = 0;
+	uint16_t Half_Word = 0;
+
+	if(BL_PORT_OK == Port_Status){
+		/* PG stays set for the whole payload, every half-word write starts one programming cycle */
+		SET_BIT(Bank->CR, FLASH_CR_PG);
+		for(Data_Counter = 0; (Data_Counter < Data_Len) && (BL_PORT_OK == Port_Status); Data_Counter += 2){
+			/* An odd length leaves the last high byte erased */
+			Half_Word = Data[Data_Counter];
+			Half_Word |= ((Data_Counter + 1) < Data_Len) ? ((uint16_t)Data[Data_Counter + 1] << 8) : 0xFF00;
+			*(volatile uint16_t *)(Address + Data_Counter) = Half_Word;
+			Port_Status = BL_Port_Flash_Wait(Bank);
+		}
+		CLEAR_BIT(Bank->CR, FLASH_CR_PG);
+		BL_Port_Flash_Lock(Bank);
+	}
+	return Port_Status;
+}
+
+static BL_Port_Status BL_Port_Flash_Unlock(BL_Port_Flash_Bank *Bank){
+	if(READ_BIT(Bank->CR, FLASH_CR_LOCK)){
+		WRITE_REG(Bank->KEYR, FLASH_KEY1);
+		WRITE_REG(Bank->KEYR, FLASH_KEY2);
+	}
+	return (READ_BIT(Bank->CR, FLASH_CR_LOCK)) ? BL_PORT_LOCKED : BL_PORT_OK;
+}
+
+static void BL_Port_Flash_Lock(BL_Port_Flash_Bank *Bank){
+	SET_BIT(Bank->CR, FLASH_CR_LOCK);
+}
+
+static BL_Port_Status BL_Port_Flash_Wait(BL_Port_Flash_Bank *Bank){
+	BL_Port_Status Port_Status = BL_PORT_OK;
+
+	while(READ_BIT(Bank->SR, FLASH_SR_BSY)){}
+	if(READ_BIT(Bank->SR, BL_PORT_FLASH_ERRORS)){
+		Port_Status = BL_PORT_ERROR;
+	}
+	/* The status flags are cleared by writing 1 */
+	WRITE_REG(Bank->SR, FLASH_SR_EOP | BL_PORT_FLASH_ERRORS);
+
+	return Port_Status;
+}
+
+static void BL_Port_Flash_Service(void){
+	BL_Port_Flash_Bank *Bank = BL_PORT_FLASH_BANK_2;
+	uint16_t Half_Word = 0;
+
+	if(BL_Port_Posted.Active && !READ_BIT(Bank->SR, FLASH_SR_BSY)){
+		/* The previous half-word is done, a failure drops the rest of the payload */
+		if(READ_BIT(Bank->SR, BL_PORT_FLASH_ERRORS)){
+			BL_Port_Posted.Status = BL_PORT_ERROR;
+		}
+		WRITE_REG(Bank->SR, FLASH_SR_EOP | BL_PORT_FLASH_ERRORS);
+		if((BL_PORT_OK == BL_Port_Posted.Status) && (BL_Port_Posted.Offset < BL_Port_Posted.Length)){
+			/* An odd length leaves the last high byte erased */
+			Half_Word = BL_Port_Posted.Data[BL_Port_Posted.Offset];
+			Half_Word |= ((BL_Port_Posted.Offset + 1) < BL_Port_Posted.Length) ? ((uint16_t)BL_Port_Posted.Data[BL_Port_Posted.Offset + 1] << 8) : 0xFF00;
+			*(volatile uint16_t *)(BL_Port_Posted.Address + BL_Port_Posted.Offset) = Half_Word;
+			BL_Port_Posted.Offset += 2;
+		}
+		else{
+			CLEAR_BIT(Bank->CR, FLASH_CR_PG);
+			BL_Port_Flash_Lock(Bank);
+			BL_Port_Posted.Active = 0;
+		}
+	}
+}
+
+/*****************************************Static Functions Implementation End*****************************************/
+
+
+#if defined(BL_PORT_LL)
+
+/*****************************************Size Profile Entry Point Start*****************************************/
+
+int main(void){
+	/* SystemInit already ran from the reset handler, no HAL_Init and no SysTick in this profile */
+	BL_Port_Init();
+	BL_Flash_Geometry_Init();
+	BL_Stats_Init();
+
+	while(1){
+		BL_UART_Featch_Host_Command();
+	}
+}
+
+/*****************************************Size Profile Entry Point End*****************************************/
+
+#endif /* BL_PORT_LL */
+
+#endif /* BL_PORT_LL || !BL_PORT_HAL_HOT_PATH */
@@ -0,0 +1,24 @@
+/**
+ ******************************************************************************
+ * @file           : bl_public_key.c
+ * @author         : Ahmed Naeim
+ * @brief          : Public key of the secure boot, written by
+ *                   Tools/sign_image.py --public-key-c from bl_dev_signing_key.txt
+ ******************************************************************************
+**/
+
+#include "Bootloader/bootloader.h"
+
+/* The development key: its private half is in this repository, anyone can sign for it. A secure boot build
+ * only takes it with -DBL_SECURE_BOOT_DEV_KEY, a product writes its own key over this file */
+#if (BL_SECURE_BOOT && !defined(BL_SECURE_BOOT_DEV_KEY))
+#error "Secure boot with the development key: add -DBL_SECURE_BOOT_DEV_KEY, or write the product key with Tools/sign_image.py --public-key-c"
+#endif
+
+/* P-256 point, X then Y, big endian. In the bootloader flash, outside every region the host may write */
+const uint8_t BL_Signing_Public_Key[BL_ECDSA_PUBLIC_KEY_SIZE] = {
+	0x29, 0x2D, 0x4D, 0xB4, 0xFE, 0xF8, 0x04, 0x29, 0xD7, 0xE6, 0x6A, 0xA2, 0x1E, 0xDD, 0x7B, 0x13,
+	0xA8, 0xBE, 0xDA, 0xF6, 0xC2, 0x16, 0xF8, 0xB8, 0xE5, 0xDB, 0x96, 0x18, 0xDE, 0xD3, 0x92, 0x66,
+	0xE7, 0x35, 0xF7, 0x26, 0x5B, 0xE4, 0x18, 0xE3, 0xAB, 0xF1, 0x9A, 0x0B, 0x4C, 0xD4, 0x34, 0xED,
+	0x26, 0xF0, 0xF1, 0x8A, 0x3F, 0x12, 0x0C, 0xD2, 0xA2, 0x9F, 0x10, 0x27, 0xF7, 0x57, 0x7F, 0x85
+};
@@ -0,0 +1,202 @@
+/**
+ ******************************************************************************
+ * @file           : bl_sha256.c
+ * @author         : Ahmed Naeim
+ * @brief          : Streaming SHA-256 (FIPS 180-4). The block function keeps
+ *                   the message schedule in a 16 word ring and expands it
+ *                   round by round, so the words stay in registers and the
+ *                   stack, the rotations are single cycle RORs on the M3
+ ******************************************************************************
+**/
+
+#include <string.h>
+#include "Bootloader/bl_sha256.h"
+
+
+
+/*****************************************Macro Declaration Start*****************************************/
+
+#define BL_SHA256_ROTR(X, N)					(((X) >> (N)) | ((X) << (32 - (N))))
+#define BL_SHA256_CH(X, Y, Z)					((Z) ^ ((X) & ((Y) ^ (Z))))
+#define BL_SHA256_MAJ(X, Y, Z)					(((X) & (Y)) | ((Z) & ((X) | (Y))))
+#define BL_SHA256_SIGMA0(X)						(BL_SHA256_ROTR(X, 2) ^ BL_SHA256_ROTR(X, 13) ^ BL_SHA256_ROTR(X, 22))
+#define BL_SHA256_SIGMA1(X)						(BL_SHA256_ROTR(X, 6) ^ BL_SHA256_ROTR(X, 11) ^ BL_SHA256_ROTR(X, 25))
+#define BL_SHA256_GAMMA0(X)						(BL_SHA256_ROTR(X, 7) ^ BL_SHA256_ROTR(X, 18) ^ ((X) >> 3))
+#define BL_SHA256_GAMMA1(X)						(BL_SHA256_ROTR(X, 17) ^ BL_SHA256_ROTR(X, 19) ^ ((X) >> 10))
+
+/* Word I of the ring from word I - 16 (in place), I - 15, I - 7 and I - 2 */
+#define BL_SHA256_SCHEDULE(W, I)				((W)[(I) & 15] += BL_SHA256_GAMMA1((W)[((I) - 2) & 15]) + (W)[((I) - 7) & 15] \
+												+ BL_SHA256_GAMMA0((W)[((I) - 15) & 15]))
+
+/* One round, the eight working variables rotate through the arguments instead of being moved */
+#define BL_SHA256_ROUND(A, B, C, D, E, F, G, H, K, W_I)	do{ \
+	uint32_t T1 = (H) + BL_SHA256_SIGMA1(E) + BL_SHA256_CH(E, F, G) + (K) + (W_I); \
+	(D) += T1; \
+	(H) = T1 + BL_SHA256_SIGMA0(A) + BL_SHA256_MAJ(A, B, C); \
+}while(0)
+
+/* Eight rounds from round I, W_X(I) gives the schedule word of round I */
+#define BL_SHA256_ROUNDS_8(I, W_X)	do{ \
+	BL_SHA256_ROUND(A, B, C, D, E, F, G, H, BL_SHA256_K[(I) + 0], W_X((I) + 0)); \
+	BL_SHA256_ROUND(H, A, B, C, D, E, F, G, BL_SHA256_K[(I) + 1], W_X((I) + 1)); \
+	BL_SHA256_ROUND(G, H, A, B, C, D, E, F, BL_SHA256_K[(I) + 2], W_X((I) + 2)); \
+	BL_SHA256_ROUND(F, G, H, A, B, C, D, E, BL_SHA256_K[(I) + 3], W_X((I) + 3)); \
+	BL_SHA256_ROUND(E, F, G, H, A, B, C, D, BL_SHA256_K[(I) + 4], W_X((I) + 4)); \
+	BL_SHA256_ROUND(D, E, F, G, H, A, B, C, BL_SHA256_K[(I) + 5], W_X((I) + 5)); \
+	BL_SHA256_ROUND(C, D, E, F, G, H, A, B, BL_SHA256_K[(I) + 6], W_X((I) + 6)); \
+	BL_SHA256_ROUND(B, C, D, E, F, G, H, A, BL_SHA256_K[(I) + 7], W_X((I) + 7)); \
+}while(0)
+
+/*****************************************Macro Declaration End*****************************************/
+
+
+
+/*****************************************Global Variables Start*****************************************/
+
+static const uint32_t BL_SHA256_K[64] = {
+	0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+	0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+	0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+	0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+	0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+	0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+	0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+	0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+};
+
+static const uint32_t BL_SHA256_H0[8] = {
+	0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+};
+
+/*****************************************Global Variables End*****************************************/
+
+
+
+/*****************************************Static Functions Declarations Start*****************************************/
+
+static void BL_SHA256_Block(uint32_t *State, const uint8_t *Block);
+static uint32_t BL_SHA256_Load_Big_Endian(const uint8_t *Data);
+
+/*****************************************Static Functions Declarations End*****************************************/
+
+
+/*****************************************Software Interface Implementation Start*****************************************/
+
+void BL_SHA256_Init(BL_SHA256_Context *Context){
+	memcpy(Context->State, BL_SHA256_H0, sizeof(Context->State));
+	Context->Length = 0;
+	Context->Block_Len = 0;
+}
+
+void BL_SHA256_Update(BL_SHA256_Context *Context, const uint8_t *Data, uint32_t Data_Len){
+	uint32_t Copy_Len = 0;
+
+	Context->Length += Data_Len;
+	/* The tail of the last frame first, then the whole blocks of this one without a copy */
+	if(0 != Context->Block_Len){
+		Copy_Len = BL_SHA256_BLOCK_SIZE - Context->Block_Len;
+		if(Copy_Len > Data_Len){
+			Copy_Len = Data_Len;
+		}
+		memcpy(&Context->Block[Context->Block_Len], Data, Copy_Len);
+		Context->Block_Len += Copy_Len;
+		Data += Copy_Len;
+		Data_Len -= Copy_Len;
+		if(BL_SHA256_BLOCK_SIZE == Context->Block_Len){
+			BL_SHA256_Block(Context->State, Context->Block);
+			Context->Block_Len = 0;
+		}
+	}
+	for(; Data_Len >= BL_SHA256_BLOCK_SIZE; Data += BL_SHA256_BLOCK_SIZE, Data_Len -= BL_SHA256_BLOCK_SIZE){
+		BL_SHA256_Block(Context->State, Data);
+	}
+	if(0 != Data_Len){
+		memcpy(Context->Block, Data, Data_Len);
+		Context->Block_Len = Data_Len;
+	}
+}
+
+void BL_SHA256_Final(BL_SHA256_Context *Context, uint8_t *Digest){
+	uint64_t Bit_Length = Context->Length * 8;
+	uint32_t Byte_Counter = 0;
+
+	/* 0x80, zeros up to 8 bytes before the end of a block, then the message length in bits, big endian */
+	Context->Block[Context->Block_Len++] = 0x80;
+	if(Context->Block_Len > (BL_SHA256_BLOCK_SIZE - 8)){
+		memset(&Context->Block[Context->Block_Len], 0, BL_SHA256_BLOCK_SIZE - Context->Block_Len);
+		BL_SHA256_Block(Context->State, Context->Block);
+		Context->Block_Len = 0;
+	}
+	memset(&Context->Block[Context->Block_Len], 0, (BL_SHA256_BLOCK_SIZE - 8) - Context->Block_Len);
+	for(Byte_Counter = 0; Byte_Counter < 8; Byte_Counter++){
+		Context->Block[BL_SHA256_BLOCK_SIZE - 1 - Byte_Counter] = (uint8_t)(Bit_Length >> (8 * Byte_Counter));
+	}
+	BL_SHA256_Block(Context->State, Context->Block);
+	for(Byte_Counter = 0; Byte_Counter < BL_SHA256_DIGEST_SIZE; Byte_Counter++){
+		Digest[Byte_Counter] = (uint8_t)(Context->State[Byte_Counter / 4] >> (24 - 8 * (Byte_Counter % 4)));
+	}
+}
+
+/*****************************************Software Interface Implementation End*****************************************/
+
+
+/*****************************************Static Functions Implementation Start*****************************************/
+
+static uint32_t BL_SHA256_Load_Big_Endian(const uint8_t *Data){
+	/* The M3 loads a word at any alignment, LDR + REV */
+	uint32_t Word = 0;
+
+	memcpy(&Word, Data, sizeof(Word));
+	return __builtin_bswap32(Word);
+}
+
+#if BL_SHA256_UNROLLED
+
+#define BL_SHA256_W_LOAD(I)						(W[I] = BL_SHA256_Load_Big_Endian(&Block[4 * (I)]))
+#define BL_SHA256_W_NEXT(I)						BL_SHA256_SCHEDULE(W, I)
+
+static void BL_SHA256_Block(uint32_t *State, const uint8_t *Block){
+	uint32_t W[16];
+	uint32_t A = State[0], B = State[1], C = State[2], D = State[3];
+	uint32_t E = State[4], F = State[5], G = State[6], H = State[7];
+	uint32_t Round = 0;
+
+	/* Rounds 0 to 15 take the block words, the next 48 expand the ring in place: every index is a constant */
+	BL_SHA256_ROUNDS_8(0, BL_SHA256_W_LOAD);
+	BL_SHA256_ROUNDS_8(8, BL_SHA256_W_LOAD);
+	for(Round = 16; Round < 64; Round += 16){
+		BL_SHA256_ROUNDS_8(Round + 0, BL_SHA256_W_NEXT);
+		BL_SHA256_ROUNDS_8(Round + 8, BL_SHA256_W_NEXT);
+	}
+	State[0] += A; State[1] += B; State[2] += C; State[3] += D;
+	State[4] += E; State[5] += F; State[6] += G; State[7] += H;
+}
+
+#else
+
+static void BL_SHA256_Block(uint32_t *State, const uint8_t *Block){
+	uint32_t W[16];
+	uint32_t A = State[0], B = State[1], C = State[2], D = State[3];
+	uint32_t E = State[4], F = State[5], G = State[6], H = State[7];
+	uint32_t Round = 0;
+	uint32_t T1 = 0;
+
+	for(Round = 0; Round < 64; Round++){
+		if(Round < 16){
+			W[Round] = BL_SHA256_Load_Big_Endian(&Block[4 * Round]);
+		}
+		else{
+			BL_SHA256_SCHEDULE(W, Round);
+		}
+		T1 = H + BL_SHA256_SIGMA1(E) + BL_SHA256_CH(E, F, G) + BL_SHA256_K[Round] + W[Round & 15];
+		H = G; G = F; F = E; E = D + T1;
+		D = C; C = B; B = A;
+		A = T1 + BL_SHA256_SIGMA0(B) + BL_SHA256_MAJ(B, C, D);
+	}
+	State[0] += A; State[1] += B; State[2] += C; State[3] += D;
+	State[4] += E; State[5] += F; State[6] += G; State[7] += H;
+}
+
+#endif /* BL_SHA256_UNROLLED */
+
+/*****************************************Static Functions Implementation End*****************************************/
@@ -14,8 +14,14 @@
 
 static uint8_t BL_HOST_BUFFER[BL_HOST_BUFFER_RX_LENGTH];		/* Array where I will receive the data */
 
+/* BL_HOST_FRAMING_LENGTH or BL_HOST_FRAMING_COBS, the host switches to COBS with a 0x00 first byte */
+static uint8_t BL_Host_Framing = BL_HOST_FRAMING_LENGTH;
 
-static uint8_t Bootloader_Supported_CMDs[12] = {
+/* Open from the reset to the first byte of the host when BL_BOOT_WINDOW_MS is not 0 */
+static uint8_t BL_Boot_Window_Open = (BL_BOOT_WINDOW_MS > 0) ? 1 : 0;
+
+
+static uint8_t Bootloader_Supported_CMDs[] = {
     CBL_GET_VER_CMD,
     CBL_GET_HELP_CMD,
     CBL_GET_CID_CMD,
@@ -23,182 +29,309 @@ static uint8_t Bootloader_Supported_CMDs[12] = {
     CBL_GO_TO_ADDR_CMD,
     CBL_FLASH_ERASE_CMD,
     CBL_MEM_WRITE_CMD,
-	CBL_ENABLE_R_W_PROTECT_CMD,
     CBL_MEM_READ_CMD,
-    CBL_READ_PAGE_STATUS_CMD,
-    CBL_OTP_READ_CMD,
-	CBL_DIS_R_W_PROTECT_CMD
+	CBL_DIS_R_W_PROTECT_CMD,
+	CBL_BATCH_CMD,
+	CBL_GET_STATS_CMD,
+	CBL_ALLOCATE_PAGES_CMD,
+	CBL_LOAD_AND_EXEC_CMD,
+#if BL_FEATURE_IMAGE
+	CBL_FLASH_IMAGE_CMD,
+#endif
+#if BL_FEATURE_RELIABLE
+	CBL_RELIABLE_CMD,
+#endif
+	CBL_GET_CAPABILITIES_CMD
 };
 
+/* Replies of the sub-commands of a batch are collected here instead of being sent one by one */
+static BL_Reply_Capture BL_Batch_Reply;
+
+/* Reply frame of the last CBL_RELIABLE_CMD as it was sent. The same request again (sequence and request CRC32)
+ * gets this frame back without being executed a second time */
+static BL_Reply_Capture BL_Reliable_Reply;
+#if BL_FEATURE_RELIABLE
+static uint32_t BL_Reliable_Request_CRC32 = 0;
+#endif
+static uint8_t BL_Reliable_Sequence = 0;
+static uint8_t BL_Reliable_Reply_Valid = 0;
+
+/* Loaded from the metadata area by BL_Stats_Init, stored back after an erase, before a jump and before an RDP change.
+ * The pages the writes erase are counted at once and stored with the next of these */
+static BL_Stats_Record BL_Stats;
+
+/*
+ * Erase plan of the writes since the last command with BL_COMMAND_ENDS_ERASE_PLAN: one bit per page the writes have
+ * already erased or found blank. A page is prepared the first time a write touches it, so the host needs no erase
+ * command and the pages the image does not cover keep their contents.
+ * The plan also keeps the span its writes covered: a write into that span over bytes that are no longer blank is a
+ * second pass of the host, the plan starts again and its pages are erased once more.
+ * */
+static uint32_t BL_Erase_Plan[BL_ERASE_PLAN_WORDS];
+static uint32_t BL_Erase_Plan_Start = 0;
+static uint32_t BL_Erase_Plan_End = 0;
+
+#if BL_FEATURE_IMAGE
+/* CBL_FLASH_IMAGE_CMD transfer in progress, from BEGIN or RESUME to COMMIT or the first failed write */
+static BL_Image_Transfer BL_Image;
+#endif
+
+#if defined(BL_PORT_CYCLE_PROFILE)
+/*
+ * Cycles of the last frame body receive and of the last payload write. The host sends a frame back to back,
+ * so the receive figure is the bit time of a byte unless the per byte cost of the port is higher than that.
+ * */
+static uint32_t BL_Rx_Cycles_Per_Byte = 0;
+static uint32_t BL_Program_Cycles_Per_Half_Word = 0;
+#endif
+
 /*****************************************Global Variables End*****************************************/
 
 
 
 /*****************************************Static Functions Declarations Start*****************************************/
-static void Bootloader_Get_Version(uint8_t *Host_Buffer);
-static void Bootloader_Get_Help(uint8_t *Host_Buffer);
-static void Bootloader_Get_Chip_Identification_Number(uint8_t *Host_Buffer);
-static void Bootloader_Read_Protection_Level(uint8_t *Host_Buffer);
-static void Bootloader_Jump_To_Address(uint8_t *Host_Buffer);
-static void Bootloader_Erase_Flash(uint8_t *Host_Buffer);
-static void Bootloader_Memory_Write(uint8_t *Host_Buffer);
-static void Bootloader_Enable_RW_Protection(uint8_t *Host_Buffer);
-static void Bootloader_Memory_Read(uint8_t *Host_Buffer);
-static void Bootloader_Get_Page_Protection_Status(uint8_t *Host_Buffer);
-static void Bootloader_Read_OTP(uint8_t *Host_Buffer);
-static void Bootloader_Change_Read_Protection_Level(uint8_t *Host_Buffer);
-
+static BL_Status Bootloader_Get_Version(uint8_t *Host_Buffer);
+static BL_Status Bootloader_Get_Help(uint8_t *Host_Buffer);
+static BL_Status Bootloader_Get_Chip_Identification_Number(uint8_t *Host_Buffer);
+static BL_Status Bootloader_Read_Protection_Level(uint8_t *Host_Buffer);
+static BL_Status Bootloader_Jump_To_Address(uint8_t *Host_Buffer);
+static BL_Status Bootloader_Erase_Flash(uint8_t *Host_Buffer);
+static BL_Status Bootloader_Memory_Write(uint8_t *Host_Buffer);
+static BL_Status Bootloader_Enable_RW_Protection(uint8_t *Host_Buffer);
+static BL_Status Bootloader_Memory_Read(uint8_t *Host_Buffer);
+static BL_Status Bootloader_Get_Page_Protection_Status(uint8_t *Host_Buffer);
+static BL_Status Bootloader_Read_OTP(uint8_t *Host_Buffer);
+static BL_Status Bootloader_Change_Read_Protection_Level(uint8_t *Host_Buffer);
+static BL_Status Bootloader_Batch(uint8_t *Host_Buffer);
+static BL_Status Bootloader_Get_Stats(uint8_t *Host_Buffer);
+static BL_Status Bootloader_Allocate_Pages(uint8_t *Host_Buffer);
+static BL_Status Bootloader_Load_And_Exec(uint8_t *Host_Buffer);
+#if BL_FEATURE_IMAGE
+static BL_Status Bootloader_Flash_Image(uint8_t *Host_Buffer);
+#endif
+#if BL_FEATURE_RELIABLE
+static BL_Status Bootloader_Reliable(uint8_t *Host_Buffer);
+#endif
+static BL_Status Bootloader_Get_Capabilities(uint8_t *Host_Buffer);
+
+static BL_Status Bootloader_Execute_Command(uint8_t *Host_Buffer);
+static void Bootloader_Erase_Plan_Reset(void);
+static uint8_t Bootloader_Prepare_Pages(uint32_t Address, uint32_t Length);
+static BL_Port_Status Flash_Memory_Program_Sparse(uint32_t Address, const uint8_t *Data, uint16_t Data_Len);
+static uint8_t Flash_Memory_Skip(uint32_t Skip_Start_Address, uint32_t Skip_Len);
+#if BL_FEATURE_IMAGE
+static BL_Meta_Status Bootloader_Image_Store(uint8_t Bootable);
+static uint32_t Bootloader_Image_Page_Count(uint32_t Length);
+static uint8_t Bootloader_Image_Checkpoint(void);
+static uint8_t Bootloader_Image_Begin(const uint8_t *Manifest_Data);
+static uint8_t Bootloader_Image_Resume(const uint8_t *Manifest_Data);
+static uint8_t Bootloader_Image_Data(uint8_t *Host_Buffer, uint16_t Host_CMD_Packet_Len);
+static uint8_t Bootloader_Image_Commit(const uint8_t *Expected_Digest);
+static void Bootloader_Image_Hash(const uint8_t *Data, uint32_t Length);
+#endif
+static uint8_t Bootloader_Image_Signature_Check(const BL_Image_Manifest *Manifest);
 static uint8_t Bootloader_CRC_Verify(uint8_t *pData, uint32_t Data_Len, uint32_t Host_CRC);
+static uint16_t Bootloader_COBS_Decode(uint8_t *Data, uint16_t Data_Len);
+static uint8_t Bootloader_App_Is_Valid(void);
+static uint8_t Bootloader_Capability_Put(uint8_t *Record, uint8_t Record_Len, uint8_t Type, const void *Value, uint8_t Value_Len);
+static void Bootloader_jump_to_user_app(void);
 static void Bootloader_Send_ACK(uint8_t Reply_Len);
 static void Bootloader_Send_NACK();
 static void Bootloader_Send_Data_To_Host(uint8_t *Host_Buffer, uint32_t Data_Len);
+static void Bootloader_Batch_Send_Reply(void);
+static void Bootloader_Reliable_Send_Reply(void);
+static void Bootloader_Stats_Update_Header(void);
+static void Bootloader_Stats_Save(void);
 
 
 /*****************************************Static Functions Declarations End*****************************************/
 
 
+/*****************************************Command Table Start*****************************************/
+
+/* Every command code handled by the bootloader, BL_UART_Featch_Host_Command and the batch command both dispatch through it */
+static const BL_Command_Entry Bootloader_Command_Table[] = {
+	{CBL_GET_VER_CMD,				Bootloader_Get_Version,						0},
+	{CBL_GET_HELP_CMD,				Bootloader_Get_Help,						0},
+	{CBL_GET_CID_CMD,				Bootloader_Get_Chip_Identification_Number,	0},
+	{CBL_GET_RDP_STATUS_CMD,		Bootloader_Read_Protection_Level,			0},
+	{CBL_GO_TO_ADDR_CMD,			Bootloader_Jump_To_Address,					BL_COMMAND_ENDS_ERASE_PLAN | BL_COMMAND_RUNS_HOST_CODE},
+	{CBL_FLASH_ERASE_CMD,			Bootloader_Erase_Flash,						BL_COMMAND_ENDS_ERASE_PLAN},
+	{CBL_MEM_WRITE_CMD,				Bootloader_Memory_Write,					BL_COMMAND_POSTS_WRITES},
+	{CBL_ENABLE_R_W_PROTECT_CMD,	Bootloader_Enable_RW_Protection,			0},
+	{CBL_MEM_READ_CMD,				Bootloader_Memory_Read,						0},
+	{CBL_READ_PAGE_STATUS_CMD,		Bootloader_Get_Page_Protection_Status,		0},
+	{CBL_OTP_READ_CMD,				Bootloader_Read_OTP,						0},
+	{CBL_DIS_R_W_PROTECT_CMD,		Bootloader_Change_Read_Protection_Level,	BL_COMMAND_ENDS_ERASE_PLAN},
+	{CBL_BATCH_CMD,					Bootloader_Batch,							0},
+	{CBL_GET_STATS_CMD,				Bootloader_Get_Stats,						0},
+	{CBL_ALLOCATE_PAGES_CMD,		Bootloader_Allocate_Pages,					0},
+	{CBL_LOAD_AND_EXEC_CMD,			Bootloader_Load_And_Exec,					BL_COMMAND_ENDS_ERASE_PLAN | BL_COMMAND_RUNS_HOST_CODE},
+#if BL_FEATURE_IMAGE
+	{CBL_FLASH_IMAGE_CMD,			Bootloader_Flash_Image,						BL_COMMAND_POSTS_WRITES},
+#endif
+#if BL_FEATURE_RELIABLE
+	{CBL_RELIABLE_CMD,				Bootloader_Reliable,						BL_COMMAND_POSTS_WRITES},
+#endif
+	{CBL_GET_CAPABILITIES_CMD,		Bootloader_Get_Capabilities,				0}
+};
+
+#define BL_COMMAND_TABLE_SIZE			(sizeof(Bootloader_Command_Table) / sizeof(Bootloader_Command_Table[0]))
+
+/*****************************************Command Table End*****************************************/
+
+
+/*****************************************Memory Region Table Start*****************************************/
+
+/* Memory the host commands may touch, in address order. Anything else is refused before the first byte moves:
+ * the bootloader and its metadata are never erased or written by the host, the bootloader data and stack never written */
+static const BL_Memory_Region Bootloader_Memory_Regions[] = {
+	/* Bootloader */
+	{(const uint8_t *)FLASH_BASE,						BL_APP_BASE,	BL_REGION_READ,	2},
+	/* Application */
+	{BL_APP_BASE,	BL_META_BASE,	BL_REGION_READ | BL_REGION_WRITE | BL_REGION_ERASE | BL_REGION_EXECUTE,	2},
+	/* Metadata, written by bl_meta.c only */
+	{BL_META_BASE,	BL_FLASH_END,	BL_REGION_READ,	2},
+	/* System memory: ROM bootloader, flash size and unique device ID */
+	{(const uint8_t *)STM32F103_SYSTEM_MEMORY_BASE,	(const uint8_t *)STM32F103_OPTION_BYTES_BASE,	BL_REGION_READ,	1},
+	/* Option bytes, changed by CBL_CHANGE_ROP_Level_CMD only */
+	{(const uint8_t *)STM32F103_OPTION_BYTES_BASE,	(const uint8_t *)STM32F103_OPTION_BYTES_END,	BL_REGION_READ,	1},
+	/* Bootloader data and stack */
+	{(const uint8_t *)SRAM_BASE,						BL_STUB_BASE,	BL_REGION_READ,	1},
+	/* Stub window of CBL_LOAD_AND_EXEC_CMD */
+	{BL_STUB_BASE,	(const uint8_t *)STM32F103_SRAM_END,	BL_REGION_READ | BL_REGION_WRITE | BL_REGION_EXECUTE,	2}
+};
+
+#define BL_MEMORY_REGION_COUNT			(sizeof(Bootloader_Memory_Regions) / sizeof(Bootloader_Memory_Regions[0]))
+
+/*****************************************Memory Region Table End*****************************************/
+
+
 /*****************************************Software Interface Implementation Start*****************************************/
 
 BL_Status BL_UART_Featch_Host_Command(void){
 	/*
 	 * Host Command Format:
 	 * Command Length (1 byte =N) + Command Code (1 Byte) + Details (N Bytes) as Memory address or page number + CRC (4 Bytes)
+	 *
+	 * COBS framing: Delimiter (1 byte = 0x00, switches the framing, then optional) + the host command COBS encoded
+	 * + Delimiter (1 byte = 0x00)
+	 *
+	 * A frame whose bytes stop for BL_PORT_INTER_BYTE_TIMEOUT_MS, or take longer than BL_PORT_FRAME_TIMEOUT_MS, is
+	 * dropped without a reply and the next byte starts a new frame
 	 * */
 
 	BL_Status Status =BL_NACK;
-	HAL_StatusTypeDef HAL_Status = HAL_ERROR;
+	BL_Port_Status Port_Status = BL_PORT_ERROR;
 	uint8_t Data_Length = 0;
+	uint16_t Frame_Length = 0;
+	uint32_t Cycle_Start = 0;
+	uint32_t Receive_Cycles = 0;
+	uint32_t First_Byte_Timeout = BL_PORT_WAIT_FOREVER;
 
 	memset(BL_HOST_BUFFER,0,BL_HOST_BUFFER_RX_LENGTH);
 
-	HAL_Status = HAL_UART_Receive(BL_HOST_COMMUNICATION_UART, BL_HOST_BUFFER, 1, HAL_MAX_DELAY);
-	if (HAL_Status != HAL_OK)
+	if((BL_BOOT_WINDOW_MS > 0) && BL_Boot_Window_Open){
+		/* Once after the reset, and only when there is an application to start. Compiled out by the default 0 */
+		BL_Boot_Window_Open = 0;
+		if(Bootloader_App_Is_Valid()){
+			First_Byte_Timeout = BL_BOOT_WINDOW_MS;
+		}
+	}
+
+	if(BL_FEATURE_COBS && (BL_HOST_FRAMING_COBS == BL_Host_Framing)){
+		Port_Status = BL_PORT_OK;
+	}
+	else{
+		Port_Status = BL_Port_Host_Receive(BL_HOST_BUFFER, 1, First_Byte_Timeout);
+		if(BL_FEATURE_COBS && (BL_PORT_OK == Port_Status) && (BL_COBS_DELIMITER == BL_HOST_BUFFER[0])){
+			/* No frame has a zero length byte, the host switched to COBS framing */
+			BL_Host_Framing = BL_HOST_FRAMING_COBS;
+		}
+	}
+
+	if((BL_PORT_TIMEOUT == Port_Status) && (BL_PORT_WAIT_FOREVER != First_Byte_Timeout)){
+		/* The boot window closed without a byte from the host */
+		BL_LOG_INFO(SYS, BL_LOG_ID_BOOT_WINDOW_CLOSED, BL_APP_BASE_ADDRESS);
+		Bootloader_Stats_Save();
+		Bootloader_jump_to_user_app();
+	}
+	else if (Port_Status != BL_PORT_OK)
 	{
 		Status = BL_NACK;
 	}
+	else if(BL_FEATURE_COBS && (BL_HOST_FRAMING_COBS == BL_Host_Framing)){
+		Cycle_Start = BL_CYCLE_COUNTER();
+		Port_Status = BL_Port_Host_Receive_Until(BL_HOST_BUFFER, BL_HOST_BUFFER_RX_LENGTH, BL_COBS_DELIMITER, &Frame_Length, BL_PORT_WAIT_FOREVER);
+		BL_Stats.Receive_Cycles += BL_CYCLE_COUNTER() - Cycle_Start;
+		if((BL_PORT_OK == Port_Status) && (0 == Frame_Length)){
+			/* Delimiters back to back, no frame between them */
+			Status = BL_NACK;
+		}
+		else if(BL_PORT_TIMEOUT == Port_Status){
+			/* The host stopped part way, the next delimiter starts the next frame */
+			BL_LOG_WARN(CRC, BL_LOG_ID_FRAME_TIMEOUT, Frame_Length);
+			Status = BL_NACK;
+		}
+		else{
+			/* The decoded frame has to be exactly what its length byte announces, anything else was hit on the line */
+			if(BL_PORT_OK == Port_Status){
+				Frame_Length = Bootloader_COBS_Decode(BL_HOST_BUFFER, Frame_Length);
+			}
+			if((BL_PORT_OK == Port_Status) && (BL_HOST_BUFFER[0] >= BL_BATCH_MIN_SUB_FRAME_LENGTH)
+					&& ((uint16_t)(BL_HOST_BUFFER[0] + 1) == Frame_Length)){
+				BL_Stats.Frames_Received++;
+				Status = Bootloader_Execute_Command(BL_HOST_BUFFER);
+			}
+			else{
+				BL_LOG_WARN(CRC, BL_LOG_ID_FRAME_DROPPED, Frame_Length);
+				Bootloader_Send_NACK();
+				Status = BL_NACK;
+			}
+		}
+	}
+	else if(BL_HOST_BUFFER[0] < BL_BATCH_MIN_SUB_FRAME_LENGTH){
+		/* No command fits in less than its code and CRC32, the handlers would underflow the packet length */
+		BL_LOG_WARN(CRC, BL_LOG_ID_FRAME_DROPPED, BL_HOST_BUFFER[0]);
+		Bootloader_Send_NACK();
+		Status = BL_NACK;
+	}
 	else{
 		Data_Length = BL_HOST_BUFFER[0];				/* Put number of bytes to make bootloader receive from the host in the first index */
 
-		HAL_Status = HAL_UART_Receive(BL_HOST_COMMUNICATION_UART, &BL_HOST_BUFFER[1], Data_Length, HAL_MAX_DELAY); /* start from index [1] to write the command code*/
-		if (HAL_Status != HAL_OK){
+		Cycle_Start = BL_CYCLE_COUNTER();
+		Port_Status = BL_Port_Host_Receive(&BL_HOST_BUFFER[1], Data_Length, BL_PORT_INTER_BYTE_TIMEOUT_MS); /* start from index [1] to write the command code*/
+		Receive_Cycles = BL_CYCLE_COUNTER() - Cycle_Start;
+		BL_Stats.Receive_Cycles += Receive_Cycles;
+#if defined(BL_PORT_CYCLE_PROFILE)
+		if(Data_Length){
+			BL_Rx_Cycles_Per_Byte = Receive_Cycles / Data_Length;
+		}
+#endif
+		if(BL_PORT_TIMEOUT == Port_Status){
+			/* A lost byte or a hit length byte, the bytes after the pause start the next frame */
+			BL_LOG_WARN(CRC, BL_LOG_ID_FRAME_TIMEOUT, Data_Length);
+			Status = BL_NACK;
+		}
+		else if (Port_Status != BL_PORT_OK){
 			Status = BL_NACK;
 		}
 		else{
-			switch(BL_HOST_BUFFER[1]){
-			case CBL_GET_VER_CMD:
-				BL_Print_Message("Read the bootloader version from the MCU !! \r\n");
-				Bootloader_Get_Version(BL_HOST_BUFFER);
-				Status = BL_OK;
-				break;
-
-			case CBL_GET_HELP_CMD:
-				BL_Print_Message("Read the commands supported by the bootloader !! \r\n");
-				Bootloader_Get_Help(BL_HOST_BUFFER);
-				Status = BL_OK;
-
-				break;
-
-			case CBL_GET_CID_CMD:
-				BL_Print_Message("Read the MCU chip identification number !! \r\n");
-				Bootloader_Get_Chip_Identification_Number(BL_HOST_BUFFER);
-				Status = BL_OK;
-
-				break;
-
-			case CBL_GET_RDP_STATUS_CMD:
-				BL_Print_Message("Read the Flash Read protection level !! \r\n");
-				Bootloader_Read_Protection_Level(BL_HOST_BUFFER);
-				Status = BL_OK;
-
-				break;
-
-			case CBL_GO_TO_ADDR_CMD:
-				BL_Print_Message("Jump bootloader into specified address !! \r\n");
-				Bootloader_Jump_To_Address(BL_HOST_BUFFER);
-				Status = BL_OK;
-
-				break;
-
-			case CBL_FLASH_ERASE_CMD:
-				BL_Print_Message("Mass erase or page erase to the user flash !! \r\n");
-				Bootloader_Erase_Flash(BL_HOST_BUFFER);
-				Status = BL_OK;
-
-				break;
-
-			case CBL_MEM_WRITE_CMD:
-				BL_Print_Message("Write data into different memories in MCU !! \r\n");
-				Bootloader_Memory_Write(BL_HOST_BUFFER);
-				Status = BL_OK;
-
-				break;
-
-			case CBL_ENABLE_R_W_PROTECT_CMD:
-				BL_Print_Message("Enable Read/Write protect on different pages of user flash !! \r\n");
-				Bootloader_Enable_RW_Protection(BL_HOST_BUFFER);
-				Status = BL_OK;
-
-				break;
-
-			case CBL_MEM_READ_CMD:
-				BL_Print_Message("Read data form different memories in MCU !! \r\n");
-				Bootloader_Memory_Read(BL_HOST_BUFFER);
-				Status = BL_OK;
-
-				break;
-
-			case CBL_READ_PAGE_STATUS_CMD:
-				BL_Print_Message("Read all pages protection status !! \r\n");
-				Bootloader_Get_Page_Protection_Status(BL_HOST_BUFFER);
-				Status = BL_OK;
-
-				break;
-
-			case CBL_OTP_READ_CMD:
-				BL_Print_Message("Read the OTP content !! \r\n");
-				Bootloader_Read_OTP(BL_HOST_BUFFER);
-				Status = BL_OK;
-
-				break;
-
-			case CBL_DIS_R_W_PROTECT_CMD:
-				BL_Print_Message("Disable Read/Write protect on different pages of user flash !! \r\n");
-				Bootloader_Change_Read_Protection_Level(BL_HOST_BUFFER);
-				Status = BL_OK;
-
-				break;
-
-			default:
-				BL_Print_Message("Invalid Code Command Received from the Host !! \r\n");
-				break;
-
-			}
+			BL_Stats.Frames_Received++;
+			Status = Bootloader_Execute_Command(BL_HOST_BUFFER);
 		}
 	}
 
 	return Status;
 }
 
-
-void BL_Print_Message(char *format, ...){
-	char Messsage[100] = {0};
-	/* holds the information needed by va_start, va_arg, va_end */
-	va_list args;
-	/* Enables access to the variable arguments */
-	va_start(args, format);
-	/* Write formatted data from variable argument list to string */
-	vsprintf(Messsage, format, args);
-#if (BL_DEBUG_METHOD == BL_ENABLE_UART_DEBUG_MESSAGE)
-	/* Trasmit the formatted data through the defined UART */
-	HAL_UART_Transmit(BL_DEBUG_UART, (uint8_t *)Messsage, sizeof(Messsage), HAL_MAX_DELAY);
-#elif (BL_DEBUG_METHOD == BL_ENABLE_SPI_DEBUG_MESSAGE)
-	/* Trasmit the formatted data through the defined SPI */
-#elif (BL_DEBUG_METHOD == BL_ENABLE_CAN_DEBUG_MESSAGE)
-	/* Trasmit the formatted data through the defined CAN */
-#endif
-	/* Performs cleanup for an object initialized by a call to va_start */
-	va_end(args);
+void BL_Stats_Init(void){
+	BL_CYCLE_COUNTER_ENABLE();
+	/* A part without a statistics record starts from zero */
+	BL_Meta_Load(BL_META_TYPE_STATS, &BL_Stats, sizeof(BL_Stats));
+	BL_Stats.Boot_Count++;
 }
+
 /*****************************************Software Interface Implementation End*****************************************/
 
 
@@ -207,17 +340,9 @@ void BL_Print_Message(char *format, ...){
 static uint8_t Bootloader_CRC_Verify(uint8_t *pData, uint32_t Data_Len, uint32_t Host_CRC){
 	uint8_t CRC_Status = CRC_VERIFICATION_FAILED;
 	uint32_t MCU_CRC_Calculated = 0;
-	uint8_t Data_Counter =0;
-	uint32_t Data_buffer = 0;			/*because function waits for uint32_t parameter but the input is uint8_t *pData*/
-
-	/*Calculate CRC32*/
-	for (Data_Counter = 0; Data_Counter < Data_Len; ++Data_Counter) {
-		Data_buffer = (uint32_t) pData[Data_Counter];		/*explicit casting to turn uint8_t into uint32_t*/
-		MCU_CRC_Calculated = HAL_CRC_Accumulate(CRC_ENGINE_OBJ, &Data_buffer, 1); /*1 because it is already Data_len because the for loop*/
-	}
 
-	/*Reset CRC Calculation Unit*/
-	__HAL_CRC_DR_RESET(CRC_ENGINE_OBJ);
+	/*Calculate CRC32, the CRC unit is reset for the next frame*/
+	MCU_CRC_Calculated = BL_Port_CRC_Calculate(pData, Data_Len);
 
 
 	/*Compare the host CRC and Calculated CRC */
@@ -226,39 +351,149 @@ static uint8_t Bootloader_CRC_Verify(uint8_t *pData, uint32_t Data_Len, uint32_t
 	}
 	else{
 		CRC_Status = CRC_VERIFICATION_FAILED;
+		BL_Stats.CRC_Failures++;
 	}
 
 	return CRC_Status;
 
 }
 
+static uint16_t Bootloader_COBS_Decode(uint8_t *Data, uint16_t Data_Len){
+	/* In place, the decoded frame is shorter than the encoded one. Returns the decoded length, 0 when a code byte
+	 * points past the end of the frame */
+	uint16_t Read_Index = 0;
+	uint16_t Write_Index = 0;
+	uint8_t Block_Code = 0;
+	uint8_t Block_Counter = 0;
+	uint8_t Frame_Valid = 1;
+
+	while((Read_Index < Data_Len) && (Frame_Valid)){
+		Block_Code = Data[Read_Index++];
+		if((Read_Index + Block_Code - 1) > Data_Len){
+			Frame_Valid = 0;
+		}
+		else{
+			for(Block_Counter = 1; Block_Counter < Block_Code; Block_Counter++){
+				Data[Write_Index++] = Data[Read_Index++];
+			}
+			/* A block shorter than 254 bytes stands for a zero, except the last one */
+			if((BL_COBS_MAX_BLOCK_CODE != Block_Code) && (Read_Index < Data_Len)){
+				Data[Write_Index++] = 0x00;
+			}
+		}
+	}
+	if(!Frame_Valid){
+		Write_Index = 0;
+	}
+	return Write_Index;
+}
+
+static void Bootloader_Capture_Reply(BL_Reply_Capture *Capture, uint8_t *Data, uint32_t Data_Len){
+	if((Capture->Length + Data_Len) > Capture->Limit){
+		/* The capture can't hold this record: the batch stops at the current sub-command, the reliable reply is a NACK */
+		Capture->Overflow = 1;
+	}
+	else{
+		memcpy(&Capture->Buffer[Capture->Length], Data, Data_Len);
+		Capture->Length += Data_Len;
+	}
+}
+
+static BL_Reply_Capture *Bootloader_Active_Capture(void){
+	/* A batch inside a reliable command captures first, its aggregated reply then goes to the reliable capture */
+	BL_Reply_Capture *Capture = NULL;
+	if(BL_Batch_Reply.Active){
+		Capture = &BL_Batch_Reply;
+	}
+	else if(BL_FEATURE_RELIABLE && BL_Reliable_Reply.Active){
+		Capture = &BL_Reliable_Reply;
+	}
+	return Capture;
+}
+
 static void Bootloader_Send_ACK(uint8_t Reply_Len){
 	uint8_t Ack_Value [2] = {0};
+	BL_Reply_Capture *Capture = Bootloader_Active_Capture();
 	Ack_Value [0] = CBL_SEND_ACK;
 	Ack_Value [1] =Reply_Len;
-	HAL_UART_Transmit(BL_HOST_COMMUNICATION_UART, (uint8_t *)Ack_Value, 2, HAL_MAX_DELAY);
-
+	if(NULL != Capture){
+		Bootloader_Capture_Reply(Capture, Ack_Value, 2);
+	}
+	else{
+		BL_Port_Host_Transmit(Ack_Value, 2);
+	}
 }
 
 static void Bootloader_Send_NACK(){
-	uint8_t Ack_Value = CBL_SEND_NACK;
-	HAL_UART_Transmit(BL_HOST_COMMUNICATION_UART, &Ack_Value, 1, HAL_MAX_DELAY);
+	/* Inside a batch the NACK gets a zero length byte so every sub-command record has the same layout */
+	uint8_t Ack_Value [2] = {CBL_SEND_NACK, 0};
+	BL_Reply_Capture *Capture = Bootloader_Active_Capture();
+	BL_Stats.NACKs_Sent++;
+	if(NULL != Capture){
+		Bootloader_Capture_Reply(Capture, Ack_Value, 2);
+	}
+	else{
+		BL_Port_Host_Transmit(Ack_Value, 1);
+	}
 }
 
 static void Bootloader_Send_Data_To_Host(uint8_t *Host_Buffer, uint32_t Data_Len){
-	HAL_UART_Transmit(BL_HOST_COMMUNICATION_UART, Host_Buffer, 4, HAL_MAX_DELAY);
+	BL_Reply_Capture *Capture = Bootloader_Active_Capture();
+	if(NULL != Capture){
+		Bootloader_Capture_Reply(Capture, Host_Buffer, Data_Len);
+	}
+	else{
+		BL_Port_Host_Transmit(Host_Buffer, Data_Len);
+	}
+}
+
+static BL_Status Bootloader_Execute_Command(uint8_t *Host_Buffer){
+	BL_Status Status = BL_NACK;
+	uint8_t Command_Index = 0;
+
+	for(Command_Index = 0; Command_Index < BL_COMMAND_TABLE_SIZE; Command_Index++){
+		if(Bootloader_Command_Table[Command_Index].Command_Code == Host_Buffer[1]){
+			break;
+		}
+	}
+
+	/* A bank 2 payload posted by the last write is finished before a command that does not write reads, erases,
+	 * jumps or stores the statistics: only the next write reports its failure to the host */
+	if(((Command_Index >= BL_COMMAND_TABLE_SIZE) || (0 == (Bootloader_Command_Table[Command_Index].Flags & BL_COMMAND_POSTS_WRITES)))
+			&& (BL_PORT_OK != BL_Port_Flash_Sync())){
+		BL_Stats.Flash_Errors++;
+		BL_LOG_ERROR(FLASH, BL_LOG_ID_POSTED_WRITE_FAILED, Host_Buffer[1]);
+	}
+
+	if(Command_Index < BL_COMMAND_TABLE_SIZE){
+		if(Bootloader_Command_Table[Command_Index].Flags & BL_COMMAND_ENDS_ERASE_PLAN){
+			Bootloader_Erase_Plan_Reset();
+		}
+		if(BL_SECURE_BOOT && (Bootloader_Command_Table[Command_Index].Flags & BL_COMMAND_RUNS_HOST_CODE)){
+			/* Secure boot: code only runs as a signed image started by the boot window, batch and reliable included */
+			BL_LOG_WARN(CMD, BL_LOG_ID_SECURE_BOOT_REFUSED, Host_Buffer[1]);
+			Bootloader_Send_NACK();
+			Status = BL_NACK;
+		}
+		else{
+			Status = Bootloader_Command_Table[Command_Index].Handler(Host_Buffer);
+		}
+	}
+	else{
+		BL_LOG_WARN(CMD, BL_LOG_ID_INVALID_COMMAND, Host_Buffer[1]);
+		Status = BL_NACK;
+	}
 
+	return Status;
 }
 
-static void Bootloader_Get_Version(uint8_t *Host_Buffer){
+static BL_Status Bootloader_Get_Version(uint8_t *Host_Buffer){
+	BL_Status Status = BL_NACK;
 	uint8_t BL_Version[4] = {CBL_VENDOR_ID,CBL_SW_MAJOR_VERSION,CBL_SW_MINOR_VERSION,CBL_SW_PATCH_VERSION};
 	uint16_t Host_CMD_Packet_Len = 0;
 	uint32_t Host_CRC32 = 0;
 
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-	BL_Print_Message("Read The bootloader version from the MCU !! \r\n");
-
-#endif
+	BL_LOG_INFO(CMD, BL_LOG_ID_CMD_GET_VER);
 
 	/*Extract CRC32 and Packet Length sent by the host*/
 
@@ -268,184 +503,208 @@ static void Bootloader_Get_Version(uint8_t *Host_Buffer){
 	/*CRC Verificatipn*/
 	if(CRC_VERIFICATION_PASSED == Bootloader_CRC_Verify((uint8_t *)&Host_Buffer[0] ,Host_CMD_Packet_Len - 4 ,Host_CRC32)){
 
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-	BL_Print_Message("CRC Verification Passed !! \r\n");
-
-#endif
+	BL_LOG_DEBUG(CRC, BL_LOG_ID_CRC_PASSED);
 		Bootloader_Send_ACK(4);
 		Bootloader_Send_Data_To_Host((uint8_t *) BL_Version, 4);
+		Status = BL_OK;
 	}
 	else{
 
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-		BL_Print_Message("CRC Verification Passed !! \r\n");
-
-#endif
+		BL_LOG_WARN(CRC, BL_LOG_ID_CRC_FAILED);
 		Bootloader_Send_NACK();
 	}
+	return Status;
 }
-static void Bootloader_Get_Help(uint8_t *Host_Buffer){
+static BL_Status Bootloader_Get_Help(uint8_t *Host_Buffer){
+	BL_Status Status = BL_NACK;
 	uint16_t Host_CMD_Packet_Len = 0;
 	uint32_t Host_CRC32 = 0;
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-	BL_Print_Message("Read the commands supported by the bootloader \r\n");
-#endif
+	BL_LOG_INFO(CMD, BL_LOG_ID_CMD_GET_HELP);
 	/* Extract the CRC32 and packet length sent by the HOST */
 	Host_CMD_Packet_Len = Host_Buffer[0] + 1;
 	Host_CRC32 = *((uint32_t *)((Host_Buffer + Host_CMD_Packet_Len) - CRC_TYPE_SIZE_BYTE));
 	/* CRC Verification */
 	if(CRC_VERIFICATION_PASSED == Bootloader_CRC_Verify((uint8_t *)&Host_Buffer[0] , Host_CMD_Packet_Len - 4, Host_CRC32)){
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-		BL_Print_Message("CRC Verification Passed \r\n");
-#endif
-		Bootloader_Send_ACK(12);
-		Bootloader_Send_Data_To_Host((uint8_t *)(&Bootloader_Supported_CMDs[0]), 12);
+		BL_LOG_DEBUG(CRC, BL_LOG_ID_CRC_PASSED);
+		Bootloader_Send_ACK(sizeof(Bootloader_Supported_CMDs));
+		Bootloader_Send_Data_To_Host((uint8_t *)(&Bootloader_Supported_CMDs[0]), sizeof(Bootloader_Supported_CMDs));
+		Status = BL_OK;
 	}
 	else{
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-		BL_Print_Message("CRC Verification Failed \r\n");
-#endif
+		BL_LOG_WARN(CRC, BL_LOG_ID_CRC_FAILED);
 		Bootloader_Send_NACK();
 	}
+	return Status;
 }
-static void Bootloader_Get_Chip_Identification_Number(uint8_t *Host_Buffer){
+static BL_Status Bootloader_Get_Chip_Identification_Number(uint8_t *Host_Buffer){
+	BL_Status Status = BL_NACK;
 	uint16_t Host_CMD_Packet_Len = 0;
 	uint32_t Host_CRC32 = 0;
 	uint16_t MCU_Identification_Number = 0;
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-	BL_Print_Message("Read the MCU chip identification number \r\n");
-#endif
+	BL_LOG_INFO(CMD, BL_LOG_ID_CMD_GET_CID);
 	/* Extract the CRC32 and packet length sent by the HOST */
 	Host_CMD_Packet_Len = Host_Buffer[0] + 1;
 	Host_CRC32 = *((uint32_t *)((Host_Buffer + Host_CMD_Packet_Len) - CRC_TYPE_SIZE_BYTE));
 	/* CRC Verification */
 	if(CRC_VERIFICATION_PASSED == Bootloader_CRC_Verify((uint8_t *)&Host_Buffer[0] , Host_CMD_Packet_Len - 4, Host_CRC32)){
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-		BL_Print_Message("CRC Verification Passed \r\n");
-#endif
+		BL_LOG_DEBUG(CRC, BL_LOG_ID_CRC_PASSED);
 		/* Get the MCU chip identification number */
 		MCU_Identification_Number = (uint16_t)((DBGMCU->IDCODE) & 0x00000FFF);
 		/* Report chip identification number to HOST */
 		Bootloader_Send_ACK(2);
 		Bootloader_Send_Data_To_Host((uint8_t *)&MCU_Identification_Number, 2);
+		Status = BL_OK;
 	}
 	else{
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-		BL_Print_Message("CRC Verification Failed \r\n");
-#endif
+		BL_LOG_WARN(CRC, BL_LOG_ID_CRC_FAILED);
 		Bootloader_Send_NACK();
 	}
+	return Status;
 }
 
 static void Bootloader_jump_to_user_app(void){
 	/*Value of the main stack pointer of our main application */
-	uint32_t MSP_Value = *((volatile uint32_t *)FLASH_PAGE2_BASE_ADDRESS);
+	uint32_t MSP_Value = *((volatile uint32_t *)BL_APP_BASE_ADDRESS);
 	/*Reset Handler Definition Function of our main application */
-	uint32_t MainAppAddr = *((volatile uint32_t *) (FLASH_PAGE2_BASE_ADDRESS + 4));
+	uint32_t MainAppAddr = *((volatile uint32_t *) (BL_APP_BASE_ADDRESS + 4));
 	/*Fetch the reset handler address of the user application */
 	pMainApp ResetHandler_Address = (pMainApp) MainAppAddr;
 
+	/*Deinitialize of Modules, on the stack of the bootloader: the log ring drains and the peripherals stop first*/
+	BL_Port_DeInit();						/*MANTADORY*/ /*Resets the RCC clock configuration to the default reset state.*/
+
 	/*Set Main Stack Pointer*/
 	__set_MSP(MSP_Value);
 
-	/*Deinitialize of Modules*/
-	HAL_RCC_DeInit();						/*MANTADORY*/ /*Resets the RCC clock configuration to the default reset state.*/
-
 	/*Jump to Application reset handler*/
 	ResetHandler_Address();
 }
 
+static uint8_t Bootloader_App_Is_Valid(void){
+	uint8_t App_Valid = 0;
+	BL_Image_Record Image_Record;
+	BL_Meta_Status Meta_Status = BL_META_OK;
+	/* The vector table of the application: initial stack pointer and reset handler */
+	uint32_t MSP_Value = *((volatile uint32_t *)BL_APP_BASE_ADDRESS);
+	uint32_t MainAppAddr = *((volatile uint32_t *)(BL_APP_BASE_ADDRESS + 4));
+
+	/* An erased or half written region fails here, the reset handler is a Thumb address inside the region */
+	if((MSP_Value > SRAM_BASE) && (MSP_Value <= STM32F103_SRAM_END) && (0 == (MSP_Value & 0x03))
+			&& (MainAppAddr & 0x01) && (MainAppAddr > BL_APP_BASE_ADDRESS) && (MainAppAddr < BL_META_BASE_ADDRESS)){
+		App_Valid = 1;
+		/* An image transfer that did not reach its COMMIT leaves the region to the host */
+		Meta_Status = BL_Meta_Load(BL_META_TYPE_IMAGE, &Image_Record, sizeof(Image_Record));
+		if((BL_META_OK == Meta_Status) && (0 == Image_Record.Bootable)){
+			App_Valid = 0;
+		}
+		/* Secure boot: only an image committed at the application base, its signature checked again on every reset */
+		else if(BL_SECURE_BOOT && ((BL_META_OK != Meta_Status) || (BL_APP_BASE_ADDRESS != Image_Record.Manifest.Load_Address)
+				|| (IMAGE_OPERATION_PASSED != Bootloader_Image_Signature_Check(&Image_Record.Manifest)))){
+			App_Valid = 0;
+		}
+	}
+	return App_Valid;
+}
+
 static uint8_t CBL_STM32F103_Get_RDP_Level(){
-	FLASH_OBProgramInitTypeDef FLASH_OBProgram;
 	/* Get the Option byte configuration */
-	HAL_FLASHEx_OBGetConfig(&FLASH_OBProgram);
-
-	return (uint8_t)(FLASH_OBProgram.RDPLevel);
-
+	return BL_Port_Get_RDP_Level();
 }
 
-static void Bootloader_Read_Protection_Level(uint8_t *Host_Buffer){
+static BL_Status Bootloader_Read_Protection_Level(uint8_t *Host_Buffer){
+	BL_Status Status = BL_NACK;
 	uint16_t Host_CMD_Packet_Len = 0;
 	uint32_t Host_CRC32 = 0;
 	uint8_t RDP_Level = 0;
 
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-	BL_Print_Message("Read the FLASH Read Protection Out level \r\n");
-#endif
+	BL_LOG_INFO(CMD, BL_LOG_ID_CMD_GET_RDP_STATUS);
 	/* Extract the CRC32 and packet length sent by the HOST */
 	Host_CMD_Packet_Len = Host_Buffer[0] + 1;
 	Host_CRC32 = *((uint32_t *)((Host_Buffer + Host_CMD_Packet_Len) - CRC_TYPE_SIZE_BYTE));
 /* CRC Verification */
 	if(CRC_VERIFICATION_PASSED == Bootloader_CRC_Verify((uint8_t *)&Host_Buffer[0] , Host_CMD_Packet_Len - 4, Host_CRC32)){
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-		BL_Print_Message("CRC Verification Passed \r\n");
-#endif
+		BL_LOG_DEBUG(CRC, BL_LOG_ID_CRC_PASSED);
 		Bootloader_Send_ACK(1);
 		/* Read Protection Level */
 		RDP_Level = CBL_STM32F103_Get_RDP_Level();
 		/* Report Valid Protection Level */
 		Bootloader_Send_Data_To_Host((uint8_t *)&RDP_Level, 1);
+		Status = BL_OK;
 	}
 	else{
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-		BL_Print_Message("CRC Verification Failed \r\n");
-#endif
+		BL_LOG_WARN(CRC, BL_LOG_ID_CRC_FAILED);
 		Bootloader_Send_NACK();
 	}
+	return Status;
 }
 
-static uint8_t Host_Jump_Address_Verification(uint32_t Jump_Address){
+static uint8_t Host_Address_Range_Verification(uint32_t Address, uint32_t Length, uint8_t Access){
 	uint8_t Address_Verification = ADDRESS_IS_INVALID;
-	if((Jump_Address >= SRAM_BASE) && (Jump_Address <= STM32F103_SRAM_END))
-	{
-		Address_Verification = ADDRESS_IS_VALID;
-	}
-	if((Jump_Address >= FLASH_BASE) && (Jump_Address <= STM32F103_FLASH_END))
-	{
-		Address_Verification = ADDRESS_IS_VALID;
-	}
-	else{
-		Address_Verification = ADDRESS_IS_INVALID;
+	const BL_Memory_Region *Region = NULL;
+	uint8_t Region_Index = 0;
+	uint32_t Remaining_Length = Length;
+
+	/* Every region the range touches has to grant Access, a range may run on into the next region when they are
+	 * adjacent. Writes and jumps start aligned for the first region. The table is short and fixed: one pass, the
+	 * same cost for a 2 byte jump and a 255 byte write. A flash layout that does not fit the part (BL_Flash) leaves
+	 * the flash read only: its pages are not where the table says */
+	for(Region_Index = 0; Region_Index < BL_MEMORY_REGION_COUNT; Region_Index++){
+		Region = &Bootloader_Memory_Regions[Region_Index];
+		if((Address >= (uint32_t)Region->Base) && (Address < (uint32_t)Region->End)){
+			if((Access != (Region->Permissions & Access)) || ((Remaining_Length == Length)
+					&& (0 != (Access & (BL_REGION_WRITE | BL_REGION_EXECUTE))) && (0 != (Address % Region->Alignment)))
+					|| (!BL_Flash.Layout_Valid && (0 != (Access & (BL_REGION_WRITE | BL_REGION_ERASE)))
+						&& ((uint32_t)Region->End <= (uint32_t)BL_FLASH_END))){
+				break;
+			}
+			if(Remaining_Length <= ((uint32_t)Region->End - Address)){
+				Address_Verification = ADDRESS_IS_VALID;
+				break;
+			}
+			Remaining_Length -= (uint32_t)Region->End - Address;
+			Address = (uint32_t)Region->End;
+		}
 	}
-
-
 	return Address_Verification;
-
 }
-static void Bootloader_Jump_To_Address(uint8_t *Host_Buffer){
+static BL_Status Bootloader_Jump_To_Address(uint8_t *Host_Buffer){
+	BL_Status Status = BL_NACK;
 	uint16_t Host_CMD_Packet_Len = 0;
 	uint32_t Host_CRC32 = 0;
 	uint32_t HOST_Jump_Address = 0;
 	uint8_t Address_Verification = ADDRESS_IS_INVALID;
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-	BL_Print_Message("Read the commands supported by the bootloader \r\n");
-#endif
+	BL_LOG_INFO(CMD, BL_LOG_ID_CMD_GO_TO_ADDR);
 	/* Extract the CRC32 and packet length sent by the HOST */
 	Host_CMD_Packet_Len = Host_Buffer[0] + 1;
 	Host_CRC32 = *((uint32_t *)((Host_Buffer + Host_CMD_Packet_Len) - CRC_TYPE_SIZE_BYTE));
 	/* CRC Verification */
 	if(CRC_VERIFICATION_PASSED == Bootloader_CRC_Verify((uint8_t *)&Host_Buffer[0] , Host_CMD_Packet_Len - 4, Host_CRC32)){
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-		BL_Print_Message("CRC Verification Passed \r\n");
-#endif
+		BL_LOG_DEBUG(CRC, BL_LOG_ID_CRC_PASSED);
 		Bootloader_Send_ACK(1);
 		/*extract address from the host from host packet*/
 		HOST_Jump_Address = *((uint32_t *) &Host_Buffer [2]);
 
 		/*Verify Address is Valid*/
-		Address_Verification = Host_Jump_Address_Verification(HOST_Jump_Address);
+		Address_Verification = Host_Address_Range_Verification(HOST_Jump_Address, 2, BL_REGION_EXECUTE);
 		if(ADDRESS_IS_VALID == Address_Verification)
 		{
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-		BL_Print_Message("Address verification succeeded \r\n");
-#endif
+		BL_LOG_DEBUG(SYS, BL_LOG_ID_JUMP_ADDRESS_VALID);
 			/*address verification succeeded*/
 			Bootloader_Send_Data_To_Host((uint8_t *)&Address_Verification, 1);
+			Status = BL_OK;
+			if(BL_Batch_Reply.Active){
+				/* Nothing comes back from the jump, report the sub-commands executed so far */
+				Bootloader_Batch_Send_Reply();
+			}
+			if(BL_FEATURE_RELIABLE && BL_Reliable_Reply.Active){
+				Bootloader_Reliable_Send_Reply();
+			}
 			/*prepare address to jump*/
 			JumpPtr Jump_Address = (JumpPtr) (HOST_Jump_Address + 1);
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-		BL_Print_Message("Jump to ox%X \r\n",Jump_Address);
-#endif
+		BL_LOG_INFO(SYS, BL_LOG_ID_JUMP_TO_ADDRESS, HOST_Jump_Address);
+			Bootloader_Stats_Save();
+			/* Sends the log record above, then stops the debug UART so none of its interrupts follows the jump */
+			BL_Port_DeInit();
 			Jump_Address();
 		}
 		else
@@ -455,109 +714,102 @@ static void Bootloader_Jump_To_Address(uint8_t *Host_Buffer){
 
 	}
 	else{
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-		BL_Print_Message("CRC Verification Failed \r\n");
-#endif
+		BL_LOG_WARN(CRC, BL_LOG_ID_CRC_FAILED);
 		Bootloader_Send_NACK();
 	}
+	return Status;
 }
 
 
-static uint8_t Perform_Flash_Erase (uint8_t Page_Number, uint16_t Number_of_Pages){
+static uint8_t Perform_Flash_Erase (uint16_t Page_Number, uint16_t Number_of_Pages){
 
 	uint8_t Page_Validity_Status = INVALID_PAGE_NUMBER;
-	FLASH_EraseInitTypeDef pEraseInit;
-	uint8_t Remaining_Pages = 0;
-	HAL_StatusTypeDef HAL_Status = HAL_ERROR;
+	BL_Port_Status Port_Status = BL_PORT_ERROR;
 	uint32_t Page_Error = 0;
+	uint32_t Cycle_Start = BL_CYCLE_COUNTER();
+	uint16_t Entry_Counter = 0;
 
-	if(Number_of_Pages > CBL_FLASH_MAX_PAGE_NUMBER)
+	if(CBL_FLASH_MASS_ERASE_EXTENDED == Page_Number)
 	{
-		/*Number of Pages is out of range*/
-		Page_Validity_Status = INVALID_PAGE_NUMBER;
+		/*Flash MASS ERASE activation: the application region, a real mass erase would take the bootloader with it*/
+		BL_LOG_INFO(FLASH, BL_LOG_ID_MASS_ERASE);
+		Page_Number = CBL_APP_FIRST_PAGE;
+		Number_of_Pages = CBL_APP_END_PAGE - CBL_APP_FIRST_PAGE;
 	}
 	else{
-		Page_Validity_Status = VALID_PAGE_NUMBER;
-		if((Page_Number <= (CBL_FLASH_MAX_PAGE_NUMBER -1)) || (CBL_FLASH_MASS_ERASE == Page_Number)){
-			if(CBL_FLASH_MASS_ERASE == Page_Number)
-			{
-				/*Flash MASS ERASE activation*/
-				pEraseInit.TypeErase = FLASH_TYPEERASE_MASSERASE;
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-		BL_Print_Message("Flash MASS ERASE activation \r\n");
-#endif
-			}
-			else{
-				/*Pages Erase ONLY*/
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-		BL_Print_Message("Flash MPages Erase ONLY activation \r\n");
-#endif
-				Remaining_Pages = CBL_FLASH_MAX_PAGE_NUMBER - Page_Number;
-				/*If user entered more pages than the available number from the page number entered*/
-				if(Number_of_Pages > Remaining_Pages){
-					Number_of_Pages = Remaining_Pages;
-				}
-				else{
-					/*Nothing*/
-				}
-				pEraseInit.TypeErase = FLASH_TYPEERASE_PAGES;
-				pEraseInit.PageAddress = Page_Number; 								/*Initial FLASH page address to erase when mass erase is disabled*/
-				pEraseInit.NbPages = Number_of_Pages; 								/*Number of pages to be erased*/
-
-
-			}
-
-			pEraseInit.Banks = 3U;													 /*Both Bank 1 and Bank 2*/
-
-			HAL_Status = HAL_FLASH_OB_Unlock();										/*Unlock Flash control register*/
-			HAL_Status = HAL_FLASHEx_Erase(&pEraseInit, &Page_Error);				/*Erase Flash memory pages*/
-
-			if(HAL_SUCCESSFUL_ERASE == Page_Error){
-				Page_Validity_Status = SUCCESSFUL_ERASE;
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-		BL_Print_Message("SUCCESSFUL ERASE \r\n");
-#endif
+		/*Pages Erase ONLY*/
+		BL_LOG_INFO(FLASH, BL_LOG_ID_PAGE_ERASE, Page_Number, Number_of_Pages);
+	}
 
+	/*Every page has to be erasable, a range reaching into the bootloader or the metadata erases nothing*/
+	if((0 != Number_of_Pages) && (ADDRESS_IS_VALID == Host_Address_Range_Verification(BL_FLASH_PAGE_ADDRESS(Page_Number),
+																					  (uint32_t)Number_of_Pages * BL_Flash.Page_Size, BL_REGION_ERASE))){
+		/*Erase Flash memory pages, the port steps by the page size of the part and picks the bank of every page*/
+		Port_Status = BL_Port_Flash_Erase_Pages(BL_FLASH_PAGE_ADDRESS(Page_Number), Number_of_Pages, &Page_Error);
+		BL_Stats.Erase_Cycles += BL_CYCLE_COUNTER() - Cycle_Start;
+		if(BL_PORT_OK == Port_Status){
+			Page_Validity_Status = SUCCESSFUL_ERASE;
+			BL_LOG_DEBUG(FLASH, BL_LOG_ID_ERASE_PASSED);
+			/*One count per command for every statistics entry the pages fall in*/
+			for(Entry_Counter = BL_STATS_ENTRY(Page_Number); Entry_Counter <= BL_STATS_ENTRY(Page_Number + Number_of_Pages - 1); Entry_Counter++){
+				if(0xFFFF != BL_Stats.Page_Erase_Count[Entry_Counter]){
+					BL_Stats.Page_Erase_Count[Entry_Counter]++;
+				}
 			}
-			else{
-				Page_Validity_Status = UNSUCCESSFUL_ERASE;
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-		BL_Print_Message("UNSUCCESSFUL ERASE \r\n");
-#endif
-			}
-			HAL_Status = HAL_FLASH_Lock();											/*Lock Flash control register*/
 		}
 		else{
 			Page_Validity_Status = UNSUCCESSFUL_ERASE;
+			BL_Stats.Flash_Errors++;
+			BL_LOG_ERROR(FLASH, BL_LOG_ID_ERASE_FAILED, Page_Error);
 		}
-
-
+	}
+	else{
+		Page_Validity_Status = INVALID_PAGE_NUMBER;
 	}
 	return Page_Validity_Status;
 }
 
-static void Bootloader_Erase_Flash(uint8_t *Host_Buffer){
+static BL_Status Bootloader_Erase_Flash(uint8_t *Host_Buffer){
+	/*
+	 * Erase Flash Command Format:
+	 * Command Length (1 byte) + CBL_FLASH_ERASE_CMD (1 byte) + First page (1 byte, CBL_FLASH_MASS_ERASE)
+	 * + Number of pages (1 byte) + CRC (4 bytes)
+	 * Extended frame, Command Length = CBL_FLASH_ERASE_EXTENDED_LENGTH: First page (2 bytes, CBL_FLASH_MASS_ERASE_EXTENDED)
+	 * + Number of pages (2 bytes)
+	 *
+	 * Reply: ACK + Erase status (1 byte)
+	 * */
+	BL_Status Status = BL_NACK;
 	uint16_t Host_CMD_Packet_Len = 0;
 	uint32_t Host_CRC32 = 0;
 	uint8_t Erase_Status = 0;
+	uint16_t Page_Number = 0;
+	uint16_t Number_of_Pages = 0;
 
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-	BL_Print_Message("Mass erase or Page erase to the user flash !! \r\n");
-#endif
+	BL_LOG_INFO(CMD, BL_LOG_ID_CMD_FLASH_ERASE);
 	/* Extract the CRC32 and packet length sent by the HOST */
 	Host_CMD_Packet_Len = Host_Buffer[0] + 1;
 	Host_CRC32 = *((uint32_t *)((Host_Buffer + Host_CMD_Packet_Len) - CRC_TYPE_SIZE_BYTE));
 
 	/* CRC Verification */
 	if(CRC_VERIFICATION_PASSED == Bootloader_CRC_Verify((uint8_t *)&Host_Buffer[0] , Host_CMD_Packet_Len - 4, Host_CRC32)){
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-		BL_Print_Message("CRC Verification Passed \r\n");
-#endif
+		BL_LOG_DEBUG(CRC, BL_LOG_ID_CRC_PASSED);
 		Bootloader_Send_ACK(1);
-		Erase_Status = Perform_Flash_Erase(Host_Buffer[2],Host_Buffer[3]);
+		if(CBL_FLASH_ERASE_EXTENDED_LENGTH == Host_Buffer[0]){
+			Page_Number = (uint16_t)(Host_Buffer[2] | (Host_Buffer[3] << 8));
+			Number_of_Pages = (uint16_t)(Host_Buffer[4] | (Host_Buffer[5] << 8));
+		}
+		else{
+			Page_Number = (CBL_FLASH_MASS_ERASE == Host_Buffer[2]) ? CBL_FLASH_MASS_ERASE_EXTENDED : Host_Buffer[2];
+			Number_of_Pages = Host_Buffer[3];
+		}
+		Erase_Status = Perform_Flash_Erase(Page_Number, Number_of_Pages);
+		/* An erase takes 20 ms per page, storing the statistics next to it costs little */
+		Bootloader_Stats_Save();
 		if(SUCCESSFUL_ERASE == Erase_Status){
 			/*report Erase Passed*/
 			Bootloader_Send_Data_To_Host((uint8_t *)&Erase_Status, 1);
+			Status = BL_OK;
 		}
 		else{
 			/*report Erase Failed*/
@@ -566,101 +818,198 @@ static void Bootloader_Erase_Flash(uint8_t *Host_Buffer){
 
 	}
 	else{
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-		BL_Print_Message("CRC Verification Failed \r\n");
-#endif
+		BL_LOG_WARN(CRC, BL_LOG_ID_CRC_FAILED);
 		Bootloader_Send_NACK();
 	}
-
+	return Status;
 }
 
 
 static uint8_t Flash_Memory_Write_Payload(uint8_t *Host_Payload, uint32_t Payload_Start_Address, uint16_t Payload_Len){
-	HAL_StatusTypeDef HAL_Status = HAL_ERROR;
 	uint8_t Flash_Payload_Write_Status = FLASH_PAYLOAD_WRITE_FAILED;
-	uint16_t Payload_Counter = 0;
-
-	/* Unlock the FLASH control register access */
-  HAL_Status = HAL_FLASH_Unlock();
-
-	if(HAL_Status != HAL_OK){
-		Flash_Payload_Write_Status = FLASH_PAYLOAD_WRITE_FAILED;
-	}
-	else{
-		for(Payload_Counter = 0; Payload_Counter < Payload_Len; Payload_Counter++){
-			/* Program a byte at a specified address */
-			HAL_Status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, Payload_Start_Address + Payload_Counter, Host_Payload[Payload_Counter]);
-			if(HAL_Status != HAL_OK){
-				Flash_Payload_Write_Status = FLASH_PAYLOAD_WRITE_FAILED;
-				break;
-			}
-			else{
-				Flash_Payload_Write_Status = FLASH_PAYLOAD_WRITE_PASSED;
-			}
-		}
-	}
-
-	if((FLASH_PAYLOAD_WRITE_PASSED == Flash_Payload_Write_Status) && (HAL_OK == HAL_Status)){
-		/* Locks the FLASH control register access */
-		HAL_Status = HAL_FLASH_Lock();
-		if(HAL_Status != HAL_OK){
-			Flash_Payload_Write_Status = FLASH_PAYLOAD_WRITE_FAILED;
+	BL_Port_Status Port_Status = BL_PORT_ERROR;
+	uint32_t Cycle_Start = 0;
+	uint32_t Program_Cycles = 0;
+	uint8_t Erase_Status = INVALID_PAGE_NUMBER;
+
+	/* The pages of the payload the plan has not met yet are erased first, unless blank */
+	Erase_Status = Bootloader_Prepare_Pages(Payload_Start_Address, Payload_Len);
+	if(UNSUCCESSFUL_ERASE != Erase_Status){
+		Cycle_Start = BL_CYCLE_COUNTER();
+		/* Program the payload as half-words, the port unlocks and locks the FLASH control register. A bank 2 payload of a
+		 * dual bank part is left programming, the port first waits for the previous one and fails with its error */
+		if(SUCCESSFUL_ERASE == Erase_Status){
+			Port_Status = Flash_Memory_Program_Sparse(Payload_Start_Address, Host_Payload, Payload_Len);
 		}
 		else{
-			Flash_Payload_Write_Status = FLASH_PAYLOAD_WRITE_PASSED;
+			/* Stub window: every byte is stored */
+			Port_Status = BL_Port_Flash_Post_Program(Payload_Start_Address, Host_Payload, Payload_Len);
 		}
+		Program_Cycles = BL_CYCLE_COUNTER() - Cycle_Start;
+		BL_Stats.Program_Cycles += Program_Cycles;
+#if defined(BL_PORT_CYCLE_PROFILE)
+		if(Payload_Len){
+			BL_Program_Cycles_Per_Half_Word = Program_Cycles / ((Payload_Len + 1) / 2);
+		}
+#endif
+	}
+	if(BL_PORT_OK == Port_Status){
+		Flash_Payload_Write_Status = FLASH_PAYLOAD_WRITE_PASSED;
+		BL_Stats.Bytes_Programmed += Payload_Len;
+	}
+	else if(BL_PORT_POSTED == Port_Status){
+		Flash_Payload_Write_Status = FLASH_PAYLOAD_WRITE_POSTED;
+		BL_Stats.Bytes_Programmed += Payload_Len;
+		BL_LOG_DEBUG(FLASH, BL_LOG_ID_WRITE_POSTED, Payload_Start_Address, Payload_Len);
 	}
 	else{
 		Flash_Payload_Write_Status = FLASH_PAYLOAD_WRITE_FAILED;
+		BL_Stats.Flash_Errors++;
 	}
 
 	return Flash_Payload_Write_Status;
 }
 
-static void Bootloader_Memory_Write(uint8_t *Host_Buffer){
-	uint16_t Host_CMD_Packet_Len = 0;
-	uint32_t Host_CRC32 = 0;
-	uint32_t HOST_Address = 0;
-	uint8_t Payload_Len = 0;
+static BL_Port_Status Flash_Memory_Program_Sparse(uint32_t Address, const uint8_t *Data, uint16_t Data_Len){
+	BL_Port_Status Port_Status = BL_Port_Flash_Sync();
+	uint16_t Run_Start = 0;
+	uint16_t Run_End = 0;
+
+	/* Programming 0xFFFF into an erased half-word changes nothing: only the runs between erased half-words are programmed.
+	 * The page is erased or blank since the plan met it, a half-word written twice would have failed on the hardware */
+	while((Run_Start < Data_Len) && ((BL_PORT_OK == Port_Status) || (BL_PORT_POSTED == Port_Status))){
+		while((Run_Start < Data_Len) && BL_HALF_WORD_IS_ERASED(Data, Run_Start, Data_Len)){
+			Run_Start += 2;
+		}
+		for(Run_End = Run_Start; (Run_End < Data_Len) && !BL_HALF_WORD_IS_ERASED(Data, Run_End, Data_Len); Run_End += 2){}
+		if(Run_End > Run_Start){
+			Port_Status = BL_Port_Flash_Post_Program(Address + Run_Start, &Data[Run_Start], ((Run_End > Data_Len) ? Data_Len : Run_End) - Run_Start);
+		}
+		Run_Start = Run_End;
+	}
+	return Port_Status;
+}
+
+static uint8_t Flash_Memory_Skip(uint32_t Skip_Start_Address, uint32_t Skip_Len){
+	uint8_t Flash_Payload_Write_Status = FLASH_PAYLOAD_WRITE_FAILED;
+
+	/* Reports the posted payload like any write, then erases the pages of the range that are not blank */
+	if((BL_PORT_OK == BL_Port_Flash_Sync()) && (SUCCESSFUL_ERASE == Bootloader_Prepare_Pages(Skip_Start_Address, Skip_Len))){
+		Flash_Payload_Write_Status = FLASH_PAYLOAD_WRITE_PASSED;
+		BL_LOG_DEBUG(FLASH, BL_LOG_ID_WRITE_SKIPPED, Skip_Start_Address, Skip_Len);
+	}
+	else{
+		BL_Stats.Flash_Errors++;
+	}
+	return Flash_Payload_Write_Status;
+}
+
+static void Bootloader_Erase_Plan_Reset(void){
+	memset(BL_Erase_Plan, 0, sizeof(BL_Erase_Plan));
+	BL_Erase_Plan_Start = 0;
+	BL_Erase_Plan_End = 0;
+}
+
+static uint8_t Bootloader_Prepare_Pages(uint32_t Address, uint32_t Length){
+	uint8_t Erase_Status = INVALID_PAGE_NUMBER;
+	uint32_t Page_Number = 0;
+	uint32_t Last_Page = 0;
+
+	/* Only the pages a host may erase are planned, INVALID_PAGE_NUMBER for a write to the stub window */
+	if((0 != Length) && (ADDRESS_IS_VALID == Host_Address_Range_Verification(Address, Length, BL_REGION_ERASE))){
+		Erase_Status = SUCCESSFUL_ERASE;
+		/* Only a write back into the span of the plan is read, a stream moving forward is never checked */
+		if((Address < BL_Erase_Plan_End) && ((Address + Length) > BL_Erase_Plan_Start)){
+			if(BL_PORT_OK != BL_Port_Flash_Sync()){
+				Erase_Status = UNSUCCESSFUL_ERASE;
+			}
+			else if(!BL_Flash_Is_Blank(Address, Length)){
+				BL_LOG_DEBUG(FLASH, BL_LOG_ID_ERASE_PLAN_RESTARTED, Address, Length);
+				Bootloader_Erase_Plan_Reset();
+			}
+		}
+		Last_Page = BL_FLASH_PAGE_NUMBER(Address + Length - 1);
+		for(Page_Number = BL_FLASH_PAGE_NUMBER(Address); (Page_Number <= Last_Page) && (SUCCESSFUL_ERASE == Erase_Status); Page_Number++){
+			if(0 == (BL_Erase_Plan[Page_Number / 32] & (1UL << (Page_Number % 32)))){
+				/* The blank check reads the page, a bank 2 payload still programming into it is finished first */
+				if(BL_PORT_OK != BL_Port_Flash_Sync()){
+					Erase_Status = UNSUCCESSFUL_ERASE;
+				}
+				else if(BL_Flash_Is_Blank(BL_FLASH_PAGE_ADDRESS(Page_Number), BL_Flash.Page_Size)){
+					BL_LOG_DEBUG(FLASH, BL_LOG_ID_PAGE_BLANK, Page_Number);
+				}
+				else{
+					Erase_Status = Perform_Flash_Erase((uint16_t)Page_Number, 1);
+				}
+				if(SUCCESSFUL_ERASE == Erase_Status){
+					BL_Erase_Plan[Page_Number / 32] |= (1UL << (Page_Number % 32));
+				}
+			}
+		}
+		if(SUCCESSFUL_ERASE == Erase_Status){
+			if((BL_Erase_Plan_Start == BL_Erase_Plan_End) || (Address < BL_Erase_Plan_Start)){
+				BL_Erase_Plan_Start = Address;
+			}
+			if((BL_Erase_Plan_Start == BL_Erase_Plan_End) || ((Address + Length) > BL_Erase_Plan_End)){
+				BL_Erase_Plan_End = Address + Length;
+			}
+		}
+	}
+	return Erase_Status;
+}
+
+static BL_Status Bootloader_Memory_Write(uint8_t *Host_Buffer){
+	BL_Status Status = BL_NACK;
+	uint16_t Host_CMD_Packet_Len = 0;
+	uint32_t Host_CRC32 = 0;
+	uint32_t HOST_Address = 0;
+	uint8_t Payload_Len = 0;
+	uint32_t Skip_Len = 0;
 	uint8_t Address_Verification = ADDRESS_IS_INVALID;
 	uint8_t Flash_Payload_Write_Status = FLASH_PAYLOAD_WRITE_FAILED;
 
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-	BL_Print_Message("Write data into different memories of the MCU \r\n");
-#endif
+	BL_LOG_INFO(CMD, BL_LOG_ID_CMD_MEM_WRITE);
 	/* Extract the CRC32 and packet length sent by the HOST */
 	Host_CMD_Packet_Len = Host_Buffer[0] + 1;
 	Host_CRC32 = *((uint32_t *)((Host_Buffer + Host_CMD_Packet_Len) - CRC_TYPE_SIZE_BYTE));
 /* CRC Verification */
 	if(CRC_VERIFICATION_PASSED == Bootloader_CRC_Verify((uint8_t *)&Host_Buffer[0] , Host_CMD_Packet_Len - 4, Host_CRC32)){
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-		BL_Print_Message("CRC Verification Passed \r\n");
-#endif
+		BL_LOG_DEBUG(CRC, BL_LOG_ID_CRC_PASSED);
 		/* Send acknowledgement to the HOST */
 		Bootloader_Send_ACK(1);
 		/* Extract the start address from the Host packet */
 		HOST_Address = *((uint32_t *)(&Host_Buffer[2]));
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-		BL_Print_Message("HOST_Address = 0x%X \r\n", HOST_Address);
-#endif
+		BL_LOG_DEBUG(FLASH, BL_LOG_ID_WRITE_ADDRESS, HOST_Address, Host_Buffer[6]);
 		/* Extract the payload length from the Host packet */
 		Payload_Len = Host_Buffer[6];
-		/* Verify the Extracted address to be valid address */
-		Address_Verification = Host_Jump_Address_Verification(HOST_Address);
+		if((0 == Payload_Len) && (CBL_MEM_WRITE_SKIP_LENGTH == Host_Buffer[0])){
+			/* Skip record: a run of 0xFF of the image, only its flash pages are prepared */
+			Skip_Len = *((uint32_t *)(&Host_Buffer[7]));
+			Address_Verification = Host_Address_Range_Verification(HOST_Address, Skip_Len, BL_REGION_ERASE);
+		}
+		else{
+			/* Verify the whole payload lands in writable memory */
+			Address_Verification = Host_Address_Range_Verification(HOST_Address, Payload_Len, BL_REGION_WRITE);
+		}
 		if(ADDRESS_IS_VALID == Address_Verification){
-			/* Write the payload to the Flash memory */
-			Flash_Payload_Write_Status = Flash_Memory_Write_Payload((uint8_t *)&Host_Buffer[7], HOST_Address, Payload_Len);
-			if(FLASH_PAYLOAD_WRITE_PASSED == Flash_Payload_Write_Status){
+			if(0 != Skip_Len){
+				Flash_Payload_Write_Status = Flash_Memory_Skip(HOST_Address, Skip_Len);
+			}
+			else{
+				/* Write the payload to the Flash memory, an empty payload only reports how the posted one ended */
+				Flash_Payload_Write_Status = Flash_Memory_Write_Payload((uint8_t *)&Host_Buffer[7], HOST_Address, Payload_Len);
+			}
+			if(FLASH_PAYLOAD_WRITE_FAILED != Flash_Payload_Write_Status){
 				/* Report payload write passed */
 				Bootloader_Send_Data_To_Host((uint8_t *)&Flash_Payload_Write_Status, 1);
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-				BL_Print_Message("Payload Valid \r\n");
+				Status = BL_OK;
+				BL_LOG_DEBUG(FLASH, BL_LOG_ID_WRITE_PASSED);
+#if defined(BL_PORT_CYCLE_PROFILE)
+				BL_LOG_INFO(FLASH, BL_LOG_ID_WRITE_CYCLES, BL_Rx_Cycles_Per_Byte, BL_Program_Cycles_Per_Half_Word);
 #endif
 			}
 			else{
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-				BL_Print_Message("Payload InValid \r\n");
-#endif
+				BL_LOG_ERROR(FLASH, BL_LOG_ID_WRITE_FAILED);
 				/* Report payload write failed */
 				Bootloader_Send_Data_To_Host((uint8_t *)&Flash_Payload_Write_Status, 1);
 			}
@@ -672,96 +1021,111 @@ static void Bootloader_Memory_Write(uint8_t *Host_Buffer){
 		}
 	}
 	else{
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-		BL_Print_Message("CRC Verification Failed \r\n");
-#endif
+		BL_LOG_WARN(CRC, BL_LOG_ID_CRC_FAILED);
 		/* Send Not acknowledge to the HOST */
 		Bootloader_Send_NACK();
 	}
+	return Status;
 }
-static void Bootloader_Enable_RW_Protection(uint8_t *Host_Buffer){
-
+static BL_Status Bootloader_Enable_RW_Protection(uint8_t *Host_Buffer){
+	/* Not implemented yet */
+	Bootloader_Send_NACK();
+	return BL_NACK;
 }
-static void Bootloader_Memory_Read(uint8_t *Host_Buffer){
+static BL_Status Bootloader_Memory_Read(uint8_t *Host_Buffer){
+	/*
+	 * Memory Read Command Format:
+	 * Command Length (1 byte) + CBL_MEM_READ_CMD (1 byte) + Start address (4 bytes) + Read length (1 byte) + CRC (4 bytes)
+	 *
+	 * Reply: ACK + the memory content, NACK on an invalid range or while the flash is read protected
+	 * */
+	BL_Status Status = BL_NACK;
+	uint16_t Host_CMD_Packet_Len = 0;
+	uint32_t Host_CRC32 = 0;
+	uint32_t HOST_Address = 0;
+	uint8_t Read_Length = 0;
+	uint8_t Read_Max_Length = CBL_MEM_READ_MAX_LENGTH;
 
+	BL_LOG_INFO(CMD, BL_LOG_ID_CMD_MEM_READ);
+	/* Extract the CRC32 and packet length sent by the HOST */
+	Host_CMD_Packet_Len = Host_Buffer[0] + 1;
+	Host_CRC32 = *((uint32_t *)((Host_Buffer + Host_CMD_Packet_Len) - CRC_TYPE_SIZE_BYTE));
+	/* CRC Verification */
+	if(CRC_VERIFICATION_PASSED == Bootloader_CRC_Verify((uint8_t *)&Host_Buffer[0] , Host_CMD_Packet_Len - 4, Host_CRC32)){
+		BL_LOG_DEBUG(CRC, BL_LOG_ID_CRC_PASSED);
+		HOST_Address = *((uint32_t *)(&Host_Buffer[2]));
+		Read_Length = Host_Buffer[6];
+		BL_LOG_DEBUG(FLASH, BL_LOG_ID_READ_ADDRESS, HOST_Address, Read_Length);
+		if(BL_Batch_Reply.Active){
+			Read_Max_Length = CBL_MEM_READ_MAX_BATCH_LENGTH;
+		}
+		/* Like the ROM bootloader, no memory leaves the MCU while the flash is read protected */
+		if((0 != Read_Length) && (Read_Length <= Read_Max_Length)
+				&& (ADDRESS_IS_VALID == Host_Address_Range_Verification(HOST_Address, Read_Length, BL_REGION_READ))
+				&& (BL_PORT_RDP_LEVEL_0 == BL_Port_Get_RDP_Level())){
+			Bootloader_Send_ACK(Read_Length);
+			Bootloader_Send_Data_To_Host((uint8_t *)HOST_Address, Read_Length);
+			Status = BL_OK;
+		}
+		else{
+			BL_LOG_WARN(FLASH, BL_LOG_ID_READ_REFUSED);
+			Bootloader_Send_NACK();
+		}
+	}
+	else{
+		BL_LOG_WARN(CRC, BL_LOG_ID_CRC_FAILED);
+		Bootloader_Send_NACK();
+	}
+	return Status;
 }
-static void Bootloader_Get_Page_Protection_Status(uint8_t *Host_Buffer){
-
+static BL_Status Bootloader_Get_Page_Protection_Status(uint8_t *Host_Buffer){
+	/* Not implemented yet */
+	Bootloader_Send_NACK();
+	return BL_NACK;
 }
-static void Bootloader_Read_OTP(uint8_t *Host_Buffer){
-
+static BL_Status Bootloader_Read_OTP(uint8_t *Host_Buffer){
+	/* Not implemented yet */
+	Bootloader_Send_NACK();
+	return BL_NACK;
 }
 
 
 static uint8_t Change_ROP_Level(uint32_t ROP_Level){
-	HAL_StatusTypeDef HAL_Status = HAL_ERROR;
-	FLASH_OBProgramInitTypeDef FLASH_OBProgramInit;
+	BL_Port_Status Port_Status = BL_PORT_ERROR;
 	uint8_t ROP_Level_Status = ROP_LEVEL_CHANGE_INVALID;
 
-	/* Unlock the FLASH Option Control Registers access */
-	HAL_Status = HAL_FLASH_OB_Unlock();
-	if(HAL_Status != HAL_OK){
+	/* Unlock the option bytes and program the RDP level, a successful change reloads the option bytes and resets the MCU */
+	Bootloader_Stats_Save();
+	Port_Status = BL_Port_Set_RDP_Level((uint8_t)ROP_Level);
+	if(BL_PORT_LOCKED == Port_Status){
 		ROP_Level_Status = ROP_LEVEL_CHANGE_INVALID;
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-	BL_Print_Message("Failed -> Unlock the FLASH Option Control Registers access \r\n");
-#endif
+		BL_LOG_ERROR(OB, BL_LOG_ID_OB_UNLOCK_FAILED);
+	}
+	else if(BL_PORT_OK != Port_Status){
+		ROP_Level_Status = ROP_LEVEL_CHANGE_INVALID;
+		BL_LOG_ERROR(OB, BL_LOG_ID_OB_PROGRAM_FAILED);
 	}
 	else{
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-		BL_Print_Message("Passed -> Unlock the FLASH Option Control Registers access \r\n");
-#endif
-		FLASH_OBProgramInit.OptionType = OPTIONBYTE_RDP; /* RDP option byte configuration */
-		FLASH_OBProgramInit.Banks = 3U; /* Both Banks */
-		FLASH_OBProgramInit.RDPLevel = ROP_Level;
-		/* Program option bytes */
-		HAL_Status = HAL_FLASHEx_OBProgram(&FLASH_OBProgramInit);
-		if(HAL_Status != HAL_OK){
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-			BL_Print_Message("Failed -> Program option bytes \r\n");
-#endif
-			HAL_Status = HAL_FLASH_OB_Lock();
-			ROP_Level_Status = ROP_LEVEL_CHANGE_INVALID;
-		}
-		else{
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-			BL_Print_Message("Passed -> Program option bytes \r\n");
-#endif
-			/* Launch the option byte loading */
-			HAL_FLASH_OB_Launch();
-			/* Lock the FLASH Option Control Registers access */
-			HAL_Status = HAL_FLASH_OB_Lock();
-			if(HAL_Status != HAL_OK){
-				ROP_Level_Status = ROP_LEVEL_CHANGE_INVALID;
-			}
-			else{
-				ROP_Level_Status = ROP_LEVEL_CHANGE_VALID;
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-				BL_Print_Message("Passed -> Program ROP to Level : 0x%X \r\n", ROP_Level);
-#endif
-			}
-
-		}
+		ROP_Level_Status = ROP_LEVEL_CHANGE_VALID;
+		BL_LOG_INFO(OB, BL_LOG_ID_OB_PROGRAM_PASSED, ROP_Level);
 	}
 	return ROP_Level_Status;
 }
 
-static void Bootloader_Change_Read_Protection_Level(uint8_t *Host_Buffer){
+static BL_Status Bootloader_Change_Read_Protection_Level(uint8_t *Host_Buffer){
+	BL_Status Status = BL_NACK;
 	uint16_t Host_CMD_Packet_Len = 0;
  	uint32_t Host_CRC32 = 0;
 	uint8_t ROP_Level_Status = ROP_LEVEL_CHANGE_INVALID;
 	uint8_t Host_ROP_Level = 0;
 
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-	BL_Print_Message("Change read protection level of the user flash \r\n");
-#endif
+	BL_LOG_INFO(CMD, BL_LOG_ID_CMD_CHANGE_ROP_LEVEL);
 	/* Extract the CRC32 and packet length sent by the HOST */
 	Host_CMD_Packet_Len = Host_Buffer[0] + 1;
 	Host_CRC32 = *((uint32_t *)((Host_Buffer + Host_CMD_Packet_Len) - CRC_TYPE_SIZE_BYTE));
 	/* CRC Verification */
 	if(CRC_VERIFICATION_PASSED == Bootloader_CRC_Verify((uint8_t *)&Host_Buffer[0] , Host_CMD_Packet_Len - 4, Host_CRC32)){
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-		BL_Print_Message("CRC Verification Passed \r\n");
-#endif
+		BL_LOG_DEBUG(CRC, BL_LOG_ID_CRC_PASSED);
 		Bootloader_Send_ACK(1);
 		/* Request change the Read Out Protection Level */
 		Host_ROP_Level = Host_Buffer[2];
@@ -770,22 +1134,883 @@ static void Bootloader_Change_Read_Protection_Level(uint8_t *Host_Buffer){
 			ROP_Level_Status = ROP_LEVEL_CHANGE_INVALID;
 		}
 		else{
+			/* STM32F1 RDP byte values, any value other than 0xA5 means level 1 */
 			if(CBL_ROP_LEVEL_0 == Host_ROP_Level){
-				Host_ROP_Level = 0xAA;
+				Host_ROP_Level = BL_PORT_RDP_LEVEL_0;
 			}
 			else if(CBL_ROP_LEVEL_1 == Host_ROP_Level){
-				Host_ROP_Level = 0x55;
+				Host_ROP_Level = BL_PORT_RDP_LEVEL_1;
 			}
 			ROP_Level_Status = Change_ROP_Level(Host_ROP_Level);
 		}
 		Bootloader_Send_Data_To_Host((uint8_t *)&ROP_Level_Status, 1);
+		if(ROP_LEVEL_CHANGE_VALID == ROP_Level_Status){
+			Status = BL_OK;
+		}
+	}
+	else{
+		BL_LOG_WARN(CRC, BL_LOG_ID_CRC_FAILED);
+		Bootloader_Send_NACK();
+	}
+	return Status;
+}
+static void Bootloader_Batch_Send_Reply(void){
+	/* Leave capture mode first so the aggregated reply itself goes out on the UART */
+	BL_Batch_Reply.Active = 0;
+	Bootloader_Send_ACK((uint8_t)BL_Batch_Reply.Length);
+	Bootloader_Send_Data_To_Host(BL_Batch_Reply.Buffer, BL_Batch_Reply.Length);
+}
+
+static BL_Status Bootloader_Batch(uint8_t *Host_Buffer){
+	/*
+	 * Batch Command Format:
+	 * Command Length (1 byte) + CBL_BATCH_CMD (1 byte) + Flags (1 byte) + Number of sub-commands (1 byte)
+	 * + Sub-commands, each one a complete host command (length, code, details, CRC) + CRC (4 bytes)
+	 *
+	 * Reply: ACK + Number of executed sub-commands (1 byte)
+	 * + for every executed sub-command: Command code + ACK/NACK + Reply length + Reply
+	 * */
+	BL_Status Status = BL_NACK;
+	BL_Status Sub_Command_Status = BL_NACK;
+	uint16_t Host_CMD_Packet_Len = 0;
+	uint32_t Host_CRC32 = 0;
+	uint8_t Batch_Flags = 0;
+	uint8_t Sub_Command_Count = 0;
+	uint8_t Sub_Command_Counter = 0;
+	uint16_t Sub_Command_Offset = 0;
+	uint16_t Sub_Command_Len = 0;
+	uint8_t *Sub_Command = NULL;
+
+	BL_LOG_INFO(CMD, BL_LOG_ID_CMD_BATCH);
+	/* Extract the CRC32 and packet length sent by the HOST */
+	Host_CMD_Packet_Len = Host_Buffer[0] + 1;
+	Host_CRC32 = *((uint32_t *)((Host_Buffer + Host_CMD_Packet_Len) - CRC_TYPE_SIZE_BYTE));
+	/* CRC Verification */
+	if(CRC_VERIFICATION_PASSED == Bootloader_CRC_Verify((uint8_t *)&Host_Buffer[0] , Host_CMD_Packet_Len - 4, Host_CRC32)){
+		BL_LOG_DEBUG(CRC, BL_LOG_ID_CRC_PASSED);
+		Batch_Flags = Host_Buffer[2];
+		Sub_Command_Count = Host_Buffer[3];
+		Sub_Command_Offset = 4;
+
+		BL_Batch_Reply.Active = 1;
+		BL_Batch_Reply.Overflow = 0;
+		BL_Batch_Reply.Length = 1;					/* Buffer[0] holds the number of executed sub-commands */
+		BL_Batch_Reply.Limit = BL_BATCH_REPLY_MAX_LENGTH;
+		BL_Batch_Reply.Buffer[0] = 0;
+		Status = BL_OK;
+
+		for(Sub_Command_Counter = 0; Sub_Command_Counter < Sub_Command_Count; Sub_Command_Counter++){
+			Sub_Command = &Host_Buffer[Sub_Command_Offset];
+			Sub_Command_Len = Sub_Command[0] + 1;
+
+			/* The sub-command has to lie completely before the CRC of the batch and can't be a batch or an envelope */
+			if((Sub_Command[0] < BL_BATCH_MIN_SUB_FRAME_LENGTH)
+					|| ((Sub_Command_Offset + Sub_Command_Len) > (Host_CMD_Packet_Len - CRC_TYPE_SIZE_BYTE))
+					|| (CBL_BATCH_CMD == Sub_Command[1]) || (CBL_RELIABLE_CMD == Sub_Command[1])){
+				Status = BL_NACK;
+				break;
+			}
+
+			/* Don't start a sub-command whose reply might not fit anymore */
+			if((BL_Batch_Reply.Length + BL_BATCH_MAX_SUB_REPLY_LENGTH) > BL_BATCH_REPLY_MAX_LENGTH){
+				Status = BL_NACK;
+				break;
+			}
+
+			BL_Batch_Reply.Buffer[0]++;
+			Bootloader_Capture_Reply(&BL_Batch_Reply, &Sub_Command[1], 1);
+			Sub_Command_Status = Bootloader_Execute_Command(Sub_Command);
+			if(BL_Batch_Reply.Overflow){
+				Status = BL_NACK;
+				break;
+			}
+			Sub_Command_Offset += Sub_Command_Len;
+
+			if(BL_OK != Sub_Command_Status){
+				Status = BL_NACK;
+				if(!(Batch_Flags & BL_BATCH_CONTINUE_ON_FAILURE)){
+					break;
+				}
+			}
+		}
+
+		Bootloader_Batch_Send_Reply();
+	}
+	else{
+		BL_LOG_WARN(CRC, BL_LOG_ID_CRC_FAILED);
+		Bootloader_Send_NACK();
+	}
+	return Status;
+}
+
+static void Bootloader_Stats_Update_Header(void){
+	uint8_t UID_Word = 0;
+	uint32_t Meta_Entry = BL_STATS_ENTRY(BL_FLASH_PAGE_NUMBER(BL_META_BASE_ADDRESS));
+	uint32_t Meta_Last_Entry = BL_STATS_ENTRY(BL_FLASH_PAGE_NUMBER(BL_META_BASE_ADDRESS) + 1);
+
+	BL_Stats.Version = BL_STATS_RECORD_VERSION;
+	BL_Stats.Page_Count = BL_STATS_PAGE_COUNT;
+	BL_Stats.Record_Length = sizeof(BL_Stats);
+	for(UID_Word = 0; UID_Word < BL_STATS_UID_WORDS; UID_Word++){
+		BL_Stats.Unique_ID[UID_Word] = ((const uint32_t *)UID_BASE)[UID_Word];
+	}
+	BL_Stats.Core_Clock_Hz = BL_PORT_SYSCLK_FREQ;
+	BL_Stats.Meta_Generation = BL_Meta_Generation();
+	BL_Stats.Flash_Size = BL_Flash.Flash_Size;
+	BL_Stats.Flash_Page_Size = BL_Flash.Page_Size;
+	BL_Stats.Pages_Per_Entry = BL_STATS_PAGES_PER_ENTRY;
+	/* bl_meta.c erases its pages in turn, the first one on odd generations. A mass erase restarts the generations */
+	if(BL_Stats.Page_Erase_Count[Meta_Entry] < ((BL_Stats.Meta_Generation + 1) / 2)){
+		BL_Stats.Page_Erase_Count[Meta_Entry] = (uint16_t)((BL_Stats.Meta_Generation + 1) / 2);
+	}
+	if(BL_Stats.Page_Erase_Count[Meta_Last_Entry] < (BL_Stats.Meta_Generation / 2)){
+		BL_Stats.Page_Erase_Count[Meta_Last_Entry] = (uint16_t)(BL_Stats.Meta_Generation / 2);
+	}
+}
+
+static void Bootloader_Stats_Save(void){
+	Bootloader_Stats_Update_Header();
+	/* A failed store keeps the previous record, the counters are still reported by CBL_GET_STATS_CMD */
+	BL_Meta_Store(BL_META_TYPE_STATS, &BL_Stats, sizeof(BL_Stats));
+}
+
+static BL_Status Bootloader_Get_Stats(uint8_t *Host_Buffer){
+	/*
+	 * Get Stats Command Format:
+	 * Command Length (1 byte) + CBL_GET_STATS_CMD (1 byte) + CRC (4 bytes)
+	 *
+	 * Reply: ACK + BL_Stats_Record, NACK inside a batch (the record is longer than a sub-command reply)
+	 * */
+	BL_Status Status = BL_NACK;
+	uint16_t Host_CMD_Packet_Len = 0;
+	uint32_t Host_CRC32 = 0;
+
+	BL_LOG_INFO(CMD, BL_LOG_ID_CMD_GET_STATS);
+	/* Extract the CRC32 and packet length sent by the HOST */
+	Host_CMD_Packet_Len = Host_Buffer[0] + 1;
+	Host_CRC32 = *((uint32_t *)((Host_Buffer + Host_CMD_Packet_Len) - CRC_TYPE_SIZE_BYTE));
+	/* CRC Verification */
+	if(CRC_VERIFICATION_PASSED == Bootloader_CRC_Verify((uint8_t *)&Host_Buffer[0] , Host_CMD_Packet_Len - 4, Host_CRC32)){
+		BL_LOG_DEBUG(CRC, BL_LOG_ID_CRC_PASSED);
+		if(BL_Batch_Reply.Active){
+			Bootloader_Send_NACK();
+		}
+		else{
+			/* Not stored: polling the statistics must not wear the metadata pages */
+			Bootloader_Stats_Update_Header();
+			Bootloader_Send_ACK(sizeof(BL_Stats));
+			Bootloader_Send_Data_To_Host((uint8_t *)&BL_Stats, sizeof(BL_Stats));
+			Status = BL_OK;
+		}
+	}
+	else{
+		BL_LOG_WARN(CRC, BL_LOG_ID_CRC_FAILED);
+		Bootloader_Send_NACK();
+	}
+	return Status;
+}
+
+static BL_Status Bootloader_Get_Capabilities(uint8_t *Host_Buffer){
+	/*
+	 * Get Capabilities Command Format:
+	 * Command Length (1 byte) + CBL_GET_CAPABILITIES_CMD (1 byte) + CRC (4 bytes)
+	 *
+	 * Reply: ACK + BL_CAP_x records, NACK inside a batch (the record is longer than a sub-command reply)
+	 * */
+	BL_Status Status = BL_NACK;
+	uint16_t Host_CMD_Packet_Len = 0;
+	uint32_t Host_CRC32 = 0;
+	uint8_t Record[BL_CAP_RECORD_MAX_LENGTH];
+	uint8_t Record_Len = 0;
+	uint8_t Protocol[5] = {CBL_PROTOCOL_VERSION, CBL_VENDOR_ID, CBL_SW_MAJOR_VERSION, CBL_SW_MINOR_VERSION, CBL_SW_PATCH_VERSION};
+	uint16_t Max_Frame[2] = {BL_HOST_BUFFER_RX_LENGTH - 2, BL_RELIABLE_REPLY_MAX_LENGTH};
+	uint8_t Window[2] = {BL_CAP_WINDOW_REQUESTS, BL_BATCH_REPLY_MAX_LENGTH};
+	uint32_t Baud_Rate = BL_PORT_HOST_BAUD_RATE;
+	uint16_t Codecs = BL_CAP_CODEC_ERASED_SKIP | (BL_FEATURE_IMAGE ? BL_CAP_CODEC_IMAGE_SHA256 : 0);
+	uint8_t Framings = BL_CAP_FRAMING_LENGTH | BL_CAP_FRAMING_BATCH | (BL_FEATURE_COBS ? BL_CAP_FRAMING_COBS : 0)
+			| (BL_FEATURE_RELIABLE ? BL_CAP_FRAMING_RELIABLE : 0) | (BL_FEATURE_IMAGE ? BL_CAP_FRAMING_IMAGE : 0);
+	/* The flash size goes in two halves, the record has no padding */
+	uint16_t Geometry[5] = {BL_Flash.Device_ID, BL_Flash.Page_Size, BL_Flash.Page_Count,
+							(uint16_t)BL_Flash.Flash_Size, (uint16_t)(BL_Flash.Flash_Size >> 16)};
+	uint32_t Slots[6] = {BL_APP_BASE_ADDRESS, BL_META_BASE_ADDRESS - BL_APP_BASE_ADDRESS,
+						 BL_META_BASE_ADDRESS, (uint32_t)BL_META_SIZE, BL_STUB_BASE_ADDRESS, BL_STUB_WINDOW_SIZE};
+
+	BL_LOG_INFO(CMD, BL_LOG_ID_CMD_GET_CAPABILITIES);
+	/* Extract the CRC32 and packet length sent by the HOST */
+	Host_CMD_Packet_Len = Host_Buffer[0] + 1;
+	Host_CRC32 = *((uint32_t *)((Host_Buffer + Host_CMD_Packet_Len) - CRC_TYPE_SIZE_BYTE));
+	/* CRC Verification */
+	if(CRC_VERIFICATION_PASSED == Bootloader_CRC_Verify((uint8_t *)&Host_Buffer[0] , Host_CMD_Packet_Len - 4, Host_CRC32)){
+		BL_LOG_DEBUG(CRC, BL_LOG_ID_CRC_PASSED);
+		if(BL_Batch_Reply.Active){
+			Bootloader_Send_NACK();
+		}
+		else{
+			Record_Len = Bootloader_Capability_Put(Record, Record_Len, BL_CAP_PROTOCOL, Protocol, sizeof(Protocol));
+			Record_Len = Bootloader_Capability_Put(Record, Record_Len, BL_CAP_MAX_FRAME, Max_Frame, sizeof(Max_Frame));
+			Record_Len = Bootloader_Capability_Put(Record, Record_Len, BL_CAP_WINDOW, Window, sizeof(Window));
+			Record_Len = Bootloader_Capability_Put(Record, Record_Len, BL_CAP_BAUD_RATES, &Baud_Rate, sizeof(Baud_Rate));
+			Record_Len = Bootloader_Capability_Put(Record, Record_Len, BL_CAP_CODECS, &Codecs, sizeof(Codecs));
+			Record_Len = Bootloader_Capability_Put(Record, Record_Len, BL_CAP_FRAMINGS, &Framings, sizeof(Framings));
+			Record_Len = Bootloader_Capability_Put(Record, Record_Len, BL_CAP_FLASH_GEOMETRY, Geometry, sizeof(Geometry));
+			Record_Len = Bootloader_Capability_Put(Record, Record_Len, BL_CAP_SLOTS, Slots, sizeof(Slots));
+			Bootloader_Send_ACK(Record_Len);
+			Bootloader_Send_Data_To_Host(Record, Record_Len);
+			Status = BL_OK;
+		}
+	}
+	else{
+		BL_LOG_WARN(CRC, BL_LOG_ID_CRC_FAILED);
+		Bootloader_Send_NACK();
+	}
+	return Status;
+}
+
+static uint8_t Bootloader_Capability_Put(uint8_t *Record, uint8_t Record_Len, uint8_t Type, const void *Value, uint8_t Value_Len){
+	/* Appends one Type + Length + Value record, the values are already in the little endian order of the core */
+	Record[Record_Len] = Type;
+	Record[Record_Len + 1] = Value_Len;
+	memcpy(&Record[Record_Len + 2], Value, Value_Len);
+	return Record_Len + 2 + Value_Len;
+}
+
+static uint16_t Bootloader_Least_Worn_Pages(uint16_t First_Page, uint16_t End_Page, uint16_t Number_of_Pages, uint16_t *Window_Wear){
+	uint16_t Window_Start = CBL_ALLOCATE_NO_PAGES_EXTENDED;
+	uint32_t Candidate = 0;
+	uint32_t Page_Counter = 0;
+	uint16_t Page_Wear = 0;
+	uint16_t Candidate_Wear = 0;
+	uint32_t Candidate_Sum = 0;
+	uint32_t Window_Sum = 0;
+
+	/* The window whose most erased page has the fewest erases, then the fewest erases in total, then the lowest address.
+	 * A page has the count of its statistics entry */
+	for(Candidate = First_Page; (Number_of_Pages > 0) && ((Candidate + Number_of_Pages) <= End_Page); Candidate++){
+		Candidate_Wear = 0;
+		Candidate_Sum = 0;
+		for(Page_Counter = Candidate; Page_Counter < (Candidate + Number_of_Pages); Page_Counter++){
+			Page_Wear = BL_Stats.Page_Erase_Count[BL_STATS_ENTRY(Page_Counter)];
+			if(Page_Wear > Candidate_Wear){
+				Candidate_Wear = Page_Wear;
+			}
+			Candidate_Sum += Page_Wear;
+		}
+		if((CBL_ALLOCATE_NO_PAGES_EXTENDED == Window_Start) || (Candidate_Wear < *Window_Wear)
+				|| ((Candidate_Wear == *Window_Wear) && (Candidate_Sum < Window_Sum))){
+			Window_Start = (uint16_t)Candidate;
+			*Window_Wear = Candidate_Wear;
+			Window_Sum = Candidate_Sum;
+		}
+	}
+	return Window_Start;
+}
+
+static BL_Status Bootloader_Allocate_Pages(uint8_t *Host_Buffer){
+	/*
+	 * Allocate Pages Command Format:
+	 * Command Length (1 byte) + CBL_ALLOCATE_PAGES_CMD (1 byte) + Number of pages (1 byte)
+	 * + First page (1 byte) + End page (1 byte, excluded) + CRC (4 bytes)
+	 *
+	 * Reply: ACK + First page of the least worn window (1 byte, CBL_ALLOCATE_NO_PAGES when none fits)
+	 * + Number of pages (1 byte) + Highest erase count in the window (2 bytes)
+	 * Extended frame, Command Length = CBL_ALLOCATE_EXTENDED_LENGTH: the three page numbers of the request and the first
+	 * page and number of pages of the reply take 2 bytes each, CBL_ALLOCATE_NO_PAGES_EXTENDED when no window fits
+	 * The search range is clipped to the application region, the host picks it outside of the installed image.
+	 * Nothing is reserved: the next erase of the window counts, so the following request moves to other pages.
+	 * */
+	BL_Status Status = BL_NACK;
+	uint16_t Host_CMD_Packet_Len = 0;
+	uint32_t Host_CRC32 = 0;
+	uint16_t Number_of_Pages = 0;
+	uint16_t First_Page = 0;
+	uint16_t End_Page = 0;
+	uint16_t Window_Start = 0;
+	uint16_t Window_Wear = 0;
+	uint8_t Allocation[6] = {0};
+	uint8_t Allocation_Len = 0;
+
+	BL_LOG_INFO(CMD, BL_LOG_ID_CMD_ALLOCATE_PAGES);
+	/* Extract the CRC32 and packet length sent by the HOST */
+	Host_CMD_Packet_Len = Host_Buffer[0] + 1;
+	Host_CRC32 = *((uint32_t *)((Host_Buffer + Host_CMD_Packet_Len) - CRC_TYPE_SIZE_BYTE));
+	/* CRC Verification */
+	if(CRC_VERIFICATION_PASSED == Bootloader_CRC_Verify((uint8_t *)&Host_Buffer[0] , Host_CMD_Packet_Len - 4, Host_CRC32)){
+		BL_LOG_DEBUG(CRC, BL_LOG_ID_CRC_PASSED);
+		if(CBL_ALLOCATE_EXTENDED_LENGTH == Host_Buffer[0]){
+			Number_of_Pages = (uint16_t)(Host_Buffer[2] | (Host_Buffer[3] << 8));
+			First_Page = (uint16_t)(Host_Buffer[4] | (Host_Buffer[5] << 8));
+			End_Page = (uint16_t)(Host_Buffer[6] | (Host_Buffer[7] << 8));
+		}
+		else{
+			Number_of_Pages = Host_Buffer[2];
+			First_Page = Host_Buffer[3];
+			End_Page = Host_Buffer[4];
+		}
+		First_Page = (First_Page < CBL_APP_FIRST_PAGE) ? CBL_APP_FIRST_PAGE : First_Page;
+		End_Page = (End_Page > CBL_APP_END_PAGE) ? CBL_APP_END_PAGE : End_Page;
+		Window_Start = Bootloader_Least_Worn_Pages(First_Page, End_Page, Number_of_Pages, &Window_Wear);
+		if(CBL_ALLOCATE_EXTENDED_LENGTH == Host_Buffer[0]){
+			Allocation[Allocation_Len++] = (uint8_t)Window_Start;
+			Allocation[Allocation_Len++] = (uint8_t)(Window_Start >> 8);
+			Allocation[Allocation_Len++] = (uint8_t)Number_of_Pages;
+			Allocation[Allocation_Len++] = (uint8_t)(Number_of_Pages >> 8);
+		}
+		else{
+			/* A window past page 254 can't be told in one byte */
+			if(Window_Start >= CBL_ALLOCATE_NO_PAGES){
+				Window_Start = CBL_ALLOCATE_NO_PAGES_EXTENDED;
+			}
+			Allocation[Allocation_Len++] = (uint8_t)Window_Start;
+			Allocation[Allocation_Len++] = (uint8_t)Number_of_Pages;
+		}
+		Allocation[Allocation_Len++] = (uint8_t)Window_Wear;
+		Allocation[Allocation_Len++] = (uint8_t)(Window_Wear >> 8);
+		BL_LOG_INFO(FLASH, BL_LOG_ID_PAGES_ALLOCATED, Window_Start, Window_Wear);
+		Bootloader_Send_ACK(Allocation_Len);
+		Bootloader_Send_Data_To_Host(Allocation, Allocation_Len);
+		if(CBL_ALLOCATE_NO_PAGES_EXTENDED != Window_Start){
+			Status = BL_OK;
+		}
+	}
+	else{
+		BL_LOG_WARN(CRC, BL_LOG_ID_CRC_FAILED);
+		Bootloader_Send_NACK();
+	}
+	return Status;
+}
+
+static BL_Status Bootloader_Load_And_Exec(uint8_t *Host_Buffer){
+	/*
+	 * Load And Exec Command Format:
+	 * Load: Command Length (1 byte) + CBL_LOAD_AND_EXEC_CMD (1 byte) + CBL_STUB_LOAD (1 byte) + Window offset (2 bytes)
+	 *       + Data length (1 byte) + Data + CRC (4 bytes)
+	 * Exec: Command Length (1 byte) + CBL_LOAD_AND_EXEC_CMD (1 byte) + CBL_STUB_EXEC (1 byte) + Entry offset (2 bytes)
+	 *       + Stub length (2 bytes) + Stub CRC32 (4 bytes) + Arg0, Arg1, Arg2 (4 bytes each) + CRC (4 bytes)
+	 *
+	 * Reply: ACK + Status (1 byte), the exec reply adds the value returned by the stub (4 bytes)
+	 * The stub is called as BL_Stub_Entry on the bootloader stack and may use the rest of the window as its buffer.
+	 * It only runs when the first Stub length bytes of the window match the Stub CRC32 (same CRC as the frames),
+	 * and never while the flash is read protected: a stub could read it out.
+	 * */
+	BL_Status Status = BL_NACK;
+	uint16_t Host_CMD_Packet_Len = 0;
+	uint32_t Host_CRC32 = 0;
+	uint16_t Window_Offset = 0;
+	uint16_t Stub_Length = 0;
+	uint32_t Stub_CRC32 = 0;
+	uint8_t Data_Len = 0;
+	uint32_t Stub_Args[CBL_STUB_ARG_COUNT] = {0};
+	uint32_t Stub_Result = 0;
+	uint8_t Stub_Reply[1 + sizeof(Stub_Result)] = {STUB_OPERATION_FAILED};
+	BL_Stub_Entry Stub_Entry = NULL;
+
+	BL_LOG_INFO(CMD, BL_LOG_ID_CMD_LOAD_AND_EXEC);
+	/* Extract the CRC32 and packet length sent by the HOST */
+	Host_CMD_Packet_Len = Host_Buffer[0] + 1;
+	Host_CRC32 = *((uint32_t *)((Host_Buffer + Host_CMD_Packet_Len) - CRC_TYPE_SIZE_BYTE));
+	/* CRC Verification */
+	if(CRC_VERIFICATION_PASSED == Bootloader_CRC_Verify((uint8_t *)&Host_Buffer[0] , Host_CMD_Packet_Len - 4, Host_CRC32)){
+		BL_LOG_DEBUG(CRC, BL_LOG_ID_CRC_PASSED);
+		Window_Offset = *((uint16_t *)&Host_Buffer[3]);
+		if(CBL_STUB_LOAD == Host_Buffer[2]){
+			Data_Len = Host_Buffer[5];
+			if(((CBL_STUB_LOAD_HEADER_SIZE + Data_Len + CRC_TYPE_SIZE_BYTE) <= Host_CMD_Packet_Len)
+					&& (Window_Offset <= BL_STUB_WINDOW_SIZE) && (Data_Len <= (BL_STUB_WINDOW_SIZE - Window_Offset))){
+				memcpy((uint8_t *)(BL_STUB_BASE_ADDRESS + Window_Offset), &Host_Buffer[CBL_STUB_LOAD_HEADER_SIZE], Data_Len);
+				Stub_Reply[0] = STUB_OPERATION_PASSED;
+				Status = BL_OK;
+			}
+			Bootloader_Send_ACK(1);
+			Bootloader_Send_Data_To_Host(Stub_Reply, 1);
+		}
+		else if((CBL_STUB_EXEC == Host_Buffer[2]) && (CBL_STUB_EXEC_LENGTH == Host_Buffer[0])){
+			/* Only read once the frame is known to hold the whole exec header, a shorter one gets the NACK below */
+			Stub_Length = *((uint16_t *)&Host_Buffer[5]);
+			Stub_CRC32 = *((uint32_t *)&Host_Buffer[7]);
+			memcpy(Stub_Args, &Host_Buffer[11], sizeof(Stub_Args));
+			if((Window_Offset < Stub_Length) && (Stub_Length <= BL_STUB_WINDOW_SIZE)
+					&& (BL_PORT_RDP_LEVEL_0 == BL_Port_Get_RDP_Level())
+					&& (Stub_CRC32 == BL_Port_CRC_Calculate((const uint8_t *)BL_STUB_BASE_ADDRESS, Stub_Length))){
+				/* Thumb entry: bit 0 set. The barriers make sure the fetch sees the stores of the load operations */
+				Stub_Entry = (BL_Stub_Entry)(BL_STUB_BASE_ADDRESS + Window_Offset + 1);
+				BL_LOG_INFO(SYS, BL_LOG_ID_STUB_CALL, BL_STUB_BASE_ADDRESS + Window_Offset, Stub_Args[0]);
+				__DSB();
+				__ISB();
+				Stub_Result = Stub_Entry(Stub_Args[0], Stub_Args[1], Stub_Args[2]);
+				BL_LOG_INFO(SYS, BL_LOG_ID_STUB_RETURNED, Stub_Result);
+				Stub_Reply[0] = STUB_OPERATION_PASSED;
+				memcpy(&Stub_Reply[1], &Stub_Result, sizeof(Stub_Result));
+				Status = BL_OK;
+			}
+			else{
+				BL_LOG_WARN(SYS, BL_LOG_ID_STUB_REFUSED);
+			}
+			Bootloader_Send_ACK(sizeof(Stub_Reply));
+			Bootloader_Send_Data_To_Host(Stub_Reply, sizeof(Stub_Reply));
+		}
+		else{
+			Bootloader_Send_NACK();
+		}
+	}
+	else{
+		BL_LOG_WARN(CRC, BL_LOG_ID_CRC_FAILED);
+		Bootloader_Send_NACK();
+	}
+	return Status;
+}
+
+#if BL_FEATURE_IMAGE
+static BL_Meta_Status Bootloader_Image_Store(uint8_t Bootable){
+	BL_Image_Record Image_Record = {0};
+
+	Image_Record.Manifest = BL_Image.Manifest;
+	Image_Record.Bootable = Bootable;
+	memcpy(Image_Record.Written_Pages, BL_Image.Written_Pages, sizeof(Image_Record.Written_Pages));
+	return BL_Meta_Store(BL_META_TYPE_IMAGE, &Image_Record, sizeof(Image_Record));
+}
+
+static uint32_t Bootloader_Image_Page_Count(uint32_t Length){
+	/* Flash pages of the first Length bytes of the image, counted from the page of the load address */
+	return BL_FLASH_PAGE_NUMBER(BL_Image.Manifest.Load_Address + Length - 1) - BL_FLASH_PAGE_NUMBER(BL_Image.Manifest.Load_Address) + 1;
+}
+
+static uint8_t Bootloader_Image_Checkpoint(void){
+	uint8_t Image_Status = IMAGE_OPERATION_PASSED;
+	uint32_t Written_Pages = 0;
+
+	/* Pages behind the next offset are complete, the last one as well once the image is */
+	if(BL_Image.Next_Offset == BL_Image.Manifest.Image_Size){
+		Written_Pages = Bootloader_Image_Page_Count(BL_Image.Manifest.Image_Size);
+	}
+	else{
+		Written_Pages = BL_FLASH_PAGE_NUMBER(BL_Image.Manifest.Load_Address + BL_Image.Next_Offset) - BL_FLASH_PAGE_NUMBER(BL_Image.Manifest.Load_Address);
+	}
+	if(Written_Pages >= (BL_Image.Checkpoint_Pages + BL_IMAGE_CHECKPOINT_PAGES)){
+		/* A page is only recorded once it is programmed: the bank 2 payload still programming is finished first */
+		if(BL_PORT_OK != BL_Port_Flash_Sync()){
+			Image_Status = IMAGE_OPERATION_FAILED;
+			BL_Stats.Flash_Errors++;
+		}
+		else{
+			for(; BL_Image.Checkpoint_Pages < Written_Pages; BL_Image.Checkpoint_Pages++){
+				BL_Image.Written_Pages[BL_Image.Checkpoint_Pages / 32] |= (1UL << (BL_Image.Checkpoint_Pages % 32));
+			}
+			/* A checkpoint that is not stored only makes a resume start further back */
+			if(BL_META_OK != Bootloader_Image_Store(0)){
+				BL_Stats.Flash_Errors++;
+			}
+			BL_LOG_DEBUG(FLASH, BL_LOG_ID_IMAGE_CHECKPOINT, BL_Image.Next_Offset, Written_Pages);
+		}
+	}
+	return Image_Status;
+}
+
+static void Bootloader_Image_Hash(const uint8_t *Data, uint32_t Length){
+	uint32_t Cycle_Start = BL_CYCLE_COUNTER();
+	uint8_t Erased_Block[BL_SHA256_BLOCK_SIZE];
+	uint32_t Block_Len = 0;
+
+	if(NULL != Data){
+		BL_SHA256_Update(&BL_Image.Digest, Data, Length);
+	}
+	else{
+		/* A skip record stands for a run of 0xFF, hashed as such without reading the pages back */
+		memset(Erased_Block, 0xFF, sizeof(Erased_Block));
+		for(; 0 != Length; Length -= Block_Len){
+			Block_Len = (Length < sizeof(Erased_Block)) ? Length : sizeof(Erased_Block);
+			BL_SHA256_Update(&BL_Image.Digest, Erased_Block, Block_Len);
+		}
+	}
+	BL_Image.Hash_Cycles += BL_CYCLE_COUNTER() - Cycle_Start;
+}
+#endif
+
+static uint8_t Bootloader_Image_Signature_Check(const BL_Image_Manifest *Manifest){
+	/* The trailer in the last bytes of the image signs the SHA-256 of the bytes before it, both read from the flash */
+	uint8_t Image_Status = IMAGE_SIGNATURE_INVALID;
+	BL_Image_Trailer Trailer;
+	BL_SHA256_Context Context;
+	uint8_t Image_Digest[BL_SHA256_DIGEST_SIZE];
+	uint32_t Cycle_Start = 0;
+	uint32_t Hash_Cycles = 0;
+	uint32_t Verify_Cycles = 0;
+
+	memset(&Trailer, 0, sizeof(Trailer));
+	if(Manifest->Image_Size >= sizeof(Trailer)){
+		memcpy(&Trailer, (const uint8_t *)(Manifest->Load_Address + Manifest->Image_Size - sizeof(Trailer)), sizeof(Trailer));
+	}
+	if((BL_IMAGE_TRAILER_MAGIC != Trailer.Magic) || ((Manifest->Image_Size - sizeof(Trailer)) != Trailer.Signed_Size)){
+		BL_LOG_WARN(SYS, BL_LOG_ID_SIGNATURE_INVALID, 0);
+	}
+	else{
+		Cycle_Start = BL_CYCLE_COUNTER();
+		BL_SHA256_Init(&Context);
+		BL_SHA256_Update(&Context, (const uint8_t *)Manifest->Load_Address, Trailer.Signed_Size);
+		BL_SHA256_Final(&Context, Image_Digest);
+		Hash_Cycles = BL_CYCLE_COUNTER() - Cycle_Start;
+		Cycle_Start = BL_CYCLE_COUNTER();
+		if(BL_ECDSA_OK == BL_ECDSA_P256_Verify(BL_Signing_Public_Key, Image_Digest, Trailer.Signature)){
+			Image_Status = IMAGE_OPERATION_PASSED;
+		}
+		Verify_Cycles = BL_CYCLE_COUNTER() - Cycle_Start;
+		BL_LOG_INFO(SYS, BL_LOG_ID_SIGNATURE_CHECKED, Hash_Cycles, Verify_Cycles);
+		if(IMAGE_OPERATION_PASSED != Image_Status){
+			BL_LOG_WARN(SYS, BL_LOG_ID_SIGNATURE_INVALID, Trailer.Signed_Size);
+		}
+		if((Hash_Cycles + Verify_Cycles) > BL_SECURE_BOOT_CYCLE_BUDGET){
+			BL_LOG_WARN(SYS, BL_LOG_ID_SIGNATURE_SLOW, Hash_Cycles + Verify_Cycles, BL_SECURE_BOOT_CYCLE_BUDGET);
+		}
+	}
+	return Image_Status;
+}
+
+#if BL_FEATURE_IMAGE
+static uint8_t Bootloader_Image_Begin(const uint8_t *Manifest_Data){
+	uint8_t Image_Status = IMAGE_MANIFEST_INVALID;
+
+	/* A transfer that did not commit is dropped, the bank 2 payload it posted is finished first */
+	if(BL_PORT_OK != BL_Port_Flash_Sync()){
+		BL_Stats.Flash_Errors++;
+		BL_LOG_ERROR(FLASH, BL_LOG_ID_POSTED_WRITE_FAILED, CBL_FLASH_IMAGE_CMD);
+	}
+	memset(&BL_Image, 0, sizeof(BL_Image));
+	memcpy(&BL_Image.Manifest, Manifest_Data, sizeof(BL_Image.Manifest));
+	/* The whole image has to land in flash the host may write and erase, checked once for all the DATA frames */
+	if((0 != BL_Image.Manifest.Image_Size) && (ADDRESS_IS_VALID == Host_Address_Range_Verification(BL_Image.Manifest.Load_Address,
+			BL_Image.Manifest.Image_Size, BL_REGION_WRITE | BL_REGION_ERASE))){
+		/* The pages of the last image are about to change: it is not bootable until this one commits */
+		if(BL_META_OK == Bootloader_Image_Store(0)){
+			Bootloader_Erase_Plan_Reset();
+			BL_SHA256_Init(&BL_Image.Digest);
+			BL_Image.Active = 1;
+			Image_Status = IMAGE_OPERATION_PASSED;
+			BL_LOG_INFO(FLASH, BL_LOG_ID_IMAGE_BEGIN, BL_Image.Manifest.Load_Address, BL_Image.Manifest.Image_Size);
+		}
+		else{
+			Image_Status = IMAGE_OPERATION_FAILED;
+			BL_Stats.Flash_Errors++;
+		}
+	}
+	return Image_Status;
+}
+
+static uint8_t Bootloader_Image_Resume(const uint8_t *Manifest_Data){
+	uint8_t Image_Status = IMAGE_NO_TRANSFER;
+	BL_Image_Record Image_Record = {0};
+	uint32_t Image_Pages = 0;
+	uint32_t Page_Index = 0;
+
+	if(BL_Image.Active){
+		/* The link dropped but the bootloader kept running: the transfer goes on where it is */
+		if(0 == memcmp(&BL_Image.Manifest, Manifest_Data, sizeof(BL_Image.Manifest))){
+			Image_Status = IMAGE_OPERATION_PASSED;
+		}
+	}
+	else if((BL_META_OK == BL_Meta_Load(BL_META_TYPE_IMAGE, &Image_Record, sizeof(Image_Record))) && (0 == Image_Record.Bootable)
+			&& (0 == memcmp(&Image_Record.Manifest, Manifest_Data, sizeof(Image_Record.Manifest)))
+			&& (0 != Image_Record.Manifest.Image_Size) && (ADDRESS_IS_VALID == Host_Address_Range_Verification(
+				Image_Record.Manifest.Load_Address, Image_Record.Manifest.Image_Size, BL_REGION_WRITE | BL_REGION_ERASE))){
+		/* After a reset: the transfer restarts at the first page the checkpoints have not recorded. The pages after it
+		 * may hold part of their data, the cleared plan erases them again at their first write */
+		memset(&BL_Image, 0, sizeof(BL_Image));
+		BL_Image.Manifest = Image_Record.Manifest;
+		memcpy(BL_Image.Written_Pages, Image_Record.Written_Pages, sizeof(BL_Image.Written_Pages));
+		Image_Pages = Bootloader_Image_Page_Count(BL_Image.Manifest.Image_Size);
+		for(Page_Index = 0; (Page_Index < Image_Pages) && (BL_Image.Written_Pages[Page_Index / 32] & (1UL << (Page_Index % 32))); Page_Index++){}
+		BL_Image.Checkpoint_Pages = Page_Index;
+		if(Page_Index >= Image_Pages){
+			BL_Image.Next_Offset = BL_Image.Manifest.Image_Size;
+		}
+		else if(0 != Page_Index){
+			BL_Image.Next_Offset = BL_FLASH_PAGE_ADDRESS(BL_FLASH_PAGE_NUMBER(BL_Image.Manifest.Load_Address) + Page_Index) - BL_Image.Manifest.Load_Address;
+		}
+		/* The digest of the RAM is lost with the reset, it is taken again over the stored pages */
+		BL_SHA256_Init(&BL_Image.Digest);
+		Bootloader_Image_Hash((const uint8_t *)BL_Image.Manifest.Load_Address, BL_Image.Next_Offset);
+		Bootloader_Erase_Plan_Reset();
+		BL_Image.Active = 1;
+		Image_Status = IMAGE_OPERATION_PASSED;
+	}
+	if(IMAGE_OPERATION_PASSED == Image_Status){
+		BL_LOG_INFO(FLASH, BL_LOG_ID_IMAGE_RESUMED, BL_Image.Next_Offset, BL_Image.Checkpoint_Pages);
+	}
+	return Image_Status;
+}
+
+static uint8_t Bootloader_Image_Data(uint8_t *Host_Buffer, uint16_t Host_CMD_Packet_Len){
+	uint8_t Image_Status = IMAGE_OPERATION_FAILED;
+	uint32_t Image_Offset = *((uint32_t *)&Host_Buffer[3]);
+	uint8_t Data_Len = Host_Buffer[7];
+	uint32_t Write_Len = Data_Len;
+	uint32_t Write_Address = BL_Image.Manifest.Load_Address + Image_Offset;
+	uint8_t Access = BL_REGION_WRITE;
+	uint8_t Flash_Payload_Write_Status = FLASH_PAYLOAD_WRITE_FAILED;
+
+	if(!BL_Image.Active){
+		Image_Status = IMAGE_NO_TRANSFER;
+	}
+	else if(Image_Offset != BL_Image.Next_Offset){
+		/* A frame sent again or one after a lost frame, the host goes on from the offset of the reply */
+		Image_Status = IMAGE_OFFSET_MISMATCH;
+	}
+	else{
+		if((0 == Data_Len) && (CBL_IMAGE_SKIP_LENGTH == Host_Buffer[0])){
+			/* Skip record: a run of 0xFF of the image, only its flash pages are prepared */
+			Write_Len = *((uint32_t *)&Host_Buffer[CBL_IMAGE_DATA_HEADER_SIZE]);
+			Access = BL_REGION_ERASE;
+		}
+		if(((CBL_IMAGE_DATA_HEADER_SIZE + Data_Len + CRC_TYPE_SIZE_BYTE) <= Host_CMD_Packet_Len)
+				&& (Write_Len <= (BL_Image.Manifest.Image_Size - Image_Offset))
+				&& (ADDRESS_IS_VALID == Host_Address_Range_Verification(Write_Address, Write_Len, Access))){
+			if(BL_REGION_ERASE == Access){
+				Flash_Payload_Write_Status = Flash_Memory_Skip(Write_Address, Write_Len);
+			}
+			else{
+				/* Same write path as CBL_MEM_WRITE_CMD: pages prepared on the way, a bank 2 payload left programming */
+				Flash_Payload_Write_Status = Flash_Memory_Write_Payload(&Host_Buffer[CBL_IMAGE_DATA_HEADER_SIZE], Write_Address, Data_Len);
+			}
+		}
+		if(FLASH_PAYLOAD_WRITE_FAILED != Flash_Payload_Write_Status){
+			/* Hashed while a bank 2 payload is still programming, the digest is ready when the last frame is written */
+			Bootloader_Image_Hash((BL_REGION_ERASE == Access) ? NULL : &Host_Buffer[CBL_IMAGE_DATA_HEADER_SIZE], Write_Len);
+			BL_Image.Next_Offset += Write_Len;
+			Image_Status = Bootloader_Image_Checkpoint();
+		}
+		if(IMAGE_OPERATION_PASSED != Image_Status){
+			/* The image is not what the manifest says any more, RESUME goes back to the last checkpoint */
+			BL_Image.Active = 0;
+		}
+	}
+	return Image_Status;
+}
+
+static uint8_t Bootloader_Image_Commit(const uint8_t *Expected_Digest){
+	uint8_t Image_Status = IMAGE_NO_TRANSFER;
+	uint8_t Image_Digest[BL_SHA256_DIGEST_SIZE];
+
+	if(!BL_Image.Active){
+		Image_Status = IMAGE_NO_TRANSFER;
+	}
+	else if(BL_Image.Next_Offset != BL_Image.Manifest.Image_Size){
+		/* Image not complete, the transfer stays open for the rest of it */
+		Image_Status = IMAGE_OFFSET_MISMATCH;
+	}
+	else{
+		BL_Image.Active = 0;
+		BL_SHA256_Final(&BL_Image.Digest, Image_Digest);
+		BL_LOG_INFO(FLASH, BL_LOG_ID_IMAGE_DIGEST, BL_Image.Next_Offset, BL_Image.Hash_Cycles);
+		if(BL_PORT_OK != BL_Port_Flash_Sync()){
+			Image_Status = IMAGE_OPERATION_FAILED;
+			BL_Stats.Flash_Errors++;
+			BL_LOG_ERROR(FLASH, BL_LOG_ID_POSTED_WRITE_FAILED, CBL_FLASH_IMAGE_CMD);
+		}
+		/* The image is checked as it is in the flash, by the CRC unit of the frame checks */
+		else if(BL_Image.Manifest.Image_CRC32 != BL_Port_CRC_Calculate((const uint8_t *)BL_Image.Manifest.Load_Address,
+				BL_Image.Manifest.Image_Size)){
+			Image_Status = IMAGE_CRC_MISMATCH;
+		}
+		/* The SHA-256 of what the frames carried, a host that sends none gets the CRC check only */
+		else if((NULL != Expected_Digest) && (0 != memcmp(Image_Digest, Expected_Digest, sizeof(Image_Digest)))){
+			Image_Status = IMAGE_DIGEST_MISMATCH;
+		}
+		/* Secure boot: an image the boot window would start has to carry its signature */
+		else if(BL_SECURE_BOOT && (BL_APP_BASE_ADDRESS == BL_Image.Manifest.Load_Address)
+				&& (IMAGE_OPERATION_PASSED != Bootloader_Image_Signature_Check(&BL_Image.Manifest))){
+			Image_Status = IMAGE_SIGNATURE_INVALID;
+		}
+		else if(BL_META_OK == Bootloader_Image_Store(1)){
+			Image_Status = IMAGE_OPERATION_PASSED;
+			BL_LOG_INFO(FLASH, BL_LOG_ID_IMAGE_COMMITTED, BL_Image.Manifest.Version, BL_Image.Manifest.Image_CRC32);
+		}
+		else{
+			Image_Status = IMAGE_OPERATION_FAILED;
+			BL_Stats.Flash_Errors++;
+		}
+		if((IMAGE_CRC_MISMATCH == Image_Status) || (IMAGE_DIGEST_MISMATCH == Image_Status) || (IMAGE_SIGNATURE_INVALID == Image_Status)){
+			/* None of the written pages can be trusted, a resume starts from the first one */
+			memset(BL_Image.Written_Pages, 0, sizeof(BL_Image.Written_Pages));
+			if(BL_META_OK != Bootloader_Image_Store(0)){
+				BL_Stats.Flash_Errors++;
+			}
+		}
+		/* The erases of the transfer are stored with the statistics, the next write starts a new plan */
+		Bootloader_Stats_Save();
+		Bootloader_Erase_Plan_Reset();
+	}
+	return Image_Status;
+}
+
+static BL_Status Bootloader_Flash_Image(uint8_t *Host_Buffer){
+	/*
+	 * Flash Image Command Format:
+	 * Begin:  Command Length (1 byte) + CBL_FLASH_IMAGE_CMD (1 byte) + CBL_IMAGE_BEGIN (1 byte) + Load address (4 bytes)
+	 *         + Image size (4 bytes) + Image CRC32 (4 bytes) + Version (4 bytes) + CRC (4 bytes)
+	 * Data:   Command Length (1 byte) + CBL_FLASH_IMAGE_CMD (1 byte) + CBL_IMAGE_DATA (1 byte) + Image offset (4 bytes)
+	 *         + Data length (1 byte) + Data + CRC (4 bytes). A data length of 0 followed by a Skip length (4 bytes) is a
+	 *         skip record of a run of 0xFF
+	 * Commit: Command Length (1 byte) + CBL_FLASH_IMAGE_CMD (1 byte) + CBL_IMAGE_COMMIT (1 byte) + CRC (4 bytes), or with
+	 *         the SHA-256 of the image (32 bytes) before the CRC
+	 * Resume: Command Length (1 byte) + CBL_FLASH_IMAGE_CMD (1 byte) + CBL_IMAGE_RESUME (1 byte) + the manifest of Begin
+	 *         + CRC (4 bytes)
+	 *
+	 * Reply: ACK + Status (1 byte) + Next image offset (4 bytes), a resume that passed adds the written pages of the
+	 * image (one bit per page, page 0 in bit 0 of the first byte)
+	 * Begin checks the whole range before the first byte moves and takes the bootable mark off the last image. Data
+	 * frames are written in image order only, a frame at another offset is left out and the reply tells the host where
+	 * the transfer is. Every BL_IMAGE_CHECKPOINT_PAGES written pages the progress is stored in the metadata, so after a
+	 * reset Resume takes the same manifest back up at the first page that was not stored. Commit runs the CRC unit
+	 * over the image in the flash and only then marks it bootable.
+	 * The SHA-256 is taken frame by frame as the data is written, so Commit only compares it with the one the host sent.
+	 * With BL_SECURE_BOOT an image at the application base also needs the signature of its trailer to commit.
+	 * */
+	BL_Status Status = BL_NACK;
+	uint16_t Host_CMD_Packet_Len = 0;
+	uint32_t Host_CRC32 = 0;
+	uint8_t Image_Reply[1 + sizeof(BL_Image.Next_Offset)] = {IMAGE_OPERATION_FAILED};
+	uint8_t Written_Pages_Len = 0;
+
+	BL_LOG_INFO(CMD, BL_LOG_ID_CMD_FLASH_IMAGE);
+	/* Extract the CRC32 and packet length sent by the HOST */
+	Host_CMD_Packet_Len = Host_Buffer[0] + 1;
+	Host_CRC32 = *((uint32_t *)((Host_Buffer + Host_CMD_Packet_Len) - CRC_TYPE_SIZE_BYTE));
+	/* CRC Verification */
+	if(CRC_VERIFICATION_PASSED == Bootloader_CRC_Verify((uint8_t *)&Host_Buffer[0] , Host_CMD_Packet_Len - 4, Host_CRC32)){
+		BL_LOG_DEBUG(CRC, BL_LOG_ID_CRC_PASSED);
+		if(CBL_IMAGE_BEGIN == Host_Buffer[2]){
+			Image_Reply[0] = (CBL_IMAGE_MANIFEST_LENGTH == Host_Buffer[0]) ? Bootloader_Image_Begin(&Host_Buffer[3]) : IMAGE_MANIFEST_INVALID;
+		}
+		else if(CBL_IMAGE_DATA == Host_Buffer[2]){
+			Image_Reply[0] = Bootloader_Image_Data(Host_Buffer, Host_CMD_Packet_Len);
+		}
+		else if(CBL_IMAGE_COMMIT == Host_Buffer[2]){
+			Image_Reply[0] = Bootloader_Image_Commit((CBL_IMAGE_COMMIT_DIGEST_LENGTH == Host_Buffer[0]) ? &Host_Buffer[3] : NULL);
+		}
+		else if(CBL_IMAGE_RESUME == Host_Buffer[2]){
+			Image_Reply[0] = (CBL_IMAGE_MANIFEST_LENGTH == Host_Buffer[0]) ? Bootloader_Image_Resume(&Host_Buffer[3]) : IMAGE_MANIFEST_INVALID;
+			if(IMAGE_OPERATION_PASSED == Image_Reply[0]){
+				/* At most BL_FLASH_MAX_PAGE_COUNT / 8 bytes, the words are little endian */
+				Written_Pages_Len = (uint8_t)((Bootloader_Image_Page_Count(BL_Image.Manifest.Image_Size) + 7) / 8);
+			}
+		}
+		else{
+			Bootloader_Send_NACK();
+		}
+		if(CBL_IMAGE_RESUME >= Host_Buffer[2]){
+			if(IMAGE_OPERATION_PASSED == Image_Reply[0]){
+				Status = BL_OK;
+			}
+			else{
+				BL_LOG_WARN(FLASH, BL_LOG_ID_IMAGE_REFUSED, Image_Reply[0], BL_Image.Next_Offset);
+			}
+			memcpy(&Image_Reply[1], &BL_Image.Next_Offset, sizeof(BL_Image.Next_Offset));
+			Bootloader_Send_ACK(sizeof(Image_Reply) + Written_Pages_Len);
+			Bootloader_Send_Data_To_Host(Image_Reply, sizeof(Image_Reply));
+			if(0 != Written_Pages_Len){
+				Bootloader_Send_Data_To_Host((uint8_t *)BL_Image.Written_Pages, Written_Pages_Len);
+			}
+		}
 	}
 	else{
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-		BL_Print_Message("CRC Verification Failed \r\n");
+		BL_LOG_WARN(CRC, BL_LOG_ID_CRC_FAILED);
+		Bootloader_Send_NACK();
+	}
+	return Status;
+}
 #endif
+
+static void Bootloader_Reliable_Send_Reply(void){
+	uint32_t Reply_CRC32 = 0;
+	uint16_t Reply_Len = 0;
+
+	/* Leave capture mode first so the reply frame itself goes out on the UART */
+	BL_Reliable_Reply.Active = 0;
+	/* Nothing captured (unknown command code) or more than a reply frame holds: the request is refused */
+	if((BL_Reliable_Reply.Overflow) || (BL_RELIABLE_HEADER_SIZE == BL_Reliable_Reply.Length)){
+		BL_Reliable_Reply.Buffer[BL_RELIABLE_HEADER_SIZE] = CBL_SEND_NACK;
+		BL_Reliable_Reply.Buffer[BL_RELIABLE_HEADER_SIZE + 1] = 0;
+		BL_Reliable_Reply.Length = BL_RELIABLE_HEADER_SIZE + 2;
+	}
+	Reply_Len = BL_Reliable_Reply.Length - BL_RELIABLE_HEADER_SIZE;
+	BL_Reliable_Reply.Buffer[0] = BL_RELIABLE_REPLY_SYNC;
+	BL_Reliable_Reply.Buffer[1] = BL_Reliable_Sequence;
+	BL_Reliable_Reply.Buffer[2] = (uint8_t)Reply_Len;
+	BL_Reliable_Reply.Buffer[3] = (uint8_t)(Reply_Len >> 8);
+	/* Same CRC as the frames, over the header and the reply. Limit leaves room for it */
+	Reply_CRC32 = BL_Port_CRC_Calculate(BL_Reliable_Reply.Buffer, BL_Reliable_Reply.Length);
+	memcpy(&BL_Reliable_Reply.Buffer[BL_Reliable_Reply.Length], &Reply_CRC32, CRC_TYPE_SIZE_BYTE);
+	BL_Reliable_Reply.Length += CRC_TYPE_SIZE_BYTE;
+	BL_Reliable_Reply_Valid = 1;
+	BL_Port_Host_Transmit(BL_Reliable_Reply.Buffer, BL_Reliable_Reply.Length);
+}
+
+#if BL_FEATURE_RELIABLE
+static BL_Status Bootloader_Reliable(uint8_t *Host_Buffer){
+	/*
+	 * Reliable Command Format:
+	 * Command Length (1 byte) + CBL_RELIABLE_CMD (1 byte) + Sequence (1 byte)
+	 * + Request, a complete host command (length, code, details, CRC) + CRC (4 bytes)
+	 *
+	 * Reply frame: Sync (1 byte = BL_RELIABLE_REPLY_SYNC) + Sequence (1 byte) + Reply length (2 bytes)
+	 * + the reply of the request (ACK + length + data, or NACK + 0) + CRC32 of the frame (4 bytes)
+	 * A bare NACK means the envelope arrived corrupted and nothing ran. The host sends the same request again after
+	 * a corrupted or missing reply frame: a request that already ran gets its stored frame, it never runs twice.
+	 * */
+	BL_Status Status = BL_NACK;
+	uint16_t Host_CMD_Packet_Len = 0;
+	uint32_t Host_CRC32 = 0;
+	uint8_t *Request = NULL;
+	uint16_t Request_Len = 0;
+	uint32_t Request_CRC32 = 0;
+	uint8_t Request_Valid = 0;
+
+	BL_LOG_INFO(CMD, BL_LOG_ID_CMD_RELIABLE);
+	/* Extract the CRC32 and packet length sent by the HOST */
+	Host_CMD_Packet_Len = Host_Buffer[0] + 1;
+	Host_CRC32 = *((uint32_t *)((Host_Buffer + Host_CMD_Packet_Len) - CRC_TYPE_SIZE_BYTE));
+	/* CRC Verification */
+	if(CRC_VERIFICATION_PASSED == Bootloader_CRC_Verify((uint8_t *)&Host_Buffer[0] , Host_CMD_Packet_Len - 4, Host_CRC32)){
+		BL_LOG_DEBUG(CRC, BL_LOG_ID_CRC_PASSED);
+		Request = &Host_Buffer[BL_RELIABLE_REQUEST_OFFSET];
+		Request_Len = Request[0] + 1;
+		/* The request fills the envelope up to its CRC and is not an envelope itself */
+		if((Host_CMD_Packet_Len > (BL_RELIABLE_REQUEST_OFFSET + CRC_TYPE_SIZE_BYTE))
+				&& (Request[0] >= BL_BATCH_MIN_SUB_FRAME_LENGTH)
+				&& ((BL_RELIABLE_REQUEST_OFFSET + Request_Len) == (Host_CMD_Packet_Len - CRC_TYPE_SIZE_BYTE))
+				&& (CBL_RELIABLE_CMD != Request[1])){
+			Request_CRC32 = *((uint32_t *)((Request + Request_Len) - CRC_TYPE_SIZE_BYTE));
+			Request_Valid = 1;
+		}
+
+		if((Request_Valid) && (BL_Reliable_Reply_Valid) && (Host_Buffer[2] == BL_Reliable_Sequence)
+				&& (Request_CRC32 == BL_Reliable_Request_CRC32)){
+			/* The reply frame got lost on the way to the host */
+			BL_LOG_WARN(CMD, BL_LOG_ID_REPLY_REPEATED, BL_Reliable_Sequence);
+			BL_Port_Host_Transmit(BL_Reliable_Reply.Buffer, BL_Reliable_Reply.Length);
+			Status = BL_OK;
+		}
+		else{
+			BL_Reliable_Sequence = Host_Buffer[2];
+			BL_Reliable_Request_CRC32 = Request_CRC32;
+			BL_Reliable_Reply_Valid = 0;
+			BL_Reliable_Reply.Active = 1;
+			BL_Reliable_Reply.Overflow = 0;
+			BL_Reliable_Reply.Length = BL_RELIABLE_HEADER_SIZE;
+			BL_Reliable_Reply.Limit = BL_RELIABLE_HEADER_SIZE + BL_RELIABLE_REPLY_MAX_LENGTH;
+			if(Request_Valid){
+				Status = Bootloader_Execute_Command(Request);
+			}
+			else{
+				Bootloader_Send_NACK();
+			}
+			Bootloader_Reliable_Send_Reply();
+		}
+	}
+	else{
+		BL_LOG_WARN(CRC, BL_LOG_ID_CRC_FAILED);
 		Bootloader_Send_NACK();
 	}
+	return Status;
 }
+#endif
 /*****************************************Static Functions Implementation End*****************************************/
 
@@ -19,6 +19,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include "main.h"
 #include "crc.h"
+#include "dma.h"
 #include "usart.h"
 #include "gpio.h"
 
@@ -87,11 +88,15 @@ int main(void)
 
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
+  MX_DMA_Init();
   MX_CRC_Init();
   MX_USART2_UART_Init();
   MX_USART3_UART_Init();
   /* USER CODE BEGIN 2 */
   BL_Status Status =BL_NACK;
+  BL_Flash_Geometry_Init();
+  BL_Stats_Init();
+  BL_LOG_INFO(SYS, BL_LOG_ID_BOOTLOADER_STARTED);
   /* USER CODE END 2 */
 
   /* Infinite loop */
@@ -100,10 +105,6 @@ int main(void)
   {
     /* USER CODE END WHILE */
 	  Status = BL_UART_Featch_Host_Command();
-#if (BL_DEBUG_ENABLE == DEBUG_INFO_ENABLE)
-	  BL_Print_Message("Bootloader Started!! \r\n");
-
-#endif
     /* USER CODE BEGIN 3 */
   }
   /* USER CODE END 3 */
@@ -5,12 +5,36 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
+../Core/Src/Bootloader/bl_ecdsa.c \
+../Core/Src/Bootloader/bl_flash.c \
+../Core/Src/Bootloader/bl_log.c \
+../Core/Src/Bootloader/bl_meta.c \
+../Core/Src/Bootloader/bl_port_hal.c \
+../Core/Src/Bootloader/bl_port_ll.c \
+../Core/Src/Bootloader/bl_public_key.c \
+../Core/Src/Bootloader/bl_sha256.c \
 ../Core/Src/Bootloader/bootloader.c 
 
 OBJS += \
+./Core/Src/Bootloader/bl_ecdsa.o \
+./Core/Src/Bootloader/bl_flash.o \
+./Core/Src/Bootloader/bl_log.o \
+./Core/Src/Bootloader/bl_meta.o \
+./Core/Src/Bootloader/bl_port_hal.o \
+./Core/Src/Bootloader/bl_port_ll.o \
+./Core/Src/Bootloader/bl_public_key.o \
+./Core/Src/Bootloader/bl_sha256.o \
 ./Core/Src/Bootloader/bootloader.o 
 
 C_DEPS += \
+./Core/Src/Bootloader/bl_ecdsa.d \
+./Core/Src/Bootloader/bl_flash.d \
+./Core/Src/Bootloader/bl_log.d \
+./Core/Src/Bootloader/bl_meta.d \
+./Core/Src/Bootloader/bl_port_hal.d \
+./Core/Src/Bootloader/bl_port_ll.d \
+./Core/Src/Bootloader/bl_public_key.d \
+./Core/Src/Bootloader/bl_sha256.d \
 ./Core/Src/Bootloader/bootloader.d 
 
 
@@ -21,7 +45,7 @@ Core/Src/Bootloader/%.o Core/Src/Bootloader/%.su Core/Src/Bootloader/%.cyclo: ..
 clean: clean-Core-2f-Src-2f-Bootloader
 
 clean-Core-2f-Src-2f-Bootloader:
-	-$(RM) ./Core/Src/Bootloader/bootloader.cyclo ./Core/Src/Bootloader/bootloader.d ./Core/Src/Bootloader/bootloader.o ./Core/Src/Bootloader/bootloader.su
+	-$(RM) ./Core/Src/Bootloader/bl_ecdsa.cyclo ./Core/Src/Bootloader/bl_ecdsa.d ./Core/Src/Bootloader/bl_ecdsa.o ./Core/Src/Bootloader/bl_ecdsa.su ./Core/Src/Bootloader/bl_flash.cyclo ./Core/Src/Bootloader/bl_flash.d ./Core/Src/Bootloader/bl_flash.o ./Core/Src/Bootloader/bl_flash.su ./Core/Src/Bootloader/bl_log.cyclo ./Core/Src/Bootloader/bl_log.d ./Core/Src/Bootloader/bl_log.o ./Core/Src/Bootloader/bl_log.su ./Core/Src/Bootloader/bl_meta.cyclo ./Core/Src/Bootloader/bl_meta.d ./Core/Src/Bootloader/bl_meta.o ./Core/Src/Bootloader/bl_meta.su ./Core/Src/Bootloader/bl_port_hal.cyclo ./Core/Src/Bootloader/bl_port_hal.d ./Core/Src/Bootloader/bl_port_hal.o ./Core/Src/Bootloader/bl_port_hal.su ./Core/Src/Bootloader/bl_port_ll.cyclo ./Core/Src/Bootloader/bl_port_ll.d ./Core/Src/Bootloader/bl_port_ll.o ./Core/Src/Bootloader/bl_port_ll.su ./Core/Src/Bootloader/bl_public_key.cyclo ./Core/Src/Bootloader/bl_public_key.d ./Core/Src/Bootloader/bl_public_key.o ./Core/Src/Bootloader/bl_public_key.su ./Core/Src/Bootloader/bl_sha256.cyclo ./Core/Src/Bootloader/bl_sha256.d ./Core/Src/Bootloader/bl_sha256.o ./Core/Src/Bootloader/bl_sha256.su ./Core/Src/Bootloader/bootloader.cyclo ./Core/Src/Bootloader/bootloader.d ./Core/Src/Bootloader/bootloader.o ./Core/Src/Bootloader/bootloader.su
 
 .PHONY: clean-Core-2f-Src-2f-Bootloader
 
@@ -3,7 +3,10 @@ import struct
 import os
 import sys
 import glob
-from time import sleep
+import re
+import json
+import hashlib
+from time import sleep, monotonic
 
 ''' Bootloader Commands '''
 CBL_GET_VER_CMD              = 0x10
@@ -18,6 +21,19 @@ CBL_MEM_READ_CMD             = 0x18
 CBL_READ_SECTOR_STATUS_CMD   = 0x19
 CBL_OTP_READ_CMD             = 0x20
 CBL_CHANGE_ROP_Level_CMD     = 0x21
+CBL_BATCH_CMD                = 0x22
+CBL_GET_STATS_CMD            = 0x23
+CBL_ALLOCATE_PAGES_CMD       = 0x24
+CBL_LOAD_AND_EXEC_CMD        = 0x25
+CBL_FLASH_IMAGE_CMD          = 0x26
+CBL_RELIABLE_CMD             = 0x27
+CBL_GET_CAPABILITIES_CMD     = 0x28
+
+BL_BATCH_STOP_ON_FAILURE     = 0x00
+BL_BATCH_CONTINUE_ON_FAILURE = 0x01
+
+BL_ACK_VALUE                 = 0xCD
+BL_NACK_VALUE                = 0xAB
 
 INVALID_SECTOR_NUMBER        = 0x00
 VALID_SECTOR_NUMBER          = 0x01
@@ -26,15 +42,262 @@ SUCCESSFUL_ERASE             = 0x03
 
 FLASH_PAYLOAD_WRITE_FAILED   = 0x00
 FLASH_PAYLOAD_WRITE_PASSED   = 0x01
+FLASH_PAYLOAD_WRITE_POSTED   = 0x02
+
+CBL_STUB_LOAD                = 0x00
+CBL_STUB_EXEC                = 0x01
+STUB_OPERATION_FAILED        = 0x00
+STUB_OPERATION_PASSED        = 0x01
+''' Largest stub chunk: the frame length byte counts code, operation, offset, length, data and CRC32 '''
+CBL_STUB_MAX_CHUNK           = 246
+
+CBL_IMAGE_BEGIN              = 0x00
+CBL_IMAGE_DATA               = 0x01
+CBL_IMAGE_COMMIT             = 0x02
+CBL_IMAGE_RESUME             = 0x03
+IMAGE_OPERATION_PASSED       = 0x01
+IMAGE_OFFSET_MISMATCH        = 0x03
+IMAGE_STATUS_NAMES = {
+    0x00 : "Failed (write error or frame out of the image)",
+    0x01 : "Passed",
+    0x02 : "Manifest invalid (empty image or range outside the application)",
+    0x03 : "Offset mismatch, nothing written",
+    0x04 : "No transfer in progress",
+    0x05 : "Image CRC32 mismatch, not bootable",
+    0x06 : "Image SHA-256 mismatch, not bootable",
+    0x07 : "Image signature invalid (secure boot), sign it with Tools/sign_image.py"
+}
+''' Bytes of an image DATA frame around the payload: length, code, operation, offset and data length, then the CRC32.
+    Frame_Payload_Max gives the payload that fits the negotiated frame (244 bytes, 236 in the reliable envelope) '''
+CBL_IMAGE_DATA_OVERHEAD      = 12
+''' RESUME sent in a row after NACKed image frames before the transfer is given up '''
+CBL_IMAGE_RESUME_RETRIES     = 3
+
+''' Reliable envelope: the request goes with a sequence number, the reply comes back as a frame with a CRC32 '''
+BL_RELIABLE_REPLY_SYNC       = 0x5A
+''' Bytes the envelope adds to a request: its length byte, code, sequence and CRC32. Longer requests go as they are '''
+CBL_RELIABLE_REQUEST_OVERHEAD = 7
+''' Longest reply a frame carries: ACK, length and the longest command reply '''
+BL_RELIABLE_REPLY_MAX_LENGTH = 257
+''' Requests sent again after a corrupted or missing reply frame, and the time a reply frame may take (s) '''
+CBL_RELIABLE_RETRIES         = 3
+BL_RELIABLE_REPLY_TIMEOUT    = 5.0
+
+''' Tokenized debug log, keep the IDs in sync with BL_Log_Id in bl_log.h '''
+BL_LOG_SYNC_BYTE             = 0xA5
+BL_LOG_HEADER_SIZE           = 4
+BL_LOG_ID_TEXT               = 0x00
+BL_LOG_DICTIONARY = {
+    0x01 : "Bootloader Started",
+    0x02 : "Invalid command code {:#04x} received from the host",
+    0x03 : "CRC Verification Passed",
+    0x04 : "CRC Verification Failed",
+    0x05 : "Reply frame {} sent again, the request already ran",
+    0x06 : "Frame dropped, {} bytes decoded or announced",
+    0x07 : "Frame timed out, length {} given up",
+    0x10 : "Read the bootloader version from the MCU",
+    0x11 : "Read the commands supported by the bootloader",
+    0x12 : "Read the MCU chip identification number",
+    0x13 : "Read the FLASH Read Protection level",
+    0x14 : "Jump bootloader into specified address",
+    0x15 : "Mass erase or page erase of the user flash",
+    0x16 : "Write data into different memories of the MCU",
+    0x18 : "Read data from different memories of the MCU",
+    0x21 : "Change read protection level of the user flash",
+    0x22 : "Execute a batch of commands",
+    0x23 : "Read the bootloader statistics",
+    0x24 : "Allocate the least worn flash pages",
+    0x25 : "Load a stub into the SRAM window or execute it",
+    0x26 : "Flash image transaction",
+    0x27 : "Reliable command",
+    0x28 : "Read the bootloader capabilities",
+    0x30 : "Address verification succeeded",
+    0x31 : "Jump to {:#010x}",
+    0x32 : "Stub call at {:#010x}, Arg0 {:#010x}",
+    0x33 : "Stub returned {:#010x}",
+    0x34 : "Stub refused: bad entry or length, CRC mismatch or read protected flash",
+    0x35 : "Boot window closed, application started at 0x{:08X}",
+    0x36 : "Image signature checked: SHA-256 in {} cycles, ECDSA in {} cycles",
+    0x37 : "Image signature invalid, {} bytes signed",
+    0x38 : "Image signature check took {} cycles, over the budget of {}",
+    0x39 : "Command 0x{:02X} refused: secure boot only starts signed images",
+    0x40 : "Flash MASS ERASE activation",
+    0x41 : "Flash page erase: first page {}, number of pages {}",
+    0x42 : "SUCCESSFUL ERASE",
+    0x43 : "UNSUCCESSFUL ERASE at {:#010x}",
+    0x44 : "Allocated pages from {}, highest erase count {}",
+    0x45 : "Flash geometry: device ID {:#05x}, F_SIZE {} KB",
+    0x46 : "memory_layout.ld does not fit this part (flash end {:#010x}, page size {}), erase and write refused",
+    0x47 : "Write posted to bank 2: address {:#010x}, length {}",
+    0x48 : "Posted bank 2 write FAILED, found by command {:#04x}",
+    0x49 : "Flash page {} already blank, not erased",
+    0x4A : "Skip record: {:#010x}, {} erased bytes",
+    0x4B : "Image transfer to {:#010x}, {} bytes",
+    0x4C : "Image version {} committed, CRC32 {:#010x}",
+    0x4D : "Image operation refused, status {}, next offset {}",
+    0x4E : "Image checkpoint at offset {}, {} pages written",
+    0x4F : "Image transfer resumed at offset {}, {} pages written",
+    0x50 : "Write to {:#010x}, payload length {}",
+    0x51 : "Payload Valid",
+    0x52 : "Payload InValid",
+    0x53 : "Write cycles : {} per received byte, {} per programmed half-word",
+    0x54 : "Read from {:#010x}, length {}",
+    0x55 : "Read refused: invalid range or read protected flash",
+    0x56 : "Image SHA-256 of {} bytes taken in {} cycles",
+    0x57 : "Write at {:#010x} of {} bytes over programmed bytes, erase plan restarted",
+    0x60 : "Failed -> Unlock the FLASH Option Control Registers access",
+    0x61 : "Passed -> Unlock the FLASH Option Control Registers access",
+    0x62 : "Failed -> Program option bytes",
+    0x63 : "Passed -> Program ROP to Level : {:#04x}",
+    0x70 : "Log ring overflow, {} records dropped"
+}
+
+''' CBL_GET_STATS_CMD reply, keep it in sync with BL_Stats_Record in bootloader.h '''
+BL_STATS_HEADER_FORMAT = '<BBH3I8I3Q'
+BL_STATS_HEADER_FIELDS = ("Version", "Page_Count", "Record_Length", "UID_Word_0", "UID_Word_1", "UID_Word_2",
+                          "Core_Clock_Hz", "Boot_Count", "Frames_Received", "CRC_Failures", "NACKs_Sent",
+                          "Flash_Errors", "Bytes_Programmed", "Meta_Generation",
+                          "Receive_Cycles", "Program_Cycles", "Erase_Cycles")
+''' Latest record of every board read with CBL_GET_STATS_CMD, keyed by the unique device ID '''
+BL_FLEET_STATS_FILE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "bl_fleet_stats.json")
+BL_FLEET_REPORT_TOP = 5
+''' Version 2 appends the geometry of the part after the erase counts '''
+BL_STATS_GEOMETRY_FORMAT = '<IHH'
+BL_STATS_GEOMETRY_FIELDS = ("Flash_Size", "Flash_Page_Size", "Pages_Per_Entry")
+''' CBL_GET_CAPABILITIES_CMD reply: Type (1 byte) + Length (1 byte) + Value records, keep the types in sync with
+    BL_CAP_x in bootloader.h. A type this host does not know is skipped '''
+BL_CAP_PROTOCOL              = 0x01
+BL_CAP_MAX_FRAME             = 0x02
+BL_CAP_WINDOW                = 0x03
+BL_CAP_BAUD_RATES            = 0x04
+BL_CAP_CODECS                = 0x05
+BL_CAP_FRAMINGS              = 0x06
+BL_CAP_FLASH_GEOMETRY        = 0x07
+BL_CAP_SLOTS                 = 0x08
+BL_CAP_FORMATS = {
+    BL_CAP_PROTOCOL       : '<5B',
+    BL_CAP_MAX_FRAME      : '<2H',
+    BL_CAP_WINDOW         : '<2B',
+    BL_CAP_CODECS         : '<H',
+    BL_CAP_FRAMINGS       : '<B',
+    BL_CAP_FLASH_GEOMETRY : '<3HI',
+    BL_CAP_SLOTS          : '<6I'
+}
+BL_CAP_CODEC_ERASED_SKIP     = 0x0001
+BL_CAP_CODEC_IMAGE_SHA256    = 0x0002
+BL_CAP_CODEC_NAMES = {
+    BL_CAP_CODEC_ERASED_SKIP  : "0xFF run skip records",
+    BL_CAP_CODEC_IMAGE_SHA256 : "image SHA-256"
+}
+BL_CAP_FRAMING_LENGTH        = 0x01
+BL_CAP_FRAMING_COBS          = 0x02
+BL_CAP_FRAMING_RELIABLE      = 0x04
+BL_CAP_FRAMING_BATCH         = 0x08
+BL_CAP_FRAMING_IMAGE         = 0x10
+BL_CAP_FRAMING_NAMES = {
+    BL_CAP_FRAMING_LENGTH   : "length byte",
+    BL_CAP_FRAMING_COBS     : "COBS",
+    BL_CAP_FRAMING_RELIABLE : "reliable envelope",
+    BL_CAP_FRAMING_BATCH    : "batch",
+    BL_CAP_FRAMING_IMAGE    : "image transaction"
+}
+''' What this host has, the negotiation keeps the fastest mode the bootloader has too '''
+HOST_MAX_FRAME               = 256
+HOST_BAUD_RATES              = (115200, 230400, 460800, 921600)
+HOST_CAP_CODECS              = BL_CAP_CODEC_ERASED_SKIP | BL_CAP_CODEC_IMAGE_SHA256
+''' Bytes of a MEM_WRITE frame around the payload: length, code, address and payload length, then the CRC32 '''
+CBL_MEM_WRITE_OVERHEAD       = 11
+''' MEM_WRITE payload of a bootloader that did not answer CBL_GET_CAPABILITIES_CMD '''
+CBL_MEM_WRITE_DEFAULT_PAYLOAD = 128
+
+''' STM32F103 datasheet, minimum flash endurance per page '''
+BL_FLASH_ENDURANCE_CYCLES = 10000
+CBL_ALLOCATE_NO_PAGES = 0xFF
+CBL_ALLOCATE_NO_PAGES_EXTENDED = 0xFFFF
+CBL_FLASH_MASS_ERASE = 0xFF
+CBL_FLASH_MASS_ERASE_EXTENDED = 0xFFFF
+''' Page numbers above this one go in the extended (two byte) erase and allocate frames '''
+CBL_FLASH_MAX_SHORT_PAGE = 0xFE
+CBL_FLASH_BASE = 0x08000000
+CBL_FLASH_MAX_SIZE = 1024 * 1024
+''' Runs of 0xFF of at least this many bytes go as a skip record (15 bytes) instead of packet bytes '''
+CBL_MEM_WRITE_SKIP_MIN_RUN = 64
+
+''' STM32F1 lines by DEV_ID: name and page size, the same table as bl_flash.c '''
+BL_FLASH_LINES = {
+    0x412 : ("Low density", 1024),
+    0x410 : ("Medium density", 1024),
+    0x420 : ("Value line", 1024),
+    0x414 : ("High density", 2048),
+    0x428 : ("High density value line", 2048),
+    0x430 : ("XL density", 2048),
+    0x418 : ("Connectivity line", 2048)
+}
+''' Page size of the connected part, learnt from CBL_GET_CID_CMD '''
+BL_Flash_Page_Size = 1024
 
 verbose_mode = 1
 Memory_Write_Active = 0
 
+''' Every request goes in the reliable envelope: Write_Data_To_Serial_Port collects it, Read_Data_From_Serial_Port
+    sends it and reads the reply frame into Reliable_Reply, which Read_Serial_Port hands out. The sequence starts at
+    random so a restarted host does not get the stored reply of the last request of an earlier session '''
+Reliable_Replies = 1
+Reliable_Sequence = int.from_bytes(os.urandom(1), 'little')
+Reliable_Request = []
+Reliable_Reply = None
+
+''' COBS framing: the request (or its envelope) is COBS encoded between two 0x00 delimiters, the bootloader drops a
+    frame hit on the line and is in sync again at the next delimiter. Write_Data_To_Serial_Port collects the request
+    in Reliable_Request for it too. The bootloader switches at the first delimiter and keeps the framing until reset '''
+COBS_Framing = 0
+BL_COBS_DELIMITER = 0x00
+
+''' Learnt from CBL_GET_CAPABILITIES_CMD: None before the first query, empty for a bootloader without the command.
+    Negotiate_BL_Mode sets the frame, the codecs and the application base from it. Image_Digest: COMMIT carries the SHA-256 '''
+BL_Capabilities = None
+Frame_Max_Length = HOST_MAX_FRAME
+Mem_Write_Payload_Max = CBL_MEM_WRITE_DEFAULT_PAYLOAD
+Erased_Skip = 1
+Image_Digest = 0
+BL_Target_App_Base = None
+
+''' Application base address, set once in memory_layout.ld at the repository root '''
+BL_MEMORY_LAYOUT_FILE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "memory_layout.ld")
+
+def Get_App_Base_Address():
+    App_Base_Address = None
+    try:
+        with open(BL_MEMORY_LAYOUT_FILE, 'r') as Layout_File:
+            Match = re.search(r'^\s*BL_APP_BASE\s*=\s*(0x[0-9a-fA-F]+)\s*;', Layout_File.read(), re.MULTILINE)
+            if Match:
+                App_Base_Address = int(Match.group(1), 16)
+    except OSError:
+        App_Base_Address = None
+    return App_Base_Address
+
+def Input_Address(Prompt):
+    ''' An empty answer selects the application base address, the one the bootloader reported first '''
+    App_Base_Address = BL_Target_App_Base if BL_Target_App_Base is not None else Get_App_Base_Address()
+    if App_Base_Address is not None:
+        Prompt = Prompt + "[{:#010x}] : ".format(App_Base_Address)
+    else:
+        Prompt = Prompt + ": "
+    Address = input(Prompt).strip()
+    while not Address and App_Base_Address is None:
+        Address = input(Prompt).strip()
+    if not Address:
+        return App_Base_Address
+    return int(Address, 16)
+
 def Check_Serial_Ports():
     Serial_Ports = []
     
     if sys.platform.startswith('win'):
         Ports = ['COM%s' % (i + 1) for i in range(256)]
+    elif sys.platform.startswith('linux'):
+        ''' USB to serial adapters, and the pseudo terminals of the bl_sim simulator '''
+        Ports = glob.glob('/dev/ttyUSB*') + glob.glob('/dev/ttyACM*') + glob.glob('/dev/pts/[0-9]*')
     else:
         raise EnvironmentError("Error !! Unsupported Platform \n")
     
@@ -75,9 +338,100 @@ def Write_Data_To_Serial_Port(Value, Length):
         print("   "+"0x{:02x}".format(Value[0]), end = ' ')
         if(Memory_Write_Active and (not verbose_mode)):
             print("#", end = ' ')
-        Serial_Port_Obj.write(_data)
+        if(Reliable_Replies or COBS_Framing):
+            Reliable_Request.append(Value[0])
+        else:
+            Serial_Port_Obj.write(_data)
+
+def Read_Reliable_Port(Data_Len):
+    ''' Like Read_Serial_Port, but gives up after BL_RELIABLE_REPLY_TIMEOUT '''
+    Serial_Value = b''
+    Deadline = monotonic() + BL_RELIABLE_REPLY_TIMEOUT
+    while(len(Serial_Value) < Data_Len and monotonic() < Deadline):
+        Serial_Value = Serial_Value + Serial_Port_Obj.read(Data_Len - len(Serial_Value))
+    return Serial_Value
+
+def Read_Reliable_Reply_Frame(Sequence):
+    ''' Returns the reply the frame carries, None on a bare NACK (the envelope arrived corrupted), a corrupted frame
+        or a timeout. A frame of an earlier sequence is the late reply of a request sent again, it is skipped '''
+    while True:
+        Header = Read_Reliable_Port(1)
+        if(Header != bytes([BL_RELIABLE_REPLY_SYNC])):
+            return None
+        Header = Header + Read_Reliable_Port(3)
+        if(len(Header) != 4 or struct.unpack_from('<H', Header, 2)[0] > BL_RELIABLE_REPLY_MAX_LENGTH):
+            return None
+        Reply_Len = struct.unpack_from('<H', Header, 2)[0]
+        Body = Read_Reliable_Port(Reply_Len + 4)
+        if(len(Body) != Reply_Len + 4 or Calculate_CRC32(Header + Body[:-4], Reply_Len + 4) != struct.unpack_from('<I', Body, Reply_Len)[0]):
+            return None
+        if(Header[1] == Sequence):
+            return bytearray(Body[:-4])
+
+def Send_Reliable_Request():
+    ''' Sends the collected request in the envelope, again after every corrupted or missing reply frame (the bootloader
+        answers a request it already ran from its stored frame, it never runs twice). Returns the reply, None when no
+        intact frame came back '''
+    global Reliable_Sequence
+    global Reliable_Request
+    Request = Reliable_Request
+    Reliable_Request = []
+    Reliable_Sequence = (Reliable_Sequence + 1) & 0xFF
+    Envelope = bytes(Build_CBL_Command(CBL_RELIABLE_CMD, [Reliable_Sequence] + Request))
+    for Attempt in range(CBL_RELIABLE_RETRIES + 1):
+        if(Attempt):
+            print("\n   Reply frame corrupted or missing, request {} sent again ({}/{})".format(Reliable_Sequence, Attempt, CBL_RELIABLE_RETRIES))
+            ''' What is left of the broken reply must not be taken for the next one '''
+            sleep(0.05)
+            Serial_Port_Obj.reset_input_buffer()
+        Write_Frame(Envelope)
+        Reply = Read_Reliable_Reply_Frame(Reliable_Sequence)
+        if(Reply is not None):
+            return Reply
+    print("\n   No intact reply frame after {} retransmissions, command given up".format(CBL_RELIABLE_RETRIES))
+    return None
+
+def COBS_Encode(Data):
+    ''' No 0x00 in the result: every block of up to 254 bytes gets a code byte, the offset of the next 0x00 '''
+    Encoded = bytearray()
+    Block = bytearray()
+    for Byte in Data:
+        if(Byte == BL_COBS_DELIMITER):
+            Encoded = Encoded + bytes([len(Block) + 1]) + Block
+            Block = bytearray()
+        else:
+            Block.append(Byte)
+            if(len(Block) == 254):
+                Encoded = Encoded + b'\xff' + Block
+                Block = bytearray()
+    return bytes(Encoded + bytes([len(Block) + 1]) + Block)
+
+def Write_Frame(Frame):
+    ''' The delimiter first also ends a frame a lost delimiter left open '''
+    if(COBS_Framing):
+        Frame = bytes([BL_COBS_DELIMITER]) + COBS_Encode(Frame) + bytes([BL_COBS_DELIMITER])
+    Serial_Port_Obj.write(bytes(Frame))
+
+def Toggle_COBS_Framing():
+    global COBS_Framing
+    COBS_Framing = 0 if COBS_Framing else 1
+    print("COBS framing (a frame hit on the line is dropped, in sync again at the next delimiter) :", "ON" if COBS_Framing else "OFF")
+    if(not COBS_Framing):
+        print("The bootloader keeps COBS framing until it is reset")
+
+def Toggle_Reliable_Replies():
+    ''' Off for a bootloader without CBL_RELIABLE_CMD '''
+    global Reliable_Replies
+    Reliable_Replies = 0 if Reliable_Replies else 1
+    print("Reliable replies (sequence numbered, CRC32 checked, sent again when corrupted) :", "ON" if Reliable_Replies else "OFF")
 
 def Read_Serial_Port(Data_Len):
+    global Reliable_Reply
+    if(Reliable_Reply is not None):
+        ''' The reply frame has already been read and checked '''
+        Serial_Value = bytes(Reliable_Reply[:Data_Len])
+        Reliable_Reply = Reliable_Reply[Data_Len:]
+        return Serial_Value
     
     Serial_Value = Serial_Port_Obj.read(Data_Len)
     Serial_Value_len = len(Serial_Value)
@@ -92,9 +446,20 @@ def Read_Serial_Port(Data_Len):
     return Serial_Value
     '''
 
-def Read_Data_From_Serial_Port(Command_Code):
+def Read_Data_From_Serial_Port(Command_Code, Exit_On_NACK = True):
+    global Reliable_Reply
+    global Reliable_Request
     Length_To_Follow = 0
     
+    Reliable_Reply = None
+    if((Reliable_Replies and len(Reliable_Request) + CBL_RELIABLE_REQUEST_OVERHEAD > 256) or (COBS_Framing and not Reliable_Replies)):
+        ''' Too long for the envelope (or no envelope), the request and its reply go as they are '''
+        Write_Frame(Reliable_Request)
+        Reliable_Request = []
+    elif(Reliable_Replies):
+        Reliable_Reply = Send_Reliable_Request()
+        if(Reliable_Reply is None):
+            return
     BL_ACK = Read_Serial_Port(2)
     if(len(BL_ACK)):
         BL_ACK_Array = bytearray(BL_ACK)
@@ -116,11 +481,26 @@ def Read_Data_From_Serial_Port(Command_Code):
                 Process_CBL_FLASH_ERASE_CMD(Length_To_Follow)
             elif (Command_Code == CBL_MEM_WRITE_CMD):
                 Process_CBL_MEM_WRITE_CMD(Length_To_Follow)
+            elif (Command_Code == CBL_MEM_READ_CMD):
+                Process_CBL_MEM_READ_CMD(Length_To_Follow)
             elif (Command_Code == CBL_CHANGE_ROP_Level_CMD):
                 Process_CBL_CHANGE_ROP_Level_CMD(Length_To_Follow)
+            elif (Command_Code == CBL_BATCH_CMD):
+                Process_CBL_BATCH_CMD(Length_To_Follow)
+            elif (Command_Code == CBL_GET_STATS_CMD):
+                Process_CBL_GET_STATS_CMD(Length_To_Follow)
+            elif (Command_Code == CBL_ALLOCATE_PAGES_CMD):
+                Process_CBL_ALLOCATE_PAGES_CMD(Length_To_Follow)
+            elif (Command_Code == CBL_LOAD_AND_EXEC_CMD):
+                Process_CBL_LOAD_AND_EXEC_CMD(Length_To_Follow)
+            elif (Command_Code == CBL_FLASH_IMAGE_CMD):
+                Process_CBL_FLASH_IMAGE_CMD(Length_To_Follow)
+            elif (Command_Code == CBL_GET_CAPABILITIES_CMD):
+                Process_CBL_GET_CAPABILITIES_CMD(Length_To_Follow)
         else:
             print ("\n   Received Not-Acknowledgement from Bootloader")
-            sys.exit()
+            if(Exit_On_NACK):
+                sys.exit()
         
 def Process_CBL_GET_VER_CMD(Data_Len):
     Serial_Data = Read_Serial_Port(Data_Len)
@@ -136,9 +516,13 @@ def Process_CBL_GET_HELP_CMD(Data_Len):
         print(hex(command), end = ' ')
 
 def Process_CBL_GET_CID_CMD(Data_Len):
+    global BL_Flash_Page_Size
     Serial_Data = Read_Serial_Port(Data_Len)
     CID = (Serial_Data[1] << 8) | Serial_Data[0]
     print("\n   Chip Identification Number : ", hex(CID))
+    if(CID in BL_FLASH_LINES):
+        BL_Flash_Page_Size = BL_FLASH_LINES[CID][1]
+        print("   Device line                : ", BL_FLASH_LINES[CID][0], "({} byte pages)".format(BL_Flash_Page_Size))
 
 def Process_CBL_GET_RDP_STATUS_CMD(Data_Len):
     Serial_Data = Read_Serial_Port(Data_Len)
@@ -178,17 +562,31 @@ def Process_CBL_FLASH_ERASE_CMD(Data_Len):
 
 def Process_CBL_MEM_WRITE_CMD(Data_Len):
     global Memory_Write_All
+    global Memory_Write_Posted
     BL_Write_Status = 0
     Serial_Data = Read_Serial_Port(Data_Len)
     BL_Write_Status = bytearray(Serial_Data)
     if(BL_Write_Status[0] == FLASH_PAYLOAD_WRITE_FAILED):
         print("\n   Write Status -> Write Failed or Invalid Address ")
+        Memory_Write_All = 0
     elif (BL_Write_Status[0] == FLASH_PAYLOAD_WRITE_PASSED):
         print("\n   Write Status -> Write Successfule ")
         Memory_Write_All = Memory_Write_All and FLASH_PAYLOAD_WRITE_PASSED
+    elif (BL_Write_Status[0] == FLASH_PAYLOAD_WRITE_POSTED):
+        ''' Bank 2 of a dual bank part: programmed while the next packet arrives, the next write reports a failure '''
+        print("\n   Write Status -> Accepted, programming in bank 2 ")
+        Memory_Write_Posted = 1
     else:
         print("Timeout !!, Bootloader is not responding")
 
+def Process_CBL_MEM_READ_CMD(Data_Len):
+    Serial_Data = Read_Serial_Port(Data_Len)
+    _value_ = bytearray(Serial_Data)
+    for Row_Index in range(0, len(_value_), 16):
+        print("\n   +{:04x} : ".format(Row_Index), end = ' ')
+        for Data in _value_[Row_Index : Row_Index + 16]:
+            print("{:02x}".format(Data), end = ' ')
+
 def Process_CBL_CHANGE_ROP_Level_CMD(Data_Len):
     BL_CHANGE_ROP_Level_Status = 0
     Serial_Data = Read_Serial_Port(Data_Len)
@@ -201,21 +599,365 @@ def Process_CBL_CHANGE_ROP_Level_CMD(Data_Len):
         else:
             print("\n   ROP Level -> Unknown Error")
 
+def Process_CBL_BATCH_CMD(Data_Len):
+    Serial_Data = Read_Serial_Port(Data_Len)
+    _value_ = bytearray(Serial_Data)
+    Executed_Commands = _value_[0]
+    print("\n   Executed sub-commands : ", Executed_Commands)
+    Record_Index = 1
+    for Sub_Command in range(Executed_Commands):
+        if(Record_Index + 3 > len(_value_)):
+            print("   Sub-command", Sub_Command + 1, ": Reply truncated")
+            break
+        Command_Code = _value_[Record_Index]
+        Reply_Status = _value_[Record_Index + 1]
+        Reply_Len = _value_[Record_Index + 2]
+        Reply_Data = _value_[Record_Index + 3 : Record_Index + 3 + Reply_Len]
+        if(Reply_Status == BL_ACK_VALUE):
+            print("   Sub-command", hex(Command_Code), ": ACK, Reply :", ' '.join(hex(Data) for Data in Reply_Data))
+        else:
+            print("   Sub-command", hex(Command_Code), ": NACK")
+        Record_Index = Record_Index + 3 + Reply_Len
+
+def Process_CBL_GET_STATS_CMD(Data_Len):
+    Serial_Data = Read_Serial_Port(Data_Len)
+    if(len(Serial_Data) < struct.calcsize(BL_STATS_HEADER_FORMAT)):
+        print("\n   Statistics record truncated (", len(Serial_Data), "bytes )")
+    else:
+        Stats = Parse_BL_Stats_Record(bytes(Serial_Data))
+        Print_BL_Stats(Stats)
+        Store_BL_Fleet_Stats(Stats, BL_FLEET_STATS_FILE)
+        print("\n   Saved to", BL_FLEET_STATS_FILE)
+
+def Parse_BL_Stats_Record(Record):
+    ''' Returns the statistics as a dictionary, the 96 bit device ID as a hex string '''
+    Header_Size = struct.calcsize(BL_STATS_HEADER_FORMAT)
+    Stats = dict(zip(BL_STATS_HEADER_FIELDS, struct.unpack_from(BL_STATS_HEADER_FORMAT, Record)))
+    Stats["Unique_ID"] = "{:08x}{:08x}{:08x}".format(Stats.pop("UID_Word_2"), Stats.pop("UID_Word_1"), Stats.pop("UID_Word_0"))
+    Page_Count = min(Stats["Page_Count"], (len(Record) - Header_Size) // 2)
+    Stats["Page_Erase_Count"] = list(struct.unpack_from('<{}H'.format(Page_Count), Record, Header_Size))
+    Geometry_Offset = Header_Size + 2 * Page_Count
+    if(Stats["Version"] >= 2 and len(Record) >= Geometry_Offset + struct.calcsize(BL_STATS_GEOMETRY_FORMAT)):
+        Stats.update(zip(BL_STATS_GEOMETRY_FIELDS, struct.unpack_from(BL_STATS_GEOMETRY_FORMAT, Record, Geometry_Offset)))
+    else:
+        ''' Version 1 records come from the STM32F103C8: 64 KB, one 1 KB page per entry '''
+        Stats.update(zip(BL_STATS_GEOMETRY_FIELDS, (64 * 1024, 1024, 1)))
+    return Stats
+
+def Cycles_To_Seconds(Stats, Cycles):
+    return Cycles / Stats["Core_Clock_Hz"] if Stats["Core_Clock_Hz"] else 0.0
+
+def Print_BL_Stats(Stats):
+    Frames = max(Stats["Frames_Received"], 1)
+    print("\n   Device ID          : ", Stats["Unique_ID"])
+    print("   Boots              : ", Stats["Boot_Count"])
+    print("   Frames received    : ", Stats["Frames_Received"])
+    print("   CRC failures       : ", Stats["CRC_Failures"], "({:.2f} %)".format(100.0 * Stats["CRC_Failures"] / Frames))
+    print("   NACKs sent         : ", Stats["NACKs_Sent"], "({:.2f} %)".format(100.0 * Stats["NACKs_Sent"] / Frames))
+    print("   Flash errors       : ", Stats["Flash_Errors"])
+    print("   Bytes programmed   : ", Stats["Bytes_Programmed"])
+    print("   Receive time       :  {:.3f} s".format(Cycles_To_Seconds(Stats, Stats["Receive_Cycles"])))
+    print("   Program time       :  {:.3f} s".format(Cycles_To_Seconds(Stats, Stats["Program_Cycles"])))
+    print("   Erase time         :  {:.3f} s".format(Cycles_To_Seconds(Stats, Stats["Erase_Cycles"])))
+    print("   Metadata erases    : ", Stats["Meta_Generation"])
+    print("   Flash              :  {} KB in {} byte pages".format(Stats["Flash_Size"] // 1024, Stats["Flash_Page_Size"]))
+    print("   Page erases        : ", end = ' ')
+    for Entry, Erase_Count in enumerate(Stats["Page_Erase_Count"]):
+        if(Erase_Count):
+            print("{}:{}".format(Page_Entry_Name(Stats, Entry), Erase_Count), end = ' ')
+    print("\n   Most worn page     :  {:.1f} % of the rated {} cycles".format(
+          100.0 * max(Stats["Page_Erase_Count"] + [0]) / BL_FLASH_ENDURANCE_CYCLES, BL_FLASH_ENDURANCE_CYCLES))
+
+def Page_Entry_Name(Stats, Entry):
+    ''' Pages counted by an erase count entry, one page on the parts with up to 64 pages '''
+    Pages_Per_Entry = Stats.get("Pages_Per_Entry", 1)
+    if(Pages_Per_Entry == 1):
+        return str(Entry)
+    return "{}-{}".format(Entry * Pages_Per_Entry, (Entry + 1) * Pages_Per_Entry - 1)
+
+def Process_CBL_ALLOCATE_PAGES_CMD(Data_Len):
+    Serial_Data = Read_Serial_Port(Data_Len)
+    _value_ = bytearray(Serial_Data)
+    if(len(_value_) == 6):
+        ''' Extended frame: two byte page numbers '''
+        First_Page, Number_Of_Pages, Erase_Count = struct.unpack('<3H', _value_)
+        No_Pages = CBL_ALLOCATE_NO_PAGES_EXTENDED
+    else:
+        First_Page, Number_Of_Pages, Erase_Count = _value_[0], _value_[1], _value_[2] | (_value_[3] << 8)
+        No_Pages = CBL_ALLOCATE_NO_PAGES
+    if(First_Page == No_Pages):
+        print("\n   No window of", Number_Of_Pages, "pages in the requested range")
+    else:
+        print("\n   Least worn window : pages", First_Page, "to", First_Page + Number_Of_Pages - 1,
+              "({:#010x}), highest erase count {}".format(0x08000000 + First_Page * BL_Flash_Page_Size, Erase_Count))
+
+def Process_CBL_LOAD_AND_EXEC_CMD(Data_Len):
+    Serial_Data = Read_Serial_Port(Data_Len)
+    _value_ = bytearray(Serial_Data)
+    if(_value_[0] != STUB_OPERATION_PASSED):
+        print("\n   Stub Status -> Refused (window bounds, stub CRC or read protected flash)")
+    elif(len(_value_) == 1):
+        print("\n   Stub Status -> Chunk Loaded")
+    else:
+        print("\n   Stub Status -> Returned {:#010x}".format(struct.unpack_from('<I', _value_, 1)[0]))
+
+def Process_CBL_FLASH_IMAGE_CMD(Data_Len):
+    global Image_Status
+    global Image_Next_Offset
+    Serial_Data = bytes(Read_Serial_Port(Data_Len))
+    Image_Status, Image_Next_Offset = struct.unpack_from('<BI', Serial_Data)
+    print("\n   Image Status -> {}, next offset {}".format(IMAGE_STATUS_NAMES.get(Image_Status, hex(Image_Status)), Image_Next_Offset))
+    if(len(Serial_Data) > 5):
+        ''' RESUME: one bit per page of the image the bootloader has stored as written '''
+        print("   Pages already written :", sum(bin(Bitmap_Byte).count('1') for Bitmap_Byte in Serial_Data[5:]))
+
+def Process_CBL_GET_CAPABILITIES_CMD(Data_Len):
+    global BL_Capabilities
+    Serial_Data = bytes(Read_Serial_Port(Data_Len))
+    BL_Capabilities = Parse_BL_Capabilities(Serial_Data)
+    Print_BL_Capabilities(BL_Capabilities)
+    Negotiate_BL_Mode(BL_Capabilities)
+
+def Parse_BL_Capabilities(Record):
+    ''' {type: tuple of values}, a record cut short ends the list '''
+    Capabilities = {}
+    Record_Index = 0
+    while(Record_Index + 2 <= len(Record)):
+        Cap_Type, Cap_Len = Record[Record_Index], Record[Record_Index + 1]
+        Value = Record[Record_Index + 2 : Record_Index + 2 + Cap_Len]
+        if(len(Value) < Cap_Len):
+            break
+        if(Cap_Type == BL_CAP_BAUD_RATES):
+            Capabilities[Cap_Type] = struct.unpack('<{}I'.format(Cap_Len // 4), Value[: Cap_Len & ~3])
+        elif(Cap_Type in BL_CAP_FORMATS and Cap_Len >= struct.calcsize(BL_CAP_FORMATS[Cap_Type])):
+            Capabilities[Cap_Type] = struct.unpack_from(BL_CAP_FORMATS[Cap_Type], Value)
+        Record_Index = Record_Index + 2 + Cap_Len
+    return Capabilities
+
+def Print_BL_Capabilities(Capabilities):
+    if(BL_CAP_PROTOCOL in Capabilities):
+        Protocol = Capabilities[BL_CAP_PROTOCOL]
+        print("\n   Protocol version   : ", Protocol[0], "(vendor", Protocol[1], "bootloader {}.{}.{})".format(*Protocol[2:]))
+    if(BL_CAP_MAX_FRAME in Capabilities):
+        print("   Longest frame      :  {} bytes request, {} bytes reply".format(*Capabilities[BL_CAP_MAX_FRAME]))
+    if(BL_CAP_WINDOW in Capabilities):
+        print("   Window             :  {} request(s) in flight, {} bytes batch reply".format(*Capabilities[BL_CAP_WINDOW]))
+    if(BL_CAP_BAUD_RATES in Capabilities):
+        print("   Baud rates         : ", ', '.join(str(Baud_Rate) for Baud_Rate in Capabilities[BL_CAP_BAUD_RATES]))
+    if(BL_CAP_CODECS in Capabilities):
+        print("   Codecs             : ", ', '.join(Name for Bit, Name in BL_CAP_CODEC_NAMES.items() if Capabilities[BL_CAP_CODECS][0] & Bit) or "none")
+    if(BL_CAP_FRAMINGS in Capabilities):
+        print("   Framings           : ", ', '.join(Name for Bit, Name in BL_CAP_FRAMING_NAMES.items() if Capabilities[BL_CAP_FRAMINGS][0] & Bit))
+    if(BL_CAP_FLASH_GEOMETRY in Capabilities):
+        Device_ID, Page_Size, Page_Count, Flash_Size = Capabilities[BL_CAP_FLASH_GEOMETRY]
+        print("   Flash              :  DEV_ID {:#05x}, {} KB in {} pages of {} bytes".format(Device_ID, Flash_Size // 1024, Page_Count, Page_Size))
+    if(BL_CAP_SLOTS in Capabilities):
+        Slots = Capabilities[BL_CAP_SLOTS]
+        for Slot_Index, Slot_Name in enumerate(("Application", "Metadata", "Stub window")):
+            print("   {:<19}:  {:#010x}, {} bytes".format(Slot_Name, Slots[2 * Slot_Index], Slots[2 * Slot_Index + 1]))
+
+def Negotiate_BL_Mode(Capabilities):
+    ''' The fastest mode both sides have: the longest frames, the skip records, the highest common baud rate.
+        A bootloader without the command keeps the defaults this host always used '''
+    global Frame_Max_Length
+    global Mem_Write_Payload_Max
+    global Erased_Skip
+    global Image_Digest
+    global Reliable_Replies
+    global COBS_Framing
+    global BL_Flash_Page_Size
+    global BL_Target_App_Base
+    if(not Capabilities):
+        Frame_Max_Length = HOST_MAX_FRAME
+        Mem_Write_Payload_Max = CBL_MEM_WRITE_DEFAULT_PAYLOAD
+        Erased_Skip = 1
+        Image_Digest = 0
+        print("\n   No capability record, the defaults stay")
+        return
+    Frame_Max_Length = min(HOST_MAX_FRAME, Capabilities.get(BL_CAP_MAX_FRAME, (HOST_MAX_FRAME,))[0])
+    Mem_Write_Payload_Max = Frame_Payload_Max(CBL_MEM_WRITE_OVERHEAD)
+    Erased_Skip = 1 if Capabilities.get(BL_CAP_CODECS, (0,))[0] & HOST_CAP_CODECS & BL_CAP_CODEC_ERASED_SKIP else 0
+    Image_Digest = 1 if Capabilities.get(BL_CAP_CODECS, (0,))[0] & HOST_CAP_CODECS & BL_CAP_CODEC_IMAGE_SHA256 else 0
+    Framings = Capabilities.get(BL_CAP_FRAMINGS, (BL_CAP_FRAMING_LENGTH,))[0]
+    if(Reliable_Replies and not Framings & BL_CAP_FRAMING_RELIABLE):
+        Reliable_Replies = 0
+    if(COBS_Framing and not Framings & BL_CAP_FRAMING_COBS):
+        COBS_Framing = 0
+    if(BL_CAP_FLASH_GEOMETRY in Capabilities):
+        BL_Flash_Page_Size = Capabilities[BL_CAP_FLASH_GEOMETRY][1]
+    if(BL_CAP_SLOTS in Capabilities):
+        BL_Target_App_Base = Capabilities[BL_CAP_SLOTS][0]
+    Common_Baud_Rates = set(HOST_BAUD_RATES) & set(Capabilities.get(BL_CAP_BAUD_RATES, ()))
+    print("\n   Negotiated mode    :  {} byte frames, {} byte writes, skip records {}, image SHA-256 {}, reliable replies {}, COBS framing {}".format(
+          Frame_Max_Length, Mem_Write_Payload_Max, "ON" if Erased_Skip else "OFF", "ON" if Image_Digest else "OFF",
+          "ON" if Reliable_Replies else "OFF", "ON" if COBS_Framing else "OFF"))
+    if(Common_Baud_Rates):
+        ''' The bootloader lists the rates of its build, the port has to be opened at one of them '''
+        print("   Fastest baud rate  : ", max(Common_Baud_Rates))
+
+def Frame_Payload_Max(Frame_Overhead):
+    ''' Largest half-word aligned payload of a frame, inside the reliable envelope when it is on '''
+    Frame_Length = Frame_Max_Length - (CBL_RELIABLE_REQUEST_OVERHEAD if Reliable_Replies else 0)
+    return (Frame_Length - Frame_Overhead) & ~1
+
+def Query_BL_Capabilities():
+    ''' Once per session, the bootloader NACKs the command when it is older than it '''
+    global BL_Capabilities
+    BL_Capabilities = {}
+    Send_CBL_Command(Build_CBL_Command(CBL_GET_CAPABILITIES_CMD, []))
+    Read_Data_From_Serial_Port(CBL_GET_CAPABILITIES_CMD, False)
+    if(not BL_Capabilities):
+        Negotiate_BL_Mode(BL_Capabilities)
+
+def Load_BL_Fleet_Stats(File_Names):
+    ''' Merges the fleet files collected on several stations, the newest record (most boots) of a board wins '''
+    Fleet = {}
+    for File_Name in File_Names:
+        try:
+            with open(File_Name, 'r') as Fleet_File:
+                for Unique_ID, Stats in json.load(Fleet_File).items():
+                    if(Unique_ID not in Fleet or Stats["Boot_Count"] >= Fleet[Unique_ID]["Boot_Count"]):
+                        Fleet[Unique_ID] = Stats
+        except (OSError, ValueError) as Error:
+            print("   Skipped", File_Name, ":", Error)
+    return Fleet
+
+def Store_BL_Fleet_Stats(Stats, File_Name):
+    Fleet = Load_BL_Fleet_Stats([File_Name]) if os.path.exists(File_Name) else {}
+    Fleet[Stats["Unique_ID"]] = Stats
+    with open(File_Name, 'w') as Fleet_File:
+        json.dump(Fleet, Fleet_File, indent = 1, sort_keys = True)
+
+def Report_BL_Fleet_Stats(Fleet):
+    ''' Totals and rates over the boards, then the boards most likely behind slow updates '''
+    if(not Fleet):
+        print("\n   No statistics records")
+        return
+    Totals = {}
+    for Field in ("Boot_Count", "Frames_Received", "CRC_Failures", "NACKs_Sent", "Flash_Errors", "Bytes_Programmed"):
+        Totals[Field] = sum(Stats[Field] for Stats in Fleet.values())
+    Receive_Time = sum(Cycles_To_Seconds(Stats, Stats["Receive_Cycles"]) for Stats in Fleet.values())
+    Program_Time = sum(Cycles_To_Seconds(Stats, Stats["Program_Cycles"]) for Stats in Fleet.values())
+    Erase_Time = sum(Cycles_To_Seconds(Stats, Stats["Erase_Cycles"]) for Stats in Fleet.values())
+    Frames = max(Totals["Frames_Received"], 1)
+    print("\n   Boards             : ", len(Fleet))
+    print("   Boots              : ", Totals["Boot_Count"])
+    print("   Frames received    : ", Totals["Frames_Received"])
+    print("   CRC failures       : ", Totals["CRC_Failures"], "({:.2f} %)".format(100.0 * Totals["CRC_Failures"] / Frames))
+    print("   NACKs sent         : ", Totals["NACKs_Sent"], "({:.2f} %)".format(100.0 * Totals["NACKs_Sent"] / Frames))
+    print("   Flash errors       : ", Totals["Flash_Errors"], "on", sum(1 for Stats in Fleet.values() if Stats["Flash_Errors"]), "boards")
+    print("   Bytes programmed   : ", Totals["Bytes_Programmed"])
+    print("   Time split         :  receive {:.1f} s, program {:.1f} s, erase {:.1f} s".format(Receive_Time, Program_Time, Erase_Time))
+    if(Program_Time > 0):
+        print("   Program throughput :  {:.0f} bytes/s".format(Totals["Bytes_Programmed"] / Program_Time))
+    print("\n   Highest CRC failure rates :")
+    for Unique_ID, Stats in sorted(Fleet.items(), key = lambda Item: Item[1]["CRC_Failures"] / max(Item[1]["Frames_Received"], 1),
+                                   reverse = True)[:BL_FLEET_REPORT_TOP]:
+        print("      {}  {:6.2f} %  {} NACKs  {} flash errors".format(Unique_ID, 100.0 * Stats["CRC_Failures"] / max(Stats["Frames_Received"], 1),
+                                                                     Stats["NACKs_Sent"], Stats["Flash_Errors"]))
+    print("\n   Most erased pages :")
+    Page_Erases = [(Erase_Count, Page_Entry_Name(Stats, Entry), Unique_ID) for Unique_ID, Stats in Fleet.items()
+                   for Entry, Erase_Count in enumerate(Stats["Page_Erase_Count"])]
+    for Erase_Count, Page_Name, Unique_ID in sorted(Page_Erases, reverse = True)[:BL_FLEET_REPORT_TOP]:
+        print("      {}  page {:>3}  {} erases ({:.1f} % of rated)".format(Unique_ID, Page_Name, Erase_Count,
+                                                                     100.0 * Erase_Count / BL_FLASH_ENDURANCE_CYCLES))
+
+def Parse_BL_Log_Stream(Log_Stream):
+    ''' Splits the raw debug UART bytes into (sequence, text) records, returns them with the unparsed tail '''
+    Log_Records = []
+    Stream_Index = 0
+    while(Stream_Index + BL_LOG_HEADER_SIZE <= len(Log_Stream)):
+        if(Log_Stream[Stream_Index] != BL_LOG_SYNC_BYTE):
+            Stream_Index = Stream_Index + 1
+            continue
+        Sequence = Log_Stream[Stream_Index + 1]
+        Log_Id = Log_Stream[Stream_Index + 2]
+        Payload_Len = Log_Stream[Stream_Index + 3]
+        if((Log_Id != BL_LOG_ID_TEXT) and ((Log_Id not in BL_LOG_DICTIONARY) or (Payload_Len % 4))):
+            ''' Not a record header, resynchronize on the next sync byte '''
+            Stream_Index = Stream_Index + 1
+            continue
+        if(Stream_Index + BL_LOG_HEADER_SIZE + Payload_Len > len(Log_Stream)):
+            break
+        Payload = Log_Stream[Stream_Index + BL_LOG_HEADER_SIZE : Stream_Index + BL_LOG_HEADER_SIZE + Payload_Len]
+        if(Log_Id == BL_LOG_ID_TEXT):
+            Log_Text = bytes(Payload).decode('ascii', 'replace').rstrip()
+        else:
+            Log_Args = struct.unpack('<' + 'I' * (Payload_Len // 4), bytes(Payload))
+            try:
+                Log_Text = BL_LOG_DICTIONARY[Log_Id].format(*Log_Args)
+            except (IndexError, ValueError):
+                Log_Text = BL_LOG_DICTIONARY[Log_Id] + " " + str(Log_Args)
+        Log_Records.append((Sequence, Log_Text))
+        Stream_Index = Stream_Index + BL_LOG_HEADER_SIZE + Payload_Len
+    return Log_Records, Log_Stream[Stream_Index:]
+
+def Monitor_BL_Log(Log_Port_Name):
+    Log_Port_Obj = serial.Serial(Log_Port_Name, 115200, timeout = 0.1)
+    Log_Stream = bytearray()
+    Expected_Sequence = None
+    print("   Decoding the bootloader log, press Ctrl+C to stop")
+    try:
+        while True:
+            Log_Stream = Log_Stream + bytearray(Log_Port_Obj.read(256))
+            Log_Records, Log_Stream = Parse_BL_Log_Stream(Log_Stream)
+            for Sequence, Log_Text in Log_Records:
+                if((Expected_Sequence is not None) and (Sequence != Expected_Sequence)):
+                    print("   [log] ... sequence gap, records lost on the link")
+                print("   [log {:3d}] {}".format(Sequence, Log_Text))
+                Expected_Sequence = (Sequence + 1) & 0xFF
+    except KeyboardInterrupt:
+        pass
+    Log_Port_Obj.close()
+
+def Build_CBL_Command(Command_Code, Details):
+    ''' Returns a complete host command: length, command code, details and CRC32 '''
+    CBL_Command = [0, Command_Code] + list(Details)
+    CBL_Command[0] = len(CBL_Command) + 4 - 1
+    CRC32_Value = Calculate_CRC32(CBL_Command, len(CBL_Command)) & 0xFFFFFFFF
+    for Byte_Index in range(1, 5):
+        CBL_Command.append(Word_Value_To_Byte_Value(CRC32_Value, Byte_Index, 1))
+    return CBL_Command
+
+def Send_CBL_Command(CBL_Command):
+    Write_Data_To_Serial_Port(CBL_Command[0], 1)
+    for Data in CBL_Command[1:]:
+        Write_Data_To_Serial_Port(Data, len(CBL_Command) - 1)
+
+def CRC32_Byte_Step(Value):
+    for DataElemBitLen in range(8):
+        if(Value & 0x80000000):
+            Value = (Value << 1) ^ 0x04C11DB7
+        else:
+            Value = (Value << 1)
+    return Value & 0xFFFFFFFF
+
+''' The 32 shifts of every byte (fed to the CRC unit as one word) done as four table steps of 8 bits '''
+CRC32_TABLE = [CRC32_Byte_Step(Index << 24) for Index in range(256)]
+
 def Calculate_CRC32(Buffer, Buffer_Length):
     CRC_Value = 0xFFFFFFFF
     for DataElem in Buffer[0:Buffer_Length]:
         CRC_Value = CRC_Value ^ DataElem
-        for DataElemBitLen in range(32):
-            if(CRC_Value & 0x80000000):
-                CRC_Value = (CRC_Value << 1) ^ 0x04C11DB7
-            else:
-                CRC_Value = (CRC_Value << 1)
+        for Step in range(4):
+            CRC_Value = ((CRC_Value << 8) & 0xFFFFFFFF) ^ CRC32_TABLE[CRC_Value >> 24]
     return CRC_Value
     
 def Word_Value_To_Byte_Value(Word_Value, Byte_Index, Byte_Lower_First):
     Byte_Value = (Word_Value >> (8 * (Byte_Index - 1)) & 0x000000FF)
     return Byte_Value
 
+def Find_Erased_Runs(Data, Min_Run = CBL_MEM_WRITE_SKIP_MIN_RUN):
+    ''' (start, end) offsets of the runs of 0xFF of Min_Run bytes or more, half-word aligned so the packets around them
+        start aligned; a run at the end of the data ends with it '''
+    Erased_Runs = []
+    for Run in re.finditer(b'\xff{%d,}' % Min_Run, Data):
+        Run_Start = Run.start() + (Run.start() & 1)
+        Run_End = Run.end() if Run.end() == len(Data) else Run.end() & ~1
+        if(Run_End - Run_Start >= Min_Run):
+            Erased_Runs.append((Run_Start, Run_End))
+    return Erased_Runs
+
 def CalulateBinFileLength():
     BinFileLength = os.path.getsize("Application.bin")
     return BinFileLength
@@ -296,8 +1038,7 @@ def Decode_CBL_Command(Command):
     elif (Command == 5):
         print("Jump bootloader to specified address command")
         CBL_GO_TO_ADDR_CMD_Len = 10
-        CBL_Jump_Address = input("\n   Please Enter the Address in Hex : ")
-        CBL_Jump_Address = int(CBL_Jump_Address, 16)
+        CBL_Jump_Address = Input_Address("\n   Please Enter the Address in Hex ")
         BL_Host_Buffer[0] = CBL_GO_TO_ADDR_CMD_Len - 1
         BL_Host_Buffer[1] = CBL_GO_TO_ADDR_CMD
         BL_Host_Buffer[2] = Word_Value_To_Byte_Value(CBL_Jump_Address, 1, 1) 
@@ -315,38 +1056,33 @@ def Decode_CBL_Command(Command):
             Write_Data_To_Serial_Port(Data, CBL_GO_TO_ADDR_CMD_Len - 1)
         Read_Data_From_Serial_Port(CBL_GO_TO_ADDR_CMD)
     elif (Command == 6):
-        print("Mass erase or sector erase of the user flash command")
-        CBL_FLASH_ERASE_CMD_Len = 8
-        SectorNumber = 0
-        NumberOfSectors = 0
-        BL_Host_Buffer[0] = CBL_FLASH_ERASE_CMD_Len - 1
-        BL_Host_Buffer[1] = CBL_FLASH_ERASE_CMD
-        SectorNumber = input("\n   Please enter start sector number(0-11)          : ")
-        SectorNumber = int(SectorNumber, 16)
-        if(SectorNumber != 0xFF):
-            NumberOfSectors = int(input("\n   Please enter number of sectors to erase (12 Max): "), 16)
-        BL_Host_Buffer[2] = SectorNumber
-        BL_Host_Buffer[3] = NumberOfSectors
-        CRC32_Value = Calculate_CRC32(BL_Host_Buffer, CBL_FLASH_ERASE_CMD_Len - 4) 
-        CRC32_Value = CRC32_Value & 0xFFFFFFFF
-        BL_Host_Buffer[4] = Word_Value_To_Byte_Value(CRC32_Value, 1, 1)
-        BL_Host_Buffer[5] = Word_Value_To_Byte_Value(CRC32_Value, 2, 1)
-        BL_Host_Buffer[6] = Word_Value_To_Byte_Value(CRC32_Value, 3, 1)
-        BL_Host_Buffer[7] = Word_Value_To_Byte_Value(CRC32_Value, 4, 1)
-        Write_Data_To_Serial_Port(BL_Host_Buffer[0], 1)
-        for Data in BL_Host_Buffer[1 : CBL_FLASH_ERASE_CMD_Len]:
-            Write_Data_To_Serial_Port(Data, CBL_FLASH_ERASE_CMD_Len - 1)
+        print("Mass erase or page erase of the user flash command")
+        PageNumber = int(input("\n   Please enter start page number in hex (FF: mass erase of the application) : "), 16)
+        NumberOfPages = 0
+        if(PageNumber in (CBL_FLASH_MASS_ERASE, CBL_FLASH_MASS_ERASE_EXTENDED)):
+            Send_CBL_Command(Build_CBL_Command(CBL_FLASH_ERASE_CMD, [CBL_FLASH_MASS_ERASE, 0]))
+        else:
+            NumberOfPages = int(input("\n   Please enter number of pages to erase in hex : "), 16)
+            if(PageNumber > CBL_FLASH_MAX_SHORT_PAGE or NumberOfPages > 0xFF):
+                ''' Parts with more than 255 pages: two byte page numbers '''
+                Send_CBL_Command(Build_CBL_Command(CBL_FLASH_ERASE_CMD, list(struct.pack('<HH', PageNumber, NumberOfPages))))
+            else:
+                Send_CBL_Command(Build_CBL_Command(CBL_FLASH_ERASE_CMD, [PageNumber, NumberOfPages]))
         Read_Data_From_Serial_Port(CBL_FLASH_ERASE_CMD)
     elif (Command == 7):
         print("Write data into different memories of the MCU command")
+        print("   Flash pages are erased by the bootloader at their first write, unless blank, and again when written over: no erase command needed")
         global Memory_Write_Is_Active
         global Memory_Write_All
+        global Memory_Write_Posted
         File_Total_Len = 0
         BinFileRemainingBytes = 0
         BinFileSentBytes = 0
         BaseMemoryAddress = 0
         BinFileReadLength = 0
+        Last_Write_Address = 0
         Memory_Write_All = 1
+        Memory_Write_Posted = 0
         
         ''' Get the total length of the binary file '''
         File_Total_Len = CalulateBinFileLength()
@@ -356,18 +1092,37 @@ def Decode_CBL_Command(Command):
         ''' Calculate the remaining payload '''
         BinFileRemainingBytes = File_Total_Len - BinFileSentBytes
         ''' Get the start address to write the payload '''
-        BaseMemoryAddress = input("\n   Enter the start address : ")
-        BaseMemoryAddress = int(BaseMemoryAddress, 16)
+        BaseMemoryAddress = Input_Address("\n   Enter the start address ")
+        ''' Runs of 0xFF are not sent to the flash: a skip record has the bootloader prepare their pages. The SRAM gets every byte '''
+        Erased_Runs = []
+        if(Erased_Skip and CBL_FLASH_BASE <= BaseMemoryAddress < CBL_FLASH_BASE + CBL_FLASH_MAX_SIZE):
+            Erased_Runs = Find_Erased_Runs(BinFile.read())
+            BinFile.seek(0)
         ''' Keep sending the write packet till the last payload byte '''
         while(BinFileRemainingBytes):
             ''' Memory write is active '''
             Memory_Write_Is_Active = 1
             
-            ''' Read 128 bytes from the binary file each time '''
-            if(BinFileRemainingBytes >= 128):
-                BinFileReadLength = 128
+            if(Erased_Runs and Erased_Runs[0][0] == BinFileSentBytes):
+                Skip_Length = Erased_Runs[0][1] - Erased_Runs[0][0]
+                Erased_Runs.pop(0)
+                Send_CBL_Command(Build_CBL_Command(CBL_MEM_WRITE_CMD, list(struct.pack('<IBI', BaseMemoryAddress, 0, Skip_Length))))
+                BinFile.seek(Skip_Length, 1)
+                BaseMemoryAddress = BaseMemoryAddress + Skip_Length
+                BinFileSentBytes = BinFileSentBytes + Skip_Length
+                BinFileRemainingBytes = File_Total_Len - BinFileSentBytes
+                print("\n   Bytes skipped (0xFF) :{0}".format(Skip_Length))
+                BL_Return_Value = Read_Data_From_Serial_Port(CBL_MEM_WRITE_CMD)
+                sleep(0.1)
+                continue
+            
+            ''' Read the negotiated payload (128 bytes by default) each time, a packet stops where a run of 0xFF starts '''
+            if(BinFileRemainingBytes >= Mem_Write_Payload_Max):
+                BinFileReadLength = Mem_Write_Payload_Max
             else:
                 BinFileReadLength = BinFileRemainingBytes
+            if(Erased_Runs):
+                BinFileReadLength = min(BinFileReadLength, Erased_Runs[0][0] - BinFileSentBytes)
             
             for BinFileByte in range(BinFileReadLength):
                 BinFileByteValue = BinFile.read(1)
@@ -399,6 +1154,7 @@ def Decode_CBL_Command(Command):
             BL_Host_Buffer[10+ BinFileReadLength] = Word_Value_To_Byte_Value(CRC32_Value, 4, 1)
             
             ''' Calculate the next Base memory address '''
+            Last_Write_Address = BaseMemoryAddress
             BaseMemoryAddress = BaseMemoryAddress + BinFileReadLength
             
             ''' Send the packet length to the bootloader '''
@@ -418,10 +1174,29 @@ def Decode_CBL_Command(Command):
             ''' Read the response from the bootloader '''
             BL_Return_Value = Read_Data_From_Serial_Port(CBL_MEM_WRITE_CMD)
             sleep(0.1)
+        if(Memory_Write_Posted):
+            ''' An empty write waits for the last posted packet and reports how it ended '''
+            Memory_Write_Posted = 0
+            Last_Address = Last_Write_Address
+            Send_CBL_Command(Build_CBL_Command(CBL_MEM_WRITE_CMD, list(struct.pack('<IB', Last_Address, 0))))
+            Read_Data_From_Serial_Port(CBL_MEM_WRITE_CMD)
         ''' Memory write is inactive '''
         Memory_Write_Is_Active = 0
         if(Memory_Write_All == 1):
             print("\n\n Payload Written Successfully")
+    elif (Command == 9):
+        print("Read data from different memories of the MCU command")
+        Read_Address = Input_Address("\n   Enter the start address ")
+        Read_Length = int(input("\n   Enter the number of bytes to read (1-255) : "))
+        if(Read_Length < 1 or Read_Length > 255):
+            print("\n   Error !! The bootloader reads 1 to 255 bytes per command")
+        else:
+            Send_CBL_Command(Build_CBL_Command(CBL_MEM_READ_CMD, [Word_Value_To_Byte_Value(Read_Address, 1, 1),
+                                                                  Word_Value_To_Byte_Value(Read_Address, 2, 1),
+                                                                  Word_Value_To_Byte_Value(Read_Address, 3, 1),
+                                                                  Word_Value_To_Byte_Value(Read_Address, 4, 1),
+                                                                  Read_Length]))
+            Read_Data_From_Serial_Port(CBL_MEM_READ_CMD)
     elif (Command == 12):
         print("Change read protection level of the user flash command")
         Protection_level = input("\n   Please Enter one of these Protection levels : 0,1,2 : ")
@@ -446,6 +1221,117 @@ def Decode_CBL_Command(Command):
             Read_Data_From_Serial_Port(CBL_CHANGE_ROP_Level_CMD)
         else:
             print("\n   Protection level (", Protection_level, ") not supported !!")
+    elif (Command == 13):
+        print("Read the device information in one batch command")
+        Batch_Flags = BL_BATCH_STOP_ON_FAILURE
+        Continue_On_Failure = input("\n   Continue after a failed sub-command (y/n) : ")
+        if(Continue_On_Failure == 'y'):
+            Batch_Flags = BL_BATCH_CONTINUE_ON_FAILURE
+        Sub_Commands = [Build_CBL_Command(CBL_GET_VER_CMD, []),
+                        Build_CBL_Command(CBL_GET_CID_CMD, []),
+                        Build_CBL_Command(CBL_GET_RDP_STATUS_CMD, [])]
+        Batch_Details = [Batch_Flags, len(Sub_Commands)]
+        for Sub_Command in Sub_Commands:
+            Batch_Details = Batch_Details + Sub_Command
+        Send_CBL_Command(Build_CBL_Command(CBL_BATCH_CMD, Batch_Details))
+        Read_Data_From_Serial_Port(CBL_BATCH_CMD)
+    elif (Command == 14):
+        print("Decode the bootloader debug log (USART3)")
+        Log_Port_Name = input("\n   Enter the Port Name of the debug UART (Ex: COM4) : ")
+        Monitor_BL_Log(Log_Port_Name)
+    elif (Command == 15):
+        print("Read the bootloader statistics")
+        Send_CBL_Command(Build_CBL_Command(CBL_GET_STATS_CMD, []))
+        Read_Data_From_Serial_Port(CBL_GET_STATS_CMD)
+    elif (Command == 16):
+        print("Aggregate the statistics of a fleet")
+        File_Names = input("\n   Enter the fleet files, comma separated [" + BL_FLEET_STATS_FILE + "] : ").strip()
+        if(not File_Names):
+            File_Names = BL_FLEET_STATS_FILE
+        Report_BL_Fleet_Stats(Load_BL_Fleet_Stats([File_Name.strip() for File_Name in File_Names.split(',')]))
+    elif (Command == 17):
+        print("Allocate the least worn flash pages for staging or scratch data")
+        Number_Of_Pages = int(input("\n   Enter the number of pages : "))
+        First_Page = int(input("\n   Enter the first page the window may use (after the application image) : "))
+        End_Page = int(input("\n   Enter the page after the last one the window may use [64] : ") or "64")
+        if(max(Number_Of_Pages, First_Page, End_Page) > CBL_FLASH_MAX_SHORT_PAGE):
+            Send_CBL_Command(Build_CBL_Command(CBL_ALLOCATE_PAGES_CMD, list(struct.pack('<3H', Number_Of_Pages, First_Page, End_Page))))
+        else:
+            Send_CBL_Command(Build_CBL_Command(CBL_ALLOCATE_PAGES_CMD, [Number_Of_Pages, First_Page, End_Page]))
+        Read_Data_From_Serial_Port(CBL_ALLOCATE_PAGES_CMD)
+    elif (Command == 18):
+        print("Load a position independent stub into the SRAM window and execute it")
+        Stub_File_Name = input("\n   Enter the stub binary [Stub.bin] : ").strip() or "Stub.bin"
+        Entry_Offset = int(input("\n   Enter the entry offset in the stub [0x0] : ").strip() or "0", 16)
+        Stub_Args = [int(input("\n   Enter Arg{} [0x0] : ".format(Arg_Index)).strip() or "0", 16) for Arg_Index in range(3)]
+        with open(Stub_File_Name, 'rb') as Stub_File:
+            Stub = Stub_File.read()
+        for Stub_Offset in range(0, len(Stub), CBL_STUB_MAX_CHUNK):
+            Stub_Chunk = Stub[Stub_Offset : Stub_Offset + CBL_STUB_MAX_CHUNK]
+            Send_CBL_Command(Build_CBL_Command(CBL_LOAD_AND_EXEC_CMD, list(struct.pack('<BHB', CBL_STUB_LOAD, Stub_Offset, len(Stub_Chunk)) + Stub_Chunk)))
+            Read_Data_From_Serial_Port(CBL_LOAD_AND_EXEC_CMD)
+        ''' The bootloader checks the whole window against this CRC before it calls the stub '''
+        Stub_CRC32 = Calculate_CRC32(Stub, len(Stub)) & 0xFFFFFFFF
+        Send_CBL_Command(Build_CBL_Command(CBL_LOAD_AND_EXEC_CMD, list(struct.pack('<BHHI3I', CBL_STUB_EXEC, Entry_Offset, len(Stub), Stub_CRC32, *Stub_Args))))
+        Read_Data_From_Serial_Port(CBL_LOAD_AND_EXEC_CMD)
+    elif (Command == 19):
+        print("Flash the application image as one transaction: manifest, data frames, commit")
+        global Image_Status
+        global Image_Next_Offset
+        Image_Status = 0
+        Image_Next_Offset = 0
+        if(BL_Capabilities is None):
+            Query_BL_Capabilities()
+        with open('Application.bin', 'rb') as Image_File:
+            Image = Image_File.read()
+        Load_Address = Input_Address("\n   Enter the load address ")
+        Image_Version = int(input("\n   Enter the image version [0] : ").strip() or "0")
+        ''' The bootloader checks the image in the flash against this CRC before it marks it bootable '''
+        Image_CRC32 = Calculate_CRC32(Image, len(Image)) & 0xFFFFFFFF
+        print("   Image of (", len(Image), ") Bytes, CRC32", hex(Image_CRC32))
+        Image_Manifest = list(struct.pack('<4I', Load_Address, len(Image), Image_CRC32, Image_Version))
+        ''' A transfer of the same manifest that did not commit (link lost, board reset) goes on from the pages the bootloader stored '''
+        Send_CBL_Command(Build_CBL_Command(CBL_FLASH_IMAGE_CMD, [CBL_IMAGE_RESUME] + Image_Manifest))
+        Read_Data_From_Serial_Port(CBL_FLASH_IMAGE_CMD, False)
+        if(Image_Status != IMAGE_OPERATION_PASSED):
+            Send_CBL_Command(Build_CBL_Command(CBL_FLASH_IMAGE_CMD, [CBL_IMAGE_BEGIN] + Image_Manifest))
+            Read_Data_From_Serial_Port(CBL_FLASH_IMAGE_CMD)
+        Erased_Runs = Find_Erased_Runs(Image) if Erased_Skip else []
+        Image_Retries = 0
+        Image_Payload_Max = Frame_Payload_Max(CBL_IMAGE_DATA_OVERHEAD)
+        ''' Every reply carries the offset the bootloader is at, the next frame starts there: no sleep, no host side bookkeeping '''
+        while(Image_Status in (IMAGE_OPERATION_PASSED, IMAGE_OFFSET_MISMATCH) and Image_Next_Offset < len(Image)):
+            Image_Offset = Image_Next_Offset
+            Erased_Run = next((Run for Run in Erased_Runs if Run[0] == Image_Offset), None)
+            if(Erased_Run):
+                Image_Details = struct.pack('<BIBI', CBL_IMAGE_DATA, Image_Offset, 0, Erased_Run[1] - Erased_Run[0])
+            else:
+                Data_End = min([Image_Offset + Image_Payload_Max, len(Image)] + [Run[0] for Run in Erased_Runs if Run[0] > Image_Offset])
+                Image_Details = struct.pack('<BIB', CBL_IMAGE_DATA, Image_Offset, Data_End - Image_Offset) + Image[Image_Offset : Data_End]
+            Image_Status = None
+            Send_CBL_Command(Build_CBL_Command(CBL_FLASH_IMAGE_CMD, list(Image_Details)))
+            Read_Data_From_Serial_Port(CBL_FLASH_IMAGE_CMD, False)
+            if(Image_Status is None and Image_Retries < CBL_IMAGE_RESUME_RETRIES):
+                ''' NACK: the frame was damaged on the way and not written, RESUME tells where the transfer is '''
+                Image_Retries = Image_Retries + 1
+                Send_CBL_Command(Build_CBL_Command(CBL_FLASH_IMAGE_CMD, [CBL_IMAGE_RESUME] + Image_Manifest))
+                Read_Data_From_Serial_Port(CBL_FLASH_IMAGE_CMD, False)
+            elif(Image_Status == IMAGE_OPERATION_PASSED):
+                Image_Retries = 0
+        if(Image_Status == IMAGE_OPERATION_PASSED):
+            ''' The bootloader hashed the frames as it wrote them, it only compares the digest with this one '''
+            Commit_Details = [CBL_IMAGE_COMMIT] + (list(hashlib.sha256(Image).digest()) if Image_Digest else [])
+            Send_CBL_Command(Build_CBL_Command(CBL_FLASH_IMAGE_CMD, Commit_Details))
+            Read_Data_From_Serial_Port(CBL_FLASH_IMAGE_CMD)
+        if(Image_Status == IMAGE_OPERATION_PASSED):
+            print("\n\n Image Committed, bootable")
+    elif (Command == 20):
+        Toggle_Reliable_Replies()
+    elif (Command == 21):
+        Toggle_COBS_Framing()
+    elif (Command == 22):
+        print("Read the bootloader capabilities and pick the fastest mode both sides have")
+        Query_BL_Capabilities()
             
         
 
@@ -468,6 +1354,16 @@ while True:
     print("   CBL_READ_SECTOR_STATUS_CMD   --> 10")
     print("   CBL_OTP_READ_CMD             --> 11")
     print("   CBL_CHANGE_ROP_Level_CMD     --> 12")
+    print("   CBL_BATCH_CMD                --> 13")
+    print("   BL_DEBUG_LOG_MONITOR         --> 14")
+    print("   CBL_GET_STATS_CMD            --> 15")
+    print("   BL_FLEET_STATS_REPORT        --> 16")
+    print("   CBL_ALLOCATE_PAGES_CMD       --> 17")
+    print("   CBL_LOAD_AND_EXEC_CMD        --> 18")
+    print("   CBL_FLASH_IMAGE_CMD          --> 19")
+    print("   BL_RELIABLE_REPLIES_TOGGLE   --> 20")
+    print("   BL_COBS_FRAMING_TOGGLE       --> 21")
+    print("   CBL_GET_CAPABILITIES_CMD     --> 22")
     
     CBL_Command = input("\nEnter the command code : ")
     
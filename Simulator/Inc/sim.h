@@ -0,0 +1,188 @@
+/**
+ ******************************************************************************
+ * @file           : sim.h
+ * @author         : Ahmed Naeim
+ * @brief          : Contains declaration for the host simulation of the
+ *                   STM32F103C8 target (flash, option bytes, SRAM, CRC unit,
+ *                   UARTs) used by the bl_sim build
+ ******************************************************************************
+**/
+#ifndef SIM_H_
+#define SIM_H_
+
+/**********************************************Includes Start**********************************************/
+#include <stdint.h>
+/**********************************************Includes End**********************************************/
+
+/**********************************************Macro Declaration Start**********************************************/
+
+/*
+ * The target memories are mapped at their STM32F103 addresses in the simulator process (non PIE build),
+ * so the address arithmetic and the pointer casts of bootloader.c run unchanged. The flash and the option
+ * bytes are mapped read only, the models write them through a second mapping of the same pages.
+ * The flash geometry and the ID code are the ones of the device picked with --device (Sim_Devices).
+ * */
+
+#define SIM_FLASH_BASE							0x08000000UL
+#define SIM_FLASH_SIZE							(Sim_Target_Device->Flash_Size)
+#define SIM_FLASH_PAGE_SIZE						(Sim_Target_Device->Page_Size)
+#define SIM_FLASH_PAGES_PER_WRP_BIT				(Sim_Target_Device->Pages_Per_WRP_Bit)
+#define SIM_FLASH_WRP_BITS						32					/* WRP0 to WRP3, the last bit covers the pages left over */
+#define SIM_FLASH_BANKS							2					/* Bank 2 only exists on the XL density parts */
+
+#define SIM_OB_PAGE_BASE						0x1FFFF000UL		/* Host page holding the option bytes */
+#define SIM_OB_BASE								0x1FFFF800UL
+#define SIM_OB_PAGE_SIZE						4096
+#define SIM_UID_BASE							0x1FFFF7E8UL		/* 96 bit unique device ID, in the option byte host page */
+#define SIM_FLASH_SIZE_REGISTER					0x1FFFF7E0UL		/* F_SIZE, flash size in KB, in the option byte host page */
+
+#define SIM_SRAM_BASE							0x20000000UL
+#define SIM_SRAM_SIZE							(20 * 1024)
+
+#define SIM_DBGMCU_BASE							0xE0042000UL
+
+/* System control space pages holding DWT (CYCCNT) and CoreDebug (DEMCR) */
+#define SIM_DWT_BASE							0xE0001000UL
+#define SIM_CORE_DEBUG_BASE						0xE000EDF0UL
+#define SIM_SCS_PAGE_SIZE						4096
+#define SIM_CORE_CLOCK_HZ						72000000ULL			/* SystemClock_Config, CYCCNT follows the simulated time at this rate */
+
+#define SIM_RDP_LEVEL_0							0xA5
+
+/* UART frame: start bit, 8 data bits, stop bit */
+#define SIM_UART_BITS_PER_BYTE					10
+#define SIM_UART_DEFAULT_BAUD_RATE				115200				/* huart2 in usart.c */
+#define SIM_UART_TIMEOUT						1					/* Sim_UART_Receive gave up, the host is silent */
+
+/* Exit codes of the simulated target, the supervisor restarts it on a reset */
+#define SIM_EXIT_RESET							3
+#define SIM_EXIT_JUMP							4
+
+/**********************************************Macro Declaration End**********************************************/
+
+
+
+/**********************************************Macro Functions Start**********************************************/
+
+/* Bank of a flash address, 0 for every address of a single bank part */
+#define SIM_FLASH_BANK(Address)					((((Address) - SIM_FLASH_BASE) >= Sim_Target_Device->Bank_Size) ? 1 : 0)
+
+/**********************************************Macro Functions End**********************************************/
+
+
+
+/**********************************************Data Types Declaration Start**********************************************/
+
+/* STM32F1 device line the simulated target belongs to */
+typedef struct{
+	const char *Name;										/* --device argument */
+	uint32_t IDCODE;										/* DBGMCU_IDCODE, revision and DEV_ID */
+	uint32_t Flash_Size;
+	uint32_t Page_Size;
+	uint32_t Pages_Per_WRP_Bit;
+	uint32_t Bank_Size;										/* Bank 1, the whole flash on a single bank part */
+}Sim_Device;
+
+typedef enum{
+	SIM_FLASH_OK = 0,
+	SIM_FLASH_PGERR,										/* Half-word not erased or address not half-word aligned */
+	SIM_FLASH_WRPRTERR,										/* Page write protected by the WRP option bytes */
+	SIM_FLASH_ADDRESS_ERROR									/* Outside the flash (bus fault on the target) */
+}Sim_Flash_Status;
+
+/* Same layout as OB_TypeDef: every option byte is stored with its complement in the upper byte */
+typedef struct{
+	uint16_t RDP;
+	uint16_t USER;
+	uint16_t Data0;
+	uint16_t Data1;
+	uint16_t WRP0;
+	uint16_t WRP1;
+	uint16_t WRP2;
+	uint16_t WRP3;
+}Sim_Option_Bytes;
+
+typedef struct{
+	int Master_Fd;
+	int Slave_Fd;											/* Kept open so reads never see a hang up between host sessions */
+	char Slave_Name[64];
+	const char *Link_Name;									/* Optional stable symlink to the slave */
+	uint8_t Drop_When_Full;									/* Debug UART: drop bytes instead of stalling the target */
+}Sim_UART;
+
+typedef enum{
+	SIM_TIMING_TYPICAL = 0,										/* Typical flash timings of the datasheet */
+	SIM_TIMING_WORST_CASE,										/* Maximum flash timings of the datasheet */
+	SIM_TIMING_CORNERS
+}Sim_Timing_Corner;
+
+typedef enum{
+	SIM_COST_UART_RX = 0,
+	SIM_COST_UART_TX,
+	SIM_COST_PROGRAM,
+	SIM_COST_ERASE,
+	SIM_COST_KINDS
+}Sim_Cost_Kind;
+
+/**********************************************Data Types Declaration End**********************************************/
+
+
+/**********************************************Software Interfaces Declaration Start**********************************************/
+
+/* Memory map (sim_memory.c) */
+extern const Sim_Device *Sim_Target_Device;
+const Sim_Device *Sim_Device_Find(const char *Device_Name);
+int Sim_Memory_Init(const char *Flash_File_Name, const Sim_Device *Device);
+uint8_t *Sim_Flash_Rw(uint32_t Address);
+Sim_Option_Bytes *Sim_OB_Rw(void);
+uint8_t Sim_Is_SRAM_Range(uint32_t Address, uint32_t Length);
+volatile uint32_t *Sim_Cycle_Counter(void);
+
+/* Flash and option byte model (sim_flash.c) */
+Sim_Flash_Status Sim_Flash_Program_Half_Word(uint32_t Address, uint16_t Half_Word, uint8_t Posted);
+Sim_Flash_Status Sim_Flash_Erase_Page(uint32_t Page_Address);
+Sim_Flash_Status Sim_Flash_Mass_Erase(void);
+void Sim_OB_Set_RDP(uint8_t RDP_Level);
+uint8_t Sim_OB_Get_RDP(void);
+int Sim_Flash_Load(uint32_t Address, const char *Image_File_Name);
+
+/* CRC unit model (sim_crc.c) */
+void Sim_CRC_Reset(void);
+void Sim_CRC_Feed(uint32_t Data);
+uint32_t Sim_CRC_Read(void);
+
+/* UART model on a pseudo terminal (sim_uart.c) */
+extern Sim_UART Sim_Host_UART;
+extern Sim_UART Sim_Debug_UART;
+int Sim_UART_Open(Sim_UART *Uart, const char *Link_Name, uint8_t Drop_When_Full);
+void Sim_UART_Close(Sim_UART *Uart);
+/* Receive: 0, SIM_UART_TIMEOUT when the bytes are not in within Timeout_Ms of wall-clock time (< 0: no limit),
+ * -1 when the pseudo terminal is gone */
+int Sim_UART_Receive(Sim_UART *Uart, uint8_t *Data, uint16_t Data_Len, int32_t Timeout_Ms);
+void Sim_UART_Transmit(Sim_UART *Uart, const uint8_t *Data, uint16_t Data_Len);
+
+/* Simulated time, charged per host command (sim_time.c) */
+int Sim_Time_Init(Sim_Timing_Corner Corner, uint32_t Baud_Rate, uint8_t Trace);
+void Sim_Time_Start_Command(uint8_t Command_Code);
+void Sim_Time_End_Command(void);
+void Sim_Time_Charge_Uart(Sim_Cost_Kind Kind, uint32_t Bytes);
+void Sim_Time_Charge_Half_Word_Program(uint8_t Bank, uint8_t Posted);
+void Sim_Time_Charge_Page_Erase(uint8_t Bank);
+void Sim_Time_Charge_Mass_Erase(void);
+void Sim_Time_Wait_Bank(uint8_t Bank);
+uint64_t Sim_Time_Now_Ns(void);
+void Sim_Time_Report(void);
+
+/* Core registers (sim_hal.c) */
+extern uint32_t Sim_MSP;
+
+/* Target control (sim_main.c) */
+void Sim_Reset(void);
+
+/* Host benchmarks (sim_bench.c), 0 when every test vector passed */
+int Sim_Bench_SHA256(void);
+int Sim_Bench_ECDSA(void);
+
+/**********************************************Software Interfaces Declaration End**********************************************/
+
+#endif /* SIM_H_ */
@@ -0,0 +1,94 @@
+/**
+ ******************************************************************************
+ * @file           : stm32f1xx_hal.h
+ * @author         : Ahmed Naeim
+ * @brief          : Simulated HAL for the bl_sim build. It replaces the ST
+ *                   HAL and CMSIS headers with the few definitions that the
+ *                   bootloader sources use directly, the hardware access goes
+ *                   through bl_port.h (bl_port_sim.c)
+ ******************************************************************************
+**/
+#ifndef SIM_STM32F1XX_HAL_H_
+#define SIM_STM32F1XX_HAL_H_
+
+/**********************************************Includes Start**********************************************/
+#include <stdint.h>
+#include "sim.h"
+/**********************************************Includes End**********************************************/
+
+/**********************************************Macro Declaration Start**********************************************/
+
+#define FLASH_BASE								SIM_FLASH_BASE
+#define SRAM_BASE								SIM_SRAM_BASE
+
+#define UID_BASE								SIM_UID_BASE
+
+#define DBGMCU									((DBGMCU_TypeDef *)SIM_DBGMCU_BASE)
+#define DWT										((DWT_Type *)SIM_DWT_BASE)
+#define CoreDebug								((CoreDebug_Type *)SIM_CORE_DEBUG_BASE)
+
+#define DWT_CTRL_CYCCNTENA_Msk					(1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk				(1UL << 24)
+
+#define __weak									__attribute__((weak))
+
+/**********************************************Macro Declaration End**********************************************/
+
+
+
+/**********************************************Data Types Declaration Start**********************************************/
+
+typedef enum{
+	HAL_OK = 0x00U,
+	HAL_ERROR = 0x01U,
+	HAL_BUSY = 0x02U,
+	HAL_TIMEOUT = 0x03U
+}HAL_StatusTypeDef;
+
+typedef struct{
+	volatile uint32_t IDCODE;
+	volatile uint32_t CR;
+}DBGMCU_TypeDef;
+
+/* Leading registers of the CMSIS layouts, CYCCNT is written by sim_time.c */
+typedef struct{
+	volatile uint32_t CTRL;
+	volatile uint32_t CYCCNT;
+}DWT_Type;
+
+typedef struct{
+	volatile uint32_t DHCSR;
+	volatile uint32_t DCRSR;
+	volatile uint32_t DCRDR;
+	volatile uint32_t DEMCR;
+}CoreDebug_Type;
+
+/* The handles only identify the peripheral, sim_hal.c maps them to the simulated UARTs */
+typedef struct{
+	Sim_UART *Instance;
+}UART_HandleTypeDef;
+
+typedef struct{
+	uint32_t Instance;
+}CRC_HandleTypeDef;
+
+/**********************************************Data Types Declaration End**********************************************/
+
+
+/**********************************************Software Interfaces Declaration Start**********************************************/
+
+/* Core registers, the simulated target has no interrupts */
+void __set_MSP(uint32_t topOfMainStack);
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t priMask);
+void __disable_irq(void);
+void __DSB(void);
+void __ISB(void);
+
+/* The DMA transfer completes before the call returns */
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size);
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart);
+
+/**********************************************Software Interfaces Declaration End**********************************************/
+
+#endif /* SIM_STM32F1XX_HAL_H_ */
@@ -0,0 +1,245 @@
+/**
+ ******************************************************************************
+ * @file           : bl_port_sim.c
+ * @author         : Ahmed Naeim
+ * @brief          : Bootloader hardware port of the bl_sim build, on top of
+ *                   the simulated UART, CRC unit, flash and option bytes.
+ *                   A posted bank 2 payload is programmed into the model at
+ *                   once and its time runs on the bank 2 clock
+ ******************************************************************************
+**/
+
+#include <stdlib.h>
+#include <time.h>
+#include "Bootloader/bootloader.h"
+
+
+
+/*****************************************Global Variables Start*****************************************/
+
+/* The bootloader receives a frame as its length byte, then the bytes it announces (command code first) */
+static uint8_t Sim_Frame_Body_Pending = 0;
+
+/* How the last posted payload ended, reported by the next BL_Port_Flash_Sync like bl_port_ll.c does */
+static BL_Port_Status Sim_Posted_Status = BL_PORT_OK;
+
+/*****************************************Global Variables End*****************************************/
+
+
+
+/*****************************************Static Functions Declarations Start*****************************************/
+
+static BL_Port_Status Sim_Port_Host_Receive_Byte(uint8_t *Data_Byte, uint32_t Timeout_Ms, int64_t *Frame_Start, uint16_t Byte_Index);
+static int64_t Sim_Port_Wall_Clock_Ms(void);
+static BL_Port_Status Sim_Port_Flash_Program(uint32_t Address, const uint8_t *Data, uint16_t Data_Len, uint8_t Posted);
+
+/*****************************************Static Functions Declarations End*****************************************/
+
+
+/*****************************************Software Interface Implementation Start*****************************************/
+
+BL_Port_Status BL_Port_Host_Receive(uint8_t *Data, uint16_t Data_Len, uint32_t Timeout_Ms){
+	BL_Port_Status Port_Status = BL_PORT_OK;
+	uint16_t Data_Counter = 0;
+	int64_t Frame_Start = 0;
+
+	for(Data_Counter = 0; (Data_Counter < Data_Len) && (BL_PORT_OK == Port_Status); Data_Counter++){
+		Port_Status = Sim_Port_Host_Receive_Byte(&Data[Data_Counter], Timeout_Ms, &Frame_Start, Data_Counter);
+	}
+	if(!Sim_Frame_Body_Pending){
+		Sim_Frame_Body_Pending = (BL_PORT_OK == Port_Status) ? 1 : 0;
+	}
+	else{
+		/* The frame is charged to its command, length byte included. A frame given up on a timeout is not charged */
+		if(BL_PORT_OK == Port_Status){
+			Sim_Time_Start_Command((Data_Len > 0) ? Data[0] : 0x00);
+			Sim_Time_Charge_Uart(SIM_COST_UART_RX, (uint32_t)Data_Len + 1);
+		}
+		Sim_Frame_Body_Pending = 0;
+	}
+	return Port_Status;
+}
+
+BL_Port_Status BL_Port_Host_Receive_Until(uint8_t *Data, uint16_t Data_Max_Len, uint8_t Delimiter, uint16_t *Data_Len, uint32_t Timeout_Ms){
+	BL_Port_Status Port_Status = BL_PORT_OK;
+	BL_Port_Status Receive_Status = BL_PORT_OK;
+	uint16_t Data_Counter = 0;
+	uint16_t Byte_Counter = 0;
+	uint32_t Wire_Bytes = 1;							/* The delimiter at the end */
+	int64_t Frame_Start = 0;
+	uint8_t Data_Byte = 0;
+
+	for(;;){
+		Receive_Status = Sim_Port_Host_Receive_Byte(&Data_Byte, Timeout_Ms, &Frame_Start, Byte_Counter++);
+		if((BL_PORT_OK != Receive_Status) || (Delimiter == Data_Byte)){
+			break;
+		}
+		Wire_Bytes++;
+		if(Data_Counter < Data_Max_Len){
+			Data[Data_Counter++] = Data_Byte;
+		}
+		else{
+			Port_Status = BL_PORT_ERROR;
+		}
+	}
+	*Data_Len = Data_Counter;
+	/* The delimiter that switched the framing came through BL_Port_Host_Receive, it is charged with this frame */
+	if(Sim_Frame_Body_Pending){
+		Wire_Bytes++;
+		Sim_Frame_Body_Pending = 0;
+	}
+	if((BL_PORT_OK == Receive_Status) && (0 != Data_Counter)){
+		/* COBS frame: the first code byte and the length byte come before the command code, neither of them is zero */
+		Sim_Time_Start_Command((Data_Counter > 2) ? Data[2] : 0x00);
+		Sim_Time_Charge_Uart(SIM_COST_UART_RX, Wire_Bytes);
+	}
+	return (BL_PORT_OK != Receive_Status) ? Receive_Status : Port_Status;
+}
+
+void BL_Port_Host_Transmit(const uint8_t *Data, uint16_t Data_Len){
+	Sim_UART_Transmit(&Sim_Host_UART, Data, Data_Len);
+	Sim_Time_Charge_Uart(SIM_COST_UART_TX, Data_Len);
+}
+
+uint32_t BL_Port_CRC_Calculate(const uint8_t *Data, uint32_t Data_Len){
+	uint32_t CRC_Value = 0;
+	uint32_t Data_Counter = 0;
+
+	Sim_CRC_Reset();
+	for(Data_Counter = 0; Data_Counter < Data_Len; Data_Counter++){
+		Sim_CRC_Feed((uint32_t)Data[Data_Counter]);
+	}
+	CRC_Value = Sim_CRC_Read();
+	Sim_CRC_Reset();
+
+	return CRC_Value;
+}
+
+BL_Port_Status BL_Port_Flash_Erase_Pages(uint32_t Page_Address, uint16_t Number_of_Pages, uint32_t *Page_Error){
+	BL_Port_Status Port_Status = BL_PORT_OK;
+	uint16_t Page_Counter = 0;
+
+	*Page_Error = HAL_SUCCESSFUL_ERASE;
+	for(Page_Counter = 0; (Page_Counter < Number_of_Pages) && (BL_PORT_OK == Port_Status); Page_Counter++){
+		if(SIM_FLASH_OK != Sim_Flash_Erase_Page(Page_Address)){
+			Port_Status = BL_PORT_ERROR;
+			*Page_Error = Page_Address;
+		}
+		Page_Address += BL_Flash.Page_Size;
+	}
+	return Port_Status;
+}
+
+BL_Port_Status BL_Port_Flash_Mass_Erase(void){
+	return (SIM_FLASH_OK == Sim_Flash_Mass_Erase()) ? BL_PORT_OK : BL_PORT_ERROR;
+}
+
+BL_Port_Status BL_Port_Flash_Program(uint32_t Address, const uint8_t *Data, uint16_t Data_Len){
+	return Sim_Port_Flash_Program(Address, Data, Data_Len, 0);
+}
+
+BL_Port_Status BL_Port_Flash_Post_Program(uint32_t Address, const uint8_t *Data, uint16_t Data_Len){
+	BL_Port_Status Port_Status = BL_Port_Flash_Sync();
+
+	if(BL_PORT_OK == Port_Status){
+		/* Same choice as bl_port_ll.c: only bank 2 runs while the bootloader executes from bank 1 */
+		if((Address >= BL_Flash.Bank_1_End) && (Address < BL_Flash.Flash_End) && (0 == (Address & 0x01))
+				&& (Data_Len > 0) && (Data_Len <= BL_PORT_POSTED_MAX_LENGTH)){
+			Sim_Posted_Status = Sim_Port_Flash_Program(Address, Data, Data_Len, 1);
+			Port_Status = BL_PORT_POSTED;
+		}
+		else{
+			Port_Status = Sim_Port_Flash_Program(Address, Data, Data_Len, 0);
+		}
+	}
+	return Port_Status;
+}
+
+BL_Port_Status BL_Port_Flash_Sync(void){
+	BL_Port_Status Port_Status = Sim_Posted_Status;
+
+	Sim_Time_Wait_Bank(1);
+	Sim_Posted_Status = BL_PORT_OK;
+	return Port_Status;
+}
+
+uint8_t BL_Port_Get_RDP_Level(void){
+	return (SIM_RDP_LEVEL_0 == Sim_OB_Get_RDP()) ? BL_PORT_RDP_LEVEL_0 : BL_PORT_RDP_LEVEL_1;
+}
+
+BL_Port_Status BL_Port_Set_RDP_Level(uint8_t RDP_Level){
+	Sim_OB_Set_RDP(RDP_Level);
+	/* Reload the option bytes, this resets the MCU */
+	Sim_Reset();
+	return BL_PORT_OK;
+}
+
+void BL_Port_DeInit(void){
+	/* No clock tree in the simulation */
+}
+
+/*****************************************Software Interface Implementation End*****************************************/
+
+
+/*****************************************Static Functions Implementation Start*****************************************/
+
+static BL_Port_Status Sim_Port_Host_Receive_Byte(uint8_t *Data_Byte, uint32_t Timeout_Ms, int64_t *Frame_Start, uint16_t Byte_Index){
+	/* Same timeouts as bl_port_ll.c, in wall-clock time: byte 0 waits up to Timeout_Ms and starts the frame, the next
+	 * ones the inter-byte timeout within the frame timeout */
+	BL_Port_Status Port_Status = BL_PORT_OK;
+	int64_t Frame_Left_Ms = 0;
+	int32_t Wait_Ms = (BL_PORT_WAIT_FOREVER == Timeout_Ms) ? -1 : (int32_t)Timeout_Ms;
+	int Receive_Status = 0;
+
+	if(0 != Byte_Index){
+		Frame_Left_Ms = *Frame_Start + BL_PORT_FRAME_TIMEOUT_MS - Sim_Port_Wall_Clock_Ms();
+		Wait_Ms = BL_PORT_INTER_BYTE_TIMEOUT_MS;
+		if(Frame_Left_Ms < Wait_Ms){
+			Wait_Ms = (Frame_Left_Ms > 0) ? (int32_t)Frame_Left_Ms : 0;
+		}
+	}
+	Receive_Status = Sim_UART_Receive(&Sim_Host_UART, Data_Byte, 1, Wait_Ms);
+	if(SIM_UART_TIMEOUT == Receive_Status){
+		Port_Status = BL_PORT_TIMEOUT;
+	}
+	else if(0 != Receive_Status){
+		/* The pseudo terminal is gone, nothing will ever arrive again */
+		exit(EXIT_FAILURE);
+	}
+	else if(0 == Byte_Index){
+		*Frame_Start = Sim_Port_Wall_Clock_Ms();
+	}
+	return Port_Status;
+}
+
+static int64_t Sim_Port_Wall_Clock_Ms(void){
+	struct timespec Now;
+
+	clock_gettime(CLOCK_MONOTONIC, &Now);
+	return ((int64_t)Now.tv_sec * 1000) + (Now.tv_nsec / 1000000);
+}
+
+static BL_Port_Status Sim_Port_Flash_Program(uint32_t Address, const uint8_t *Data, uint16_t Data_Len, uint8_t Posted){
+	BL_Port_Status Port_Status = BL_PORT_ERROR;
+	uint16_t Data_Counter = 0;
+	uint16_t Half_Word = 0;
+
+	if(0 == (Address & 0x01)){
+		Port_Status = BL_PORT_OK;
+	}
+	for(Data_Counter = 0; (Data_Counter < Data_Len) && (BL_PORT_OK == Port_Status); Data_Counter += 2){
+		/* An odd length leaves the last high byte erased */
+		Half_Word = Data[Data_Counter];
+		Half_Word |= ((Data_Counter + 1) < Data_Len) ? ((uint16_t)Data[Data_Counter + 1] << 8) : 0xFF00;
+		if(Sim_Is_SRAM_Range(Address + Data_Counter, 2)){
+			/* PG does not matter outside the flash, the store goes to SRAM */
+			*(volatile uint16_t *)(uintptr_t)(Address + Data_Counter) = Half_Word;
+		}
+		else if(SIM_FLASH_OK != Sim_Flash_Program_Half_Word(Address + Data_Counter, Half_Word, Posted)){
+			Port_Status = BL_PORT_ERROR;
+		}
+	}
+	return Port_Status;
+}
+
+/*****************************************Static Functions Implementation End*****************************************/
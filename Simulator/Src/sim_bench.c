@@ -0,0 +1,295 @@
+/**
+ ******************************************************************************
+ * @file           : sim_bench.c
+ * @author         : Ahmed Naeim
+ * @brief          : Host benchmarks of the bootloader code paths that do not
+ *                   touch the simulated peripherals: the image SHA-256 is
+ *                   checked against the FIPS 180-4 vectors, then timed in
+ *                   cycles per byte (TSC on x86, nanoseconds elsewhere). The
+ *                   ECDSA P-256 check of the secure boot is run on the
+ *                   RFC 6979 vectors and on broken copies of them, timed per
+ *                   signature and its stack measured on a painted stack
+ ******************************************************************************
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <ucontext.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "sim.h"
+#include "Bootloader/bl_sha256.h"
+#include "Bootloader/bl_ecdsa.h"
+
+
+
+/*****************************************Macro Declaration Start*****************************************/
+
+#define SIM_BENCH_FRAME_SIZE					238						/* Image DATA payload of a negotiated 256 byte frame */
+#define SIM_BENCH_IMAGE_SIZE					(64 * 1024)
+#define SIM_BENCH_RUNS							32
+#define SIM_BENCH_ECDSA_RUNS					16
+#define SIM_BENCH_STACK_SIZE					(64 * 1024)
+#define SIM_BENCH_STACK_PAINT					0xA5
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIM_BENCH_UNIT							"cycles"
+#else
+#define SIM_BENCH_UNIT							"ns"
+#endif
+
+/*****************************************Macro Declaration End*****************************************/
+
+
+
+/*****************************************Data Types Declaration Start*****************************************/
+
+typedef struct{
+	const char *Message;
+	uint32_t Repeat;							/* Times the message is fed, the million 'a' vector goes in 1000 byte frames */
+	const char *Digest;
+}Sim_Bench_SHA256_Vector;
+
+typedef struct{
+	const char *Name;
+	const char *Public_Key;						/* Hex, X then Y */
+	const char *Digest;							/* Hex SHA-256 of the message */
+	const char *Signature;						/* Hex, r then s */
+	BL_ECDSA_Status Expected;
+}Sim_Bench_ECDSA_Vector;
+
+typedef struct{
+	uint8_t Public_Key[BL_ECDSA_PUBLIC_KEY_SIZE];
+	uint8_t Digest[BL_ECDSA_DIGEST_SIZE];
+	uint8_t Signature[BL_ECDSA_SIGNATURE_SIZE];
+}Sim_Bench_ECDSA_Input;
+
+/*****************************************Data Types Declaration End*****************************************/
+
+
+
+/*****************************************Global Variables Start*****************************************/
+
+static const Sim_Bench_SHA256_Vector Sim_Bench_SHA256_Vectors[] = {
+	{"", 1, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"},
+	{"abc", 1, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+	{"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1, "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"},
+	{"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+	 "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+	 "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+	 "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+	 "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+	 "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+	 "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+	 "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+	 "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+	 "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+	 1000, "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"}
+};
+
+/* RFC 6979 A.2.5, P-256 with SHA-256 on the messages "sample" and "test", then broken copies of the first one */
+#define SIM_BENCH_RFC6979_KEY					"60FED4BA255A9D31C961EB74C6356D68C049B8923B61FA6CE669622E60F29FB6" \
+												"7903FE1008B8BC99A41AE9E95628BC64F2F1B20C2D7E9F5177A3C294D4462299"
+#define SIM_BENCH_SAMPLE_DIGEST					"AF2BDBE1AA9B6EC1E2ADE1D694F41FC71A831D0268E9891562113D8A62ADD1BF"
+#define SIM_BENCH_SAMPLE_R						"EFD48B2AACB6A8FD1140DD9CD45E81D69D2C877B56AAF991C34D0EA84EAF3716"
+#define SIM_BENCH_SAMPLE_S						"F7CB1C942D657C41D436C7A1B6E29F65F3E900DBB9AFF4064DC4AB2F843ACDA8"
+#define SIM_BENCH_P256_N						"FFFFFFFF00000000FFFFFFFFFFFFFFFFBCE6FAADA7179E84F3B9CAC2FC632551"
+#define SIM_BENCH_ZERO							"0000000000000000000000000000000000000000000000000000000000000000"
+
+static const Sim_Bench_ECDSA_Vector Sim_Bench_ECDSA_Vectors[] = {
+	{"sample", SIM_BENCH_RFC6979_KEY, SIM_BENCH_SAMPLE_DIGEST, SIM_BENCH_SAMPLE_R SIM_BENCH_SAMPLE_S, BL_ECDSA_OK},
+	{"test", SIM_BENCH_RFC6979_KEY, "9F86D081884C7D659A2FEAA0C55AD015A3BF4F1B2B0B822CD15D6C15B0F00A08",
+	 "F1ABB023518351CD71D881567B1EA663ED3EFCF6C5132B354F28D3B0B7D38367"
+	 "019F4113742A2B14BD25926B49C649155F267E60D3814B4C0CC84250E46F0083", BL_ECDSA_OK},
+	{"digest changed", SIM_BENCH_RFC6979_KEY, "AF2BDBE1AA9B6EC1E2ADE1D694F41FC71A831D0268E9891562113D8A62ADD1BE",
+	 SIM_BENCH_SAMPLE_R SIM_BENCH_SAMPLE_S, BL_ECDSA_INVALID_SIGNATURE},
+	{"r changed", SIM_BENCH_RFC6979_KEY, SIM_BENCH_SAMPLE_DIGEST,
+	 "EFD48B2AACB6A8FD1140DD9CD45E81D69D2C877B56AAF991C34D0EA84EAF3717" SIM_BENCH_SAMPLE_S, BL_ECDSA_INVALID_SIGNATURE},
+	{"s changed", SIM_BENCH_RFC6979_KEY, SIM_BENCH_SAMPLE_DIGEST,
+	 SIM_BENCH_SAMPLE_R "F7CB1C942D657C41D436C7A1B6E29F65F3E900DBB9AFF4064DC4AB2F843ACDA9", BL_ECDSA_INVALID_SIGNATURE},
+	{"r = 0", SIM_BENCH_RFC6979_KEY, SIM_BENCH_SAMPLE_DIGEST, SIM_BENCH_ZERO SIM_BENCH_SAMPLE_S, BL_ECDSA_INVALID_SIGNATURE},
+	{"s = n", SIM_BENCH_RFC6979_KEY, SIM_BENCH_SAMPLE_DIGEST, SIM_BENCH_SAMPLE_R SIM_BENCH_P256_N, BL_ECDSA_INVALID_SIGNATURE},
+	{"key off the curve", "60FED4BA255A9D31C961EB74C6356D68C049B8923B61FA6CE669622E60F29FB6"
+	 "7903FE1008B8BC99A41AE9E95628BC64F2F1B20C2D7E9F5177A3C294D4462298", SIM_BENCH_SAMPLE_DIGEST,
+	 SIM_BENCH_SAMPLE_R SIM_BENCH_SAMPLE_S, BL_ECDSA_INVALID_KEY}
+};
+
+static uint8_t Sim_Bench_Stack[SIM_BENCH_STACK_SIZE];
+static ucontext_t Sim_Bench_Caller_Context;
+static Sim_Bench_ECDSA_Input Sim_Bench_Stack_Input;
+
+/*****************************************Global Variables End*****************************************/
+
+
+
+/*****************************************Static Functions Declarations Start*****************************************/
+
+static uint64_t Sim_Bench_Now(void);
+static int Sim_Bench_SHA256_Check(const Sim_Bench_SHA256_Vector *Vector);
+static void Sim_Bench_Hex(uint8_t *Bytes, const char *Text, uint32_t Length);
+static void Sim_Bench_ECDSA_Load(Sim_Bench_ECDSA_Input *Input, const Sim_Bench_ECDSA_Vector *Vector);
+static void Sim_Bench_ECDSA_Stack_Entry(void);
+static uint32_t Sim_Bench_ECDSA_Stack_Used(void);
+
+/*****************************************Static Functions Declarations End*****************************************/
+
+
+/*****************************************Software Interface Implementation Start*****************************************/
+
+int Sim_Bench_SHA256(void){
+	static uint8_t Image[SIM_BENCH_IMAGE_SIZE];
+	BL_SHA256_Context Context;
+	uint8_t Digest[BL_SHA256_DIGEST_SIZE];
+	uint64_t Best = UINT64_MAX;
+	uint64_t Start = 0;
+	uint32_t Offset = 0;
+	uint32_t Frame_Len = 0;
+	uint32_t Run = 0;
+	uint32_t Vector_Index = 0;
+	int Failures = 0;
+
+	for(Vector_Index = 0; Vector_Index < (sizeof(Sim_Bench_SHA256_Vectors) / sizeof(Sim_Bench_SHA256_Vectors[0])); Vector_Index++){
+		Failures += Sim_Bench_SHA256_Check(&Sim_Bench_SHA256_Vectors[Vector_Index]);
+	}
+	/* The image goes in frames of a negotiated DATA payload like on the target, the best run of several is kept */
+	for(Offset = 0; Offset < SIM_BENCH_IMAGE_SIZE; Offset++){
+		Image[Offset] = (uint8_t)(Offset * 2654435761UL >> 24);
+	}
+	for(Run = 0; Run < SIM_BENCH_RUNS; Run++){
+		Start = Sim_Bench_Now();
+		BL_SHA256_Init(&Context);
+		for(Offset = 0; Offset < SIM_BENCH_IMAGE_SIZE; Offset += Frame_Len){
+			Frame_Len = ((SIM_BENCH_IMAGE_SIZE - Offset) < SIM_BENCH_FRAME_SIZE) ? (SIM_BENCH_IMAGE_SIZE - Offset) : SIM_BENCH_FRAME_SIZE;
+			BL_SHA256_Update(&Context, &Image[Offset], Frame_Len);
+		}
+		BL_SHA256_Final(&Context, Digest);
+		if((Sim_Bench_Now() - Start) < Best){
+			Best = Sim_Bench_Now() - Start;
+		}
+	}
+	printf("bl_sim: SHA-256 %s, %u vectors %s, %u KB in %u byte frames: %.2f %s/byte\n",
+		   BL_SHA256_UNROLLED ? "unrolled" : "rolled", (unsigned)Vector_Index, (0 == Failures) ? "passed" : "FAILED",
+		   (unsigned)(SIM_BENCH_IMAGE_SIZE / 1024), (unsigned)SIM_BENCH_FRAME_SIZE, (double)Best / SIM_BENCH_IMAGE_SIZE, SIM_BENCH_UNIT);
+	return Failures;
+}
+
+int Sim_Bench_ECDSA(void){
+	Sim_Bench_ECDSA_Input Input;
+	BL_ECDSA_Status Status = BL_ECDSA_OK;
+	uint64_t Best = UINT64_MAX;
+	uint64_t Start = 0;
+	uint32_t Stack_Used = 0;
+	uint32_t Run = 0;
+	uint32_t Vector_Index = 0;
+	int Failures = 0;
+
+	for(Vector_Index = 0; Vector_Index < (sizeof(Sim_Bench_ECDSA_Vectors) / sizeof(Sim_Bench_ECDSA_Vectors[0])); Vector_Index++){
+		Sim_Bench_ECDSA_Load(&Input, &Sim_Bench_ECDSA_Vectors[Vector_Index]);
+		Status = BL_ECDSA_P256_Verify(Input.Public_Key, Input.Digest, Input.Signature);
+		if(Status != Sim_Bench_ECDSA_Vectors[Vector_Index].Expected){
+			Failures++;
+			printf("bl_sim: ECDSA vector \"%s\" gave %u, expected %u\n", Sim_Bench_ECDSA_Vectors[Vector_Index].Name,
+				   (unsigned)Status, (unsigned)Sim_Bench_ECDSA_Vectors[Vector_Index].Expected);
+		}
+	}
+	Sim_Bench_ECDSA_Load(&Input, &Sim_Bench_ECDSA_Vectors[0]);
+	for(Run = 0; Run < SIM_BENCH_ECDSA_RUNS; Run++){
+		Start = Sim_Bench_Now();
+		BL_ECDSA_P256_Verify(Input.Public_Key, Input.Digest, Input.Signature);
+		if((Sim_Bench_Now() - Start) < Best){
+			Best = Sim_Bench_Now() - Start;
+		}
+	}
+	/* The host frames are not the Cortex-M3 ones (make stack-budget), but a check that outgrows the budget here did so there too */
+	Stack_Used = Sim_Bench_ECDSA_Stack_Used();
+	if(Stack_Used > BL_ECDSA_STACK_BUDGET){
+		Failures++;
+	}
+	printf("bl_sim: ECDSA P-256, %u vectors %s: %llu %s per signature, %u bytes of stack (budget %u)\n",
+		   (unsigned)Vector_Index, (0 == Failures) ? "passed" : "FAILED", (unsigned long long)Best, SIM_BENCH_UNIT,
+		   (unsigned)Stack_Used, (unsigned)BL_ECDSA_STACK_BUDGET);
+	return Failures;
+}
+
+/*****************************************Software Interface Implementation End*****************************************/
+
+
+/*****************************************Static Functions Implementation Start*****************************************/
+
+static uint64_t Sim_Bench_Now(void){
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec Now;
+
+	clock_gettime(CLOCK_MONOTONIC, &Now);
+	return ((uint64_t)Now.tv_sec * 1000000000ULL) + (uint64_t)Now.tv_nsec;
+#endif
+}
+
+static int Sim_Bench_SHA256_Check(const Sim_Bench_SHA256_Vector *Vector){
+	BL_SHA256_Context Context;
+	uint8_t Digest[BL_SHA256_DIGEST_SIZE];
+	char Digest_Text[(2 * BL_SHA256_DIGEST_SIZE) + 1];
+	uint32_t Repeat = 0;
+	uint32_t Byte_Counter = 0;
+	int Failed = 0;
+
+	BL_SHA256_Init(&Context);
+	for(Repeat = 0; Repeat < Vector->Repeat; Repeat++){
+		BL_SHA256_Update(&Context, (const uint8_t *)Vector->Message, (uint32_t)strlen(Vector->Message));
+	}
+	BL_SHA256_Final(&Context, Digest);
+	for(Byte_Counter = 0; Byte_Counter < BL_SHA256_DIGEST_SIZE; Byte_Counter++){
+		sprintf(&Digest_Text[2 * Byte_Counter], "%02x", Digest[Byte_Counter]);
+	}
+	if(0 != strcmp(Digest_Text, Vector->Digest)){
+		Failed = 1;
+		printf("bl_sim: SHA-256 of %u x %u bytes is %s, expected %s\n", (unsigned)Vector->Repeat,
+			   (unsigned)strlen(Vector->Message), Digest_Text, Vector->Digest);
+	}
+	return Failed;
+}
+
+static void Sim_Bench_Hex(uint8_t *Bytes, const char *Text, uint32_t Length){
+	uint32_t Byte_Counter = 0;
+	unsigned int Value = 0;
+
+	for(Byte_Counter = 0; Byte_Counter < Length; Byte_Counter++){
+		sscanf(&Text[2 * Byte_Counter], "%2x", &Value);
+		Bytes[Byte_Counter] = (uint8_t)Value;
+	}
+}
+
+static void Sim_Bench_ECDSA_Load(Sim_Bench_ECDSA_Input *Input, const Sim_Bench_ECDSA_Vector *Vector){
+	Sim_Bench_Hex(Input->Public_Key, Vector->Public_Key, BL_ECDSA_PUBLIC_KEY_SIZE);
+	Sim_Bench_Hex(Input->Digest, Vector->Digest, BL_ECDSA_DIGEST_SIZE);
+	Sim_Bench_Hex(Input->Signature, Vector->Signature, BL_ECDSA_SIGNATURE_SIZE);
+}
+
+static void Sim_Bench_ECDSA_Stack_Entry(void){
+	BL_ECDSA_P256_Verify(Sim_Bench_Stack_Input.Public_Key, Sim_Bench_Stack_Input.Digest, Sim_Bench_Stack_Input.Signature);
+}
+
+static uint32_t Sim_Bench_ECDSA_Stack_Used(void){
+	/* Runs one check on a painted stack, the deepest byte written is the first one not holding the paint */
+	ucontext_t Check_Context;
+	uint32_t Untouched = 0;
+
+	Sim_Bench_ECDSA_Load(&Sim_Bench_Stack_Input, &Sim_Bench_ECDSA_Vectors[0]);
+	memset(Sim_Bench_Stack, SIM_BENCH_STACK_PAINT, sizeof(Sim_Bench_Stack));
+	getcontext(&Check_Context);
+	Check_Context.uc_stack.ss_sp = Sim_Bench_Stack;
+	Check_Context.uc_stack.ss_size = sizeof(Sim_Bench_Stack);
+	Check_Context.uc_link = &Sim_Bench_Caller_Context;
+	makecontext(&Check_Context, Sim_Bench_ECDSA_Stack_Entry, 0);
+	swapcontext(&Sim_Bench_Caller_Context, &Check_Context);
+	while((Untouched < sizeof(Sim_Bench_Stack)) && (SIM_BENCH_STACK_PAINT == Sim_Bench_Stack[Untouched])){
+		Untouched++;
+	}
+	return (uint32_t)(sizeof(Sim_Bench_Stack) - Untouched);
+}
+
+/*****************************************Static Functions Implementation End*****************************************/
@@ -0,0 +1,55 @@
+/**
+ ******************************************************************************
+ * @file           : sim_crc.c
+ * @author         : Ahmed Naeim
+ * @brief          : STM32F1 CRC unit model: CRC-32 polynomial 0x04C11DB7,
+ *                   reset value 0xFFFFFFFF, 32 bit words fed MSB first, no
+ *                   reflection and no final XOR
+ ******************************************************************************
+**/
+
+#include "sim.h"
+
+
+
+/*****************************************Macro Declaration Start*****************************************/
+
+#define SIM_CRC_POLYNOMIAL						0x04C11DB7UL
+#define SIM_CRC_RESET_VALUE						0xFFFFFFFFUL
+
+/*****************************************Macro Declaration End*****************************************/
+
+
+
+/*****************************************Global Variables Start*****************************************/
+
+static uint32_t Sim_CRC_DR = SIM_CRC_RESET_VALUE;
+
+/*****************************************Global Variables End*****************************************/
+
+
+/*****************************************Software Interface Implementation Start*****************************************/
+
+void Sim_CRC_Reset(void){
+	Sim_CRC_DR = SIM_CRC_RESET_VALUE;
+}
+
+void Sim_CRC_Feed(uint32_t Data){
+	uint8_t Bit_Counter = 0;
+
+	Sim_CRC_DR ^= Data;
+	for(Bit_Counter = 0; Bit_Counter < 32; Bit_Counter++){
+		if(Sim_CRC_DR & 0x80000000UL){
+			Sim_CRC_DR = (Sim_CRC_DR << 1) ^ SIM_CRC_POLYNOMIAL;
+		}
+		else{
+			Sim_CRC_DR = (Sim_CRC_DR << 1);
+		}
+	}
+}
+
+uint32_t Sim_CRC_Read(void){
+	return Sim_CRC_DR;
+}
+
+/*****************************************Software Interface Implementation End*****************************************/
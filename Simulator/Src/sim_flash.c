@@ -0,0 +1,164 @@
+/**
+ ******************************************************************************
+ * @file           : sim_flash.c
+ * @author         : Ahmed Naeim
+ * @brief          : STM32F103 flash and option byte model: 1 or 2 KB pages,
+ *                   half-word programming of erased locations only, write
+ *                   protection from the WRP option bytes, mass erase on an
+ *                   RDP level 1 to level 0 change, datasheet program and
+ *                   erase times charged to the simulated clock, per bank
+ ******************************************************************************
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include "sim.h"
+
+
+
+/*****************************************Static Functions Declarations Start*****************************************/
+
+static uint8_t Sim_Is_Flash_Range(uint32_t Address, uint32_t Length);
+static uint8_t Sim_Is_Write_Protected(uint32_t Address);
+
+/*****************************************Static Functions Declarations End*****************************************/
+
+
+/*****************************************Software Interface Implementation Start*****************************************/
+
+Sim_Flash_Status Sim_Flash_Program_Half_Word(uint32_t Address, uint16_t Half_Word, uint8_t Posted){
+	Sim_Flash_Status Flash_Status = SIM_FLASH_OK;
+	uint8_t *Location = NULL;
+	uint16_t Current_Value = 0;
+
+	if(!Sim_Is_Flash_Range(Address, 2)){
+		Flash_Status = SIM_FLASH_ADDRESS_ERROR;
+	}
+	else if(Address & 0x01){
+		Flash_Status = SIM_FLASH_PGERR;
+	}
+	else if(Sim_Is_Write_Protected(Address)){
+		Flash_Status = SIM_FLASH_WRPRTERR;
+	}
+	else{
+		Location = Sim_Flash_Rw(Address);
+		Current_Value = (uint16_t)(Location[0] | (Location[1] << 8));
+		/* The controller only programs an erased half-word, writing 0x0000 is the one exception */
+		if((0xFFFF != Current_Value) && (0x0000 != Half_Word)){
+			Flash_Status = SIM_FLASH_PGERR;
+		}
+		else{
+			Location[0] = (uint8_t)(Half_Word & 0xFF);
+			Location[1] = (uint8_t)(Half_Word >> 8);
+			Sim_Time_Charge_Half_Word_Program(SIM_FLASH_BANK(Address), Posted);
+		}
+	}
+	return Flash_Status;
+}
+
+Sim_Flash_Status Sim_Flash_Erase_Page(uint32_t Page_Address){
+	Sim_Flash_Status Flash_Status = SIM_FLASH_OK;
+
+	/* Any address inside the page selects it, like FLASH_AR */
+	Page_Address &= ~((uint32_t)SIM_FLASH_PAGE_SIZE - 1);
+	if(!Sim_Is_Flash_Range(Page_Address, SIM_FLASH_PAGE_SIZE)){
+		Flash_Status = SIM_FLASH_ADDRESS_ERROR;
+	}
+	else if(Sim_Is_Write_Protected(Page_Address)){
+		Flash_Status = SIM_FLASH_WRPRTERR;
+	}
+	else{
+		memset(Sim_Flash_Rw(Page_Address), 0xFF, SIM_FLASH_PAGE_SIZE);
+		Sim_Time_Charge_Page_Erase(SIM_FLASH_BANK(Page_Address));
+	}
+	return Flash_Status;
+}
+
+Sim_Flash_Status Sim_Flash_Mass_Erase(void){
+	Sim_Flash_Status Flash_Status = SIM_FLASH_OK;
+	uint32_t Page_Address = 0;
+
+	/* The mass erase is refused as a whole when any page is write protected */
+	for(Page_Address = SIM_FLASH_BASE; Page_Address < (SIM_FLASH_BASE + SIM_FLASH_SIZE); Page_Address += SIM_FLASH_PAGE_SIZE){
+		if(Sim_Is_Write_Protected(Page_Address)){
+			Flash_Status = SIM_FLASH_WRPRTERR;
+		}
+	}
+	if(SIM_FLASH_OK == Flash_Status){
+		memset(Sim_Flash_Rw(SIM_FLASH_BASE), 0xFF, SIM_FLASH_SIZE);
+		Sim_Time_Charge_Mass_Erase();
+	}
+	return Flash_Status;
+}
+
+void Sim_OB_Set_RDP(uint8_t RDP_Level){
+	Sim_Option_Bytes *Option_Bytes = Sim_OB_Rw();
+
+	if((SIM_RDP_LEVEL_0 != Sim_OB_Get_RDP()) && (SIM_RDP_LEVEL_0 == RDP_Level)){
+		/* Leaving level 1 erases the whole flash, write protection included */
+		memset(Sim_Flash_Rw(SIM_FLASH_BASE), 0xFF, SIM_FLASH_SIZE);
+		Sim_Time_Charge_Mass_Erase();
+	}
+	/* Same as OPTER + OPTPG of the RDP byte: the other option bytes go back to their erased value */
+	memset(Option_Bytes, 0xFF, sizeof(Sim_Option_Bytes));
+	Option_Bytes->RDP = (uint16_t)(RDP_Level | ((uint16_t)(uint8_t)~RDP_Level << 8));
+}
+
+uint8_t Sim_OB_Get_RDP(void){
+	Sim_Option_Bytes *Option_Bytes = Sim_OB_Rw();
+	uint8_t RDP_Value = (uint8_t)(Option_Bytes->RDP & 0xFF);
+	uint8_t RDP_Complement = (uint8_t)(Option_Bytes->RDP >> 8);
+
+	/* A byte that does not match its complement loads as level 1 */
+	return ((SIM_RDP_LEVEL_0 == RDP_Value) && ((uint8_t)~RDP_Value == RDP_Complement)) ? SIM_RDP_LEVEL_0 : 0x00;
+}
+
+int Sim_Flash_Load(uint32_t Address, const char *Image_File_Name){
+	FILE *Image_File = fopen(Image_File_Name, "rb");
+	long Image_Size = 0;
+	int Status = -1;
+
+	if(NULL == Image_File){
+		perror("bl_sim: image");
+	}
+	else{
+		fseek(Image_File, 0, SEEK_END);
+		Image_Size = ftell(Image_File);
+		fseek(Image_File, 0, SEEK_SET);
+		if((Image_Size <= 0) || !Sim_Is_Flash_Range(Address, (uint32_t)Image_Size)){
+			fprintf(stderr, "bl_sim: %s does not fit in flash at 0x%08X\n", Image_File_Name, (unsigned)Address);
+		}
+		else if((size_t)Image_Size == fread(Sim_Flash_Rw(Address), 1, (size_t)Image_Size, Image_File)){
+			/* Programmed like a debug probe would, the erase and program rules do not apply */
+			Status = 0;
+		}
+		fclose(Image_File);
+	}
+	return Status;
+}
+
+/*****************************************Software Interface Implementation End*****************************************/
+
+
+/*****************************************Static Functions Implementation Start*****************************************/
+
+static uint8_t Sim_Is_Flash_Range(uint32_t Address, uint32_t Length){
+	return ((Address >= SIM_FLASH_BASE) && (Length <= SIM_FLASH_SIZE) && ((Address - SIM_FLASH_BASE) <= (SIM_FLASH_SIZE - Length))) ? 1 : 0;
+}
+
+static uint8_t Sim_Is_Write_Protected(uint32_t Address){
+	Sim_Option_Bytes *Option_Bytes = Sim_OB_Rw();
+	uint32_t WRP_Bits = (uint32_t)(Option_Bytes->WRP0 & 0xFF) | ((uint32_t)(Option_Bytes->WRP1 & 0xFF) << 8) |
+						((uint32_t)(Option_Bytes->WRP2 & 0xFF) << 16) | ((uint32_t)(Option_Bytes->WRP3 & 0xFF) << 24);
+	uint32_t WRP_Bit = ((Address - SIM_FLASH_BASE) / SIM_FLASH_PAGE_SIZE) / SIM_FLASH_PAGES_PER_WRP_BIT;
+
+	if(WRP_Bit >= SIM_FLASH_WRP_BITS){
+		/* High and XL density: WRP3 bit 7 protects every page after the first 62 */
+		WRP_Bit = SIM_FLASH_WRP_BITS - 1;
+	}
+
+	/* A cleared WRP bit protects its pages */
+	return (WRP_Bits & (1UL << WRP_Bit)) ? 0 : 1;
+}
+
+/*****************************************Static Functions Implementation End*****************************************/
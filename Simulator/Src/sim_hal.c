@@ -0,0 +1,70 @@
+/**
+ ******************************************************************************
+ * @file           : sim_hal.c
+ * @author         : Ahmed Naeim
+ * @brief          : Simulated HAL handles and core register functions used
+ *                   directly by the bootloader sources
+ ******************************************************************************
+**/
+
+#include "main.h"
+#include "usart.h"
+#include "crc.h"
+
+
+
+/*****************************************Global Variables Start*****************************************/
+
+UART_HandleTypeDef huart2 = {&Sim_Host_UART};
+UART_HandleTypeDef huart3 = {&Sim_Debug_UART};
+CRC_HandleTypeDef hcrc = {0};
+
+uint32_t Sim_MSP = 0;										/* Last value written to the main stack pointer */
+static uint32_t Sim_PRIMASK = 0;
+
+/*****************************************Global Variables End*****************************************/
+
+
+/*****************************************Software Interface Implementation Start*****************************************/
+
+void __set_MSP(uint32_t topOfMainStack){
+	/* The host stack stays in use, the value is reported when the target jumps */
+	Sim_MSP = topOfMainStack;
+}
+
+uint32_t __get_PRIMASK(void){
+	return Sim_PRIMASK;
+}
+
+void __set_PRIMASK(uint32_t priMask){
+	Sim_PRIMASK = priMask;
+}
+
+void __disable_irq(void){
+	Sim_PRIMASK = 1;
+}
+
+void __DSB(void){
+	/* One core and no write buffer to drain in the simulation */
+}
+
+void __ISB(void){
+	/* No pipeline to flush in the simulation */
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size){
+	Sim_UART_Transmit(huart->Instance, pData, Size);
+	/* The completion interrupt fires once the caller has recorded the transfer */
+	HAL_UART_TxCpltCallback(huart);
+	return HAL_OK;
+}
+
+__weak void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart){
+	(void)huart;
+}
+
+void Error_Handler(void){
+	Sim_Reset();
+}
+
+/*****************************************Software Interface Implementation End*****************************************/
@@ -0,0 +1,270 @@
+/**
+ ******************************************************************************
+ * @file           : sim_main.c
+ * @author         : Ahmed Naeim
+ * @brief          : bl_sim entry point. The supervisor owns the pseudo
+ *                   terminals and the flash, the simulated target runs the
+ *                   bootloader in a child process that is restarted on every
+ *                   reset, so RAM starts over and flash is kept. A call into
+ *                   the stub window of CBL_LOAD_AND_EXEC_CMD returns its
+ *                   first argument: Thumb code does not run on the host
+ ******************************************************************************
+**/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <ucontext.h>
+#include <sys/wait.h>
+#include "Bootloader/bootloader.h"
+
+
+
+/*****************************************Macro Declaration Start*****************************************/
+
+#define SIM_USAGE								"Usage: bl_sim [--flash FILE] [--image FILE.bin] [--link PATH] [--log-link PATH] [--exit-on-jump]\n" \
+												"              [--timing typical|worst] [--baud RATE] [--trace] [--device medium|high|xl]\n" \
+												"       bl_sim --bench-sha256\n" \
+												"       bl_sim --bench-ecdsa\n"
+
+/*****************************************Macro Declaration End*****************************************/
+
+
+
+/*****************************************Global Variables Start*****************************************/
+
+static volatile sig_atomic_t Sim_Stop = 0;
+static volatile pid_t Sim_Target_Pid = 0;
+
+/*****************************************Global Variables End*****************************************/
+
+
+
+/*****************************************Static Functions Declarations Start*****************************************/
+
+static void Sim_Target_Main(void);
+static void Sim_Fault_Handler(int Signal, siginfo_t *Info, void *Context);
+static uintptr_t Sim_Fault_Program_Counter(void *Context);
+static void Sim_Return_From_Stub(void *Context);
+static void Sim_Stop_Handler(int Signal);
+
+/*****************************************Static Functions Declarations End*****************************************/
+
+
+/*****************************************Software Interface Implementation Start*****************************************/
+
+int main(int argc, char *argv[]){
+	const char *Flash_File_Name = NULL;
+	const char *Image_File_Name = NULL;
+	const char *Host_Link_Name = NULL;
+	const char *Log_Link_Name = NULL;
+	uint8_t Exit_On_Jump = 0;
+	Sim_Timing_Corner Timing_Corner = SIM_TIMING_TYPICAL;
+	uint32_t Baud_Rate = SIM_UART_DEFAULT_BAUD_RATE;
+	uint8_t Trace = 0;
+	const Sim_Device *Device = Sim_Target_Device;
+	int Arg_Counter = 0;
+	int Exit_Status = EXIT_FAILURE;
+	int Child_Status = 0;
+	pid_t Target = 0;
+
+	for(Arg_Counter = 1; Arg_Counter < argc; Arg_Counter++){
+		if((0 == strcmp(argv[Arg_Counter], "--flash")) && ((Arg_Counter + 1) < argc)){
+			Flash_File_Name = argv[++Arg_Counter];
+		}
+		else if((0 == strcmp(argv[Arg_Counter], "--image")) && ((Arg_Counter + 1) < argc)){
+			Image_File_Name = argv[++Arg_Counter];
+		}
+		else if((0 == strcmp(argv[Arg_Counter], "--link")) && ((Arg_Counter + 1) < argc)){
+			Host_Link_Name = argv[++Arg_Counter];
+		}
+		else if((0 == strcmp(argv[Arg_Counter], "--log-link")) && ((Arg_Counter + 1) < argc)){
+			Log_Link_Name = argv[++Arg_Counter];
+		}
+		else if(0 == strcmp(argv[Arg_Counter], "--exit-on-jump")){
+			Exit_On_Jump = 1;
+		}
+		else if((0 == strcmp(argv[Arg_Counter], "--timing")) && ((Arg_Counter + 1) < argc)){
+			Timing_Corner = (0 == strcmp(argv[++Arg_Counter], "worst")) ? SIM_TIMING_WORST_CASE : SIM_TIMING_TYPICAL;
+		}
+		else if((0 == strcmp(argv[Arg_Counter], "--baud")) && ((Arg_Counter + 1) < argc)){
+			Baud_Rate = (uint32_t)strtoul(argv[++Arg_Counter], NULL, 0);
+		}
+		else if(0 == strcmp(argv[Arg_Counter], "--trace")){
+			Trace = 1;
+		}
+		else if(0 == strcmp(argv[Arg_Counter], "--bench-sha256")){
+			/* Runs on the host alone, no target is started */
+			return (0 == Sim_Bench_SHA256()) ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+		else if(0 == strcmp(argv[Arg_Counter], "--bench-ecdsa")){
+			return (0 == Sim_Bench_ECDSA()) ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+		else if((0 == strcmp(argv[Arg_Counter], "--device")) && ((Arg_Counter + 1) < argc) && (NULL != Sim_Device_Find(argv[Arg_Counter + 1]))){
+			/* Flash geometry and ID code of another F1 line, link the bootloader with a layout for it (make LAYOUT=...) */
+			Device = Sim_Device_Find(argv[++Arg_Counter]);
+		}
+		else{
+			fputs(SIM_USAGE, stderr);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if((0 != Sim_Memory_Init(Flash_File_Name, Device)) || (0 != Sim_Time_Init(Timing_Corner, Baud_Rate, Trace)) ||
+	   ((NULL != Image_File_Name) && (0 != Sim_Flash_Load(BL_APP_BASE_ADDRESS, Image_File_Name))) ||
+	   (0 != Sim_UART_Open(&Sim_Host_UART, Host_Link_Name, 0)) ||
+	   (0 != Sim_UART_Open(&Sim_Debug_UART, Log_Link_Name, 1))){
+		return EXIT_FAILURE;
+	}
+	printf("bl_sim: host UART %s at %u baud, debug UART %s, application base 0x%08X, %s flash timings\n",
+		   (NULL != Host_Link_Name) ? Host_Link_Name : Sim_Host_UART.Slave_Name, (unsigned)Baud_Rate,
+		   (NULL != Log_Link_Name) ? Log_Link_Name : Sim_Debug_UART.Slave_Name, (unsigned)BL_APP_BASE_ADDRESS,
+		   (SIM_TIMING_WORST_CASE == Timing_Corner) ? "worst case" : "typical");
+	printf("bl_sim: %s density device, %u KB flash in %u byte pages\n", Device->Name, (unsigned)(Device->Flash_Size / 1024), (unsigned)Device->Page_Size);
+	fflush(stdout);
+
+	signal(SIGINT, Sim_Stop_Handler);
+	signal(SIGTERM, Sim_Stop_Handler);
+
+	while(!Sim_Stop){
+		Target = fork();
+		Sim_Target_Pid = Target;
+		if(0 == Target){
+			signal(SIGINT, SIG_DFL);
+			signal(SIGTERM, SIG_DFL);
+			Sim_Target_Main();
+		}
+		else if((Target < 0) || (waitpid(Target, &Child_Status, 0) < 0)){
+			Sim_Stop = 1;
+		}
+		else{
+			/* Whatever ended the target, the command it was running is over */
+			Sim_Time_End_Command();
+			if(WIFEXITED(Child_Status) && (SIM_EXIT_RESET == WEXITSTATUS(Child_Status))){
+				printf("bl_sim: reset\n");
+			}
+			else if(WIFEXITED(Child_Status) && (SIM_EXIT_JUMP == WEXITSTATUS(Child_Status))){
+				/* The update ends with the jump: report its simulated time. The application is not simulated,
+				 * the target comes back through a reset */
+				Sim_Time_Report();
+				if(Exit_On_Jump){
+					Exit_Status = EXIT_SUCCESS;
+					Sim_Stop = 1;
+				}
+			}
+			else{
+				if(WIFSIGNALED(Child_Status) && !Sim_Stop){
+					fprintf(stderr, "bl_sim: target stopped by signal %d\n", WTERMSIG(Child_Status));
+				}
+				else if(Sim_Stop){
+					Exit_Status = EXIT_SUCCESS;
+				}
+				Sim_Stop = 1;
+			}
+		}
+		fflush(stdout);
+	}
+
+	if(!Exit_On_Jump){
+		Sim_Time_Report();
+	}
+	Sim_UART_Close(&Sim_Host_UART);
+	Sim_UART_Close(&Sim_Debug_UART);
+	return Exit_Status;
+}
+
+void Sim_Reset(void){
+	fflush(stdout);
+	_exit(SIM_EXIT_RESET);
+}
+
+/*****************************************Software Interface Implementation End*****************************************/
+
+
+/*****************************************Static Functions Implementation Start*****************************************/
+
+static void Sim_Target_Main(void){
+	struct sigaction Fault_Action;
+
+	/* A jump into target memory faults on the host, the handler reports it as the end of the bootloader */
+	memset(&Fault_Action, 0, sizeof(Fault_Action));
+	Fault_Action.sa_sigaction = Sim_Fault_Handler;
+	Fault_Action.sa_flags = SA_SIGINFO;
+	sigaction(SIGSEGV, &Fault_Action, NULL);
+	sigaction(SIGBUS, &Fault_Action, NULL);
+
+	BL_Flash_Geometry_Init();
+	BL_Stats_Init();
+	BL_LOG_INFO(SYS, BL_LOG_ID_BOOTLOADER_STARTED);
+
+	while(1){
+		BL_UART_Featch_Host_Command();
+	}
+}
+
+static void Sim_Fault_Handler(int Signal, siginfo_t *Info, void *Context){
+	uintptr_t Fault_Address = (uintptr_t)Info->si_addr;
+	char Message[96];
+	int Message_Len = 0;
+
+	if((Fault_Address == Sim_Fault_Program_Counter(Context)) && (Fault_Address >= BL_STUB_BASE_ADDRESS) && (Fault_Address < STM32F103_SRAM_END)){
+		/* Call of a CBL_LOAD_AND_EXEC_CMD stub: back to the bootloader as if the stub returned Arg0 */
+		Message_Len = snprintf(Message, sizeof(Message), "bl_sim: stub call 0x%08lX\n", (unsigned long)Fault_Address);
+		if(Message_Len > 0){
+			write(STDOUT_FILENO, Message, (size_t)Message_Len);
+		}
+		Sim_Return_From_Stub(Context);
+		return;
+	}
+	if((Fault_Address == Sim_Fault_Program_Counter(Context)) && (Fault_Address <= 0xFFFFFFFFUL)){
+		/* Instruction fetch from a 32 bit target address: the bootloader handed over the CPU */
+		Message_Len = snprintf(Message, sizeof(Message), "bl_sim: jump to 0x%08lX, MSP 0x%08lX\n",
+							   (unsigned long)Fault_Address, (unsigned long)Sim_MSP);
+		if(Message_Len > 0){
+			write(STDOUT_FILENO, Message, (size_t)Message_Len);
+		}
+		_exit(SIM_EXIT_JUMP);
+	}
+	/* A real fault of the simulated bootloader, let it crash */
+	signal(Signal, SIG_DFL);
+}
+
+static uintptr_t Sim_Fault_Program_Counter(void *Context){
+	uintptr_t Program_Counter = 0;
+#if defined(__x86_64__)
+	Program_Counter = (uintptr_t)((ucontext_t *)Context)->uc_mcontext.gregs[REG_RIP];
+#elif defined(__aarch64__)
+	Program_Counter = (uintptr_t)((ucontext_t *)Context)->uc_mcontext.pc;
+#else
+#error "bl_sim: add the program counter of this host architecture"
+#endif
+	return Program_Counter;
+}
+
+static void Sim_Return_From_Stub(void *Context){
+	mcontext_t *Machine_Context = &((ucontext_t *)Context)->uc_mcontext;
+#if defined(__x86_64__)
+	/* The call pushed the return address, the result goes where Arg0 came from */
+	Machine_Context->gregs[REG_RIP] = *(greg_t *)Machine_Context->gregs[REG_RSP];
+	Machine_Context->gregs[REG_RSP] += sizeof(greg_t);
+	Machine_Context->gregs[REG_RAX] = Machine_Context->gregs[REG_RDI];
+#elif defined(__aarch64__)
+	/* Arg0 and the result share x0 */
+	Machine_Context->pc = Machine_Context->regs[30];
+#else
+#error "bl_sim: add the return sequence of this host architecture"
+#endif
+}
+
+static void Sim_Stop_Handler(int Signal){
+	Sim_Stop = 1;
+	/* The target does not share the handler, stop it so the supervisor gets out of waitpid */
+	if(Sim_Target_Pid > 0){
+		kill(Sim_Target_Pid, Signal);
+	}
+}
+
+/*****************************************Static Functions Implementation End*****************************************/
@@ -0,0 +1,207 @@
+/**
+ ******************************************************************************
+ * @file           : sim_memory.c
+ * @author         : Ahmed Naeim
+ * @brief          : Maps the simulated flash, option bytes, SRAM, DBGMCU, DWT
+ *                   and CoreDebug at their STM32F103 addresses, for the
+ *                   flash geometry of the simulated device line
+ ******************************************************************************
+**/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "sim.h"
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE						0x100000
+#endif
+
+
+
+/*****************************************Macro Declaration Start*****************************************/
+
+/* Backing store layout: the flash, then the host page that holds the option bytes */
+#define SIM_STORE_FLASH_OFFSET					0
+#define SIM_STORE_OB_OFFSET						SIM_FLASH_SIZE
+#define SIM_STORE_SIZE							(SIM_FLASH_SIZE + SIM_OB_PAGE_SIZE)
+
+#define SIM_DBGMCU_PAGE_SIZE					4096
+#define SIM_DEVICE_COUNT						(sizeof(Sim_Devices) / sizeof(Sim_Devices[0]))
+
+/*****************************************Macro Declaration End*****************************************/
+
+
+
+/*****************************************Global Variables Start*****************************************/
+
+static uint8_t *Sim_Flash_Alias = NULL;					/* Writable view of the flash, used by the flash model only */
+static uint8_t *Sim_OB_Page_Alias = NULL;
+
+/* The first one is the default, the STM32F103C8 of the board */
+static const Sim_Device Sim_Devices[] = {
+	{"medium",	0x20036410UL,	64 * 1024,		1024,	4,	64 * 1024},		/* Medium density, revision X */
+	{"high",	0x10036414UL,	512 * 1024,		2048,	2,	512 * 1024},	/* High density, revision Y (STM32F103ZE) */
+	{"xl",		0x10006430UL,	1024 * 1024,	2048,	2,	512 * 1024}		/* XL density, revision A (STM32F103ZG), two 512 KB banks */
+};
+
+const Sim_Device *Sim_Target_Device = &Sim_Devices[0];
+
+/*****************************************Global Variables End*****************************************/
+
+
+
+/*****************************************Static Functions Declarations Start*****************************************/
+
+static void *Sim_Map_Fixed(uint32_t Address, size_t Length, int Protection, int Flags, int Fd, off_t Offset);
+static int Sim_Store_Open(const char *Flash_File_Name);
+
+/*****************************************Static Functions Declarations End*****************************************/
+
+
+/*****************************************Software Interface Implementation Start*****************************************/
+
+const Sim_Device *Sim_Device_Find(const char *Device_Name){
+	const Sim_Device *Device = NULL;
+	uint32_t Device_Index = 0;
+
+	for(Device_Index = 0; Device_Index < SIM_DEVICE_COUNT; Device_Index++){
+		if(0 == strcmp(Sim_Devices[Device_Index].Name, Device_Name)){
+			Device = &Sim_Devices[Device_Index];
+		}
+	}
+	return Device;
+}
+
+int Sim_Memory_Init(const char *Flash_File_Name, const Sim_Device *Device){
+	int Store_Fd = -1;
+	uint32_t *DBGMCU_Page = NULL;
+	void *DWT_Page = NULL;
+	void *Core_Debug_Page = NULL;
+	uint16_t Flash_Size_KB = 0;
+	int Status = -1;
+
+	Sim_Target_Device = Device;
+	Store_Fd = Sim_Store_Open(Flash_File_Name);
+	if(Store_Fd >= 0){
+		Sim_Flash_Alias = mmap(NULL, SIM_STORE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, Store_Fd, 0);
+		if(MAP_FAILED == Sim_Flash_Alias){
+			Sim_Flash_Alias = NULL;
+		}
+	}
+	if(NULL != Sim_Flash_Alias){
+		Sim_OB_Page_Alias = Sim_Flash_Alias + SIM_STORE_OB_OFFSET;
+		/* The bootloader reads flash and option bytes through plain pointers, writing them directly faults like a bus error */
+		if((NULL != Sim_Map_Fixed(SIM_FLASH_BASE, SIM_FLASH_SIZE, PROT_READ, MAP_SHARED, Store_Fd, SIM_STORE_FLASH_OFFSET)) &&
+		   (NULL != Sim_Map_Fixed(SIM_OB_PAGE_BASE, SIM_OB_PAGE_SIZE, PROT_READ, MAP_SHARED, Store_Fd, SIM_STORE_OB_OFFSET)) &&
+		   (NULL != Sim_Map_Fixed(SIM_SRAM_BASE, SIM_SRAM_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0))){
+			DBGMCU_Page = Sim_Map_Fixed(SIM_DBGMCU_BASE, SIM_DBGMCU_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		}
+	}
+	if(NULL != DBGMCU_Page){
+		/* Shared like the simulated time, CYCCNT keeps counting across target resets */
+		DWT_Page = Sim_Map_Fixed(SIM_DWT_BASE & ~(SIM_SCS_PAGE_SIZE - 1UL), SIM_SCS_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	}
+	if(NULL != DWT_Page){
+		Core_Debug_Page = Sim_Map_Fixed(SIM_CORE_DEBUG_BASE & ~(SIM_SCS_PAGE_SIZE - 1UL), SIM_SCS_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	}
+	if(NULL != Core_Debug_Page){
+		DBGMCU_Page[0] = Sim_Target_Device->IDCODE;
+		/* Written by ST at the factory, the store keeps it only for the device it was made for */
+		Flash_Size_KB = (uint16_t)(Sim_Target_Device->Flash_Size / 1024);
+		memcpy(Sim_OB_Page_Alias + (SIM_FLASH_SIZE_REGISTER - SIM_OB_PAGE_BASE), &Flash_Size_KB, sizeof(Flash_Size_KB));
+		Status = 0;
+	}
+	if(Store_Fd >= 0){
+		close(Store_Fd);
+	}
+	return Status;
+}
+
+uint8_t *Sim_Flash_Rw(uint32_t Address){
+	return Sim_Flash_Alias + (Address - SIM_FLASH_BASE);
+}
+
+Sim_Option_Bytes *Sim_OB_Rw(void){
+	return (Sim_Option_Bytes *)(Sim_OB_Page_Alias + (SIM_OB_BASE - SIM_OB_PAGE_BASE));
+}
+
+uint8_t Sim_Is_SRAM_Range(uint32_t Address, uint32_t Length){
+	return ((Address >= SIM_SRAM_BASE) && (Length <= SIM_SRAM_SIZE) && ((Address - SIM_SRAM_BASE) <= (SIM_SRAM_SIZE - Length))) ? 1 : 0;
+}
+
+volatile uint32_t *Sim_Cycle_Counter(void){
+	return &((volatile uint32_t *)SIM_DWT_BASE)[1];
+}
+
+/*****************************************Software Interface Implementation End*****************************************/
+
+
+/*****************************************Static Functions Implementation Start*****************************************/
+
+static void *Sim_Map_Fixed(uint32_t Address, size_t Length, int Protection, int Flags, int Fd, off_t Offset){
+	void *Mapping = mmap((void *)(uintptr_t)Address, Length, Protection, Flags | MAP_FIXED_NOREPLACE, Fd, Offset);
+
+	if(MAP_FAILED == Mapping){
+		perror("bl_sim: mmap");
+		Mapping = NULL;
+	}
+	else if((void *)(uintptr_t)Address != Mapping){
+		/* Kernels before 4.17 ignore MAP_FIXED_NOREPLACE and treat the address as a hint */
+		fprintf(stderr, "bl_sim: 0x%08X is not available in this process\n", (unsigned)Address);
+		munmap(Mapping, Length);
+		Mapping = NULL;
+	}
+	return Mapping;
+}
+
+static int Sim_Store_Open(const char *Flash_File_Name){
+	static const Sim_Option_Bytes Factory_Option_Bytes = {
+		0x5AA5,												/* RDP level 0 */
+		0x00FF, 0x00FF, 0x00FF,
+		0x00FF, 0x00FF, 0x00FF, 0x00FF						/* No write protection */
+	};
+	struct stat Store_Stat;
+	uint32_t Unique_ID[3] = {0};
+	uint8_t Erased[SIM_OB_PAGE_SIZE];
+	uint32_t Offset = 0;
+	int Store_Fd = -1;
+
+	if(NULL == Flash_File_Name){
+		/* Volatile flash, lost when the simulator exits but kept across target resets */
+		Store_Fd = memfd_create("bl_sim_flash", 0);
+	}
+	else{
+		Store_Fd = open(Flash_File_Name, O_RDWR | O_CREAT, 0644);
+	}
+	if(Store_Fd < 0){
+		perror("bl_sim: flash store");
+	}
+	else if((0 == fstat(Store_Fd, &Store_Stat)) && (SIM_STORE_SIZE == Store_Stat.st_size)){
+		/* Existing flash image, keep its content. A store of another device size starts over as a new part */
+	}
+	else{
+		/* New part: erased flash and factory option bytes */
+		memset(Erased, 0xFF, sizeof(Erased));
+		for(Offset = 0; Offset < SIM_STORE_SIZE; Offset += sizeof(Erased)){
+			if(sizeof(Erased) != pwrite(Store_Fd, Erased, sizeof(Erased), Offset)){
+				perror("bl_sim: flash store");
+			}
+		}
+		pwrite(Store_Fd, &Factory_Option_Bytes, sizeof(Factory_Option_Bytes), SIM_STORE_OB_OFFSET + (SIM_OB_BASE - SIM_OB_PAGE_BASE));
+		/* Every new flash store is another part, it gets its own device ID */
+		Unique_ID[0] = (uint32_t)getpid();
+		Unique_ID[1] = (uint32_t)time(NULL);
+		Unique_ID[2] = (uint32_t)clock();
+		pwrite(Store_Fd, Unique_ID, sizeof(Unique_ID), SIM_STORE_OB_OFFSET + (SIM_UID_BASE - SIM_OB_PAGE_BASE));
+		ftruncate(Store_Fd, SIM_STORE_SIZE);
+	}
+	return Store_Fd;
+}
+
+/*****************************************Static Functions Implementation End*****************************************/
@@ -0,0 +1,208 @@
+/**
+ ******************************************************************************
+ * @file           : sim_time.c
+ * @author         : Ahmed Naeim
+ * @brief          : Simulated time of the target. The flash and UART models
+ *                   charge their STM32F103 costs to a virtual clock, split per
+ *                   host command, and the supervisor reports it as the
+ *                   predicted wall-clock time of an update. Each flash bank
+ *                   has its own busy time: the CPU waits for a bank 1
+ *                   operation, a posted bank 2 one runs next to it
+ ******************************************************************************
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "sim.h"
+
+
+
+/*****************************************Data Types Declaration Start*****************************************/
+
+typedef struct{
+	uint64_t Half_Word_Program_Ns;
+	uint64_t Page_Erase_Ns;
+	uint64_t Mass_Erase_Ns;
+}Sim_Flash_Timing;
+
+typedef struct{
+	uint32_t Count;
+	uint64_t Cost_Ns[SIM_COST_KINDS];
+}Sim_Command_Time;
+
+/* Shared with the supervisor, so the time of a target survives its resets */
+typedef struct{
+	uint64_t Now_Ns;
+	uint64_t Uart_Byte_Ns;
+	Sim_Timing_Corner Corner;
+	uint8_t Trace;												/* Print the time of every command when it ends */
+	uint8_t Command_Active;
+	uint8_t Command_Code;
+	uint64_t Command_Start_Ns;
+	uint64_t Bank_Busy_Until_Ns[SIM_FLASH_BANKS];				/* End of the last operation started on the bank */
+	Sim_Command_Time Command[256];
+}Sim_Clock;
+
+/*****************************************Data Types Declaration End*****************************************/
+
+
+
+/*****************************************Global Variables Start*****************************************/
+
+/* STM32F103 datasheet, flash memory characteristics: tPROG, tERASE and tME */
+static const Sim_Flash_Timing Sim_Flash_Timing_Table[SIM_TIMING_CORNERS] = {
+	[SIM_TIMING_TYPICAL]	= {52000, 20000000, 40000000},
+	[SIM_TIMING_WORST_CASE]	= {70000, 40000000, 40000000}
+};
+
+static const char *const Sim_Cost_Names[SIM_COST_KINDS] = {
+	[SIM_COST_UART_RX]	= "uart_rx_us",
+	[SIM_COST_UART_TX]	= "uart_tx_us",
+	[SIM_COST_PROGRAM]	= "program_us",
+	[SIM_COST_ERASE]	= "erase_us"
+};
+
+static Sim_Clock *Sim_Time = NULL;
+
+/*****************************************Global Variables End*****************************************/
+
+
+
+/*****************************************Static Functions Declarations Start*****************************************/
+
+static void Sim_Time_Charge(Sim_Cost_Kind Kind, uint64_t Cost_Ns);
+static void Sim_Time_Charge_Bank(uint8_t Bank, Sim_Cost_Kind Kind, uint64_t Cost_Ns, uint8_t Posted);
+static void Sim_Time_Print(const char *Name, const Sim_Command_Time *Command_Time);
+
+/*****************************************Static Functions Declarations End*****************************************/
+
+
+/*****************************************Software Interface Implementation Start*****************************************/
+
+int Sim_Time_Init(Sim_Timing_Corner Corner, uint32_t Baud_Rate, uint8_t Trace){
+	int Status = -1;
+
+	Sim_Time = mmap(NULL, sizeof(Sim_Clock), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if((MAP_FAILED != Sim_Time) && (Baud_Rate > 0)){
+		memset(Sim_Time, 0, sizeof(Sim_Clock));
+		Sim_Time->Corner = Corner;
+		Sim_Time->Trace = Trace;
+		Sim_Time->Uart_Byte_Ns = (SIM_UART_BITS_PER_BYTE * 1000000000ULL) / Baud_Rate;
+		Status = 0;
+	}
+	else{
+		perror("bl_sim: clock");
+		Sim_Time = NULL;
+	}
+	return Status;
+}
+
+void Sim_Time_Start_Command(uint8_t Command_Code){
+	/* The host sends a command once it has the reply of the previous one */
+	Sim_Time_End_Command();
+	Sim_Time->Command_Active = 1;
+	Sim_Time->Command_Code = Command_Code;
+	Sim_Time->Command_Start_Ns = Sim_Time->Now_Ns;
+	Sim_Time->Command[Command_Code].Count++;
+}
+
+void Sim_Time_End_Command(void){
+	if(Sim_Time->Command_Active && Sim_Time->Trace){
+		printf("bl_sim: trace 0x%02X us %llu\n", Sim_Time->Command_Code,
+			   (unsigned long long)((Sim_Time->Now_Ns - Sim_Time->Command_Start_Ns) / 1000));
+		fflush(stdout);
+	}
+	Sim_Time->Command_Active = 0;
+}
+
+void Sim_Time_Charge_Uart(Sim_Cost_Kind Kind, uint32_t Bytes){
+	Sim_Time_Charge(Kind, Sim_Time->Uart_Byte_Ns * Bytes);
+}
+
+void Sim_Time_Charge_Half_Word_Program(uint8_t Bank, uint8_t Posted){
+	Sim_Time_Charge_Bank(Bank, SIM_COST_PROGRAM, Sim_Flash_Timing_Table[Sim_Time->Corner].Half_Word_Program_Ns, Posted);
+}
+
+void Sim_Time_Charge_Page_Erase(uint8_t Bank){
+	Sim_Time_Charge_Bank(Bank, SIM_COST_ERASE, Sim_Flash_Timing_Table[Sim_Time->Corner].Page_Erase_Ns, 0);
+}
+
+void Sim_Time_Charge_Mass_Erase(void){
+	/* Both controllers erase at the same time, the CPU waits for the slower one */
+	Sim_Time_Wait_Bank(1);
+	Sim_Time_Charge_Bank(0, SIM_COST_ERASE, Sim_Flash_Timing_Table[Sim_Time->Corner].Mass_Erase_Ns, 0);
+	Sim_Time->Bank_Busy_Until_Ns[1] = Sim_Time->Now_Ns;
+}
+
+void Sim_Time_Wait_Bank(uint8_t Bank){
+	/* The CPU polls BSY: the rest of the posted work is charged as programming time of the waiting command */
+	if(Sim_Time->Bank_Busy_Until_Ns[Bank] > Sim_Time->Now_Ns){
+		Sim_Time_Charge(SIM_COST_PROGRAM, Sim_Time->Bank_Busy_Until_Ns[Bank] - Sim_Time->Now_Ns);
+	}
+}
+
+uint64_t Sim_Time_Now_Ns(void){
+	return Sim_Time->Now_Ns;
+}
+
+void Sim_Time_Report(void){
+	Sim_Command_Time Total;
+	uint16_t Command_Code = 0;
+	uint8_t Kind = 0;
+	char Name[8];
+
+	memset(&Total, 0, sizeof(Total));
+	for(Command_Code = 0; Command_Code < 256; Command_Code++){
+		if(Sim_Time->Command[Command_Code].Count){
+			snprintf(Name, sizeof(Name), "0x%02X", Command_Code);
+			Sim_Time_Print(Name, &Sim_Time->Command[Command_Code]);
+			Total.Count += Sim_Time->Command[Command_Code].Count;
+			for(Kind = 0; Kind < SIM_COST_KINDS; Kind++){
+				Total.Cost_Ns[Kind] += Sim_Time->Command[Command_Code].Cost_Ns[Kind];
+			}
+		}
+	}
+	Sim_Time_Print("total", &Total);
+	fflush(stdout);
+}
+
+/*****************************************Software Interface Implementation End*****************************************/
+
+
+/*****************************************Static Functions Implementation Start*****************************************/
+
+static void Sim_Time_Charge(Sim_Cost_Kind Kind, uint64_t Cost_Ns){
+	Sim_Time->Now_Ns += Cost_Ns;
+	Sim_Time->Command[Sim_Time->Command_Code].Cost_Ns[Kind] += Cost_Ns;
+	/* The bootloader reads DWT->CYCCNT around the operations that are charged here */
+	*Sim_Cycle_Counter() = (uint32_t)((Sim_Time->Now_Ns * (SIM_CORE_CLOCK_HZ / 1000000ULL)) / 1000ULL);
+}
+
+static void Sim_Time_Charge_Bank(uint8_t Bank, Sim_Cost_Kind Kind, uint64_t Cost_Ns, uint8_t Posted){
+	/* A bank runs one operation at a time, the next one starts when the previous one is over */
+	if(Posted){
+		/* The port feeds the next half-word from its receive loop as soon as the controller is idle, the CPU goes on */
+		Sim_Time->Bank_Busy_Until_Ns[Bank] = ((Sim_Time->Bank_Busy_Until_Ns[Bank] > Sim_Time->Now_Ns) ?
+											  Sim_Time->Bank_Busy_Until_Ns[Bank] : Sim_Time->Now_Ns) + Cost_Ns;
+	}
+	else{
+		Sim_Time_Wait_Bank(Bank);
+		Sim_Time_Charge(Kind, Cost_Ns);
+		Sim_Time->Bank_Busy_Until_Ns[Bank] = Sim_Time->Now_Ns;
+	}
+}
+
+static void Sim_Time_Print(const char *Name, const Sim_Command_Time *Command_Time){
+	uint64_t Total_Ns = 0;
+	uint8_t Kind = 0;
+
+	printf("bl_sim: time %s count %u", Name, (unsigned)Command_Time->Count);
+	for(Kind = 0; Kind < SIM_COST_KINDS; Kind++){
+		printf(" %s %llu", Sim_Cost_Names[Kind], (unsigned long long)(Command_Time->Cost_Ns[Kind] / 1000));
+		Total_Ns += Command_Time->Cost_Ns[Kind];
+	}
+	printf(" total_us %llu\n", (unsigned long long)(Total_Ns / 1000));
+}
+
+/*****************************************Static Functions Implementation End*****************************************/
@@ -0,0 +1,134 @@
+/**
+ ******************************************************************************
+ * @file           : sim_uart.c
+ * @author         : Ahmed Naeim
+ * @brief          : UART model on a pseudo terminal, Host.py (pyserial) opens
+ *                   the slave side like a USB to serial adapter
+ ******************************************************************************
+**/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <termios.h>
+#include "sim.h"
+
+
+
+/*****************************************Global Variables Start*****************************************/
+
+Sim_UART Sim_Host_UART = {-1, -1, {0}, NULL, 0};			/* USART2, host protocol */
+Sim_UART Sim_Debug_UART = {-1, -1, {0}, NULL, 0};			/* USART3, tokenized log */
+
+/*****************************************Global Variables End*****************************************/
+
+
+/*****************************************Software Interface Implementation Start*****************************************/
+
+int Sim_UART_Open(Sim_UART *Uart, const char *Link_Name, uint8_t Drop_When_Full){
+	struct termios Line_Settings;
+	int Status = -1;
+
+	Uart->Link_Name = Link_Name;
+	Uart->Drop_When_Full = Drop_When_Full;
+	Uart->Master_Fd = posix_openpt(O_RDWR | O_NOCTTY);
+	if((Uart->Master_Fd >= 0) && (0 == grantpt(Uart->Master_Fd)) && (0 == unlockpt(Uart->Master_Fd)) &&
+	   (0 == ptsname_r(Uart->Master_Fd, Uart->Slave_Name, sizeof(Uart->Slave_Name)))){
+		Uart->Slave_Fd = open(Uart->Slave_Name, O_RDWR | O_NOCTTY);
+	}
+	if(Uart->Slave_Fd >= 0){
+		/* Raw 8 bit line, no echo and no line editing between the host and the target */
+		tcgetattr(Uart->Slave_Fd, &Line_Settings);
+		cfmakeraw(&Line_Settings);
+		tcsetattr(Uart->Slave_Fd, TCSANOW, &Line_Settings);
+		if(Drop_When_Full){
+			fcntl(Uart->Master_Fd, F_SETFL, fcntl(Uart->Master_Fd, F_GETFL) | O_NONBLOCK);
+		}
+		Status = 0;
+		if(NULL != Link_Name){
+			unlink(Link_Name);
+			if(0 != symlink(Uart->Slave_Name, Link_Name)){
+				perror("bl_sim: link");
+				Status = -1;
+			}
+		}
+	}
+	else{
+		perror("bl_sim: pseudo terminal");
+	}
+	return Status;
+}
+
+void Sim_UART_Close(Sim_UART *Uart){
+	if(NULL != Uart->Link_Name){
+		unlink(Uart->Link_Name);
+	}
+}
+
+int Sim_UART_Receive(Sim_UART *Uart, uint8_t *Data, uint16_t Data_Len, int32_t Timeout_Ms){
+	struct pollfd Poll_Fd = {Uart->Master_Fd, POLLIN, 0};
+	struct timespec Now;
+	int64_t Deadline_Ms = 0;
+	int64_t Wait_Ms = 0;
+	uint16_t Received = 0;
+	ssize_t Read_Length = 0;
+	int Poll_Status = 1;
+	int Status = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &Now);
+	Deadline_Ms = ((int64_t)Now.tv_sec * 1000) + (Now.tv_nsec / 1000000) + Timeout_Ms;
+	while((Received < Data_Len) && (0 == Status)){
+		if(Timeout_Ms >= 0){
+			/* Wall-clock time: the host gaps are real, the simulated clock only runs for the target */
+			clock_gettime(CLOCK_MONOTONIC, &Now);
+			Wait_Ms = Deadline_Ms - (((int64_t)Now.tv_sec * 1000) + (Now.tv_nsec / 1000000));
+			Poll_Status = (Wait_Ms < 0) ? 0 : poll(&Poll_Fd, 1, (int)Wait_Ms);
+		}
+		if(0 == Poll_Status){
+			Status = SIM_UART_TIMEOUT;
+		}
+		else if(Poll_Status < 0){
+			/* Interrupted, wait again */
+		}
+		else{
+			Read_Length = read(Uart->Master_Fd, &Data[Received], Data_Len - Received);
+			if(Read_Length > 0){
+				Received += (uint16_t)Read_Length;
+			}
+			else if((Read_Length < 0) && (EINTR == errno)){
+				/* Interrupted, read again */
+			}
+			else{
+				Status = -1;
+			}
+		}
+	}
+	return Status;
+}
+
+void Sim_UART_Transmit(Sim_UART *Uart, const uint8_t *Data, uint16_t Data_Len){
+	uint16_t Sent = 0;
+	ssize_t Write_Length = 0;
+
+	while(Sent < Data_Len){
+		Write_Length = write(Uart->Master_Fd, &Data[Sent], Data_Len - Sent);
+		if(Write_Length > 0){
+			Sent += (uint16_t)Write_Length;
+		}
+		else if((Write_Length < 0) && (EINTR == errno)){
+			/* Interrupted, write again */
+		}
+		else{
+			/* Nobody reads the line and the pseudo terminal buffer is full: the bytes are lost like on a real wire */
+			Sent = Data_Len;
+		}
+	}
+}
+
+/*****************************************Software Interface Implementation End*****************************************/
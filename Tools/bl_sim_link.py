@@ -0,0 +1,433 @@
+''' Host side of the bootloader protocol for the tools: BL_Link frames the
+    commands like Host.py, Sim_Target runs it against Simulator/Build/bl_sim
+    over the host UART pseudo terminal and collects the simulated time.
+    The simulator is Linux only.
+'''
+
+import os
+import re
+import hashlib
+import select
+import struct
+import subprocess
+import tempfile
+import threading
+import time
+import tty
+
+CBL_GET_CID_CMD              = 0x12
+CBL_GO_TO_ADDR_CMD           = 0x14
+CBL_FLASH_ERASE_CMD          = 0x15
+CBL_MEM_WRITE_CMD            = 0x16
+CBL_MEM_READ_CMD             = 0x18
+CBL_GET_STATS_CMD            = 0x23
+CBL_ALLOCATE_PAGES_CMD       = 0x24
+CBL_ALLOCATE_NO_PAGES        = 0xFF
+CBL_ALLOCATE_NO_PAGES_EXTENDED = 0xFFFF
+CBL_LOAD_AND_EXEC_CMD        = 0x25
+CBL_STUB_LOAD                = 0x00
+CBL_STUB_EXEC                = 0x01
+STUB_OPERATION_PASSED        = 0x01
+CBL_FLASH_IMAGE_CMD          = 0x26
+CBL_IMAGE_BEGIN              = 0x00
+CBL_IMAGE_DATA               = 0x01
+CBL_IMAGE_COMMIT             = 0x02
+CBL_IMAGE_RESUME             = 0x03
+IMAGE_OPERATION_PASSED       = 0x01
+IMAGE_OFFSET_MISMATCH        = 0x03
+CBL_RELIABLE_CMD             = 0x27
+BL_RELIABLE_REPLY_SYNC       = 0x5A
+
+BL_ACK_VALUE                 = 0xCD
+BL_NACK_VALUE                = 0xAB
+
+SUCCESSFUL_ERASE             = 0x03
+FLASH_PAYLOAD_WRITE_PASSED   = 0x01
+FLASH_PAYLOAD_WRITE_POSTED   = 0x02
+
+CBL_FLASH_BASE               = 0x08000000
+CBL_FLASH_PAGE_SIZE          = 1024
+CBL_FLASH_SIZE               = 64 * 1024
+''' Page numbers above this one go in the extended (two byte) erase and allocate frames '''
+CBL_FLASH_MAX_SHORT_PAGE     = 0xFE
+''' DEV_ID of the F1 lines with 2 KB pages (high density, XL density, connectivity, high density value line), bl_flash.c '''
+BL_FLASH_LARGE_PAGE_DEV_IDS  = (0x414, 0x430, 0x418, 0x428)
+BL_FLASH_LARGE_PAGE_SIZE     = 2048
+''' XL density: bank 2 starts after the first 512 KB, the bootloader programs it while it receives '''
+BL_FLASH_BANK_2_BASE         = 0x08080000
+
+''' Largest write payload: the frame length byte counts code, address, length, payload and CRC32 '''
+CBL_MEM_WRITE_MAX_PAYLOAD    = 244
+''' Runs of 0xFF of at least this many bytes go as a skip record (15 bytes) instead of packet bytes '''
+CBL_MEM_WRITE_SKIP_MIN_RUN   = 64
+''' Largest read: the reply length has to fit in the ACK length byte '''
+CBL_MEM_READ_MAX_LENGTH      = 255
+''' Largest stub chunk: the frame length byte counts code, operation, offset, length, data and CRC32 '''
+CBL_STUB_MAX_CHUNK           = 246
+''' Largest image DATA payload: the frame length byte counts code, operation, offset, length, data and CRC32 '''
+CBL_IMAGE_DATA_MAX_PAYLOAD   = 244
+''' Bytes the reliable envelope adds to a request: its length byte, code, sequence and CRC32 '''
+CBL_RELIABLE_REQUEST_OVERHEAD = 7
+''' Longest reply a reliable reply frame carries: ACK, length and the longest command reply '''
+BL_RELIABLE_REPLY_MAX_LENGTH = 2 + CBL_MEM_READ_MAX_LENGTH
+''' Requests sent again after a corrupted or missing reply frame before the command is given up '''
+CBL_RELIABLE_RETRIES         = 3
+''' COBS framing: a frame with a 0x00 first byte switches the bootloader to it until its next reset '''
+BL_COBS_DELIMITER            = 0x00
+
+SIM_REPO_ROOT                = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+SIM_DEFAULT_BINARY           = os.path.join(SIM_REPO_ROOT, "Simulator", "Build", "bl_sim")
+SIM_DEVICES                  = ("medium", "high", "xl")
+SIM_REPLY_TIMEOUT            = 5.0
+
+Sim_Time_Pattern = re.compile(r'^bl_sim: time (\S+) count (\d+)((?: \w+_us \d+)+)$')
+Sim_Trace_Pattern = re.compile(r'^bl_sim: trace 0x([0-9A-Fa-f]{2}) us (\d+)$')
+
+def Get_App_Base_Address():
+    with open(os.path.join(SIM_REPO_ROOT, "memory_layout.ld"), 'r') as Layout_File:
+        Match = re.search(r'^\s*BL_APP_BASE\s*=\s*(0x[0-9a-fA-F]+)\s*;', Layout_File.read(), re.MULTILINE)
+    return int(Match.group(1), 16)
+
+def Sim_Binary_For(Device):
+    ''' make -C Simulator DEVICE=high|xl builds a simulator linked for the larger parts next to the default one '''
+    return SIM_DEFAULT_BINARY if Device == "medium" else os.path.join(SIM_REPO_ROOT, "Simulator", "Build", Device, "bl_sim")
+
+def Sparse_Records(Image, Payload_Len, Min_Run = CBL_MEM_WRITE_SKIP_MIN_RUN):
+    ''' Yields (offset, payload, 0) of the write packets of an image and (offset, None, length) of its runs of 0xFF
+        of Min_Run bytes or more, the skip records; runs are half-word aligned so the packets after them start aligned '''
+    Offset = 0
+    for Run in re.finditer(b'\xff{%d,}' % Min_Run, Image) if Min_Run else ():
+        Run_Start = Run.start() + (Run.start() & 1)
+        Run_End = Run.end() if Run.end() == len(Image) else Run.end() & ~1
+        if Run_End - Run_Start >= Min_Run:
+            for Packet in range(Offset, Run_Start, Payload_Len):
+                yield Packet, Image[Packet : min(Packet + Payload_Len, Run_Start)], 0
+            yield Run_Start, None, Run_End - Run_Start
+            Offset = Run_End
+    for Packet in range(Offset, len(Image), Payload_Len):
+        yield Packet, Image[Packet : Packet + Payload_Len], 0
+
+def CRC32_Byte_Step(Value):
+    for DataElemBitLen in range(8):
+        Value = ((Value << 1) ^ 0x04C11DB7) if Value & 0x80000000 else (Value << 1)
+    return Value & 0xFFFFFFFF
+
+''' The 32 shifts of every byte (fed to the CRC unit as one word) done as four table steps of 8 bits '''
+CRC32_TABLE = tuple(CRC32_Byte_Step(Index << 24) for Index in range(256))
+
+def Calculate_CRC32(Buffer):
+    CRC_Value = 0xFFFFFFFF
+    for DataElem in Buffer:
+        CRC_Value = CRC_Value ^ DataElem
+        for Step in range(4):
+            CRC_Value = ((CRC_Value << 8) & 0xFFFFFFFF) ^ CRC32_TABLE[CRC_Value >> 24]
+    return CRC_Value
+
+def Image_Manifest(Address, Image, Version):
+    ''' Manifest of a flash image transfer: load address, size, CRC32 of the image and version '''
+    return struct.pack('<4I', Address, len(Image), Calculate_CRC32(Image), Version)
+
+def COBS_Encode(Data):
+    ''' Consistent overhead byte stuffing: no 0x00 in the result, one code byte per block of up to 254 bytes '''
+    Encoded = bytearray()
+    Block = bytearray()
+    for Byte in Data:
+        if Byte == BL_COBS_DELIMITER:
+            Encoded += bytes([len(Block) + 1]) + Block
+            Block = bytearray()
+        else:
+            Block.append(Byte)
+            if len(Block) == 254:
+                Encoded += b'\xff' + Block
+                Block = bytearray()
+    return bytes(Encoded + bytes([len(Block) + 1]) + Block)
+
+def COBS_Frame(Frame):
+    ''' Delimiter first (switches the framing, ends a frame a lost delimiter left open) and last '''
+    return bytes([BL_COBS_DELIMITER]) + COBS_Encode(Frame) + bytes([BL_COBS_DELIMITER])
+
+def Build_CBL_Command(Command_Code, Details):
+    ''' Same frame as Host.py: length, command code, details and CRC32 '''
+    CBL_Command = bytearray([0, Command_Code]) + bytearray(Details)
+    CBL_Command[0] = len(CBL_Command) + 4 - 1
+    return bytes(CBL_Command) + struct.pack('<I', Calculate_CRC32(CBL_Command))
+
+class BL_Link:
+    ''' Bootloader commands over a byte link, the subclass provides Send and Read (and Discard_Input).
+        With Reliable set every command that fits goes in a CBL_RELIABLE_CMD envelope and is sent again, up to
+        CBL_RELIABLE_RETRIES times, when its reply frame is corrupted or missing; Retransmissions counts them.
+        With COBS set every request goes COBS framed '''
+
+    Reliable = False
+    COBS = False
+    Sequence = 0
+    Retransmissions = 0
+
+    def Send_Frame(self, Frame):
+        self.Send(COBS_Frame(Frame) if self.COBS else Frame)
+
+    def Send(self, Data):
+        raise NotImplementedError
+
+    def Read(self, Data_Len):
+        raise NotImplementedError
+
+    def Discard_Input(self):
+        ''' Drops what is left of a broken reply before a request is sent again '''
+        pass
+
+    def Command(self, Command_Code, Details = b''):
+        ''' Returns the reply bytes of an ACK, None on a NACK or no reply '''
+        Request = Build_CBL_Command(Command_Code, Details)
+        Reply = None
+        if self.Reliable and len(Request) + CBL_RELIABLE_REQUEST_OVERHEAD <= 256:
+            Frame_Reply = self.Reliable_Command(Request)
+            if Frame_Reply is not None and Frame_Reply[0] == BL_ACK_VALUE and len(Frame_Reply) == 2 + Frame_Reply[1]:
+                Reply = Frame_Reply[2:]
+            return Reply
+        self.Send_Frame(Request)
+        Header = self.Read(1)
+        if Header == bytes([BL_ACK_VALUE]):
+            Header += self.Read(1)
+            if len(Header) == 2:
+                Reply = self.Read(Header[1])
+        return Reply
+
+    def Reliable_Command(self, Request):
+        ''' Returns the reply the frame carries (ACK, length and data, or NACK and 0), None when no intact reply frame
+            came back for any of the retransmissions. The bootloader answers a request it already ran from its stored frame '''
+        self.Sequence = (self.Sequence + 1) & 0xFF
+        Envelope = Build_CBL_Command(CBL_RELIABLE_CMD, bytes([self.Sequence]) + Request)
+        Reply = None
+        for Attempt in range(CBL_RELIABLE_RETRIES + 1):
+            if Attempt:
+                self.Retransmissions += 1
+                self.Discard_Input()
+            self.Send_Frame(Envelope)
+            Reply = self.Read_Reply_Frame(self.Sequence)
+            if Reply is not None:
+                break
+        return Reply
+
+    def Read_Reply_Frame(self, Sequence):
+        ''' None on a bare NACK (the envelope arrived corrupted), a corrupted frame or a timeout.
+            A frame of an earlier sequence is the late reply of a request sent again, it is skipped '''
+        while True:
+            Header = self.Read(1)
+            if Header != bytes([BL_RELIABLE_REPLY_SYNC]):
+                return None
+            Header += self.Read(3)
+            Reply_Len = struct.unpack_from('<H', Header, 2)[0] if len(Header) == 4 else None
+            if Reply_Len is None or Reply_Len > BL_RELIABLE_REPLY_MAX_LENGTH:
+                return None
+            Body = self.Read(Reply_Len + 4)
+            if len(Body) != Reply_Len + 4 or Calculate_CRC32(Header + Body[:-4]) != struct.unpack_from('<I', Body, Reply_Len)[0]:
+                return None
+            if Header[1] == Sequence:
+                return Body[:-4]
+
+    def Flash_Page_Size(self):
+        ''' Page size of the target from its DEV_ID, asked once '''
+        if getattr(self, "Page_Size", None) is None:
+            Reply = self.Command(CBL_GET_CID_CMD)
+            Device_ID = struct.unpack('<H', Reply)[0] if Reply is not None and len(Reply) == 2 else 0
+            self.Page_Size = BL_FLASH_LARGE_PAGE_SIZE if Device_ID in BL_FLASH_LARGE_PAGE_DEV_IDS else CBL_FLASH_PAGE_SIZE
+        return self.Page_Size
+
+    def Erase_Pages(self, Address, Length):
+        Page_Size = self.Flash_Page_Size()
+        First_Page = (Address - CBL_FLASH_BASE) // Page_Size
+        Number_Of_Pages = (Address + Length + Page_Size - 1) // Page_Size - (Address // Page_Size)
+        if First_Page > CBL_FLASH_MAX_SHORT_PAGE or Number_Of_Pages > 0xFF:
+            Reply = self.Command(CBL_FLASH_ERASE_CMD, struct.pack('<HH', First_Page, Number_Of_Pages))
+        else:
+            Reply = self.Command(CBL_FLASH_ERASE_CMD, bytes([First_Page, Number_Of_Pages]))
+        return Reply is not None and Reply[:1] == bytes([SUCCESSFUL_ERASE])
+
+    def Write(self, Address, Payload):
+        ''' True when the payload is programmed or posted (bank 2 of a dual bank part, Flush reports how it ended) '''
+        Reply = self.Command(CBL_MEM_WRITE_CMD, struct.pack('<IB', Address, len(Payload)) + Payload)
+        self.Posted = Reply is not None and Reply[:1] == bytes([FLASH_PAYLOAD_WRITE_POSTED])
+        return Reply is not None and Reply[:1] in (bytes([FLASH_PAYLOAD_WRITE_PASSED]), bytes([FLASH_PAYLOAD_WRITE_POSTED]))
+
+    def Skip(self, Address, Length):
+        ''' Skip record: the range of the image reads 0xFF, the bootloader only erases its pages that are not blank '''
+        Reply = self.Command(CBL_MEM_WRITE_CMD, struct.pack('<IBI', Address, 0, Length))
+        self.Posted = False
+        return Reply is not None and Reply[:1] == bytes([FLASH_PAYLOAD_WRITE_PASSED])
+
+    def Flush(self, Address):
+        ''' Empty write: waits for the posted payload, False when it failed '''
+        return self.Write(Address, b'')
+
+    def Read_Memory(self, Address, Length):
+        ''' Returns the memory content, None when the bootloader refuses the range '''
+        Reply = self.Command(CBL_MEM_READ_CMD, struct.pack('<IB', Address, Length))
+        if Reply is not None and len(Reply) != Length:
+            Reply = None
+        return Reply
+
+    def Get_Stats(self):
+        ''' Raw BL_Stats_Record, Host.py Parse_BL_Stats_Record decodes it '''
+        return self.Command(CBL_GET_STATS_CMD)
+
+    def Allocate_Pages(self, Number_Of_Pages, First_Page, End_Page):
+        ''' Returns (first page, highest erase count) of the least worn window, None when no window fits '''
+        Allocation = None
+        if max(Number_Of_Pages, First_Page, End_Page) > CBL_FLASH_MAX_SHORT_PAGE:
+            Reply = self.Command(CBL_ALLOCATE_PAGES_CMD, struct.pack('<3H', Number_Of_Pages, First_Page, End_Page))
+            if Reply is not None and len(Reply) == 6 and struct.unpack_from('<H', Reply)[0] != CBL_ALLOCATE_NO_PAGES_EXTENDED:
+                Allocation = (struct.unpack_from('<H', Reply)[0], struct.unpack_from('<H', Reply, 4)[0])
+        else:
+            Reply = self.Command(CBL_ALLOCATE_PAGES_CMD, bytes([Number_Of_Pages, First_Page, End_Page]))
+            if Reply is not None and len(Reply) == 4 and Reply[0] != CBL_ALLOCATE_NO_PAGES:
+                Allocation = (Reply[0], struct.unpack_from('<H', Reply, 2)[0])
+        return Allocation
+
+    def Load_Stub(self, Stub):
+        ''' Copies Stub to the start of the SRAM stub window, False when the bootloader refuses a chunk '''
+        Loaded = True
+        for Offset in range(0, len(Stub), CBL_STUB_MAX_CHUNK):
+            Chunk = Stub[Offset : Offset + CBL_STUB_MAX_CHUNK]
+            Reply = self.Command(CBL_LOAD_AND_EXEC_CMD, struct.pack('<BHB', CBL_STUB_LOAD, Offset, len(Chunk)) + Chunk)
+            Loaded = Loaded and Reply is not None and Reply[:1] == bytes([STUB_OPERATION_PASSED])
+        return Loaded
+
+    def Exec_Stub(self, Stub, Entry_Offset = 0, Args = (0, 0, 0)):
+        ''' Runs the loaded Stub, returns its result or None when the bootloader refuses the call '''
+        Reply = self.Command(CBL_LOAD_AND_EXEC_CMD, struct.pack('<BHHI3I', CBL_STUB_EXEC, Entry_Offset, len(Stub),
+                                                                Calculate_CRC32(Stub), *Args))
+        Result = None
+        if Reply is not None and len(Reply) == 5 and Reply[0] == STUB_OPERATION_PASSED:
+            Result = struct.unpack_from('<I', Reply, 1)[0]
+        return Result
+
+    def Image_Command(self, Operation, Details = b''):
+        ''' Returns (status, next image offset) of a flash image operation, None on a NACK '''
+        Reply = self.Command(CBL_FLASH_IMAGE_CMD, bytes([Operation]) + Details)
+        return struct.unpack('<BI', Reply) if Reply is not None and len(Reply) == 5 else None
+
+    def Image_Begin(self, Address, Image, Version = 0):
+        return self.Image_Command(CBL_IMAGE_BEGIN, Image_Manifest(Address, Image, Version))
+
+    def Image_Resume(self, Address, Image, Version = 0):
+        ''' Returns (status, next image offset, written pages bitmap) of the transfer of the same manifest, None on a NACK '''
+        Reply = self.Command(CBL_FLASH_IMAGE_CMD, bytes([CBL_IMAGE_RESUME]) + Image_Manifest(Address, Image, Version))
+        return struct.unpack_from('<BI', Reply) + (Reply[5:],) if Reply is not None and len(Reply) >= 5 else None
+
+    def Image_Data(self, Offset, Payload):
+        return self.Image_Command(CBL_IMAGE_DATA, struct.pack('<IB', Offset, len(Payload)) + Payload)
+
+    def Image_Skip(self, Offset, Length):
+        return self.Image_Command(CBL_IMAGE_DATA, struct.pack('<IBI', Offset, 0, Length))
+
+    def Image_Commit(self, Digest = b''):
+        ''' With the SHA-256 of the image the bootloader also compares it with the one it took from the DATA frames '''
+        return self.Image_Command(CBL_IMAGE_COMMIT, Digest)
+
+    def Flash_Image(self, Address, Image, Version = 0, Payload_Len = CBL_IMAGE_DATA_MAX_PAYLOAD, Min_Run = CBL_MEM_WRITE_SKIP_MIN_RUN,
+                    Resume = False):
+        ''' Whole transaction: BEGIN, or with Resume the RESUME of a transfer of the same manifest that did not commit,
+            the DATA frames and skip records in image order from the offset the bootloader is at, COMMIT.
+            True when it committed '''
+        if self.Reliable:
+            ''' Even, the frames after it stay half-word aligned '''
+            Payload_Len = min(Payload_Len, (CBL_IMAGE_DATA_MAX_PAYLOAD - CBL_RELIABLE_REQUEST_OVERHEAD) & ~1)
+        Reply = self.Image_Resume(Address, Image, Version) if Resume else None
+        if Reply is None or Reply[0] != IMAGE_OPERATION_PASSED:
+            Reply = self.Image_Begin(Address, Image, Version)
+        Start = Reply[1] if Reply is not None else 0
+        Records = ((Start + Offset, Payload, Skip_Length) for Offset, Payload, Skip_Length in Sparse_Records(Image[Start:], Payload_Len, Min_Run))
+        while Reply is not None and Reply[0] == IMAGE_OPERATION_PASSED:
+            Record = next(Records, None)
+            if Record is None:
+                Reply = self.Image_Commit(hashlib.sha256(Image).digest())
+                break
+            Offset, Payload, Skip_Length = Record
+            Reply = self.Image_Data(Offset, Payload) if Payload is not None else self.Image_Skip(Offset, Skip_Length)
+        self.Posted = False
+        return Reply is not None and Reply[0] == IMAGE_OPERATION_PASSED
+
+    def Jump(self, Address):
+        return self.Command(CBL_GO_TO_ADDR_CMD, struct.pack('<I', Address)) is not None
+
+class Sim_Target(BL_Link):
+    ''' One bl_sim process with a fresh flash, optionally holding an application image. With Flash_File the flash
+        is kept in that file, a second target started on it runs as the same part after a reset '''
+
+    Reply_Timeout = SIM_REPLY_TIMEOUT
+
+    def __init__(self, Sim_Binary = SIM_DEFAULT_BINARY, Timing = "typical", Baud_Rate = 115200,
+                 Image = None, Exit_On_Jump = True, Trace = False, Device = "medium", Flash_File = None):
+        self.Work_Dir = tempfile.TemporaryDirectory(prefix = "bl_sim_")
+        Link_Name = os.path.join(self.Work_Dir.name, "host_uart")
+        Flash_File = Flash_File or os.path.join(self.Work_Dir.name, "flash.bin")
+        Arguments = [Sim_Binary, "--flash", Flash_File, "--link", Link_Name,
+                     "--timing", Timing, "--baud", str(Baud_Rate), "--device", Device]
+        if Image is not None:
+            Image_File_Name = os.path.join(self.Work_Dir.name, "image.bin")
+            with open(Image_File_Name, 'wb') as Image_File:
+                Image_File.write(Image)
+            Arguments += ["--image", Image_File_Name]
+        if Exit_On_Jump:
+            Arguments.append("--exit-on-jump")
+        if Trace:
+            Arguments.append("--trace")
+        ''' Known from the device, no GET_CID round trip in the measured scenarios '''
+        self.Page_Size = CBL_FLASH_PAGE_SIZE if Device == "medium" else BL_FLASH_LARGE_PAGE_SIZE
+        self.Process = subprocess.Popen(Arguments, stdout = subprocess.PIPE, universal_newlines = True)
+        ''' The first line is printed once both UARTs are up '''
+        self.Banner = self.Process.stdout.readline().strip()
+        ''' Drained in the background so the trace lines never stall the simulator '''
+        self.Output = []
+        self.Output_Reader = threading.Thread(target = self.Collect_Output, daemon = True)
+        self.Output_Reader.start()
+        self.Port = os.open(Link_Name, os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(self.Port)
+
+    def Collect_Output(self):
+        for Line in self.Process.stdout:
+            self.Output.append(Line.strip())
+
+    def Send(self, Data):
+        os.write(self.Port, Data)
+
+    def Discard_Input(self):
+        ''' Until the link has been quiet for 50 ms '''
+        while select.select([self.Port], [], [], 0.05)[0]:
+            os.read(self.Port, 256)
+
+    def Read(self, Data_Len):
+        Data = b''
+        Deadline = time.monotonic() + self.Reply_Timeout
+        while len(Data) < Data_Len and time.monotonic() < Deadline:
+            Ready, _, _ = select.select([self.Port], [], [], 0.1)
+            if Ready:
+                Data += os.read(self.Port, Data_Len - len(Data))
+        return Data
+
+    def Close(self):
+        ''' Stops the simulator, returns its time report {command code or "total": {cost: us}} and
+            the trace [(command code, us)] of every command when tracing '''
+        os.close(self.Port)
+        try:
+            self.Process.wait(timeout = 0.5 if self.Process.poll() is None else None)
+        except subprocess.TimeoutExpired:
+            self.Process.terminate()
+            self.Process.wait(timeout = SIM_REPLY_TIMEOUT)
+        self.Output_Reader.join()
+        self.Work_Dir.cleanup()
+        Report = {}
+        Trace = []
+        for Line in self.Output:
+            Match = Sim_Time_Pattern.match(Line)
+            if Match:
+                Fields = Match.group(3).split()
+                Costs = {Fields[Index][:-3] : int(Fields[Index + 1]) for Index in range(0, len(Fields), 2)}
+                Costs["count"] = int(Match.group(2))
+                Name = Match.group(1)
+                Report[Name if Name == "total" else int(Name, 16)] = Costs
+            Match = Sim_Trace_Pattern.match(Line)
+            if Match:
+                Trace.append((int(Match.group(1), 16), int(Match.group(2))))
+        return Report, Trace
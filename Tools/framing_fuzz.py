@@ -0,0 +1,238 @@
+''' Fuzz and replay of the host framing: how fast the bootloader is back in sync after a byte of a request was
+lost, added or changed on the line.
+
+    python framing_fuzz.py                              200 faults, COBS framing, simulated target
+    python framing_fuzz.py --framing length             The same faults on the length byte framing
+    python framing_fuzz.py --faults 1000 --seed 7 --record faults.json
+    python framing_fuzz.py --replay faults.json         Run a recorded fault list again
+    python framing_fuzz.py --device xl --json results.json
+    python framing_fuzz.py --short-frames               Length bytes 0 to 4, fails when one is not refused
+
+The target holds a random image and answers a stream of MEM_READ probes, each
+one reads a different 16 byte block so a reply can not be taken for the reply
+of another probe. One probe of every fault carries the fault:
+    drop         one byte of the frame is not sent
+    insert       one random byte is added to the frame
+    flip         one bit of one byte is inverted
+    delimiter    one 0x00 is added to the frame
+The probes that follow go intact until one gets its own block back. A fault is
+recovered when that happens within --max-probes probes, the target is started
+again otherwise. Recovery latency is the number of intact probes lost after
+the faulted one and their bytes on the line (resync bytes, also given in ms at
+the baud rate): with COBS framing the next delimiter ends the broken frame,
+the first intact probe already gets its reply and nothing is lost. A faulted
+probe that still gets its block back counts as accepted. A dropped end
+delimiter leaves the faulted frame open, the bootloader gives it up when the
+reply timeout of the probe is past its inter-byte timeout. With the length
+byte framing that pause also ends a frame short of or past its length byte,
+but a 0x00 read as a length byte switches the bootloader to COBS.
+--record keeps the fault list, --replay runs it again on either framing; a
+fault position past the end of a frame wraps around, so a list recorded with
+one framing replays on the other.
+--short-frames sends each length byte below the shortest frame (command code
+and CRC32) on a fresh target, followed by as many bytes of the same value: the
+bootloader has to answer every one of them with a NACK, without receiving a
+payload for it, and the next probe has to get its block back. The 0x00 length
+byte switches to COBS and gets no reply, its probe goes COBS framed.
+Build the simulator first: make -C Simulator
+'''
+
+import sys
+import json
+import time
+import random
+import argparse
+from bl_sim_link import *
+
+FUZZ_FAULT_KINDS      = ("drop", "insert", "flip", "delimiter")
+FUZZ_PROBE_BLOCKS     = 64
+FUZZ_PROBE_LENGTH     = 16
+FUZZ_REPLY_TIMEOUT    = 0.25
+''' Command code + CRC32, BL_BATCH_MIN_SUB_FRAME_LENGTH of the bootloader '''
+FUZZ_MIN_FRAME_LENGTH = 5
+
+''' Wire bits of one byte on the UART: start, 8 data, stop '''
+UART_BITS_PER_BYTE    = 10
+
+def Make_Faults(Count, Seed):
+    Rng = random.Random(Seed)
+    return [{"block": Rng.randrange(FUZZ_PROBE_BLOCKS), "kind": Rng.choice(FUZZ_FAULT_KINDS),
+             "position": Rng.randrange(256), "value": Rng.randrange(256)} for _ in range(Count)]
+
+def Apply_Fault(Wire, Fault):
+    ''' The wire bytes of a frame with the fault in, the position wraps around the frame length '''
+    Wire = bytearray(Wire)
+    Position = Fault["position"] % len(Wire)
+    if Fault["kind"] == "drop":
+        del Wire[Position]
+    elif Fault["kind"] == "insert":
+        Wire.insert(Position, Fault["value"])
+    elif Fault["kind"] == "flip":
+        Wire[Position] ^= 1 << (Fault["value"] & 7)
+    else:
+        Wire.insert(Position, BL_COBS_DELIMITER)
+    return bytes(Wire)
+
+class Fuzz_Session:
+    ''' One simulated target and the probe replies it has to give '''
+
+    def __init__(self, Framing, Sim_Binary, Device, Baud_Rate, Seed):
+        self.Framing = Framing
+        self.Sim_Binary = Sim_Binary
+        self.Device = Device
+        self.Baud_Rate = Baud_Rate
+        Rng = random.Random(Seed)
+        self.Image = bytes(Rng.randrange(256) for _ in range(FUZZ_PROBE_BLOCKS * FUZZ_PROBE_LENGTH))
+        self.Base_Address = Get_App_Base_Address()
+        self.Restarts = 0
+        self.Target = None
+        self.Start()
+
+    def Start(self):
+        if self.Target is not None:
+            self.Target.Close()
+            self.Restarts += 1
+        self.Target = Sim_Target(self.Sim_Binary, Baud_Rate = self.Baud_Rate, Image = self.Image, Device = self.Device)
+        self.Target.Reply_Timeout = FUZZ_REPLY_TIMEOUT
+
+    def Wire(self, Block):
+        Request = Build_CBL_Command(CBL_MEM_READ_CMD, struct.pack('<IB', self.Base_Address + Block * FUZZ_PROBE_LENGTH,
+                                                                  FUZZ_PROBE_LENGTH))
+        return COBS_Frame(Request) if self.Framing == "cobs" else Request
+
+    def Probe(self, Wire, Block):
+        ''' True when the reply is the block of this probe '''
+        Expected = bytes([BL_ACK_VALUE, FUZZ_PROBE_LENGTH]) + self.Image[Block * FUZZ_PROBE_LENGTH:(Block + 1) * FUZZ_PROBE_LENGTH]
+        self.Target.Send(Wire)
+        Reply = self.Target.Read(len(Expected))
+        self.Target.Discard_Input()
+        return Reply == Expected
+
+    def Run_Fault(self, Fault, Max_Probes):
+        ''' Returns the result of one fault: accepted, recovered, intact probes lost and their bytes '''
+        Result = {"kind": Fault["kind"], "accepted": self.Probe(Apply_Fault(self.Wire(Fault["block"]), Fault), Fault["block"]),
+                  "recovered": False, "frames_lost": 0, "resync_bytes": 0}
+        Block = Fault["block"]
+        while not Result["recovered"] and Result["frames_lost"] < Max_Probes:
+            Block = (Block + 1) % FUZZ_PROBE_BLOCKS
+            Wire = self.Wire(Block)
+            if self.Probe(Wire, Block):
+                Result["recovered"] = True
+            else:
+                Result["frames_lost"] += 1
+                Result["resync_bytes"] += len(Wire)
+        if not Result["recovered"]:
+            self.Start()
+        return Result
+
+    def Run_Short_Frame(self, Length_Byte):
+        ''' Returns the replies to the short frame, the replies expected and whether the next probe got its block '''
+        Expected = bytes([BL_NACK_VALUE]) * (Length_Byte + 1) if Length_Byte else b''
+        self.Target.Send(bytes([Length_Byte]) * (Length_Byte + 1))
+        Replies = self.Target.Read(len(Expected) + 1)
+        self.Target.Discard_Input()
+        Probe_Passed = self.Probe(self.Wire(0), 0)
+        return Replies, Expected, Probe_Passed
+
+    def Close(self):
+        self.Target.Close()
+
+def Run_Short_Frames(Sim_Binary, Device, Baud_Rate, Seed):
+    ''' Every length byte under FUZZ_MIN_FRAME_LENGTH on a fresh target, True when all of them are refused '''
+    All_Passed = True
+    print("{:<13}{:>14}{:>14}{:>8}".format("Length byte", "Replies", "Expected", "Probe"))
+    for Length_Byte in range(FUZZ_MIN_FRAME_LENGTH):
+        Session = Fuzz_Session("cobs" if Length_Byte == 0 else "length", Sim_Binary, Device, Baud_Rate, Seed)
+        Replies, Expected, Probe_Passed = Session.Run_Short_Frame(Length_Byte)
+        Session.Close()
+        All_Passed = All_Passed and Replies == Expected and Probe_Passed
+        print("{:<13}{:>14}{:>14}{:>8}".format(Length_Byte, Replies.hex() or "-", Expected.hex() or "-",
+                                               "yes" if Probe_Passed else "NO"))
+    return All_Passed
+
+def Percentile(Values, Fraction):
+    Ordered = sorted(Values)
+    return Ordered[min(len(Ordered) - 1, int(Fraction * len(Ordered)))] if Ordered else 0
+
+def Summarize(Results, Baud_Rate):
+    ''' Per fault kind and over all faults '''
+    Summary = {}
+    for Kind in FUZZ_FAULT_KINDS + ("all",):
+        Selected = [Result for Result in Results if Kind in ("all", Result["kind"])]
+        if not Selected:
+            continue
+        Recovered = [Result for Result in Selected if Result["recovered"]]
+        Resync_Bytes = [Result["resync_bytes"] for Result in Recovered]
+        Summary[Kind] = {
+            "faults": len(Selected),
+            "accepted": sum(1 for Result in Selected if Result["accepted"]),
+            "recovered": len(Recovered),
+            "frames_lost_mean": sum(Result["frames_lost"] for Result in Recovered) / len(Recovered) if Recovered else 0.0,
+            "frames_lost_max": max((Result["frames_lost"] for Result in Recovered), default = 0),
+            "resync_bytes_p95": Percentile(Resync_Bytes, 0.95),
+            "resync_bytes_max": max(Resync_Bytes, default = 0),
+            "resync_ms_max": max(Resync_Bytes, default = 0) * UART_BITS_PER_BYTE * 1000.0 / Baud_Rate
+        }
+    return Summary
+
+def Print_Summary(Summary):
+    print("{:<11}{:>8}{:>10}{:>11}{:>12}{:>11}{:>13}{:>13}{:>11}".format(
+          "Fault", "Faults", "Accepted", "Recovered", "Lost mean", "Lost max", "Resync p95", "Resync max", "Max ms"))
+    for Kind, Row in Summary.items():
+        print("{:<11}{:>8}{:>10}{:>11}{:>12.2f}{:>11}{:>13}{:>13}{:>11.2f}".format(
+              Kind, Row["faults"], Row["accepted"], Row["recovered"], Row["frames_lost_mean"], Row["frames_lost_max"],
+              Row["resync_bytes_p95"], Row["resync_bytes_max"], Row["resync_ms_max"]))
+
+def main():
+    Parser = argparse.ArgumentParser(description="Framing fuzz of the bootloader protocol, recovery latency after line faults")
+    Parser.add_argument("--framing", choices=("cobs", "length"), default="cobs", help="request framing")
+    Parser.add_argument("--faults", type=int, default=200, help="number of faults to generate")
+    Parser.add_argument("--seed", type=int, default=1, help="seed of the fault generator and of the image")
+    Parser.add_argument("--max-probes", type=int, default=32, help="intact probes after a fault before the target is started again")
+    Parser.add_argument("--record", help="write the fault list to this file")
+    Parser.add_argument("--replay", help="run the fault list of this file instead of generating one")
+    Parser.add_argument("--json", help="write the summary and every fault result to this file")
+    Parser.add_argument("--baud", type=int, default=115200, help="host UART baud rate")
+    Parser.add_argument("--device", choices=SIM_DEVICES, default="medium", help="simulated device density")
+    Parser.add_argument("--sim", help="bl_sim binary, defaults to the build of the device")
+    Parser.add_argument("--short-frames", action="store_true", help="check the length bytes 0 to 4 instead of the fault run")
+    Args = Parser.parse_args()
+
+    if Args.short_frames:
+        try:
+            Passed = Run_Short_Frames(Args.sim or Sim_Binary_For(Args.device), Args.device, Args.baud, Args.seed)
+        except OSError as Error:
+            print(Error)
+            sys.exit(1)
+        sys.exit(0 if Passed else 1)
+
+    if Args.replay:
+        with open(Args.replay) as Fault_File:
+            Faults = json.load(Fault_File)["faults"]
+    else:
+        Faults = Make_Faults(Args.faults, Args.seed)
+    if Args.record:
+        with open(Args.record, 'w') as Fault_File:
+            json.dump({"seed": Args.seed, "faults": Faults}, Fault_File, indent = 1)
+
+    try:
+        Session = Fuzz_Session(Args.framing, Args.sim or Sim_Binary_For(Args.device), Args.device, Args.baud, Args.seed)
+    except OSError as Error:
+        print(Error)
+        sys.exit(1)
+    Start_Time = time.monotonic()
+    Results = [Session.Run_Fault(Fault, Args.max_probes) for Fault in Faults]
+    Session.Close()
+
+    Summary = Summarize(Results, Args.baud)
+    print("{} faults, {} framing, {} device, {} baud, {} target restarts, {:.1f} s\n".format(
+          len(Faults), Args.framing, Args.device, Args.baud, Session.Restarts, time.monotonic() - Start_Time))
+    Print_Summary(Summary)
+    if Args.json:
+        with open(Args.json, 'w') as Json_File:
+            json.dump({"config": {"framing": Args.framing, "device": Args.device, "baud": Args.baud,
+                                  "max_probes": Args.max_probes, "restarts": Session.Restarts},
+                       "summary": Summary, "results": Results}, Json_File, indent = 1)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,161 @@
+''' Size report of a GNU ld map file, per memory region and per object file.
+
+    python map_size_report.py BootloaderApp.map
+    python map_size_report.py --before Debug/BootloaderApp.map Build/release/BootloaderApp.map
+
+With --before the report compares both images and lists the objects whose
+footprint changed, largest change first. Sizes are in bytes.
+'''
+
+import re
+import sys
+import argparse
+
+MAP_MEMORY_CONFIGURATION = "Memory Configuration"
+MAP_MEMORY_MAP           = "Linker script and memory map"
+
+''' Output sections that are reserved in RAM but never copied from flash '''
+MAP_NOLOAD_SECTIONS      = (".bss", "._user_heap_stack", ".noinit")
+
+Output_Section_Pattern = re.compile(r'^(\.\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)(?:\s+load address 0x([0-9a-fA-F]+))?')
+Input_Section_Pattern  = re.compile(r'^ (\.\S+|\*fill\*|COMMON)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s*(.*))?$')
+Input_Wrapped_Pattern  = re.compile(r'^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$')
+Region_Pattern         = re.compile(r'^(\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)')
+
+def Map_Object_Name(Object_Path):
+    Object_Path = Object_Path.strip()
+    if not Object_Path:
+        return "(fill)"
+    if Object_Path == "linker stubs":
+        return "(linker stubs)"
+    if Object_Path.startswith("./"):
+        return Object_Path[2:]
+    ''' Toolchain libraries: keep the archive and member name only '''
+    return re.split(r'[\\/]', Object_Path)[-1]
+
+def Map_Find_Region(Regions, Address):
+    for Region_Name, (Origin, Length) in Regions.items():
+        if Origin <= Address < Origin + Length:
+            return Region_Name
+    return None
+
+def Parse_Map_File(Map_File_Name):
+    ''' Returns the memory regions {name: (origin, length)} and the usage {object: {region: bytes}} '''
+    Regions = {}
+    Usage = {}
+    State = None
+    Output_Region = None
+    Load_Region = None
+    Pending_Section = None
+
+    def Account(Object_Name, Size):
+        if Size == 0 or Output_Region is None:
+            return
+        Object_Usage = Usage.setdefault(Object_Name, {})
+        Object_Usage[Output_Region] = Object_Usage.get(Output_Region, 0) + Size
+        if Load_Region is not None and Load_Region != Output_Region:
+            Object_Usage[Load_Region] = Object_Usage.get(Load_Region, 0) + Size
+
+    with open(Map_File_Name, 'r', errors='replace') as Map_File:
+        for Line in Map_File:
+            Line = Line.rstrip('\r\n')
+            if Line.startswith(MAP_MEMORY_CONFIGURATION):
+                State = MAP_MEMORY_CONFIGURATION
+                continue
+            if Line.startswith(MAP_MEMORY_MAP):
+                State = MAP_MEMORY_MAP
+                continue
+
+            if State == MAP_MEMORY_CONFIGURATION:
+                Match = Region_Pattern.match(Line)
+                if Match and Match.group(1) not in ("Name", "*default*"):
+                    Regions[Match.group(1)] = (int(Match.group(2), 16), int(Match.group(3), 16))
+            elif State == MAP_MEMORY_MAP:
+                Match = Output_Section_Pattern.match(Line)
+                if Match:
+                    Pending_Section = None
+                    Output_Region = Map_Find_Region(Regions, int(Match.group(2), 16))
+                    Load_Region = None
+                    if Match.group(4) and not Match.group(1).startswith(MAP_NOLOAD_SECTIONS):
+                        Load_Region = Map_Find_Region(Regions, int(Match.group(4), 16))
+                    continue
+                if Line and not Line[0].isspace():
+                    ''' Debug sections and other top level entries outside the memory regions '''
+                    Output_Region = None
+                    Pending_Section = None
+                    continue
+                Match = Input_Section_Pattern.match(Line)
+                if Match:
+                    if Match.group(2) is None:
+                        ''' Long section names push the address and size to the next line '''
+                        Pending_Section = Match.group(1)
+                    else:
+                        Pending_Section = None
+                        Account(Map_Object_Name(Match.group(4)), int(Match.group(3), 16))
+                    continue
+                if Pending_Section is not None:
+                    Match = Input_Wrapped_Pattern.match(Line)
+                    if Match:
+                        Account(Map_Object_Name(Match.group(3)), int(Match.group(2), 16))
+                    Pending_Section = None
+    return Regions, Usage
+
+def Region_Totals(Regions, Usage):
+    Totals = {Region_Name: 0 for Region_Name in Regions}
+    for Object_Usage in Usage.values():
+        for Region_Name, Size in Object_Usage.items():
+            Totals[Region_Name] += Size
+    return Totals
+
+def Print_Single_Report(Regions, Usage, Top_Count):
+    Totals = Region_Totals(Regions, Usage)
+    Region_Names = sorted(Regions)
+    print("{:<16}{:>10}{:>10}{:>8}".format("Region", "Used", "Size", "Use%"))
+    for Region_Name in Region_Names:
+        Length = Regions[Region_Name][1]
+        print("{:<16}{:>10}{:>10}{:>7.1f}%".format(Region_Name, Totals[Region_Name], Length, 100.0 * Totals[Region_Name] / Length))
+    print("")
+    print(("{:<60}" + "{:>10}" * len(Region_Names)).format("Object", *Region_Names))
+    Ordered = sorted(Usage.items(), key=lambda Item: -sum(Item[1].values()))
+    for Object_Name, Object_Usage in Ordered[:Top_Count]:
+        print(("{:<60}" + "{:>10}" * len(Region_Names)).format(Object_Name[-59:], *[Object_Usage.get(Name, 0) for Name in Region_Names]))
+
+def Print_Compare_Report(Before_Regions, Before_Usage, After_Regions, After_Usage, Top_Count):
+    Before_Totals = Region_Totals(Before_Regions, Before_Usage)
+    After_Totals = Region_Totals(After_Regions, After_Usage)
+    Region_Names = sorted(set(Before_Regions) | set(After_Regions))
+    print("{:<16}{:>10}{:>10}{:>10}".format("Region", "Before", "After", "Delta"))
+    for Region_Name in Region_Names:
+        Before = Before_Totals.get(Region_Name, 0)
+        After = After_Totals.get(Region_Name, 0)
+        print("{:<16}{:>10}{:>10}{:>+10}".format(Region_Name, Before, After, After - Before))
+    print("")
+    Changes = []
+    for Object_Name in set(Before_Usage) | set(After_Usage):
+        Deltas = [After_Usage.get(Object_Name, {}).get(Name, 0) - Before_Usage.get(Object_Name, {}).get(Name, 0) for Name in Region_Names]
+        if any(Deltas):
+            Changes.append((Object_Name, Deltas))
+    Changes.sort(key=lambda Change: -sum(abs(Delta) for Delta in Change[1]))
+    print(("{:<60}" + "{:>10}" * len(Region_Names)).format("Object (delta)", *Region_Names))
+    for Object_Name, Deltas in Changes[:Top_Count]:
+        print(("{:<60}" + "{:>+10}" * len(Region_Names)).format(Object_Name[-59:], *Deltas))
+
+def main():
+    Parser = argparse.ArgumentParser(description="Size report of a GNU ld map file")
+    Parser.add_argument("map_file", help="map file of the image to report")
+    Parser.add_argument("--before", help="map file of the reference image, prints the difference")
+    Parser.add_argument("--top", type=int, default=25, help="number of objects to list")
+    Args = Parser.parse_args()
+
+    After_Regions, After_Usage = Parse_Map_File(Args.map_file)
+    if not After_Regions:
+        print("No memory configuration found in {}".format(Args.map_file))
+        sys.exit(1)
+    if Args.before:
+        Before_Regions, Before_Usage = Parse_Map_File(Args.before)
+        Print_Compare_Report(Before_Regions, Before_Usage, After_Regions, After_Usage, Args.top)
+    else:
+        Print_Single_Report(After_Regions, After_Usage, Args.top)
+
+if __name__ == "__main__":
+    main()
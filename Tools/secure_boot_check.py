@@ -0,0 +1,123 @@
+''' Checks of the secure boot build on the simulator: only a signed image committed at the application base runs.
+
+    python secure_boot_check.py                         Simulator/Build/secure/bl_sim (make -C Simulator SECURE_BOOT=1)
+    python secure_boot_check.py --device xl             Simulator/Build/xl-secure/bl_sim (DEVICE=xl SECURE_BOOT=1)
+
+Every case starts a fresh simulated target and writes an application image:
+    signed       committed with FLASH_IMAGE, the boot window starts it after a reset
+    unsigned     refused at the COMMIT, nothing starts after a reset
+    other key    signed with another key, refused the same way
+    go to addr   the unsigned image written with MEM_WRITE, GO_TO_ADDR to its base
+                 alone, in a batch and in a reliable envelope: NACK and no jump
+    load exec    LOAD_AND_EXEC load and exec of a stub: NACK and no stub call
+A jump or a stub call is read from the simulator output (bl_sim: jump to,
+bl_sim: stub call). The exit code is 1 when a case fails.
+'''
+
+import os
+import sys
+import time
+import random
+import struct
+import argparse
+import tempfile
+from bl_sim_link import *
+import sign_image
+
+CBL_BATCH_CMD             = 0x22
+''' Seconds a reset target gets to close its boot window and jump '''
+SECURE_RESET_TIMEOUT      = 3.0
+''' A Thumb return (bx lr), the stub LOAD_AND_EXEC would run '''
+SECURE_STUB               = b'\x70\x47'
+
+def Sim_Secure_Binary_For(Device):
+    ''' make -C Simulator SECURE_BOOT=1 [DEVICE=high|xl] '''
+    Build_Dir = "secure" if Device == "medium" else Device + "-secure"
+    return os.path.join(SIM_REPO_ROOT, "Simulator", "Build", Build_Dir, "bl_sim")
+
+def Test_Image(Base_Address):
+    ''' Vector table of a valid application: stack pointer in the SRAM, Thumb reset handler inside the image '''
+    Rng = random.Random(0x5EC)
+    return struct.pack('<II', 0x20004000, Base_Address + 0x101) + bytes(Rng.getrandbits(8) for _ in range(4094))
+
+def Write_Raw(Target, Address, Image):
+    ''' MEM_WRITE of every byte, no FLASH_IMAGE transaction and no signature '''
+    Passed = True
+    for Offset in range(0, len(Image), CBL_MEM_WRITE_MAX_PAYLOAD):
+        Passed = Passed and Target.Write(Address + Offset, Image[Offset : Offset + CBL_MEM_WRITE_MAX_PAYLOAD])
+    return Passed and Target.Flush(Address + Offset)
+
+def Sim_Events(Target):
+    ''' Jumps and stub calls the simulator reported, the target is stopped '''
+    Target.Close()
+    return [Line for Line in Target.Output if Line.startswith(("bl_sim: jump to", "bl_sim: stub call"))]
+
+def Boots_After_Reset(Sim_Binary, Device, Flash_File):
+    ''' Starts the part again on its flash, True when the boot window jumps to the application '''
+    Target = Sim_Target(Sim_Binary, Device = Device, Flash_File = Flash_File)
+    Deadline = time.monotonic() + SECURE_RESET_TIMEOUT
+    while Target.Process.poll() is None and time.monotonic() < Deadline:
+        time.sleep(0.05)
+    return any(Event.startswith("bl_sim: jump to") for Event in Sim_Events(Target))
+
+def Check_Commit(Sim_Binary, Device, Base_Address, Image, Expect_Boot):
+    ''' FLASH_IMAGE of Image and a reset, passes when the commit and the boot both go as expected '''
+    with tempfile.TemporaryDirectory(prefix = "bl_secure_") as Flash_Dir:
+        Flash_File = os.path.join(Flash_Dir, "flash.bin")
+        Target = Sim_Target(Sim_Binary, Device = Device, Flash_File = Flash_File)
+        Committed = Target.Flash_Image(Base_Address, Image)
+        Events = Sim_Events(Target)
+        Booted = Boots_After_Reset(Sim_Binary, Device, Flash_File)
+    return Committed == Expect_Boot and Booted == Expect_Boot and not Events
+
+def Check_Go_To_Addr(Sim_Binary, Device, Base_Address, Image):
+    ''' GO_TO_ADDR to an unsigned image alone, in a batch and in a reliable envelope '''
+    Target = Sim_Target(Sim_Binary, Device = Device)
+    Written = Write_Raw(Target, Base_Address, Image)
+    Alone_Refused = not Target.Jump(Base_Address)
+    Sub_Command = Build_CBL_Command(CBL_GO_TO_ADDR_CMD, struct.pack('<I', Base_Address))
+    Reply = Target.Command(CBL_BATCH_CMD, bytes([0, 1]) + Sub_Command)
+    ''' Executed count, then the code, NACK and empty reply of the sub-command '''
+    Batch_Refused = Reply == bytes([1, CBL_GO_TO_ADDR_CMD, BL_NACK_VALUE, 0])
+    Target.Reliable = True
+    Reliable_Refused = not Target.Jump(Base_Address)
+    return Written and Alone_Refused and Batch_Refused and Reliable_Refused and not Sim_Events(Target)
+
+def Check_Load_Exec(Sim_Binary, Device):
+    ''' LOAD_AND_EXEC of a stub that would return at once '''
+    Target = Sim_Target(Sim_Binary, Device = Device)
+    Load_Refused = not Target.Load_Stub(SECURE_STUB)
+    Exec_Refused = Target.Exec_Stub(SECURE_STUB) is None
+    return Load_Refused and Exec_Refused and not Sim_Events(Target)
+
+def main():
+    Parser = argparse.ArgumentParser(description="Secure boot checks of the bootloader on the simulator")
+    Parser.add_argument("--device", choices=SIM_DEVICES, default="medium", help="simulated device density")
+    Parser.add_argument("--sim", help="bl_sim binary built with SECURE_BOOT=1, defaults to the build of the device")
+    Args = Parser.parse_args()
+    Sim_Binary = Args.sim or Sim_Secure_Binary_For(Args.device)
+    if not os.path.exists(Sim_Binary):
+        print("{} not found, build it with make -C Simulator SECURE_BOOT=1".format(Sim_Binary))
+        sys.exit(1)
+
+    Base_Address = Get_App_Base_Address()
+    Image = Test_Image(Base_Address)
+    Dev_Key = sign_image.Load_Private_Key(sign_image.DEV_KEY_FILE)
+    Cases = (("signed", lambda: Check_Commit(Sim_Binary, Args.device, Base_Address, sign_image.Sign_Image(Image, Dev_Key), True)),
+             ("unsigned", lambda: Check_Commit(Sim_Binary, Args.device, Base_Address, Image, False)),
+             ("other key", lambda: Check_Commit(Sim_Binary, Args.device, Base_Address, sign_image.Sign_Image(Image, Dev_Key + 1), False)),
+             ("go to addr", lambda: Check_Go_To_Addr(Sim_Binary, Args.device, Base_Address, Image)),
+             ("load exec", lambda: Check_Load_Exec(Sim_Binary, Args.device)))
+    All_Passed = True
+    for Name, Check in Cases:
+        try:
+            Passed = Check()
+        except OSError:
+            ''' The link closed under the host: the simulator exited on a jump '''
+            Passed = False
+        All_Passed = All_Passed and Passed
+        print("{:<12}{}".format(Name, "pass" if Passed else "FAIL"))
+    sys.exit(0 if All_Passed else 1)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,239 @@
+''' Signing of application images for the secure boot of the bootloader (-DBL_SECURE_BOOT=1).
+
+    python sign_image.py Application.bin                     Writes Application_signed.bin with the development key
+    python sign_image.py Application.bin --key product.key --output App.bin
+    python sign_image.py --check App.bin                     Checks the trailer of a signed image
+    python sign_image.py --generate-key product.key          New private key, keep it off the repository
+    python sign_image.py --key product.key --public-key-c ../BootloaderApp/Core/Src/Bootloader/bl_public_key.c
+    python sign_image.py --self-test                         RFC 6979 A.2.5 vectors of the signing and of the check
+
+The signature is ECDSA P-256 of the SHA-256 of the image (FIPS 186-4), with
+the nonce of RFC 6979 so the same image and key always give the same
+signature. The signed image is the image, 0xFF up to a multiple of 4 bytes,
+then the trailer the bootloader reads from the last bytes of the image:
+    Magic        uint32  BL_IMAGE_TRAILER_MAGIC ("SIGN")
+    Signed_Size  uint32  Bytes before the trailer, all of them are hashed
+    Signature    64      r then s, 32 bytes each, big endian
+Flash the signed image with the flash image command (Host.py option 19 or
+bl_sim_link Flash_Image): the bootloader checks the signature at the COMMIT
+and again before the boot window starts the application.
+bl_dev_signing_key.txt is a development key, its private half is public in
+this repository; a product generates its own key and the bootloader is built
+with the public key source --public-key-c writes. The source of the
+development key fails a secure boot build without -DBL_SECURE_BOOT_DEV_KEY.
+Pure Python, nothing to install.
+'''
+
+import os
+import sys
+import hmac
+import struct
+import secrets
+import hashlib
+import argparse
+
+P256_P  = 0xFFFFFFFF00000001000000000000000000000000FFFFFFFFFFFFFFFFFFFFFFFF
+P256_N  = 0xFFFFFFFF00000000FFFFFFFFFFFFFFFFBCE6FAADA7179E84F3B9CAC2FC632551
+P256_B  = 0x5AC635D8AA3A93E7B3EBBD55769886BC651D06B0CC53B0F63BCE3C3E27D2604B
+P256_G  = (0x6B17D1F2E12C4247F8BCE6E563A440F277037D812DEB33A0F4A13945D898C296,
+           0x4FE342E2FE1A7F9B8EE7EB4A7C0F9E162BCE33576B315ECECBB6406837BF51F5)
+
+BL_IMAGE_TRAILER_MAGIC    = 0x4E474953
+BL_IMAGE_TRAILER_FORMAT   = '<II64s'
+BL_IMAGE_TRAILER_SIZE     = struct.calcsize(BL_IMAGE_TRAILER_FORMAT)
+BL_IMAGE_SIGNED_ALIGNMENT = 4
+
+DEV_KEY_FILE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "bl_dev_signing_key.txt")
+
+''' RFC 6979 A.2.5: private key, public key, then message, r, s of SHA-256 signatures '''
+RFC6979_PRIVATE_KEY = 0xC9AFA9D845BA75166B5C215767B1D6934E50C3DB36E89B127B8A622B120F6721
+RFC6979_PUBLIC_KEY  = (0x60FED4BA255A9D31C961EB74C6356D68C049B8923B61FA6CE669622E60F29FB6,
+                       0x7903FE1008B8BC99A41AE9E95628BC64F2F1B20C2D7E9F5177A3C294D4462299)
+RFC6979_VECTORS = (
+    (b"sample", 0xEFD48B2AACB6A8FD1140DD9CD45E81D69D2C877B56AAF991C34D0EA84EAF3716,
+                0xF7CB1C942D657C41D436C7A1B6E29F65F3E900DBB9AFF4064DC4AB2F843ACDA8),
+    (b"test",   0xF1ABB023518351CD71D881567B1EA663ED3EFCF6C5132B354F28D3B0B7D38367,
+                0x019F4113742A2B14BD25926B49C649155F267E60D3814B4C0CC84250E46F0083))
+
+def Point_Add(P, Q):
+    ''' Affine points, None is the point at infinity '''
+    if P is None:
+        return Q
+    if Q is None:
+        return P
+    if P[0] == Q[0]:
+        if (P[1] + Q[1]) % P256_P == 0:
+            return None
+        Slope = (3 * P[0] * P[0] - 3) * pow(2 * P[1], -1, P256_P) % P256_P
+    else:
+        Slope = (Q[1] - P[1]) * pow(Q[0] - P[0], -1, P256_P) % P256_P
+    X = (Slope * Slope - P[0] - Q[0]) % P256_P
+    return (X, (Slope * (P[0] - X) - P[1]) % P256_P)
+
+def Point_Multiply(Scalar, P):
+    Result = None
+    for Bit_Index in reversed(range(Scalar.bit_length())):
+        Result = Point_Add(Result, Result)
+        if (Scalar >> Bit_Index) & 1:
+            Result = Point_Add(Result, P)
+    return Result
+
+def Is_On_Curve(Q):
+    return (0 <= Q[0] < P256_P and 0 <= Q[1] < P256_P and
+            (Q[1] * Q[1] - (Q[0] * Q[0] * Q[0] - 3 * Q[0] + P256_B)) % P256_P == 0)
+
+def Rfc6979_Nonce(Private_Key, Digest):
+    ''' Deterministic nonce of RFC 6979 3.2 with HMAC-SHA256, the digest is as long as n '''
+    X = Private_Key.to_bytes(32, 'big')
+    H = (int.from_bytes(Digest, 'big') % P256_N).to_bytes(32, 'big')
+    V = b'\x01' * 32
+    K = b'\x00' * 32
+    K = hmac.new(K, V + b'\x00' + X + H, hashlib.sha256).digest()
+    V = hmac.new(K, V, hashlib.sha256).digest()
+    K = hmac.new(K, V + b'\x01' + X + H, hashlib.sha256).digest()
+    V = hmac.new(K, V, hashlib.sha256).digest()
+    while True:
+        V = hmac.new(K, V, hashlib.sha256).digest()
+        Nonce = int.from_bytes(V, 'big')
+        if 1 <= Nonce < P256_N:
+            return Nonce
+        K = hmac.new(K, V + b'\x00', hashlib.sha256).digest()
+        V = hmac.new(K, V, hashlib.sha256).digest()
+
+def Sign_Digest(Private_Key, Digest):
+    ''' Returns (r, s) '''
+    E = int.from_bytes(Digest, 'big')
+    Nonce = Rfc6979_Nonce(Private_Key, Digest)
+    R = Point_Multiply(Nonce, P256_G)[0] % P256_N
+    S = pow(Nonce, -1, P256_N) * (E + R * Private_Key) % P256_N
+    return (R, S)
+
+def Verify_Digest(Public_Key, Digest, R, S):
+    ''' The check of BL_ECDSA_P256_Verify, written plainly '''
+    if not Is_On_Curve(Public_Key) or not (1 <= R < P256_N and 1 <= S < P256_N):
+        return False
+    W = pow(S, -1, P256_N)
+    E = int.from_bytes(Digest, 'big')
+    Sum = Point_Add(Point_Multiply(E * W % P256_N, P256_G), Point_Multiply(R * W % P256_N, Public_Key))
+    return Sum is not None and Sum[0] % P256_N == R
+
+def Load_Private_Key(Path):
+    ''' Hex of the private key, lines starting with # are comments '''
+    with open(Path) as Key_File:
+        Lines = [Line.strip() for Line in Key_File if Line.strip() and not Line.startswith('#')]
+    Private_Key = int(Lines[0], 16)
+    if not 1 <= Private_Key < P256_N:
+        raise ValueError("{}: not a P-256 private key".format(Path))
+    return Private_Key
+
+def Public_Key_Bytes(Public_Key):
+    return Public_Key[0].to_bytes(32, 'big') + Public_Key[1].to_bytes(32, 'big')
+
+def Sign_Image(Image, Private_Key):
+    ''' The signed image: the image padded with 0xFF, then the trailer '''
+    Padding = -len(Image) % BL_IMAGE_SIGNED_ALIGNMENT
+    Signed = bytes(Image) + b'\xFF' * Padding
+    R, S = Sign_Digest(Private_Key, hashlib.sha256(Signed).digest())
+    return Signed + struct.pack(BL_IMAGE_TRAILER_FORMAT, BL_IMAGE_TRAILER_MAGIC, len(Signed),
+                                R.to_bytes(32, 'big') + S.to_bytes(32, 'big'))
+
+def Check_Image(Image, Public_Key):
+    ''' True when the trailer of the signed image checks with the public key '''
+    if len(Image) < BL_IMAGE_TRAILER_SIZE:
+        return False
+    Magic, Signed_Size, Signature = struct.unpack(BL_IMAGE_TRAILER_FORMAT, Image[-BL_IMAGE_TRAILER_SIZE:])
+    if Magic != BL_IMAGE_TRAILER_MAGIC or Signed_Size != len(Image) - BL_IMAGE_TRAILER_SIZE:
+        return False
+    return Verify_Digest(Public_Key, hashlib.sha256(Image[:Signed_Size]).digest(),
+                         int.from_bytes(Signature[:32], 'big'), int.from_bytes(Signature[32:], 'big'))
+
+def Public_Key_C_Source(Public_Key, Key_Name, Development = False):
+    ''' The source of the development key stops a secure boot build that does not ask for it with BL_SECURE_BOOT_DEV_KEY '''
+    Key_Bytes = Public_Key_Bytes(Public_Key)
+    Rows = [', '.join('0x{:02X}'.format(Byte) for Byte in Key_Bytes[Offset:Offset + 16])
+            for Offset in range(0, len(Key_Bytes), 16)]
+    Guard = ('/* The development key: its private half is in this repository, anyone can sign for it. A secure boot build\n'
+             ' * only takes it with -DBL_SECURE_BOOT_DEV_KEY, a product writes its own key over this file */\n'
+             '#if (BL_SECURE_BOOT && !defined(BL_SECURE_BOOT_DEV_KEY))\n'
+             '#error "Secure boot with the development key: add -DBL_SECURE_BOOT_DEV_KEY, or write the product key with '
+             'Tools/sign_image.py --public-key-c"\n'
+             '#endif\n'
+             '\n') if Development else ''
+    return ('/**\n'
+            ' ******************************************************************************\n'
+            ' * @file           : bl_public_key.c\n'
+            ' * @author         : Ahmed Naeim\n'
+            ' * @brief          : Public key of the secure boot, written by\n'
+            ' *                   Tools/sign_image.py --public-key-c from {}\n'
+            ' ******************************************************************************\n'
+            '**/\n'
+            '\n'
+            '#include "Bootloader/bootloader.h"\n'
+            '\n'
+            '{}'
+            '/* P-256 point, X then Y, big endian. In the bootloader flash, outside every region the host may write */\n'
+            'const uint8_t BL_Signing_Public_Key[BL_ECDSA_PUBLIC_KEY_SIZE] = {{\n'
+            '\t{}\n'
+            '}};\n').format(Key_Name, Guard, ',\n\t'.join(Rows))
+
+def Self_Test():
+    ''' Returns the number of failures '''
+    Failures = 0
+    if Point_Multiply(RFC6979_PRIVATE_KEY, P256_G) != RFC6979_PUBLIC_KEY:
+        print("RFC 6979 public key: FAILED")
+        Failures += 1
+    for Message, R, S in RFC6979_VECTORS:
+        Digest = hashlib.sha256(Message).digest()
+        Signed = Sign_Digest(RFC6979_PRIVATE_KEY, Digest) == (R, S)
+        Checked = Verify_Digest(RFC6979_PUBLIC_KEY, Digest, R, S)
+        Refused = not Verify_Digest(RFC6979_PUBLIC_KEY, hashlib.sha256(Message + b'!').digest(), R, S)
+        print("RFC 6979 \"{}\": signature {}, check {}, changed message {}".format(
+              Message.decode(), "passed" if Signed else "FAILED", "passed" if Checked else "FAILED",
+              "refused" if Refused else "ACCEPTED"))
+        Failures += (not Signed) + (not Checked) + (not Refused)
+    return Failures
+
+def main():
+    Parser = argparse.ArgumentParser(description="ECDSA P-256 signing of application images for the bootloader secure boot")
+    Parser.add_argument("image", nargs='?', help="application image (.bin) to sign")
+    Parser.add_argument("--key", default=DEV_KEY_FILE, help="private key file (hex), the development key by default")
+    Parser.add_argument("--output", help="signed image, <image>_signed.bin by default")
+    Parser.add_argument("--check", help="signed image to check against the public key of --key")
+    Parser.add_argument("--generate-key", help="write a new private key to this file")
+    Parser.add_argument("--public-key-c", help="write the C source of the public key of --key to this file")
+    Parser.add_argument("--self-test", action="store_true", help="run the RFC 6979 vectors")
+    Args = Parser.parse_args()
+
+    if Args.self_test:
+        sys.exit(1 if Self_Test() else 0)
+    if Args.generate_key:
+        with open(Args.generate_key, 'w') as Key_File:
+            Key_File.write("# P-256 private key of the bootloader secure boot, Tools/sign_image.py\n")
+            Key_File.write("{:064X}\n".format(1 + secrets.randbelow(P256_N - 1)))
+        print("Private key written to {}".format(Args.generate_key))
+        return
+    Private_Key = Load_Private_Key(Args.key)
+    Public_Key = Point_Multiply(Private_Key, P256_G)
+    if Args.public_key_c:
+        with open(Args.public_key_c, 'w', newline='\r\n') as Source_File:
+            Source_File.write(Public_Key_C_Source(Public_Key, os.path.basename(Args.key),
+                                                  Private_Key == Load_Private_Key(DEV_KEY_FILE)))
+        print("Public key source written to {}".format(Args.public_key_c))
+    if Args.check:
+        with open(Args.check, 'rb') as Image_File:
+            Passed = Check_Image(Image_File.read(), Public_Key)
+        print("{}: signature {}".format(Args.check, "passed" if Passed else "FAILED"))
+        sys.exit(0 if Passed else 1)
+    if Args.image:
+        with open(Args.image, 'rb') as Image_File:
+            Signed = Sign_Image(Image_File.read(), Private_Key)
+        Output = Args.output or os.path.splitext(Args.image)[0] + "_signed.bin"
+        with open(Output, 'wb') as Image_File:
+            Image_File.write(Signed)
+        print("{}: {} bytes signed, {} bytes written to {}".format(Args.image, len(Signed) - BL_IMAGE_TRAILER_SIZE,
+              len(Signed), Output))
+    elif not Args.public_key_c:
+        Parser.print_help()
+
+if __name__ == "__main__":
+    main()
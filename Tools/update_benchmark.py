@@ -0,0 +1,294 @@
+''' End to end update benchmark of the bootloader protocol.
+
+    python update_benchmark.py                                   Simulated target, generated 20 KB image
+    python update_benchmark.py --image Application.bin --json results.json
+    python update_benchmark.py --port /dev/ttyUSB0 --image Application.bin
+    python update_benchmark.py --baseline main.json --max-regression 5
+    python update_benchmark.py --device xl                       XL density target (make -C Simulator DEVICE=xl)
+    python update_benchmark.py --padding 40 --dense              Image with 0xFF fill, every byte sent
+    python update_benchmark.py --reliable                        Every command in the reliable envelope
+
+Scenarios, run in this order:
+    cold         write the whole image into a blank flash
+    transaction  cold as one flash image transaction: manifest, data frames, commit with
+                 the image CRC checked by the bootloader; no host gap between the frames
+    incremental  the target holds the image, write only the pages of the update that differ
+    overwrite    cold, then the whole update over it with no reset or command between them;
+                 passes when the update reads back
+The bootloader erases a page the first time a write touches it unless it is
+blank, no scenario sends an erase command. Runs of 0xFF in the images go as
+skip records unless --dense.
+    verify       read back the update and compare, nothing is written
+    readback     read the whole application region
+    staging      XL density only: cold into bank 2, programmed while the next packet
+                 arrives; cold is the same transfer into bank 1
+    rewrite      XL density only: the image into bank 2, a FLASH_ERASE of its pages, then
+                 the update; passes when the update reads back
+
+Each scenario reports the image bytes per second of total time, the round trips,
+the per-command latency percentiles and the total time; --json writes them
+machine readable so results can be compared across commits. On the simulator
+(Simulator/Build/bl_sim, make -C Simulator) the times come from its timing
+model, so they do not depend on the speed of the PC. On real hardware (--port,
+needs pyserial) they are wall-clock times; the bootloader must be running and
+the target flash is overwritten.
+'''
+
+import os
+import sys
+import json
+import time
+import random
+import argparse
+import subprocess
+from bl_sim_link import *
+from update_time_predict import PROTOCOL_MODES
+
+BENCH_SCHEMA_VERSION = 1
+BENCH_SCENARIOS      = ("cold", "transaction", "incremental", "overwrite", "verify", "readback", "staging", "rewrite")
+''' Scenarios that need a second flash bank '''
+BENCH_DUAL_BANK_SCENARIOS = ("staging", "rewrite")
+
+class Serial_Target(BL_Link):
+    ''' Real board on a serial port, every command is timed on the wall clock '''
+
+    def __init__(self, Port_Name, Baud_Rate):
+        import serial
+        self.Serial_Port_Obj = serial.Serial(Port_Name, Baud_Rate, timeout = SIM_REPLY_TIMEOUT)
+        self.Latencies = []
+
+    def Send(self, Data):
+        self.Serial_Port_Obj.write(Data)
+
+    def Read(self, Data_Len):
+        return self.Serial_Port_Obj.read(Data_Len)
+
+    def Command(self, Command_Code, Details = b''):
+        Start = time.perf_counter()
+        Reply = BL_Link.Command(self, Command_Code, Details)
+        self.Latencies.append((Command_Code, int((time.perf_counter() - Start) * 1000000)))
+        return Reply
+
+    def Close(self):
+        self.Serial_Port_Obj.close()
+        return self.Latencies
+
+def Changed_Page_Runs(Old_Image, New_Image, Page_Size = CBL_FLASH_PAGE_SIZE):
+    ''' Yields (offset, length) of the runs of consecutive flash pages that differ '''
+    Run_Start = None
+    Image_Length = max(len(Old_Image), len(New_Image))
+    for Offset in range(0, Image_Length + Page_Size, Page_Size):
+        Changed = Offset < Image_Length and Old_Image[Offset : Offset + Page_Size] != New_Image[Offset : Offset + Page_Size]
+        if Changed and Run_Start is None:
+            Run_Start = Offset
+        elif not Changed and Run_Start is not None:
+            yield Run_Start, min(Offset, len(New_Image)) - Run_Start
+            Run_Start = None
+
+def Write_Image(Target, Address, Image, Payload_Len, Host_Gap_Ms, Min_Run):
+    ''' The host gap is added to the round trips afterwards, a board still has to be given the time '''
+    Passed = True
+    Posted = False
+    for Offset, Payload, Skip_Length in Sparse_Records(Image, Payload_Len, Min_Run):
+        if Payload is None:
+            Passed = Passed and Target.Skip(Address + Offset, Skip_Length)
+        else:
+            Passed = Passed and Target.Write(Address + Offset, Payload)
+            Posted = Posted or Target.Posted
+        if Passed and Host_Gap_Ms and isinstance(Target, Serial_Target):
+            time.sleep(Host_Gap_Ms / 1000.0)
+    if Passed and Posted:
+        ''' The last packet is still being programmed in bank 2 '''
+        Passed = Target.Flush(Address + Offset)
+    return Passed
+
+def Read_Image(Target, Address, Length):
+    Data = b''
+    for Offset in range(0, Length, CBL_MEM_READ_MAX_LENGTH):
+        Chunk = Target.Read_Memory(Address + Offset, min(CBL_MEM_READ_MAX_LENGTH, Length - Offset))
+        if Chunk is None:
+            return None
+        Data += Chunk
+    return Data
+
+def Run_Scenario(Name, Target, Base_Address, Old_Image, New_Image, Payload_Len, Host_Gap_Ms, Min_Run):
+    ''' Returns (passed, image bytes the scenario moves) '''
+    Passed = True
+    if Name in ("cold", "staging"):
+        if Name == "staging":
+            Base_Address = BL_FLASH_BANK_2_BASE
+        Passed = Write_Image(Target, Base_Address, Old_Image, Payload_Len, Host_Gap_Ms, Min_Run)
+        Length = len(Old_Image)
+    elif Name == "rewrite":
+        Passed = Write_Image(Target, BL_FLASH_BANK_2_BASE, Old_Image, Payload_Len, Host_Gap_Ms, Min_Run)
+        Passed = Passed and Target.Erase_Pages(BL_FLASH_BANK_2_BASE, len(Old_Image))
+        Passed = Passed and Write_Image(Target, BL_FLASH_BANK_2_BASE, New_Image, Payload_Len, Host_Gap_Ms, Min_Run)
+        Passed = Passed and Read_Image(Target, BL_FLASH_BANK_2_BASE, len(New_Image)) == New_Image
+        Length = len(Old_Image) + len(New_Image)
+    elif Name == "transaction":
+        Passed = Target.Flash_Image(Base_Address, Old_Image, 1, Payload_Len, Min_Run)
+        Length = len(Old_Image)
+    elif Name == "incremental":
+        Length = 0
+        for Offset, Run_Length in Changed_Page_Runs(Old_Image, New_Image, Target.Flash_Page_Size()):
+            Passed = Passed and Write_Image(Target, Base_Address + Offset, New_Image[Offset : Offset + Run_Length], Payload_Len, Host_Gap_Ms, Min_Run)
+            Length += Run_Length
+    elif Name == "overwrite":
+        ''' The second pass goes over pages the erase plan of the first one already holds '''
+        Passed = Write_Image(Target, Base_Address, Old_Image, Payload_Len, Host_Gap_Ms, Min_Run)
+        Passed = Passed and Write_Image(Target, Base_Address, New_Image, Payload_Len, Host_Gap_Ms, Min_Run)
+        Passed = Passed and Read_Image(Target, Base_Address, len(New_Image)) == New_Image
+        Length = len(Old_Image) + len(New_Image)
+    elif Name == "verify":
+        Passed = Read_Image(Target, Base_Address, len(New_Image)) == New_Image
+        Length = len(New_Image)
+    else:
+        Length = CBL_FLASH_BASE + CBL_FLASH_SIZE - Base_Address
+        Passed = Read_Image(Target, Base_Address, Length) is not None
+    return Passed, Length
+
+def Percentile(Values, Percent):
+    ''' Nearest rank percentile '''
+    Ordered = sorted(Values)
+    return Ordered[max(0, -(-len(Ordered) * Percent // 100) - 1)] if Ordered else 0
+
+def Latency_Summary(Values):
+    return {"p50": Percentile(Values, 50), "p95": Percentile(Values, 95), "p99": Percentile(Values, 99), "max": max(Values, default = 0)}
+
+def Scenario_Result(Passed, Image_Bytes, Latencies, Host_Gap_Ms):
+    ''' Latencies: [(command code, us)] of every round trip, the host gap follows every write '''
+    Round_Trip_Us = [Us + (int(Host_Gap_Ms * 1000) if Code == CBL_MEM_WRITE_CMD else 0) for Code, Us in Latencies]
+    Total_S = sum(Round_Trip_Us) / 1000000.0
+    Per_Command = {}
+    for (Code, _), Us in zip(Latencies, Round_Trip_Us):
+        Per_Command.setdefault("{:#04x}".format(Code), []).append(Us)
+    return {"passed": Passed,
+            "bytes": Image_Bytes,
+            "round_trips": len(Latencies),
+            "total_s": round(Total_S, 6),
+            "bytes_per_s": round(Image_Bytes / Total_S, 1) if Total_S else 0.0,
+            "latency_us": Latency_Summary(Round_Trip_Us),
+            "commands": {Code: dict(count = len(Values), **Latency_Summary(Values)) for Code, Values in sorted(Per_Command.items())}}
+
+def Git_Revision():
+    try:
+        return subprocess.check_output(["git", "-C", SIM_REPO_ROOT, "describe", "--always", "--dirty"],
+                                       universal_newlines = True, stderr = subprocess.DEVNULL).strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+def Check_Regression(Results, Baseline_File_Name, Max_Regression):
+    ''' Returns the scenarios whose total time grew by more than Max_Regression percent '''
+    with open(Baseline_File_Name, 'r') as Baseline_File:
+        Baseline = json.load(Baseline_File)
+    Regressions = []
+    for Name, Result in Results["scenarios"].items():
+        Before = Baseline.get("scenarios", {}).get(Name)
+        if Before and Before["total_s"] and Result["total_s"] > Before["total_s"] * (1 + Max_Regression / 100.0):
+            Regressions.append("{}: {:.3f} s -> {:.3f} s".format(Name, Before["total_s"], Result["total_s"]))
+    return Regressions
+
+def main():
+    Parser = argparse.ArgumentParser(description="End to end update benchmark of the bootloader")
+    Parser.add_argument("--image", help="application binary (default: generated)")
+    Parser.add_argument("--update", help="binary of the incremental update (default: the image with --changed-pages pages modified)")
+    Parser.add_argument("--size", type=int, default=20 * 1024, help="size of the generated image")
+    Parser.add_argument("--padding", type=int, default=0, help="percent of the generated image that is 0xFF fill, in the middle")
+    Parser.add_argument("--dense", action="store_true", help="send the 0xFF runs as packet bytes instead of skip records")
+    Parser.add_argument("--changed-pages", type=int, default=2, help="pages modified for the generated update")
+    Parser.add_argument("--scenario", action="append", choices=BENCH_SCENARIOS, help="scenario to run, repeatable (default: all)")
+    Parser.add_argument("--mode", choices=sorted(PROTOCOL_MODES), default="stream", help="protocol mode")
+    Parser.add_argument("--payload", type=int, help="write payload bytes per packet, overrides the mode")
+    Parser.add_argument("--timing", choices=("typical", "worst"), default="typical", help="simulated flash timings")
+    Parser.add_argument("--baud", type=int, default=115200, help="host UART baud rate")
+    Parser.add_argument("--device", choices=SIM_DEVICES, default="medium", help="simulated device, xl adds the staging scenario")
+    Parser.add_argument("--sim", help="bl_sim binary (default: the one built for --device)")
+    Parser.add_argument("--reliable", action="store_true", help="send every command in the reliable envelope (CRC32 checked reply frames)")
+    Parser.add_argument("--port", help="serial port of a real board instead of the simulator")
+    Parser.add_argument("--json", help="write the results to this file ('-' for stdout)")
+    Parser.add_argument("--baseline", help="results of a previous run to compare the total times with")
+    Parser.add_argument("--max-regression", type=float, default=5.0, help="allowed total time growth against the baseline, percent")
+    Args = Parser.parse_args()
+    if Args.sim is None:
+        Args.sim = Sim_Binary_For(Args.device)
+
+    Payload_Len, Host_Gap_Ms = PROTOCOL_MODES[Args.mode]
+    if Args.payload is not None:
+        Payload_Len = Args.payload
+    Base_Address = Get_App_Base_Address()
+    Region_Size = CBL_FLASH_BASE + CBL_FLASH_SIZE - Base_Address
+
+    Generator = random.Random(0x5A17)
+    if Args.image:
+        with open(Args.image, 'rb') as Image_File:
+            Old_Image = Image_File.read()
+    else:
+        Old_Image = bytes(Generator.getrandbits(8) for _ in range(min(Args.size, Region_Size)))
+        Fill_Length = len(Old_Image) * max(0, min(Args.padding, 100)) // 100
+        Fill_Start = (len(Old_Image) - Fill_Length) // 2
+        Old_Image = Old_Image[:Fill_Start] + b'\xff' * Fill_Length + Old_Image[Fill_Start + Fill_Length:]
+    if Args.update:
+        with open(Args.update, 'rb') as Update_File:
+            New_Image = Update_File.read()
+    else:
+        New_Image = bytearray(Old_Image)
+        Pages = (len(Old_Image) + CBL_FLASH_PAGE_SIZE - 1) // CBL_FLASH_PAGE_SIZE
+        for Page in Generator.sample(range(Pages), min(Args.changed_pages, Pages)):
+            Offset = Page * CBL_FLASH_PAGE_SIZE + Generator.randrange(min(CBL_FLASH_PAGE_SIZE, len(Old_Image) - Page * CBL_FLASH_PAGE_SIZE))
+            New_Image[Offset] ^= 0xFF
+        New_Image = bytes(New_Image)
+    if not 0 < len(Old_Image) <= Region_Size or not 0 < len(New_Image) <= Region_Size:
+        print("The images have to fit in the application region ({} bytes)".format(Region_Size))
+        sys.exit(1)
+
+    Results = {"schema": BENCH_SCHEMA_VERSION,
+               "revision": Git_Revision(),
+               "target": "serial" if Args.port else "sim",
+               "config": {"device": Args.device, "mode": Args.mode, "payload": Payload_Len, "host_gap_ms": Host_Gap_Ms, "baud": Args.baud,
+                          "timing": None if Args.port else Args.timing, "image_bytes": len(Old_Image),
+                          "update_bytes": len(New_Image), "sparse": not Args.dense, "reliable": Args.reliable},
+               "scenarios": {}}
+
+    Serial_Board = Serial_Target(Args.port, Args.baud) if Args.port else None
+    Scenarios = Args.scenario or [Name for Name in BENCH_SCENARIOS if Args.device == "xl" or Name not in BENCH_DUAL_BANK_SCENARIOS]
+    for Name in [Name for Name in BENCH_SCENARIOS if Name in Scenarios]:
+        if Serial_Board:
+            ''' The board keeps its flash from one scenario to the next, like the simulated targets are preloaded '''
+            Target = Serial_Board
+            Target.Latencies = []
+        else:
+            Preload = {"cold": None, "transaction": None, "incremental": Old_Image, "overwrite": None}.get(Name, New_Image)
+            Target = Sim_Target(Args.sim, Args.timing, Args.baud, Image = Preload, Exit_On_Jump = False, Trace = True,
+                                Device = Args.device)
+        Target.Reliable = Args.reliable
+        Passed, Image_Bytes = Run_Scenario(Name, Target, Base_Address, Old_Image, New_Image, Payload_Len, Host_Gap_Ms,
+                                           0 if Args.dense else CBL_MEM_WRITE_SKIP_MIN_RUN)
+        Latencies = list(Target.Latencies) if Serial_Board else Target.Close()[1]
+        Results["scenarios"][Name] = Scenario_Result(Passed, Image_Bytes, Latencies, Host_Gap_Ms)
+    if Serial_Board:
+        Serial_Board.Close()
+
+    print("{:<12}{:>6}{:>10}{:>8}{:>12}{:>12}{:>10}{:>10}{:>10}".format(
+          "Scenario", "Pass", "Bytes", "Trips", "Total s", "Bytes/s", "p50 us", "p95 us", "p99 us"))
+    for Name, Result in Results["scenarios"].items():
+        print("{:<12}{:>6}{:>10}{:>8}{:>12.3f}{:>12.1f}{:>10}{:>10}{:>10}".format(
+              Name, "yes" if Result["passed"] else "NO", Result["bytes"], Result["round_trips"], Result["total_s"],
+              Result["bytes_per_s"], Result["latency_us"]["p50"], Result["latency_us"]["p95"], Result["latency_us"]["p99"]))
+
+    if Args.json == '-':
+        print(json.dumps(Results, indent = 2))
+    elif Args.json:
+        with open(Args.json, 'w') as Json_File:
+            json.dump(Results, Json_File, indent = 2)
+
+    Exit_Code = 0 if all(Result["passed"] for Result in Results["scenarios"].values()) else 1
+    if Args.baseline:
+        Regressions = Check_Regression(Results, Args.baseline, Args.max_regression)
+        for Regression in Regressions:
+            print("Regression " + Regression)
+        if Regressions:
+            Exit_Code = 1
+    sys.exit(Exit_Code)
+
+if __name__ == "__main__":
+    main()
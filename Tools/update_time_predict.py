@@ -0,0 +1,107 @@
+''' Predicted wall-clock time of a bootloader update, from the bl_sim timing model.
+
+    python update_time_predict.py Application.bin
+    python update_time_predict.py --preloaded Previous.bin Application.bin
+    python update_time_predict.py --blank --mode stream --timing worst --baud 460800 Application.bin
+
+Flashes the image into a simulated target the way Host.py does (memory write
+packets and skip records for the runs of 0xFF, jump to the application base)
+and prints the time of every phase. The target starts with an application at
+its base: --preloaded names it, by default it is the image itself, --blank
+starts from an erased flash (first flash of a part). The bootloader erases the
+pages that are not blank at their first write, their time is in the erase
+column of the write phase. The target side (UART bit time at the baud rate,
+flash program and erase times of the datasheet) is charged by the simulator,
+the host side gap after every write reply comes from the protocol mode.
+Build the simulator first: make -C Simulator
+'''
+
+import sys
+import argparse
+from bl_sim_link import *
+
+''' Protocol modes: write payload bytes per packet and host gap after every write reply (ms) '''
+PROTOCOL_MODES = {
+    "host"   : (128, 100.0),                        # Host.py as is: sleep(0.1) after every reply
+    "stream" : (128, 0.0),                          # Next packet as soon as the reply is in
+    "max"    : (CBL_MEM_WRITE_MAX_PAYLOAD, 0.0)     # Largest packet the frame length allows
+}
+
+''' Phases of an update and the command that carries each one '''
+UPDATE_PHASES = (("write", CBL_MEM_WRITE_CMD), ("jump", CBL_GO_TO_ADDR_CMD))
+
+def Run_Update(Image, Payload_Len, Sim_Binary, Timing, Baud_Rate, Preloaded_Image = None):
+    ''' Returns the simulator time report, raises RuntimeError when a command fails.
+        Preloaded_Image is the application the flash holds before the update, None for an erased flash '''
+    Base_Address = Get_App_Base_Address()
+    Target = Sim_Target(Sim_Binary, Timing, Baud_Rate, Image = Preloaded_Image)
+    Failure = None
+    for Offset, Payload, Skip_Length in Sparse_Records(Image, Payload_Len):
+        if Failure is None and Payload is None and not Target.Skip(Base_Address + Offset, Skip_Length):
+            Failure = "skip record at {:#010x}".format(Base_Address + Offset)
+        elif Failure is None and Payload is not None and not Target.Write(Base_Address + Offset, Payload):
+            Failure = "write at {:#010x}".format(Base_Address + Offset)
+    if Failure is None and not Target.Jump(Base_Address):
+        Failure = "jump"
+    Report = Target.Close()[0]
+    if Failure is not None:
+        raise RuntimeError("Simulated update failed: " + Failure)
+    return Report
+
+def Print_Prediction(Report, Host_Gap_Ms):
+    print("{:<8}{:>10}{:>12}{:>12}{:>12}{:>12}{:>12}".format("Phase", "Commands", "UART ms", "Program ms", "Erase ms", "Host ms", "Total ms"))
+    Totals = [0, 0.0, 0.0, 0.0, 0.0, 0.0]
+    for Phase_Name, Command_Code in UPDATE_PHASES:
+        Costs = Report.get(Command_Code, {"count": 0})
+        Uart_Ms = (Costs.get("uart_rx", 0) + Costs.get("uart_tx", 0)) / 1000.0
+        Program_Ms = Costs.get("program", 0) / 1000.0
+        Erase_Ms = Costs.get("erase", 0) / 1000.0
+        Host_Ms = Costs["count"] * Host_Gap_Ms if Command_Code == CBL_MEM_WRITE_CMD else 0.0
+        Row = [Costs["count"], Uart_Ms, Program_Ms, Erase_Ms, Host_Ms, Uart_Ms + Program_Ms + Erase_Ms + Host_Ms]
+        Totals = [Total + Value for Total, Value in zip(Totals, Row)]
+        print("{:<8}{:>10}{:>12.1f}{:>12.1f}{:>12.1f}{:>12.1f}{:>12.1f}".format(Phase_Name, *Row))
+    print("{:<8}{:>10}{:>12.1f}{:>12.1f}{:>12.1f}{:>12.1f}{:>12.1f}".format("total", *Totals))
+
+def main():
+    Parser = argparse.ArgumentParser(description="Predicted update time from the bl_sim timing model")
+    Parser.add_argument("image", help="application binary, written at BL_APP_BASE")
+    Parser.add_argument("--mode", choices=sorted(PROTOCOL_MODES), default="host", help="protocol mode")
+    Parser.add_argument("--payload", type=int, help="write payload bytes per packet, overrides the mode")
+    Parser.add_argument("--gap-ms", type=float, help="host gap after every write reply, overrides the mode")
+    Parser.add_argument("--timing", choices=("typical", "worst"), default="typical", help="flash timings of the datasheet")
+    Parser.add_argument("--baud", type=int, default=115200, help="host UART baud rate")
+    Parser.add_argument("--sim", default=SIM_DEFAULT_BINARY, help="bl_sim binary")
+    Preload_Group = Parser.add_mutually_exclusive_group()
+    Preload_Group.add_argument("--preloaded", metavar="IMAGE", help="application the target holds before the update (default: the image)")
+    Preload_Group.add_argument("--blank", action="store_true", help="the target flash is erased before the update")
+    Args = Parser.parse_args()
+
+    Payload_Len, Host_Gap_Ms = PROTOCOL_MODES[Args.mode]
+    if Args.payload is not None:
+        Payload_Len = Args.payload
+    if Args.gap_ms is not None:
+        Host_Gap_Ms = Args.gap_ms
+    if not 0 < Payload_Len <= CBL_MEM_WRITE_MAX_PAYLOAD:
+        print("The write payload is 1 to {} bytes".format(CBL_MEM_WRITE_MAX_PAYLOAD))
+        sys.exit(1)
+
+    with open(Args.image, 'rb') as Image_File:
+        Image = Image_File.read()
+    Preloaded_Image = Image
+    if Args.blank:
+        Preloaded_Image = None
+    elif Args.preloaded:
+        with open(Args.preloaded, 'rb') as Preloaded_File:
+            Preloaded_Image = Preloaded_File.read()
+    try:
+        Report = Run_Update(Image, Payload_Len, Args.sim, Args.timing, Args.baud, Preloaded_Image)
+    except (OSError, RuntimeError) as Error:
+        print(Error)
+        sys.exit(1)
+    print("{} bytes, {} byte packets, {} ms host gap, {} baud, {} flash timings, {}\n".format(
+          len(Image), Payload_Len, Host_Gap_Ms, Args.baud, Args.timing,
+          "blank flash" if Preloaded_Image is None else "{} byte application preloaded".format(len(Preloaded_Image))))
+    Print_Prediction(Report, Host_Gap_Ms)
+
+if __name__ == "__main__":
+    main()